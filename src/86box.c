@@ -63,6 +63,7 @@
 #include <86box/device.h>
 #include <86box/pit.h>
 #include <86box/random.h>
+#include <86box/snapshot.h>
 #include <86box/nvr.h>
 #include <86box/machine.h>
 #include <86box/bugger.h>
@@ -97,9 +98,13 @@
 #include <86box/thread.h>
 #include <86box/network.h>
 #include <86box/sound.h>
+#include <86box/sound_capture.h>
+#include <86box/snd_opl.h>
 #include <86box/midi.h>
 #include <86box/snd_speaker.h>
 #include <86box/video.h>
+#include <86box/vid_svga.h>
+#include <86box/vid_svga_render.h>
 #include <86box/ui.h>
 #include <86box/path.h>
 #include <86box/plat.h>
@@ -189,6 +194,7 @@ int      isarom_type[ISAROM_MAX]                = { 0, 0, 0, 0 }; /* (C) enable
 int      isartc_type                            = 0;              /* (C) enable ISA RTC card */
 int      gfxcard[GFXCARD_MAX]                   = { 0, 0 };       /* (C) graphics/video card */
 int      show_second_monitors                   = 1;              /* (C) show non-primary monitors */
+int      vid_render_thread                      = 0;              /* (C) render SVGA lines on their own thread */
 int      sound_is_float                         = 1;              /* (C) sound uses FP values */
 int      voodoo_enabled                         = 0;              /* (C) video option */
 int      ibm8514_standalone_enabled             = 0;              /* (C) video option */
@@ -208,6 +214,7 @@ int      confirm_save                           = 1;              /* (G) enable
 int      enable_discord                         = 0;              /* (C) enable Discord integration */
 int      pit_mode                               = -1;             /* (C) force setting PIT mode */
 int      fm_driver                              = 0;              /* (C) select FM sound driver */
+int      fm_thread                              = 0;              /* (C) render FM on its own thread */
 int      open_dir_usr_path                      = 0;              /* (G) default file open dialog directory
                                                                          of usr_path */
 int      video_fullscreen_scale_maximized       = 0;              /* (C) Whether fullscreen scaling settings
@@ -352,6 +359,20 @@ int title_update;
 int framecountx        = 0;
 int hard_reset_pending = 0;
 
+char       snapshot_path[1024]   = { '\0' }; /* (O) machine snapshot file */
+int        snapshot_interval     = 0;        /* (O) seconds of guest time between checkpoints */
+static int snapshot_save_pending = 0;
+static int snapshot_load_pending = 0;
+static int snapshot_ms           = 0;
+
+char jit_cache_path[1024] = { '\0' }; /* (O) dynarec block profile file */
+
+int          batch_mode      = 0; /* (O) headless, unthrottled batch run */
+uint32_t     batch_time      = 0; /* (O) guest seconds to run for, 0 = no limit */
+uint16_t     batch_exit_port = 0; /* (O) I/O port whose writes end the batch run */
+int          batch_exit_code = 0; /* exit code of the batch run */
+volatile int batch_stop      = 0; /* the guest asked to end the batch run */
+
 #if 0
 int unscaled_size_x = SCREEN_RES_X; /* current unscaled size X */
 int unscaled_size_y = SCREEN_RES_Y; /* current unscaled size Y */
@@ -718,17 +739,39 @@ pc_show_usage(void)
 #endif
 #endif
             "-I or --image d:path\t\t- load 'path' as floppy image on drive d\n"
+#ifdef USE_NEW_DYNAREC
+            "--jitcache path\t\t- keep a profile of compiled code blocks in 'path',\n"
+            "\t\t\t\t   to compile them on first use in the next session\n"
+#endif
+            "-K or --checkpoint secs\t\t- write an incremental snapshot every 'secs'\n"
+            "\t\t\t\t   seconds of emulated time\n"
 #ifdef USE_INSTRUMENT
             "-J or --instrument name\t- set 'name' to be the profiling instrument\n"
 #endif
             "-L or --logfile path\t\t- set 'path' to be the logfile\n"
             "-M or --missing\t\t- dump missing machines and video cards\n"
             "-N or --noconfirm\t\t- do not ask for confirmation on quit\n"
+            "--oplbench file\t\t- time the OPL3 cores on a VGM or DRO log and exit\n"
+            "--overlay op,file[,base]\t- manage an overlay hard disk image and exit:\n"
+            "\t\t\t\t   create (over 'base'), commit or discard\n"
             "-P or --vmpath path\t\t- set 'path' to be root for vm\n"
             "-O or --global path\t\t- set 'path' to be global config file\n"
+            "-Q or --snapshot path\t\t- set 'path' to be the machine snapshot file,\n"
+            "\t\t\t\t   restored on startup if it exists\n"
             "-R or --rompath path\t\t- set 'path' to be ROM path\n"
 #ifndef USE_SDL_UI
             "-S or --settings\t\t\t- show only the settings dialog\n"
+#endif
+            "--svgabench\t\t\t- time the SVGA line converters and exit\n"
+            "--tlbbench\t\t\t- time the soft TLB at every size and exit\n"
+            "--timerbench file\t\t- replay a timer trace on the timer queue and exit\n"
+            "--timertrace file\t\t- record the timer activity of the run to 'file'\n"
+            "--vhdbench dir\t\t- time VHD reads on images created in 'dir' and exit\n"
+#ifdef USE_SDL_UI
+            "-B or --batch secs\t\t- headless batch run for 'secs' seconds of\n"
+            "\t\t\t\t   emulated time, as fast as possible (0 = no limit)\n"
+            "-U or --exitport port\t\t- end the batch run on a write to I/O 'port'\n"
+            "\t\t\t\t   (hex), the value written is the exit code\n"
 #endif
 #ifdef SHOW_EXTRA_PARAMS
             "-T or --testmode\t\t- test mode: execute the test mode entry\n"
@@ -740,6 +783,8 @@ pc_show_usage(void)
 #else
             "-W or --nohook\t\t- alters keyboard behavior\n"
 #endif
+            "--wavcap path\t\t- capture the sound output to the WAV file 'path'\n"
+            "--wavcap-split\t\t- also capture each sound device to its own file\n"
             "-X or --clear what\t\t- clears the 'what' (cmos/flash/both)\n"
 #ifdef SHOW_EXTRA_PARAMS
             "-Y or --donothing\t\t- do not show any UI or run the emulation\n"
@@ -754,6 +799,46 @@ pc_show_usage(void)
 #endif
 }
 
+/* Run an --overlay command. Returns 0, so that the emulator exits. */
+static int
+pc_overlay_tool(const char *arg)
+{
+    char  op[16] = { 0 };
+    char *fn     = NULL;
+    char *base   = NULL;
+    char *args   = strdup(arg);
+    char *comma  = strchr(args, ',');
+    int   ret    = -1;
+
+    if (comma != NULL) {
+        *comma = '\0';
+        strncpy(op, args, sizeof(op) - 1);
+        fn    = comma + 1;
+        comma = strchr(fn, ',');
+        if (comma != NULL) {
+            *comma = '\0';
+            base   = comma + 1;
+        }
+    }
+
+    if (fn == NULL)
+        always_log("--overlay: expected op,file[,base]\n");
+    else if (!strcasecmp(op, "create") && (base != NULL))
+        ret = hdd_image_overlay_create(fn, base);
+    else if (!strcasecmp(op, "commit"))
+        ret = hdd_image_overlay_commit(fn);
+    else if (!strcasecmp(op, "discard"))
+        ret = hdd_image_overlay_discard(fn);
+    else
+        always_log("--overlay: unknown operation '%s'\n", op);
+
+    if (fn != NULL)
+        always_log("--overlay: %s %s %s\n", op, fn, (ret < 0) ? "failed" : "done");
+    free(args);
+
+    return 0;
+}
+
 /*
  * Perform initial startup of the PC.
  *
@@ -768,6 +853,9 @@ pc_init(int argc, char *argv[])
     char            *rpath = NULL;
     char            *apath = NULL;
     char            *cfg = NULL;
+    char            *snp = NULL;
+    char            *jcp = NULL;
+    char            *wcp = NULL;
     char            *global = NULL;
     char            *p;
     char             temp[2048];
@@ -935,6 +1023,74 @@ usage:
                 goto usage;
 
             strcpy(vm_name, argv[++c]);
+        } else if (!strcasecmp(argv[c], "--snapshot") || !strcasecmp(argv[c], "-Q")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            snp = argv[++c];
+        } else if (!strcasecmp(argv[c], "--wavcap")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            wcp = argv[++c];
+        } else if (!strcasecmp(argv[c], "--wavcap-split")) {
+            sound_capture_split = 1;
+#ifdef USE_NEW_DYNAREC
+        } else if (!strcasecmp(argv[c], "--jitcache")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            jcp = argv[++c];
+#endif
+#ifdef USE_SDL_UI
+        } else if (!strcasecmp(argv[c], "--batch") || !strcasecmp(argv[c], "-B")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            batch_mode = 1;
+            batch_time = strtoul(argv[++c], NULL, 10);
+        } else if (!strcasecmp(argv[c], "--exitport") || !strcasecmp(argv[c], "-U")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            batch_exit_port = (uint16_t) strtoul(argv[++c], NULL, 16);
+#endif
+        } else if (!strcasecmp(argv[c], "--oplbench")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            return opl_bench(argv[++c]);
+        } else if (!strcasecmp(argv[c], "--svgabench")) {
+            return svga_render_bench();
+        } else if (!strcasecmp(argv[c], "--tlbbench")) {
+            return mem_tlb_bench();
+        } else if (!strcasecmp(argv[c], "--timerbench")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            return timer_bench(argv[++c]);
+        } else if (!strcasecmp(argv[c], "--timertrace")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            timer_trace_open(argv[++c]);
+        } else if (!strcasecmp(argv[c], "--vhdbench")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            return vhd_bench(argv[++c]);
+        } else if (!strcasecmp(argv[c], "--overlay")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            return pc_overlay_tool(argv[++c]);
+        } else if (!strcasecmp(argv[c], "--checkpoint") || !strcasecmp(argv[c], "-K")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            snapshot_interval = atoi(argv[++c]);
+            if (snapshot_interval <= 0)
+                goto usage;
 #ifndef USE_SDL_UI
         } else if (!strcasecmp(argv[c], "--settings") || !strcasecmp(argv[c], "-S")) {
             settings_only = 1;
@@ -1189,6 +1345,35 @@ usage:
     /* At this point, we can safely create the full path name. */
     path_append_filename(cfg_path, usr_path, p);
 
+    /* A relative snapshot path is relative to the VM directory. */
+    if (snp != NULL) {
+        if (path_abs(snp))
+            strcpy(snapshot_path, snp);
+        else
+            path_append_filename(snapshot_path, usr_path, snp);
+
+        if (plat_file_check(snapshot_path))
+            snapshot_load_pending = 1;
+    }
+
+    /* Same for the dynarec block profile. */
+    if (jcp != NULL) {
+        if (path_abs(jcp))
+            strcpy(jit_cache_path, jcp);
+        else
+            path_append_filename(jit_cache_path, usr_path, jcp);
+    }
+
+    /* And for the sound capture. */
+    if (wcp != NULL) {
+        if (path_abs(wcp))
+            strcpy(sound_capture_path, wcp);
+        else
+            path_append_filename(sound_capture_path, usr_path, wcp);
+        sound_capture_enabled = 1;
+    } else
+        sound_capture_split = 0;
+
     /* Build the global configuration file path. */
     if (global == NULL) {
         plat_get_global_config_dir(global_cfg_path, sizeof(global_cfg_path));
@@ -1498,6 +1683,10 @@ pc_init_modules(void)
         pthread_jit_write_protect_np(1);
     }
 #    endif
+#    ifdef USE_NEW_DYNAREC
+    if (jit_cache_path[0] != '\0')
+        codegen_cache_load(jit_cache_path);
+#    endif
 #endif
 
     keyboard_init();
@@ -1691,6 +1880,20 @@ pc_reset_hard_close(void)
     lpt_set_next_inst(0);
 }
 
+/* End a batch run, the platform code reports and exits with the code. */
+void
+pc_batch_stop(int code)
+{
+    batch_exit_code = code;
+    batch_stop      = 1;
+}
+
+static void
+pc_batch_port_write(UNUSED(uint16_t port), uint8_t val, UNUSED(void *priv))
+{
+    pc_batch_stop(val);
+}
+
 /*
  * This is basically the spot where we start up the actual machine,
  * by issuing a 'hard reset' to the entire configuration. Order is
@@ -1829,6 +2032,8 @@ pc_reset_hard_init(void)
         device_add(&postcard_device);
     if (unittester_enabled)
         device_add(&unittester_device);
+    if (batch_mode && batch_exit_port)
+        io_sethandler(batch_exit_port, 1, NULL, NULL, NULL, pc_batch_port_write, NULL, NULL, NULL);
 
     if (novell_keycard_enabled)
         device_add(&novell_keycard_device);
@@ -1946,6 +2151,10 @@ pc_close(UNUSED(thread_t *ptr))
 
     nvr_save();
 
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    codegen_cache_save();
+#endif
+
     plat_mouse_capture(0);
 
     /* Close all the memory mappings. */
@@ -1953,6 +2162,7 @@ pc_close(UNUSED(thread_t *ptr))
 
     /* Turn off timer processing to avoid potential segmentation faults. */
     timer_close();
+    timer_trace_close();
 
     lpt_devices_close();
 
@@ -1978,6 +2188,8 @@ pc_close(UNUSED(thread_t *ptr))
 
     sound_cd_thread_end();
 
+    sound_capture_close();
+
     cdrom_close();
 
     rdisk_close();
@@ -2010,6 +2222,42 @@ ack_pause(void)
     }
 }
 
+/* Request a snapshot of the machine, taken between two emulation blocks. */
+void
+pc_snapshot_save(void)
+{
+    snapshot_save_pending = 1;
+}
+
+void
+pc_snapshot_load(void)
+{
+    snapshot_load_pending = 1;
+}
+
+static void
+pc_snapshot_process(void)
+{
+    if (!snapshot_save_pending && !snapshot_load_pending)
+        return;
+
+    if (snapshot_path[0] == '\0')
+        path_append_filename(snapshot_path, usr_path, SNAPSHOT_FILE);
+
+    if (snapshot_load_pending) {
+        snapshot_load_pending = 0;
+        snapshot_load_chain(snapshot_path);
+    }
+
+    if (snapshot_save_pending) {
+        snapshot_save_pending = 0;
+        if (snapshot_interval)
+            snapshot_checkpoint(snapshot_path);
+        else
+            snapshot_save(snapshot_path);
+    }
+}
+
 void
 pc_run(void)
 {
@@ -2023,6 +2271,16 @@ pc_run(void)
         pc_reset_hard_init();
     }
 
+    /* Take or restore a snapshot if one is pending. */
+    if (snapshot_interval) {
+        snapshot_ms += force_10ms ? 10 : 1;
+        if (snapshot_ms >= (snapshot_interval * 1000)) {
+            snapshot_ms           = 0;
+            snapshot_save_pending = 1;
+        }
+    }
+    pc_snapshot_process();
+
     /* Update the guest-CPU independent timer for devices with independent clock speed */
     rivatimer_update_all();
 
@@ -2083,6 +2341,9 @@ pc_onesec(void)
     fps        = framecount;
     framecount = 0;
 
+    hdd_image_onesec();
+    mmu_tlb_onesec();
+
     title_update = 1;
 }
 
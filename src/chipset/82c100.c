@@ -321,8 +321,10 @@ mem_write_emsb(uint32_t addr, uint8_t val, void *priv)
 
     addr = addr - page->virt + page->phys;
 
-    if (addr < (mem_size << 10))
+    if (addr < (mem_size << 10)) {
+        mem_snap_mark(addr);
         ram[addr] = val;
+    }
 
     ct_82c100_log("mem_write_emsb(%08X = %08X, %02X)\n", old_addr, addr, val);
 }
@@ -337,8 +339,10 @@ mem_write_emsw(uint32_t addr, uint16_t val, void *priv)
 
     addr = addr - page->virt + page->phys;
 
-    if (addr < (mem_size << 10))
+    if (addr < (mem_size << 10)) {
+        mem_snap_mark_range(addr, 2);
         *(uint16_t *) &ram[addr] = val;
+    }
 
     ct_82c100_log("mem_write_emsw(%08X = %08X, %04X)\n", old_addr, addr, val);
 }
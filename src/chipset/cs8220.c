@@ -80,8 +80,10 @@ cs8220_mem_write(uint32_t addr, uint8_t val, void *priv)
 
     addr = (addr - dev->virt) + dev->phys;
 
-    if (addr < (mem_size << 10))
+    if (addr < (mem_size << 10)) {
+        mem_snap_mark(addr);
         ram[addr] = val;
+    }
 }
 
 static void
@@ -91,8 +93,10 @@ cs8220_mem_writew(uint32_t addr, uint16_t val, void *priv)
 
     addr = (addr - dev->virt) + dev->phys;
 
-    if (addr < (mem_size << 10))
+    if (addr < (mem_size << 10)) {
+        mem_snap_mark_range(addr, 2);
         *(uint16_t *) &(ram[addr]) = val;
+    }
 }
 
 static uint8_t
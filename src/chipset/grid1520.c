@@ -101,8 +101,10 @@ static void grid_ems_mem_write8(uint32_t addr, uint8_t val, void *priv) {
 
     addr = get_grid_ems_paddr(dev, addr);
 
-    if (addr < (mem_size << 10))
-        ram[addr] = val;                
+    if (addr < (mem_size << 10)) {
+        mem_snap_mark(addr);
+        ram[addr] = val;
+    }
 }
 
 static uint8_t grid_ems_mem_read8(uint32_t addr, void *priv) {
@@ -122,8 +124,10 @@ static void grid_ems_mem_write16(uint32_t addr, uint16_t val, void *priv) {
 
     addr = get_grid_ems_paddr(dev, addr);
 
-    if (addr < (mem_size << 10))
-        *(uint16_t *)&(ram[addr]) = val;                
+    if (addr < (mem_size << 10)) {
+        mem_snap_mark_range(addr, 2);
+        *(uint16_t *)&(ram[addr]) = val;
+    }
 }
 
 static uint16_t grid_ems_mem_read16(uint32_t addr, void *priv) {
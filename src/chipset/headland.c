@@ -596,8 +596,10 @@ mem_write_b(uint32_t addr, uint8_t val, void *priv)
     headland_t    *dev = mr->headland;
 
     addr = get_addr(dev, addr, mr);
-    if (addr < (mem_size << 10))
+    if (addr < (mem_size << 10)) {
+        mem_snap_mark(addr);
         ram[addr] = val;
+    }
 }
 
 static void
@@ -607,8 +609,10 @@ mem_write_w(uint32_t addr, uint16_t val, void *priv)
     headland_t    *dev = mr->headland;
 
     addr = get_addr(dev, addr, mr);
-    if (addr < (mem_size << 10))
+    if (addr < (mem_size << 10)) {
+        mem_snap_mark_range(addr, 2);
         *(uint16_t *) &ram[addr] = val;
+    }
 }
 
 static void
@@ -618,8 +622,10 @@ mem_write_l(uint32_t addr, uint32_t val, void *priv)
     headland_t    *dev = mr->headland;
 
     addr = get_addr(dev, addr, mr);
-    if (addr < (mem_size << 10))
+    if (addr < (mem_size << 10)) {
+        mem_snap_mark_range(addr, 4);
         *(uint32_t *) &ram[addr] = val;
+    }
 }
 
 static void
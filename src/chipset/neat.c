@@ -315,8 +315,10 @@ neat_write_ram(uint32_t addr, uint8_t val, void *priv)
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramb_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
+        mem_snap_mark(addr);
         ram[addr] = val;
+    }
 }
 
 static void
@@ -330,8 +332,10 @@ neat_write_ramw(uint32_t addr, uint16_t val, void *priv)
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramw_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
+        mem_snap_mark_range(addr, 2);
         *(uint16_t *) &ram[addr] = val;
+    }
 }
 
 /* Read one byte from paged RAM. */
@@ -393,8 +397,10 @@ ems_writeb(uint32_t addr, uint8_t val, void *priv)
     neat_log("[W08] %08X -> %08X (%08X): val = %02X\n", old, addr, (mem_size << 10), val);
 #endif
 
-    if (addr < (mem_size << 10))
+    if (addr < (mem_size << 10)) {
+        mem_snap_mark(addr);
         *(uint8_t *) &(ram[addr]) = val;
+    }
 }
 
 /* Write one word to paged RAM. */
@@ -412,8 +418,10 @@ ems_writew(uint32_t addr, uint16_t val, void *priv)
     neat_log("[W16] %08X -> %08X (%08X): val = %04X\n", old, addr, (mem_size << 10), val);
 #endif
 
-    if (addr < (mem_size << 10))
+    if (addr < (mem_size << 10)) {
+        mem_snap_mark_range(addr, 2);
         *(uint16_t *) &(ram[addr]) = val;
+    }
 }
 
 static void
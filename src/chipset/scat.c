@@ -1343,8 +1343,10 @@ mem_write_scatb(uint32_t addr, uint8_t val, void *priv)
             return;
     }
 
-    if (addr < ((uint32_t) mem_size << 10))
+    if (addr < ((uint32_t) mem_size << 10)) {
+        mem_snap_mark(addr);
         ram[addr] = val;
+    }
 }
 
 static void
@@ -1362,8 +1364,10 @@ mem_write_scatw(uint32_t addr, uint16_t val, void *priv)
             return;
     }
 
-    if (addr < ((uint32_t) mem_size << 10))
+    if (addr < ((uint32_t) mem_size << 10)) {
+        mem_snap_mark_range(addr, 2);
         *(uint16_t *) &ram[addr] = val;
+    }
 }
 
 static void
@@ -1381,8 +1385,10 @@ mem_write_scatl(uint32_t addr, uint32_t val, void *priv)
             return;
     }
 
-    if (addr < ((uint32_t) mem_size << 10))
+    if (addr < ((uint32_t) mem_size << 10)) {
+        mem_snap_mark_range(addr, 4);
         *(uint32_t *) &ram[addr] = val;
+    }
 }
 
 static void
@@ -372,8 +372,10 @@ sis_85c471_write_ram(uint32_t addr, uint8_t val, void *priv)
 
     addr = (rel + dev->phys_base);
 
-    if ((addr < (mem_size << 10)) && (rel < dev->phys_size))
+    if ((addr < (mem_size << 10)) && (rel < dev->phys_size)) {
+        mem_snap_mark(addr);
         ram[addr] = val;
+    }
 }
 
 static void
@@ -389,8 +391,10 @@ sis_85c471_write_ramw(uint32_t addr, uint16_t val, void *priv)
 
     addr = (rel + dev->phys_base);
 
-    if ((addr < (mem_size << 10)) && (rel < dev->phys_size))
+    if ((addr < (mem_size << 10)) && (rel < dev->phys_size)) {
+        mem_snap_mark_range(addr, 2);
         *(uint16_t *) &(ram[addr]) = val;
+    }
 }
 
 static void
@@ -406,8 +410,10 @@ sis_85c471_write_raml(uint32_t addr, uint32_t val, void *priv)
 
     addr = (rel + dev->phys_base);
 
-    if ((addr < (mem_size << 10)) && (rel < dev->phys_size))
+    if ((addr < (mem_size << 10)) && (rel < dev->phys_size)) {
+        mem_snap_mark_range(addr, 4);
         *(uint32_t *) &(ram[addr]) = val;
+    }
 }
 
 static void
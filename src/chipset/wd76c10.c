@@ -547,8 +547,10 @@ wd76c10_write_ram(uint32_t addr, uint8_t val, void *priv)
     if (addr != WD76C10_ADDR_INVALID) {
         if (dev->fast)
             mem_write_ram(addr, val, priv);
-        else
+        else {
+            mem_snap_mark(addr);
             ram[addr] = val;
+        }
     }
 }
 
@@ -562,8 +564,10 @@ wd76c10_write_ramw(uint32_t addr, uint16_t val, void *priv)
     if (addr != WD76C10_ADDR_INVALID) {
         if (dev->fast)
             mem_write_ramw(addr, val, priv);
-        else
+        else {
+            mem_snap_mark_range(addr, 2);
             *(uint16_t *) &(ram[addr]) = val;
+        }
     }
 }
 
@@ -314,6 +314,9 @@ extern int codegen_purge_purgable_list(void);
   will only be called when the allocator is out of memory*/
 extern void codegen_delete_random_block(int required_mem_block);
 
+extern void codegen_cache_add(codeblock_t *block);
+extern int  codegen_cache_prime(uint32_t phys_addr);
+
 extern int      cpu_block_end;
 extern uint32_t codegen_endpc;
 
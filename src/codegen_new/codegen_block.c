@@ -778,6 +778,7 @@ codegen_block_end_recompile(codeblock_t *block)
     block->next_2 = block->prev_2 = BLOCK_INVALID;
     codegen_block_generate_end_mask_recompile();
     add_to_block_list(block);
+    codegen_cache_add(block);
 
     if (!(block->flags & CODEBLOCK_HAS_FPU))
         block->flags &= ~CODEBLOCK_STATIC_TOP;
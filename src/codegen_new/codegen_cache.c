@@ -0,0 +1,344 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+#include <86box/plat.h>
+
+#include "codegen.h"
+
+/*Persistent block profile.
+
+  Compiled blocks can not be kept across sessions as is: both the host code
+  and the IR embed absolute host addresses (cpu_state, ram, helper functions)
+  which change from one run to the next. What is kept instead is the list of
+  blocks that were hot enough to be compiled, along with a hash of the guest
+  code they were compiled from.
+
+  On the next run, when the dispatcher finds no block for an address, it asks
+  codegen_cache_prime() whether that block was compiled last time. If the
+  guest code still hashes the same, the block is created and compiled right
+  away, instead of first going through the interpreted marking pass, and it
+  starts off with the code mask mode it had settled on last time.
+
+  The profile is only used with the CPU model it was recorded with, as both
+  the decoding status and the timing tables that are compiled into blocks
+  depend on it.*/
+
+#define CODEGEN_CACHE_MAGIC   "86BxJitP"
+#define CODEGEN_CACHE_VERSION 1
+
+#define CODEGEN_CACHE_SIZE    (1 << 16)
+#define CODEGEN_CACHE_MASK    (CODEGEN_CACHE_SIZE - 1)
+#define CODEGEN_CACHE_PROBES  16
+
+/*Block flags worth carrying over to the next session*/
+#define CODEGEN_CACHE_FLAGS (CODEBLOCK_BYTE_MASK | CODEBLOCK_NO_IMMEDIATES)
+
+typedef struct codegen_cache_entry_t {
+    uint32_t phys;
+    uint32_t phys_2;
+    uint32_t pc;
+    uint32_t _cs;
+    uint32_t code_hash;
+    uint16_t status;
+    uint16_t flags;
+    uint16_t len; /*Distance from pc to codegen_endpc, 0 if entry is free*/
+    uint16_t pad;
+    uint64_t page_mask;
+    uint64_t page_mask2;
+} codegen_cache_entry_t;
+
+typedef struct codegen_cache_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t key;
+    uint32_t count;
+    uint32_t entry_size;
+} codegen_cache_header_t;
+
+static codegen_cache_entry_t *cache_table = NULL;
+static char                   cache_fn[1024];
+static uint32_t               cache_key;
+static const CPU             *cache_cpu;
+static int                    cache_count;
+static int                    cache_primed;
+static int                    cache_stale;
+
+#ifdef ENABLE_CODEGEN_CACHE_LOG
+int codegen_cache_do_log = ENABLE_CODEGEN_CACHE_LOG;
+
+static void
+codegen_cache_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (codegen_cache_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define codegen_cache_log(fmt, ...)
+#endif
+
+static uint32_t
+cache_fnv(uint32_t hash, const void *data, size_t size)
+{
+    const uint8_t *p = (const uint8_t *) data;
+
+    while (size--)
+        hash = (hash ^ *p++) * 0x01000193;
+
+    return hash;
+}
+
+/*Key identifying the CPU model the profile was recorded with.*/
+static uint32_t
+cache_cpu_key(void)
+{
+    uint32_t hash = 0x811c9dc5;
+
+    hash = cache_fnv(hash, cpu_f->internal_name, strlen(cpu_f->internal_name));
+    hash = cache_fnv(hash, cpu_s->name, strlen(cpu_s->name));
+    hash = cache_fnv(hash, &cpu_s->cpu_type, sizeof(cpu_s->cpu_type));
+    hash = cache_fnv(hash, &cpu_s->rspeed, sizeof(cpu_s->rspeed));
+    hash = cache_fnv(hash, &cpu_s->multi, sizeof(cpu_s->multi));
+
+    return hash;
+}
+
+/*Drop the profile if the CPU has been changed since it was recorded.*/
+static void
+cache_check_cpu(void)
+{
+    uint32_t key;
+
+    if (cpu_s == cache_cpu)
+        return;
+
+    cache_cpu = cpu_s;
+    key       = cache_cpu_key();
+    if (key != cache_key) {
+        codegen_cache_log("codegen_cache: CPU changed, dropping %i entries\n", cache_count);
+        memset(cache_table, 0, CODEGEN_CACHE_SIZE * sizeof(codegen_cache_entry_t));
+        cache_key   = key;
+        cache_count = 0;
+    }
+}
+
+static int
+cache_slot(uint32_t phys, uint32_t pc)
+{
+    return ((phys * 0x9e3779b1) ^ pc) & CODEGEN_CACHE_MASK;
+}
+
+/*Hash the guest code covered by a code mask. In byte mask mode each bit is a
+  byte of the 64 byte window phys is in, otherwise a 64 byte chunk of the
+  page. Returns 0 if the code is not in RAM.*/
+static int
+cache_hash_code(uint32_t *hash, uint32_t phys, uint64_t mask, int byte_mask)
+{
+    const page_t *page;
+    uint32_t      offset;
+
+    if ((phys >> 12) >= pages_sz)
+        return 0;
+    page = &pages[phys >> 12];
+    if (page->mem == page_ff)
+        return 0;
+
+    for (int c = 0; c < 64; c++) {
+        if (!(mask & ((uint64_t) 1 << c)))
+            continue;
+
+        if (byte_mask) {
+            offset = (phys & 0xfc0) + c;
+            *hash  = cache_fnv(*hash, &page->mem[offset], 1);
+        } else {
+            offset = c << PAGE_MASK_SHIFT;
+            *hash  = cache_fnv(*hash, &page->mem[offset], 1 << PAGE_MASK_SHIFT);
+        }
+    }
+
+    return 1;
+}
+
+static int
+cache_hash_entry(const codegen_cache_entry_t *entry, uint32_t *hash)
+{
+    int byte_mask = entry->flags & CODEBLOCK_BYTE_MASK;
+
+    *hash = 0x811c9dc5;
+    if (!cache_hash_code(hash, entry->phys, entry->page_mask, byte_mask))
+        return 0;
+    if (entry->page_mask2 && !cache_hash_code(hash, entry->phys_2, entry->page_mask2, byte_mask))
+        return 0;
+
+    return 1;
+}
+
+static codegen_cache_entry_t *
+cache_find(uint32_t phys, uint32_t pc, uint32_t _cs, uint16_t status, int alloc)
+{
+    int slot = cache_slot(phys, pc);
+
+    for (int c = 0; c < CODEGEN_CACHE_PROBES; c++) {
+        codegen_cache_entry_t *entry = &cache_table[(slot + c) & CODEGEN_CACHE_MASK];
+
+        if (!entry->len)
+            return alloc ? entry : NULL;
+        if ((entry->phys == phys) && (entry->pc == pc) && (entry->_cs == _cs) && (entry->status == status))
+            return entry;
+    }
+
+    return NULL;
+}
+
+static void
+cache_insert(const codegen_cache_entry_t *new_entry)
+{
+    codegen_cache_entry_t *entry = cache_find(new_entry->phys, new_entry->pc, new_entry->_cs, new_entry->status, 1);
+
+    if (entry) {
+        if (!entry->len)
+            cache_count++;
+        *entry = *new_entry;
+    }
+}
+
+void
+codegen_cache_load(const char *fn)
+{
+    codegen_cache_header_t hdr;
+    codegen_cache_entry_t  entry;
+    FILE                  *fp;
+
+    if (cache_table == NULL)
+        cache_table = calloc(CODEGEN_CACHE_SIZE, sizeof(codegen_cache_entry_t));
+    else
+        memset(cache_table, 0, CODEGEN_CACHE_SIZE * sizeof(codegen_cache_entry_t));
+    strncpy(cache_fn, fn, sizeof(cache_fn) - 1);
+    cache_key    = 0;
+    cache_cpu    = NULL;
+    cache_count  = 0;
+    cache_primed = 0;
+    cache_stale  = 0;
+
+    fp = plat_fopen(fn, "rb");
+    if (fp == NULL)
+        return;
+
+    if ((fread(&hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) || memcmp(hdr.magic, CODEGEN_CACHE_MAGIC, 8) ||
+        (hdr.version != CODEGEN_CACHE_VERSION) || (hdr.entry_size != sizeof(codegen_cache_entry_t))) {
+        pclog("codegen_cache: %s is not a usable block profile, ignoring\n", fn);
+        fclose(fp);
+        return;
+    }
+
+    cache_key = hdr.key;
+    while (hdr.count--) {
+        if (fread(&entry, 1, sizeof(entry), fp) != sizeof(entry))
+            break;
+        if (entry.len)
+            cache_insert(&entry);
+    }
+    fclose(fp);
+
+    codegen_cache_log("codegen_cache: loaded %i entries from %s\n", cache_count, fn);
+}
+
+void
+codegen_cache_save(void)
+{
+    codegen_cache_header_t hdr;
+    FILE                  *fp;
+
+    if (cache_table == NULL)
+        return;
+
+    codegen_cache_log("codegen_cache: %i blocks primed, %i stale, saving %i entries\n",
+                      cache_primed, cache_stale, cache_count);
+
+    fp = plat_fopen(cache_fn, "wb");
+    if (fp == NULL) {
+        pclog("codegen_cache: unable to write %s\n", cache_fn);
+        return;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CODEGEN_CACHE_MAGIC, 8);
+    hdr.version    = CODEGEN_CACHE_VERSION;
+    hdr.key        = cache_key;
+    hdr.count      = cache_count;
+    hdr.entry_size = sizeof(codegen_cache_entry_t);
+    fwrite(&hdr, 1, sizeof(hdr), fp);
+
+    for (int c = 0; c < CODEGEN_CACHE_SIZE; c++) {
+        if (cache_table[c].len)
+            fwrite(&cache_table[c], 1, sizeof(codegen_cache_entry_t), fp);
+    }
+    fclose(fp);
+}
+
+/*Record a block that has just been compiled.*/
+void
+codegen_cache_add(codeblock_t *block)
+{
+    codegen_cache_entry_t entry;
+
+    if (cache_table == NULL)
+        return;
+    cache_check_cpu();
+
+    memset(&entry, 0, sizeof(entry));
+    entry.phys       = block->phys;
+    entry.phys_2     = block->page_mask2 ? block->phys_2 : 0;
+    entry.pc         = block->pc;
+    entry._cs        = block->_cs;
+    entry.status     = block->status;
+    entry.flags      = block->flags & CODEGEN_CACHE_FLAGS;
+    entry.len        = codegen_endpc - block->pc;
+    entry.page_mask  = block->page_mask;
+    entry.page_mask2 = block->page_mask2;
+
+    if (entry.len && cache_hash_entry(&entry, &entry.code_hash))
+        cache_insert(&entry);
+}
+
+/*Called by the dispatcher when it has no usable block for the current
+  address. If the block was compiled in a previous session and its code has
+  not changed, create it as if the marking pass had already been run, so it
+  gets compiled right away. Returns 1 if a block has been created, it is then
+  codeblock[block_current].*/
+int
+codegen_cache_prime(uint32_t phys_addr)
+{
+    const codegen_cache_entry_t *entry;
+    uint32_t                     hash;
+
+    if (cache_table == NULL)
+        return 0;
+    cache_check_cpu();
+
+    entry = cache_find(phys_addr, cs + cpu_state.pc, cs, cpu_cur_status, 0);
+    if (entry == NULL)
+        return 0;
+    if (!cache_hash_entry(entry, &hash) || (hash != entry->code_hash)) {
+        cache_stale++;
+        return 0;
+    }
+
+    codegen_block_init(phys_addr);
+    codegen_endpc = (cs + cpu_state.pc) + entry->len;
+    codegen_block_end();
+    codeblock[block_current].flags |= entry->flags;
+    cache_primed++;
+
+    return 1;
+}
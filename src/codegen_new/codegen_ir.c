@@ -86,6 +86,8 @@ codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
 
     codegen_reg_mark_as_required();
     codegen_reg_process_dead_list(ir);
+    codegen_ir_optimise(ir);
+    codegen_reg_analyse(ir);
     block_write_data = codeblock_allocator_get_ptr(block->head_mem_block);
     block_pos        = 0;
     codegen_backend_prologue(block);
@@ -110,6 +112,8 @@ codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
         if ((uop->type & UOP_MASK) == UOP_INVALID)
             continue;
 
+        codegen_reg_set_uop(ir, c);
+
 #ifdef CODEGEN_BACKEND_HAS_MOV_IMM
         if ((uop->type & UOP_MASK) == (UOP_MOV_IMM & UOP_MASK) && reg_is_native_size(uop->dest_reg_a) && !codegen_reg_is_loaded(uop->dest_reg_a) && reg_version[IREG_GET_REG(uop->dest_reg_a.reg)][uop->dest_reg_a.version].refcount <= 0) {
             /*Special case for UOP_MOV_IMM - if destination not already in host register
@@ -193,6 +197,7 @@ codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
 
     codegen_backend_epilogue(block);
     block_write_data = NULL;
+    codegen_reg_block_end(block);
 #if 0
     if (has_ea)
         fatal("IR compilation complete\n");
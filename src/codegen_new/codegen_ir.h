@@ -4,3 +4,27 @@ ir_data_t *codegen_ir_init(void);
 
 void codegen_ir_set_unroll(int count, int start, int first_instruction);
 void codegen_ir_compile(ir_data_t *ir, codeblock_t *block);
+
+/*Run the uOP optimisation passes on a fully generated block*/
+void codegen_ir_optimise(ir_data_t *ir);
+
+/*Bit mask of enabled optimisation passes - bit 0 is constant propagation,
+  bit 1 effective address CSE, bit 2 dead partial register write removal.
+  Clearing bits is useful when chasing a miscompilation.*/
+extern uint32_t codegen_ir_opt_mask;
+
+typedef struct codegen_ir_opt_stats_t {
+    /*Register operands replaced with immediates*/
+    uint64_t folded;
+    /*Effective address calculations replaced by an earlier identical one*/
+    uint64_t ea_reused;
+    /*Register versions removed as only partially overwritten*/
+    uint64_t dead_writes;
+} codegen_ir_opt_stats_t;
+
+extern codegen_ir_opt_stats_t codegen_ir_opt_stats;
+
+#ifdef ENABLE_CODEGEN_IR_OPT_LOG
+/*Dump the IR of a block, when codegen_ir_opt_do_log is 2 or more*/
+void codegen_ir_dump(ir_data_t *ir, const char *when, const char *pass);
+#endif
@@ -0,0 +1,603 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+#include <86box/plat_unused.h>
+
+#include "codegen.h"
+#include "codegen_ir.h"
+#include "codegen_reg.h"
+
+/*uOP optimisation passes.
+
+  These run on the IR of a block once it has been fully generated, and after
+  the initial dead code elimination, but before register allocation and
+  lowering. Each pass rewrites uOPs in place and keeps register version
+  refcounts accurate, as the allocator relies on them. uOPs made redundant by
+  a pass are put on the dead list, which is processed after each pass.
+
+  IR register versions are only meaningful as values in straight line code.
+  A barrier uOP may change any register behind the IR's back (eg an
+  interpreted instruction), and a jump destination may be reached with state
+  from a different path. Passes that reason about values therefore never look
+  across either of these.*/
+
+#define EA_EXPR_MAX 4
+
+typedef struct ea_expr_op_t {
+    uint32_t  type;
+    ir_reg_t  src_reg_a;
+    ir_reg_t  src_reg_b;
+    uintptr_t imm_data;
+} ea_expr_op_t;
+
+/*Expression an IREG_eaaddr version has been calculated with, as a list of
+  uOPs starting from the one that does not read IREG_eaaddr. References to the
+  previous IREG_eaaddr version of the chain are stored as invalid_ir_reg.*/
+typedef struct ea_expr_t {
+    int          len;
+    int          first_uop;
+    int          valid;
+    ea_expr_op_t op[EA_EXPR_MAX];
+} ea_expr_t;
+
+typedef struct codegen_ir_opt_pass_t {
+    const char *name;
+    int (*pass)(ir_data_t *ir);
+} codegen_ir_opt_pass_t;
+
+static int constant_propagation(ir_data_t *ir);
+static int ea_cse(ir_data_t *ir);
+static int dead_partial_writes(ir_data_t *ir);
+
+static const codegen_ir_opt_pass_t passes[] = {
+    { "constant propagation",         constant_propagation },
+    { "address CSE",                  ea_cse               },
+    { "dead partial register writes", dead_partial_writes  }
+};
+
+#define NR_PASSES (int) (sizeof(passes) / sizeof(passes[0]))
+
+/*Bit n set enables passes[n]*/
+uint32_t codegen_ir_opt_mask = ~0u;
+
+codegen_ir_opt_stats_t codegen_ir_opt_stats;
+
+/*Start of the straight line region each uOP is in, ie the position of the
+  last barrier or jump destination at or before it*/
+static uint16_t  region_start[UOP_NR_MAX];
+static ea_expr_t ea_exprs[256];
+/*IREG_eaaddr version each version has been replaced by, if any*/
+static uint8_t ea_alias[256];
+
+#ifdef ENABLE_CODEGEN_IR_OPT_LOG
+/*1 - log per block pass statistics, 2 - also dump the IR before and after
+  each pass*/
+int codegen_ir_opt_do_log = ENABLE_CODEGEN_IR_OPT_LOG;
+
+static void
+codegen_ir_opt_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (codegen_ir_opt_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+
+static const char *
+dump_reg(char *s, ir_reg_t ir_reg)
+{
+    static const char *sizes[8] = { "L", "W", "B", "BH", "D", "Q", "?", "?" };
+
+    sprintf(s, "%i%s.%i", IREG_GET_REG(ir_reg.reg), sizes[IREG_GET_SIZE(ir_reg.reg) >> IREG_SIZE_SHIFT], ir_reg.version);
+    return s;
+}
+
+void
+codegen_ir_dump(ir_data_t *ir, const char *when, const char *pass)
+{
+    char dest[16];
+    char src_a[16];
+    char src_b[16];
+    char src_c[16];
+
+    if (codegen_ir_opt_do_log < 2)
+        return;
+
+    pclog("IR %s %s:\n", when, pass);
+    for (int c = 0; c < ir->wr_pos; c++) {
+        const uop_t *uop = &ir->uops[c];
+
+        if ((uop->type & UOP_MASK) == UOP_INVALID)
+            continue;
+
+        strcpy(dest, "-");
+        strcpy(src_a, "-");
+        strcpy(src_b, "-");
+        strcpy(src_c, "-");
+        if (!ir_reg_is_invalid(uop->dest_reg_a))
+            dump_reg(dest, uop->dest_reg_a);
+        if (!ir_reg_is_invalid(uop->src_reg_a))
+            dump_reg(src_a, uop->src_reg_a);
+        if (!ir_reg_is_invalid(uop->src_reg_b))
+            dump_reg(src_b, uop->src_reg_b);
+        if (!ir_reg_is_invalid(uop->src_reg_c))
+            dump_reg(src_c, uop->src_reg_c);
+
+        pclog("  %4i: %08x %02x  %-8s <- %-8s %-8s %-8s imm=%08x%s%s\n",
+              c, uop->pc, uop->type & UOP_MASK, dest, src_a, src_b, src_c, (uint32_t) uop->imm_data,
+              (uop->type & UOP_TYPE_BARRIER) ? " barrier" : "",
+              (uop->type & UOP_TYPE_ORDER_BARRIER) ? " order" : "");
+    }
+}
+#else
+#    define codegen_ir_opt_log(fmt, ...)
+#    define codegen_ir_dump(ir, when, pass)
+#endif
+
+static void
+find_regions(ir_data_t *ir)
+{
+    int start = 0;
+
+    memset(region_start, 0, ir->wr_pos * sizeof(region_start[0]));
+    for (int c = 0; c < ir->wr_pos; c++) {
+        const uop_t *uop = &ir->uops[c];
+
+        if (uop->jump_dest_uop >= 0 && uop->jump_dest_uop < ir->wr_pos)
+            region_start[uop->jump_dest_uop] = 1;
+    }
+    for (int c = 0; c < ir->wr_pos; c++) {
+        if (region_start[c] || (ir->uops[c].type & UOP_TYPE_BARRIER))
+            start = c;
+        region_start[c] = start;
+    }
+}
+
+static int
+reg_is_l(ir_reg_t ir_reg)
+{
+    return IREG_GET_SIZE(ir_reg.reg) == IREG_SIZE_L && reg_is_native_size(ir_reg);
+}
+
+static inline reg_version_t *
+get_version(ir_reg_t ir_reg)
+{
+    return &reg_version[IREG_GET_REG(ir_reg.reg)][ir_reg.version];
+}
+
+/*Drop a read of a register version, and queue the version for removal if it is
+  no longer used. Version 0 is the value on entry to the block, the first four
+  registers are never optimised out, and the last version of a register and
+  versions followed by a partial write are still needed.*/
+static void
+release_read(ir_data_t *ir, ir_reg_t ir_reg)
+{
+    reg_version_t *regv    = get_version(ir_reg);
+    int            reg     = IREG_GET_REG(ir_reg.reg);
+    int            version = ir_reg.version;
+
+    regv->refcount--;
+    if (regv->refcount || !version || reg <= IREG_EBX || (regv->flags & (REG_FLAGS_REQUIRED | REG_FLAGS_DEAD)))
+        return;
+    if (version >= reg_last_version[reg] || !reg_is_native_size(ir->uops[reg_version[reg][version + 1].parent_uop].dest_reg_a))
+        return;
+
+    add_to_dead_list(regv, reg, version);
+}
+
+/*Returns 1 and the value in *imm if ir_reg is known to hold a constant at
+  uop_nr, ie it was written in full by a UOP_MOV_IMM in the same region.*/
+static int
+get_constant(ir_data_t *ir, ir_reg_t ir_reg, int uop_nr, uint32_t *imm)
+{
+    const reg_version_t *regv;
+    const uop_t         *parent;
+
+    if (!ir_reg.version || !reg_is_l(ir_reg))
+        return 0;
+    regv = get_version(ir_reg);
+    if ((regv->flags & REG_FLAGS_DEAD) || regv->parent_uop >= uop_nr || regv->parent_uop < region_start[uop_nr])
+        return 0;
+    parent = &ir->uops[regv->parent_uop];
+    if (parent->type != UOP_MOV_IMM || parent->dest_reg_a.reg != ir_reg.reg || parent->dest_reg_a.version != ir_reg.version)
+        return 0;
+
+    *imm = (uint32_t) parent->imm_data;
+    return 1;
+}
+
+/*Replace register operands that are known constants with immediates. Only
+  full 32-bit operations are converted, as these are the only forms every
+  backend implements for both register and immediate operands.*/
+static int
+constant_propagation(ir_data_t *ir)
+{
+    int nr_folded = 0;
+
+    for (int c = 0; c < ir->wr_pos; c++) {
+        uop_t   *uop = &ir->uops[c];
+        uint32_t imm_a;
+        uint32_t imm_b;
+        uint32_t imm_type;
+        int      const_a;
+        int      const_b;
+        int      commutative = 1;
+
+        switch (uop->type) {
+            case UOP_MOV:
+                if (reg_is_l(uop->dest_reg_a) && get_constant(ir, uop->src_reg_a, c, &imm_a)) {
+                    release_read(ir, uop->src_reg_a);
+                    uop->type      = UOP_MOV_IMM;
+                    uop->imm_data  = imm_a;
+                    uop->src_reg_a = invalid_ir_reg;
+                    nr_folded++;
+                }
+                continue;
+
+            case UOP_ADD:
+                imm_type = UOP_ADD_IMM;
+                break;
+            case UOP_AND:
+                imm_type = UOP_AND_IMM;
+                break;
+            case UOP_OR:
+                imm_type = UOP_OR_IMM;
+                break;
+            case UOP_XOR:
+                imm_type = UOP_XOR_IMM;
+                break;
+            case UOP_SUB:
+                imm_type    = UOP_SUB_IMM;
+                commutative = 0;
+                break;
+
+            default:
+                continue;
+        }
+
+        if (!reg_is_l(uop->dest_reg_a) || !reg_is_l(uop->src_reg_a) || !reg_is_l(uop->src_reg_b))
+            continue;
+        const_a = get_constant(ir, uop->src_reg_a, c, &imm_a);
+        const_b = get_constant(ir, uop->src_reg_b, c, &imm_b);
+
+        if (const_a && const_b) {
+            switch (uop->type) {
+                case UOP_ADD:
+                    imm_a += imm_b;
+                    break;
+                case UOP_AND:
+                    imm_a &= imm_b;
+                    break;
+                case UOP_OR:
+                    imm_a |= imm_b;
+                    break;
+                case UOP_XOR:
+                    imm_a ^= imm_b;
+                    break;
+                case UOP_SUB:
+                    imm_a -= imm_b;
+                    break;
+            }
+            release_read(ir, uop->src_reg_a);
+            release_read(ir, uop->src_reg_b);
+            uop->type      = UOP_MOV_IMM;
+            uop->imm_data  = imm_a;
+            uop->src_reg_a = invalid_ir_reg;
+            uop->src_reg_b = invalid_ir_reg;
+            nr_folded++;
+        } else if (const_b) {
+            release_read(ir, uop->src_reg_b);
+            uop->type      = imm_type;
+            uop->imm_data  = imm_b;
+            uop->src_reg_b = invalid_ir_reg;
+            nr_folded++;
+        } else if (const_a && commutative) {
+            release_read(ir, uop->src_reg_a);
+            uop->type      = imm_type;
+            uop->imm_data  = imm_a;
+            uop->src_reg_a = uop->src_reg_b;
+            uop->src_reg_b = invalid_ir_reg;
+            nr_folded++;
+        }
+    }
+
+    return nr_folded;
+}
+
+static int
+ea_is_chain_uop(const uop_t *uop)
+{
+    switch (uop->type) {
+        case UOP_MOV:
+        case UOP_MOV_IMM:
+        case UOP_MOVZX:
+        case UOP_ADD:
+        case UOP_ADD_IMM:
+        case UOP_ADD_LSHIFT:
+        case UOP_AND_IMM:
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+static int
+ea_expr_equal(const ea_expr_t *a, const ea_expr_t *b)
+{
+    if (!a->valid || !b->valid || a->len != b->len)
+        return 0;
+
+    for (int c = 0; c < a->len; c++) {
+        const ea_expr_op_t *op_a = &a->op[c];
+        const ea_expr_op_t *op_b = &b->op[c];
+
+        if (op_a->type != op_b->type || op_a->imm_data != op_b->imm_data ||
+            op_a->src_reg_a.reg != op_b->src_reg_a.reg || op_a->src_reg_a.version != op_b->src_reg_a.version ||
+            op_a->src_reg_b.reg != op_b->src_reg_b.reg || op_a->src_reg_b.version != op_b->src_reg_b.version)
+            return 0;
+    }
+
+    return 1;
+}
+
+/*Try to remove the chain of uOPs that calculated IREG_eaaddr version
+  new_version, which has the same value as the older version old_version. The
+  readers of the new version are pointed at the old one instead.*/
+static int
+ea_cse_replace(ir_data_t *ir, int old_version, int new_version, int uop_nr)
+{
+    const ea_expr_t *expr     = &ea_exprs[new_version];
+    reg_version_t   *old_regv = &reg_version[IREG_eaaddr][old_version];
+    reg_version_t   *new_regv = &reg_version[IREG_eaaddr][new_version];
+    int              next_write;
+    int              nr_reads = 0;
+
+    if ((old_regv->flags & REG_FLAGS_DEAD) || (ir->uops[old_regv->parent_uop].type & UOP_MASK) == UOP_INVALID)
+        return 0;
+    if ((old_regv->refcount + new_regv->refcount) > REG_REFCOUNT_MAX)
+        return 0;
+
+    /*Intermediate versions must only be used by the chain itself, and must not
+      be needed in memory*/
+    for (int version = new_version - expr->len + 1; version < new_version; version++) {
+        const reg_version_t *regv = &reg_version[IREG_eaaddr][version];
+
+        if (regv->refcount != 1 || (regv->flags & REG_FLAGS_REQUIRED))
+            return 0;
+    }
+
+    /*Find the readers of the new version, up to the next write. That write must
+      be in full, as a partial write would read the new version implicitly.*/
+    for (next_write = uop_nr + 1; next_write < ir->wr_pos; next_write++) {
+        const uop_t *uop = &ir->uops[next_write];
+
+        if ((uop->type & UOP_MASK) == UOP_INVALID)
+            continue;
+        if (IREG_GET_REG(uop->src_reg_a.reg) == IREG_eaaddr && uop->src_reg_a.version == new_version)
+            nr_reads++;
+        if (IREG_GET_REG(uop->src_reg_b.reg) == IREG_eaaddr && uop->src_reg_b.version == new_version)
+            nr_reads++;
+        if (IREG_GET_REG(uop->src_reg_c.reg) == IREG_eaaddr && uop->src_reg_c.version == new_version)
+            nr_reads++;
+        if (IREG_GET_REG(uop->dest_reg_a.reg) == IREG_eaaddr) {
+            if (!reg_is_native_size(uop->dest_reg_a))
+                return 0;
+            break;
+        }
+    }
+    if (nr_reads != new_regv->refcount)
+        return 0;
+
+    for (int c = uop_nr + 1; c < ir->wr_pos && c <= next_write; c++) {
+        uop_t *uop = &ir->uops[c];
+
+        if ((uop->type & UOP_MASK) == UOP_INVALID)
+            continue;
+        if (IREG_GET_REG(uop->src_reg_a.reg) == IREG_eaaddr && uop->src_reg_a.version == new_version)
+            uop->src_reg_a.version = old_version;
+        if (IREG_GET_REG(uop->src_reg_b.reg) == IREG_eaaddr && uop->src_reg_b.version == new_version)
+            uop->src_reg_b.version = old_version;
+        if (IREG_GET_REG(uop->src_reg_c.reg) == IREG_eaaddr && uop->src_reg_c.version == new_version)
+            uop->src_reg_c.version = old_version;
+    }
+    old_regv->refcount += new_regv->refcount;
+    old_regv->flags |= (new_regv->flags & REG_FLAGS_REQUIRED);
+    ea_alias[new_version] = old_version;
+
+    /*Remove the chain*/
+    for (int c = expr->first_uop; c <= uop_nr; c++) {
+        uop_t         *uop = &ir->uops[c];
+        reg_version_t *regv;
+
+        if ((uop->type & UOP_MASK) == UOP_INVALID || IREG_GET_REG(uop->dest_reg_a.reg) != IREG_eaaddr)
+            continue;
+
+        regv = get_version(uop->dest_reg_a);
+        if (!ir_reg_is_invalid(uop->src_reg_a) && IREG_GET_REG(uop->src_reg_a.reg) != IREG_eaaddr)
+            release_read(ir, uop->src_reg_a);
+        if (!ir_reg_is_invalid(uop->src_reg_b) && IREG_GET_REG(uop->src_reg_b.reg) != IREG_eaaddr)
+            release_read(ir, uop->src_reg_b);
+        uop->type      = UOP_INVALID;
+        regv->refcount = 0;
+        regv->flags    = REG_FLAGS_DEAD;
+    }
+
+    return 1;
+}
+
+/*Remove recalculations of an effective address that IREG_eaaddr already
+  holds, eg consecutive instructions accessing the same memory operand.*/
+static int
+ea_cse(ir_data_t *ir)
+{
+    int nr_removed   = 0;
+    int prev_version = -1;
+
+    for (int c = 0; c <= reg_last_version[IREG_eaaddr]; c++) {
+        ea_exprs[c].valid = 0;
+        ea_alias[c]       = c;
+    }
+
+    for (int c = 0; c < ir->wr_pos; c++) {
+        const uop_t  *uop = &ir->uops[c];
+        ea_expr_t    *expr;
+        ea_expr_op_t *op;
+        int           version;
+        int           reads_ea;
+
+        if ((uop->type & UOP_MASK) == UOP_INVALID || IREG_GET_REG(uop->dest_reg_a.reg) != IREG_eaaddr)
+            continue;
+
+        version  = uop->dest_reg_a.version;
+        expr     = &ea_exprs[version];
+        reads_ea = (IREG_GET_REG(uop->src_reg_a.reg) == IREG_eaaddr) || (IREG_GET_REG(uop->src_reg_b.reg) == IREG_eaaddr);
+
+        expr->valid = 0;
+        if (!ea_is_chain_uop(uop) || !reg_is_l(uop->dest_reg_a) || !ir_reg_is_invalid(uop->src_reg_c))
+            continue;
+
+        if (!reads_ea) {
+            expr->len       = 0;
+            expr->first_uop = c;
+            /*If the previous calculation was itself removed, compare against
+              the one it was replaced by*/
+            prev_version = ea_alias[version - 1];
+        } else {
+            const ea_expr_t *parent = &ea_exprs[version - 1];
+
+            if (!parent->valid || parent->len >= EA_EXPR_MAX)
+                continue;
+            if ((IREG_GET_REG(uop->src_reg_a.reg) == IREG_eaaddr && !reg_is_l(uop->src_reg_a)) ||
+                (IREG_GET_REG(uop->src_reg_b.reg) == IREG_eaaddr && !reg_is_l(uop->src_reg_b)))
+                continue;
+            *expr = *parent;
+        }
+
+        op            = &expr->op[expr->len++];
+        op->type      = uop->type;
+        op->imm_data  = uop->imm_data;
+        op->src_reg_a = (IREG_GET_REG(uop->src_reg_a.reg) == IREG_eaaddr) ? invalid_ir_reg : uop->src_reg_a;
+        op->src_reg_b = (IREG_GET_REG(uop->src_reg_b.reg) == IREG_eaaddr) ? invalid_ir_reg : uop->src_reg_b;
+        expr->valid   = 1;
+
+        /*The previous chain and this one must be in the same region, so that
+          their source register versions hold the same values*/
+        if (prev_version >= 0 && ea_exprs[prev_version].valid && region_start[c] <= ea_exprs[prev_version].first_uop &&
+            ea_expr_equal(expr, &ea_exprs[prev_version]) && ea_cse_replace(ir, prev_version, version, c)) {
+            /*The new version no longer exists, stop extending this chain*/
+            expr->valid = 0;
+            nr_removed++;
+        }
+    }
+
+    return nr_removed;
+}
+
+static int
+read_is_covered(int write_size, int read_size)
+{
+    switch (write_size) {
+        case IREG_SIZE_W:
+            return read_size == IREG_SIZE_W || read_size == IREG_SIZE_B;
+        case IREG_SIZE_B:
+            return read_size == IREG_SIZE_B;
+        case IREG_SIZE_BH:
+            return read_size == IREG_SIZE_BH;
+
+        default:
+            return 0;
+    }
+}
+
+/*A register version that is only followed by a partial write doesn't get
+  removed by the normal dead code elimination, as the partial write merges
+  into it. This is however common for flags calculations (eg 8 and 16-bit
+  CMP write flags_res_B/W, then zero extend into flags_res), where the part
+  of the old value that survives is never looked at before being overwritten
+  in full. Remove such versions.*/
+static int
+dead_partial_writes(ir_data_t *ir)
+{
+    int nr_removed = 0;
+
+    for (int reg = IREG_EBX + 1; reg < IREG_COUNT; reg++) {
+        for (int version = 1; (version + 2) <= reg_last_version[reg]; version++) {
+            reg_version_t       *regv      = &reg_version[reg][version];
+            const reg_version_t *partial_v = &reg_version[reg][version + 1];
+            const reg_version_t *full_v    = &reg_version[reg][version + 2];
+            const uop_t         *partial   = &ir->uops[partial_v->parent_uop];
+            const uop_t         *full      = &ir->uops[full_v->parent_uop];
+            int                  write_size;
+            int                  covered = 1;
+
+            /*REG_FLAGS_REQUIRED is set on versions that are live across a
+              barrier, which must then be kept in full*/
+            if (regv->refcount || (regv->flags & (REG_FLAGS_REQUIRED | REG_FLAGS_DEAD)) ||
+                (partial_v->flags & (REG_FLAGS_REQUIRED | REG_FLAGS_DEAD)) || (full_v->flags & REG_FLAGS_DEAD))
+                continue;
+            if (ir->uops[regv->parent_uop].type & (UOP_TYPE_BARRIER | UOP_TYPE_ORDER_BARRIER))
+                continue;
+            if (reg_is_native_size(partial->dest_reg_a) || !reg_is_native_size(full->dest_reg_a))
+                continue;
+            if (region_start[full_v->parent_uop] > regv->parent_uop)
+                continue;
+
+            write_size = IREG_GET_SIZE(partial->dest_reg_a.reg);
+            for (int c = partial_v->parent_uop + 1; c <= full_v->parent_uop; c++) {
+                const uop_t *uop = &ir->uops[c];
+
+                if ((uop->type & UOP_MASK) == UOP_INVALID)
+                    continue;
+                if ((IREG_GET_REG(uop->src_reg_a.reg) == reg && uop->src_reg_a.version == (version + 1) && !read_is_covered(write_size, IREG_GET_SIZE(uop->src_reg_a.reg))) ||
+                    (IREG_GET_REG(uop->src_reg_b.reg) == reg && uop->src_reg_b.version == (version + 1) && !read_is_covered(write_size, IREG_GET_SIZE(uop->src_reg_b.reg))) ||
+                    (IREG_GET_REG(uop->src_reg_c.reg) == reg && uop->src_reg_c.version == (version + 1) && !read_is_covered(write_size, IREG_GET_SIZE(uop->src_reg_c.reg)))) {
+                    covered = 0;
+                    break;
+                }
+            }
+            if (!covered)
+                continue;
+
+            add_to_dead_list(regv, reg, version);
+            nr_removed++;
+        }
+    }
+
+    return nr_removed;
+}
+
+void
+codegen_ir_optimise(ir_data_t *ir)
+{
+    int results[NR_PASSES];
+
+    find_regions(ir);
+
+    for (int c = 0; c < NR_PASSES; c++) {
+        if (!(codegen_ir_opt_mask & (1u << c))) {
+            results[c] = 0;
+            continue;
+        }
+
+        codegen_ir_dump(ir, "before", passes[c].name);
+        codegen_ir_opt_log("codegen_ir_opt: running %s\n", passes[c].name);
+        results[c] = passes[c].pass(ir);
+        /*Remove the uOPs the pass has made redundant*/
+        codegen_reg_process_dead_list(ir);
+        codegen_ir_opt_log("codegen_ir_opt: %s - %i changes\n", passes[c].name, results[c]);
+        codegen_ir_dump(ir, "after", passes[c].name);
+    }
+
+    codegen_ir_opt_stats.folded += results[0];
+    codegen_ir_opt_stats.ea_reused += results[1];
+    codegen_ir_opt_stats.dead_writes += results[2];
+}
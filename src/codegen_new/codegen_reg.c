@@ -1,4 +1,6 @@
+#include <stdarg.h>
 #include <stdint.h>
+#define HAVE_STDARG_H
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/mem.h>
@@ -36,6 +38,48 @@ static host_reg_set_t host_fp_reg_set;
 
 uint64_t dirty_ir_regs[2] = { 0, 0 };
 
+int                 codegen_reg_spill_furthest = 1;
+codegen_reg_stats_t codegen_reg_stats;
+static codegen_reg_stats_t block_start_stats;
+
+/*Whole-block liveness, filled in by codegen_reg_analyse(). For each uOP and
+  each of its operands (src_reg_a, src_reg_b, src_reg_c, dest_reg_a), the next
+  uOP referencing the same IR register, or UOP_NR_MAX if there is none. Bit n
+  of uop_next_wo is set if that next reference of operand n only writes the
+  full register, without reading it.*/
+static uint16_t uop_next_use[UOP_NR_MAX][4];
+static uint8_t  uop_next_wo[UOP_NR_MAX];
+/*First uOP at or after each uOP that writes registers back or may leave the
+  block, ie a barrier, an order barrier or a jump.*/
+static uint16_t uop_next_barrier[UOP_NR_MAX];
+
+/*Next reference to each IR register after the uOP being compiled*/
+static uint16_t reg_next_use[IREG_COUNT];
+static uint8_t  reg_next_wo[IREG_COUNT];
+static int      cur_uop;
+
+/*IR registers sharing their storage with another one, which are never
+  considered dead on eviction*/
+static uint8_t ireg_aliased[IREG_COUNT];
+
+#ifdef ENABLE_CODEGEN_REG_LOG
+int codegen_reg_do_log = ENABLE_CODEGEN_REG_LOG;
+
+static void
+codegen_reg_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (codegen_reg_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define codegen_reg_log(fmt, ...)
+#endif
+
 enum {
     REG_BYTE,
     REG_WORD,
@@ -243,6 +287,16 @@ codegen_check_regs(void)
             fatal("Register number %d outside cpu_state!\n", i);
         }
     }
+
+    /*FPU stack registers are indexed by TOP and overlap the MMX registers, so
+      treat all of those as aliased, along with anything sharing a pointer.*/
+    for (i = 0; i < IREG_COUNT; i++) {
+        ireg_aliased[i] = (ireg_data[i].type != REG_INTEGER) || (ireg_data[i].native_size == REG_FPU_ST_BYTE);
+        for (int j = 0; j < IREG_COUNT && !ireg_aliased[i]; j++) {
+            if ((j != i) && ireg_data[i].p && (ireg_data[i].p == ireg_data[j].p))
+                ireg_aliased[i] = 1;
+        }
+    }
 }
 
 void
@@ -278,6 +332,8 @@ codegen_reg_reset(void)
 
     reg_dead_list        = 0;
     max_version_refcount = 0;
+
+    block_start_stats = codegen_reg_stats;
 }
 
 static inline int
@@ -392,6 +448,7 @@ codegen_reg_load(host_reg_set_t *reg_set, codeblock_t *block, int c, ir_reg_t ir
     }
 
     reg_set->regs[c] = ir_reg;
+    codegen_reg_stats.loads++;
 }
 
 static void
@@ -403,6 +460,8 @@ codegen_reg_writeback(host_reg_set_t *reg_set, codeblock_t *block, int c, int in
     if (!reg_version[ir_reg][reg_set->regs[c].version].refcount && ireg_data[ir_reg].is_volatile)
         return;
 
+    codegen_reg_stats.stores++;
+
     switch (ireg_data[ir_reg].native_size) {
         case REG_BYTE:
 #ifndef RELEASE_BUILD
@@ -552,6 +611,74 @@ codegen_reg_write_imm(codeblock_t *block, ir_reg_t ir_reg, uint32_t imm_data)
 }
 #endif
 
+/*A dirty register does not need writing back if it has no pending reads and
+  its next reference fully overwrites it before any barrier, memory access or
+  jump, as nothing can observe the stale copy in cpu_state in between.*/
+static int
+codegen_reg_value_is_dead(const host_reg_set_t *reg_set, int c)
+{
+    int reg = IREG_GET_REG(reg_set->regs[c].reg);
+    int next_use;
+
+    if (!codegen_reg_spill_furthest || ireg_aliased[reg] || !reg_next_wo[reg] || ir_get_refcount(reg_set->regs[c]))
+        return 0;
+
+    next_use = reg_next_use[reg];
+    return (next_use < UOP_NR_MAX) && (uop_next_barrier[cur_uop] > next_use);
+}
+
+/*Choose a host register to evict among those not locked by the current uOP.
+  Empty registers go first, then values with no pending reads, then the value
+  whose next use is furthest away. Registers that can be dropped without a
+  write back win ties.*/
+static int
+codegen_reg_pick_spill(const host_reg_set_t *reg_set)
+{
+    int best       = reg_set->nr_regs;
+    int best_score = -1;
+
+    for (int c = 0; c < reg_set->nr_regs; c++) {
+        int score;
+
+        if (reg_set->locked & (1 << c))
+            continue;
+        if (ir_reg_is_invalid(reg_set->regs[c]))
+            return c;
+
+        if (!ir_get_refcount(reg_set->regs[c]))
+            score = 2 * (UOP_NR_MAX + 1);
+        else
+            score = 2 * reg_next_use[IREG_GET_REG(reg_set->regs[c].reg)];
+        if (!reg_set->dirty[c] || codegen_reg_value_is_dead(reg_set, c))
+            score++;
+
+        if (score > best_score) {
+            best       = c;
+            best_score = score;
+        }
+    }
+
+    return best;
+}
+
+/*Free up host register c so another value can be loaded into it.*/
+static void
+codegen_reg_spill(host_reg_set_t *reg_set, codeblock_t *block, int c)
+{
+    if (ir_reg_is_invalid(reg_set->regs[c]))
+        return;
+
+    codegen_reg_stats.spills++;
+    if (reg_set->dirty[c]) {
+        if (codegen_reg_value_is_dead(reg_set, c)) {
+            codegen_reg_stats.stores_elided++;
+            reg_set->regs[c]  = invalid_ir_reg;
+            reg_set->dirty[c] = 0;
+        } else
+            codegen_reg_writeback(reg_set, block, c, 1);
+    }
+}
+
 static void
 alloc_reg(ir_reg_t ir_reg)
 {
@@ -635,11 +762,14 @@ codegen_reg_alloc_read_reg(codeblock_t *block, ir_reg_t ir_reg, int *host_reg_id
 
     /*Search for required register*/
     for (c = 0; c < reg_set->nr_regs; c++) {
-        if (!ir_reg_is_invalid(reg_set->regs[c]) && IREG_GET_REG(reg_set->regs[c].reg) == IREG_GET_REG(ir_reg.reg) && reg_set->regs[c].version == ir_reg.version)
+        if (!ir_reg_is_invalid(reg_set->regs[c]) && IREG_GET_REG(reg_set->regs[c].reg) == IREG_GET_REG(ir_reg.reg) && reg_set->regs[c].version == ir_reg.version) {
+            codegen_reg_stats.reuses++;
             break;
+        }
 
         if (!ir_reg_is_invalid(reg_set->regs[c]) && IREG_GET_REG(reg_set->regs[c].reg) == IREG_GET_REG(ir_reg.reg) && reg_set->regs[c].version <= ir_reg.version) {
             reg_version[IREG_GET_REG(reg_set->regs[c].reg)][reg_set->regs[c].version].refcount++;
+            codegen_reg_stats.reuses++;
             break;
         }
 
@@ -650,24 +780,27 @@ codegen_reg_alloc_read_reg(codeblock_t *block, ir_reg_t ir_reg, int *host_reg_id
     }
 
     if (c == reg_set->nr_regs) {
-        /*No unused registers. Search for an unlocked register with no pending reads*/
-        for (c = 0; c < reg_set->nr_regs; c++) {
-            if (!(reg_set->locked & (1 << c)) && IREG_GET_REG(reg_set->regs[c].reg) != IREG_INVALID && !ir_get_refcount(reg_set->regs[c]))
-                break;
-        }
-        if (c == reg_set->nr_regs) {
-            /*Search for any unlocked register*/
+        if (codegen_reg_spill_furthest)
+            c = codegen_reg_pick_spill(reg_set);
+        else {
+            /*No unused registers. Search for an unlocked register with no pending reads*/
             for (c = 0; c < reg_set->nr_regs; c++) {
-                if (!(reg_set->locked & (1 << c)))
+                if (!(reg_set->locked & (1 << c)) && IREG_GET_REG(reg_set->regs[c].reg) != IREG_INVALID && !ir_get_refcount(reg_set->regs[c]))
                     break;
             }
+            if (c == reg_set->nr_regs) {
+                /*Search for any unlocked register*/
+                for (c = 0; c < reg_set->nr_regs; c++) {
+                    if (!(reg_set->locked & (1 << c)))
+                        break;
+                }
+            }
+        }
 #ifndef RELEASE_BUILD
-            if (c == reg_set->nr_regs)
-                fatal("codegen_reg_alloc_read_reg - out of registers\n");
+        if (c == reg_set->nr_regs)
+            fatal("codegen_reg_alloc_read_reg - out of registers\n");
 #endif
-        }
-        if (reg_set->dirty[c])
-            codegen_reg_writeback(reg_set, block, c, 1);
+        codegen_reg_spill(reg_set, block, c);
         codegen_reg_load(reg_set, block, c, ir_reg);
         reg_set->locked |= (1 << c);
         reg_set->dirty[c] = 0;
@@ -727,25 +860,28 @@ codegen_reg_alloc_write_reg(codeblock_t *block, ir_reg_t ir_reg)
     }
 
     if (c == reg_set->nr_regs) {
-        /*Search for unused registers*/
-        for (c = 0; c < reg_set->nr_regs; c++) {
-            if (ir_reg_is_invalid(reg_set->regs[c]))
-                break;
-        }
-
-        if (c == reg_set->nr_regs) {
-            /*No unused registers. Search for an unlocked register*/
+        if (codegen_reg_spill_furthest)
+            c = codegen_reg_pick_spill(reg_set);
+        else {
+            /*Search for unused registers*/
             for (c = 0; c < reg_set->nr_regs; c++) {
-                if (!(reg_set->locked & (1 << c)))
+                if (ir_reg_is_invalid(reg_set->regs[c]))
                     break;
             }
+
+            if (c == reg_set->nr_regs) {
+                /*No unused registers. Search for an unlocked register*/
+                for (c = 0; c < reg_set->nr_regs; c++) {
+                    if (!(reg_set->locked & (1 << c)))
+                        break;
+                }
+            }
+        }
 #ifndef RELEASE_BUILD
-            if (c == reg_set->nr_regs)
-                fatal("codegen_reg_alloc_write_reg - out of registers\n");
+        if (c == reg_set->nr_regs)
+            fatal("codegen_reg_alloc_write_reg - out of registers\n");
 #endif
-            if (reg_set->dirty[c])
-                codegen_reg_writeback(reg_set, block, c, 1);
-        }
+        codegen_reg_spill(reg_set, block, c);
     }
 
     reg_set->regs[c].reg     = ir_reg.reg;
@@ -910,3 +1046,95 @@ codegen_reg_process_dead_list(ir_data_t *ir)
         reg_dead_list = regv->next;
     }
 }
+
+void
+codegen_reg_analyse(ir_data_t *ir)
+{
+    uint16_t next_pos[IREG_COUNT];
+    uint8_t  next_wo[IREG_COUNT];
+    uint16_t next_barrier = UOP_NR_MAX;
+
+    for (int c = 0; c < IREG_COUNT; c++) {
+        next_pos[c]     = UOP_NR_MAX;
+        next_wo[c]      = 0;
+        reg_next_use[c] = UOP_NR_MAX;
+        reg_next_wo[c]  = 0;
+    }
+    cur_uop = 0;
+
+    /*Walk the block backwards, so that the next reference to each register
+      is known when each uOP is reached*/
+    for (int c = ir->wr_pos - 1; c >= 0; c--) {
+        const uop_t    *uop    = &ir->uops[c];
+        const ir_reg_t *ops[4] = { &uop->src_reg_a, &uop->src_reg_b, &uop->src_reg_c, &uop->dest_reg_a };
+        int             wo;
+
+        uop_next_wo[c] = 0;
+        if ((uop->type & UOP_MASK) == UOP_INVALID) {
+            uop_next_barrier[c] = next_barrier;
+            for (int op = 0; op < 4; op++)
+                uop_next_use[c][op] = UOP_NR_MAX;
+            continue;
+        }
+
+        if (uop->type & (UOP_TYPE_BARRIER | UOP_TYPE_ORDER_BARRIER | UOP_TYPE_JUMP))
+            next_barrier = c;
+        uop_next_barrier[c] = next_barrier;
+
+        for (int op = 0; op < 4; op++) {
+            if (ir_reg_is_invalid(*ops[op])) {
+                uop_next_use[c][op] = UOP_NR_MAX;
+                continue;
+            }
+            uop_next_use[c][op] = next_pos[IREG_GET_REG(ops[op]->reg)];
+            if (next_wo[IREG_GET_REG(ops[op]->reg)])
+                uop_next_wo[c] |= (1 << op);
+        }
+
+        /*A destination is write only if the uOP does not also read it, and
+          it is written in full rather than merged into its parent register*/
+        wo = !ir_reg_is_invalid(uop->dest_reg_a) && reg_is_native_size(uop->dest_reg_a);
+        for (int op = 0; op < 3; op++) {
+            if (!ir_reg_is_invalid(*ops[op]) && (IREG_GET_REG(ops[op]->reg) == IREG_GET_REG(uop->dest_reg_a.reg)))
+                wo = 0;
+        }
+
+        for (int op = 0; op < 4; op++) {
+            if (!ir_reg_is_invalid(*ops[op])) {
+                next_pos[IREG_GET_REG(ops[op]->reg)] = c;
+                next_wo[IREG_GET_REG(ops[op]->reg)]  = 0;
+            }
+        }
+        if (wo)
+            next_wo[IREG_GET_REG(uop->dest_reg_a.reg)] = 1;
+    }
+}
+
+void
+codegen_reg_set_uop(ir_data_t *ir, int uop_nr)
+{
+    const uop_t    *uop    = &ir->uops[uop_nr];
+    const ir_reg_t *ops[4] = { &uop->src_reg_a, &uop->src_reg_b, &uop->src_reg_c, &uop->dest_reg_a };
+
+    cur_uop = uop_nr;
+    for (int op = 0; op < 4; op++) {
+        if (!ir_reg_is_invalid(*ops[op])) {
+            reg_next_use[IREG_GET_REG(ops[op]->reg)] = uop_next_use[uop_nr][op];
+            reg_next_wo[IREG_GET_REG(ops[op]->reg)]  = (uop_next_wo[uop_nr] >> op) & 1;
+        }
+    }
+}
+
+void
+codegen_reg_block_end(codeblock_t *block)
+{
+    codegen_reg_stats.blocks++;
+
+    codegen_reg_log("codegen_reg: block %08x: %i loads, %i stores, %i reuses, %i spills, %i stores elided\n",
+                    block->pc,
+                    (int) (codegen_reg_stats.loads - block_start_stats.loads),
+                    (int) (codegen_reg_stats.stores - block_start_stats.stores),
+                    (int) (codegen_reg_stats.reuses - block_start_stats.reuses),
+                    (int) (codegen_reg_stats.spills - block_start_stats.spills),
+                    (int) (codegen_reg_stats.stores_elided - block_start_stats.stores_elided));
+}
@@ -423,4 +423,35 @@ void codegen_reg_rename(codeblock_t *block, ir_reg_t src, ir_reg_t dst);
 
 void codegen_reg_mark_as_required(void);
 void codegen_reg_process_dead_list(struct ir_data_t *ir);
+
+/*Compute whole-block next use information for the register allocator. Must
+  be called once the IR is final, before it is compiled.*/
+void codegen_reg_analyse(struct ir_data_t *ir);
+/*Tell the register allocator which uOP is being compiled*/
+void codegen_reg_set_uop(struct ir_data_t *ir, int uop_nr);
+/*Account for a compiled block in codegen_reg_stats*/
+void codegen_reg_block_end(codeblock_t *block);
+
+/*When set (the default), the register spilled is the one whose next use in
+  the block is furthest away, and write backs of registers that will be
+  overwritten before anything can observe them are skipped. When clear, the
+  allocator picks the first register it can evict, as it used to; useful for
+  comparing the counters below.*/
+extern int codegen_reg_spill_furthest;
+
+typedef struct codegen_reg_stats_t {
+    uint64_t blocks;
+    /*Guest registers loaded into host registers*/
+    uint64_t loads;
+    /*Guest registers written back from host registers*/
+    uint64_t stores;
+    /*Reads served by a host register that already held the value*/
+    uint64_t reuses;
+    /*Write backs skipped because the value is dead*/
+    uint64_t stores_elided;
+    /*Host registers evicted to make room for another value*/
+    uint64_t spills;
+} codegen_reg_stats_t;
+
+extern codegen_reg_stats_t codegen_reg_stats;
 #endif
@@ -69,6 +69,7 @@
 #include <86box/gameport.h>
 #include <86box/keyboard.h>
 #include <86box/machine.h>
+#include <86box/mem.h>
 #include <86box/mouse.h>
 #include <86box/thread.h>
 #include <86box/network.h>
@@ -80,6 +81,7 @@
 #include <86box/mo.h>
 #include <86box/scsi_tape.h>
 #include <86box/sound.h>
+#include <86box/sound_mixer.h>
 #include <86box/midi.h>
 #include <86box/snd_mpu401.h>
 #include <86box/video.h>
@@ -594,6 +596,7 @@ load_machine(void)
         mem_size = machine_get_max_ram(machine);
 
     cpu_use_dynarec = !!ini_section_get_int(cat, "cpu_use_dynarec", 0);
+    mem_tlb_size    = ini_section_get_int(cat, "tlb_size", MMU_TLB_DEFAULT);
     fpu_softfloat = !!ini_section_get_int(cat, "fpu_softfloat", 0);
     if ((fpu_type != FPU_NONE) && machine_has_flags(machine, MACHINE_SOFTFLOAT_ONLY))
         fpu_softfloat = 1;
@@ -714,6 +717,7 @@ load_video(void)
     da2_standalone_enabled           = !!ini_section_get_int(cat, "da2", 0);
     show_second_monitors             = !!ini_section_get_int(cat, "show_second_monitors", 1);
     video_fullscreen_scale_maximized = !!ini_section_get_int(cat, "video_fullscreen_scale_maximized", 0);
+    vid_render_thread                = !!ini_section_get_int(cat, "render_thread", 0);
 
     vid_cga_comp_brightness = ini_section_get_int(cat, "vid_cga_comp_brightness", 0);
     vid_cga_comp_sharpness  = ini_section_get_int(cat, "vid_cga_comp_sharpness", 0);
@@ -954,6 +958,10 @@ load_sound(void)
         fm_driver = FM_DRV_NUKED;
     }
 
+    fm_thread = !!ini_section_get_int(cat, "fm_thread", 0);
+
+    sound_mixer_enabled = !!ini_section_get_int(cat, "sound_mixer", 1);
+
     p = ini_section_get_string(cat, "sound_output_device", "");
     strncpy(sound_output_device, p, sizeof(sound_output_device) - 1);
     sound_output_device[sizeof(sound_output_device) - 1] = '\0';
@@ -1524,6 +1532,16 @@ load_hard_disks(void)
 
     hdd_audio_load_profiles();
 
+    hdd_image_async                = !!ini_section_get_int(cat, "async_io", 0);
+    hdd_image_cache_size           = ini_section_get_int(cat, "cache_size", 0);
+    hdd_image_cache_policy         = ini_section_get_int(cat, "cache_policy", HDD_IMAGE_CACHE_WRITE_THROUGH);
+    hdd_image_cache_flush_interval = ini_section_get_int(cat, "cache_flush_interval", 5);
+    hdd_image_mmap                 = !!ini_section_get_int(cat, "mmap", 0);
+    if ((hdd_image_cache_policy < HDD_IMAGE_CACHE_WRITE_THROUGH) || (hdd_image_cache_policy > HDD_IMAGE_CACHE_WRITE_BACK_SYNC))
+        hdd_image_cache_policy = HDD_IMAGE_CACHE_WRITE_THROUGH;
+    if (hdd_image_cache_flush_interval < 1)
+        hdd_image_cache_flush_interval = 1;
+
     memset(temp, '\0', sizeof(temp));
     for (uint8_t c = 0; c < HDD_NUM; c++) {
         sprintf(temp, "hdd_%02i_parameters", c + 1);
@@ -3087,6 +3105,11 @@ save_machine(void)
 
     ini_section_set_int(cat, "cpu_use_dynarec", cpu_use_dynarec);
 
+    if (mem_tlb_size == MMU_TLB_DEFAULT)
+        ini_section_delete_var(cat, "tlb_size");
+    else
+        ini_section_set_int(cat, "tlb_size", mem_tlb_size);
+
     if (fpu_softfloat == 0)
         ini_section_delete_var(cat, "fpu_softfloat");
     else
@@ -3190,6 +3213,11 @@ save_video(void)
     else
         ini_section_set_int(cat, "video_fullscreen_scale_maximized", video_fullscreen_scale_maximized);
 
+    if (vid_render_thread == 0)
+        ini_section_delete_var(cat, "render_thread");
+    else
+        ini_section_set_int(cat, "render_thread", vid_render_thread);
+
     ini_delete_section_if_empty(config, cat);
 }
 
@@ -3344,6 +3372,16 @@ save_sound(void)
     else
         ini_section_set_string(cat, "fm_driver", "ymfm");
 
+    if (fm_thread)
+        ini_section_set_int(cat, "fm_thread", fm_thread);
+    else
+        ini_section_delete_var(cat, "fm_thread");
+
+    if (sound_mixer_enabled)
+        ini_section_delete_var(cat, "sound_mixer");
+    else
+        ini_section_set_int(cat, "sound_mixer", sound_mixer_enabled);
+
     if (sound_output_device[0] == '\0')
         ini_section_delete_var(cat, "sound_output_device");
     else
@@ -3929,6 +3967,31 @@ save_hard_disks(void)
         }
     }
 
+    if (hdd_image_async)
+        ini_section_set_int(cat, "async_io", hdd_image_async);
+    else
+        ini_section_delete_var(cat, "async_io");
+
+    if (hdd_image_cache_size > 0)
+        ini_section_set_int(cat, "cache_size", hdd_image_cache_size);
+    else
+        ini_section_delete_var(cat, "cache_size");
+
+    if (hdd_image_cache_policy != HDD_IMAGE_CACHE_WRITE_THROUGH)
+        ini_section_set_int(cat, "cache_policy", hdd_image_cache_policy);
+    else
+        ini_section_delete_var(cat, "cache_policy");
+
+    if (hdd_image_cache_flush_interval != 5)
+        ini_section_set_int(cat, "cache_flush_interval", hdd_image_cache_flush_interval);
+    else
+        ini_section_delete_var(cat, "cache_flush_interval");
+
+    if (hdd_image_mmap)
+        ini_section_set_int(cat, "mmap", hdd_image_mmap);
+    else
+        ini_section_delete_var(cat, "mmap");
+
     ini_delete_section_if_empty(config, cat);
 }
 
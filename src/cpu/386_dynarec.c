@@ -513,6 +513,13 @@ exec386_dynarec_dyn(void)
     }
 
 #    ifdef USE_NEW_DYNAREC
+    /* A block that was compiled in a previous session, and whose code has
+       not changed since, skips the marking pass and is compiled right away. */
+    if (!valid_block && !cpu_state.abrt && codegen_cache_prime(phys_addr)) {
+        block       = &codeblock[block_current];
+        valid_block = 1;
+    }
+
     if (valid_block && (block->flags & CODEBLOCK_WAS_RECOMPILED))
 #    else
     if (valid_block && block->was_recompiled)
@@ -52,6 +52,13 @@
 extern void codegen_init(void);
 extern void codegen_flush(void);
 
+#ifdef USE_NEW_DYNAREC
+/*Persistent profile of compiled blocks, used to compile them on first sight
+  in the next session*/
+extern void codegen_cache_load(const char *fn);
+extern void codegen_cache_save(void);
+#endif
+
 /*Current physical page of block being recompiled. -1 if no recompilation taking place */
 extern uint32_t recomp_page;
 extern int      codegen_in_recompile;
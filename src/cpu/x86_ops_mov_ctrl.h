@@ -216,8 +216,7 @@ opMOV_CRx_r_a16(uint32_t fetchdat)
             cr2 = cpu_state.regs[cpu_rm].l;
             break;
         case 3:
-            cr3 = cpu_state.regs[cpu_rm].l;
-            flushmmucache();
+            flushmmucache_cr3(cpu_state.regs[cpu_rm].l);
             break;
         case 4:
             if (cpu_has_feature(CPU_FEATURE_CR4)) {
@@ -280,8 +279,7 @@ opMOV_CRx_r_a32(uint32_t fetchdat)
             cr2 = cpu_state.regs[cpu_rm].l;
             break;
         case 3:
-            cr3 = cpu_state.regs[cpu_rm].l;
-            flushmmucache();
+            flushmmucache_cr3(cpu_state.regs[cpu_rm].l);
             break;
         case 4:
             if (cpu_has_feature(CPU_FEATURE_CR4)) {
@@ -53,6 +53,7 @@
 #include <86box/mem.h>
 #include <86box/plat.h>
 #include <86box/rom.h>
+#include <86box/snapshot.h>
 #include <86box/sound.h>
 #include <86box/ui.h>
 
@@ -60,6 +61,7 @@
 
 static device_t        *devices[DEVICE_MAX];
 static void            *device_priv[DEVICE_MAX];
+static uint8_t          device_restored[DEVICE_MAX];
 static device_context_t device_current;
 static device_context_t device_prev;
 static void            *device_common_priv;
@@ -518,6 +520,118 @@ device_reset_all(uint32_t match_flags)
     }
 }
 
+static const char *
+device_state_name(const device_t *dev)
+{
+    return dev->internal_name ? dev->internal_name : dev->name;
+}
+
+/* Return the name of the first device in use that can not save its state,
+   or NULL if they all can. A snapshot of such a machine could not be
+   restored to a consistent state, so none is taken. */
+const char *
+device_find_unsaved(void)
+{
+    const char *name;
+
+    for (uint16_t c = 0; c < DEVICE_MAX; c++) {
+        if ((devices[c] != NULL) && ((devices[c]->save == NULL) || (devices[c]->load == NULL))) {
+            name = device_state_name(devices[c]);
+            return name ? name : "(unnamed)";
+        }
+    }
+
+    return NULL;
+}
+
+/* Write one DEV chunk per device slot in use. */
+void
+device_save_state(snapshot_t *snap)
+{
+    char        reason[512];
+    const char *name = device_find_unsaved();
+
+    if (name != NULL) {
+        snprintf(reason, sizeof(reason), "\"%s\" has no save state support", name);
+        snapshot_fail(snap, reason);
+        return;
+    }
+
+    for (uint16_t c = 0; c < DEVICE_MAX; c++) {
+        if (devices[c] != NULL) {
+            uint32_t len;
+
+            name = device_state_name(devices[c]);
+            len  = name ? (uint32_t) strlen(name) : 0;
+
+            snapshot_chunk_begin(snap, SNAPSHOT_CHUNK_DEV, c);
+            snapshot_write_var(snap, len);
+            snapshot_write(snap, name, len);
+            devices[c]->save(device_priv[c], snap);
+            snapshot_chunk_end(snap);
+        }
+    }
+}
+
+void
+device_load_state_begin(void)
+{
+    memset(device_restored, 0x00, sizeof(device_restored));
+}
+
+/* Every device in use must have been restored, or it would keep running
+   with a state that does not match the rest of the machine. */
+void
+device_load_state_end(snapshot_t *snap)
+{
+    char        reason[512];
+    const char *name;
+
+    for (uint16_t c = 0; c < DEVICE_MAX; c++) {
+        if ((devices[c] != NULL) && !device_restored[c]) {
+            name = device_state_name(devices[c]);
+            snprintf(reason, sizeof(reason), "no saved state for \"%s\"", name ? name : "(unnamed)");
+            snapshot_fail(snap, reason);
+            return;
+        }
+    }
+}
+
+void
+device_load_state(snapshot_t *snap, int slot)
+{
+    char        name[256];
+    char        reason[512];
+    const char *cur;
+    uint32_t    len;
+
+    if ((slot < 0) || (slot >= DEVICE_MAX) || (devices[slot] == NULL) || device_restored[slot]) {
+        snapshot_fail(snap, "device layout mismatch");
+        return;
+    }
+
+    if (snapshot_read_var(snap, len) || (len >= sizeof(name)) || snapshot_read(snap, name, len)) {
+        snapshot_fail(snap, "bad device chunk");
+        return;
+    }
+    name[len] = '\0';
+
+    cur = device_state_name(devices[slot]);
+    if ((cur == NULL) || strcmp(cur, name)) {
+        snapshot_fail(snap, "device layout mismatch");
+        return;
+    }
+
+    if (devices[slot]->load == NULL) {
+        snprintf(reason, sizeof(reason), "\"%s\" has no save state support", name);
+        snapshot_fail(snap, reason);
+        return;
+    }
+
+    devices[slot]->load(device_priv[slot], snap);
+    device_restored[slot] = 1;
+}
+
 void *
 device_find_first_priv(uint32_t match_flags)
 {
@@ -20,6 +20,7 @@
 #include <string.h>
 #include <stdarg.h>
 #define HAVE_STDARG_H
+#include <stddef.h>
 #include <wchar.h>
 #include <86box/86box.h>
 #include "cpu.h"
@@ -38,6 +39,7 @@
 #include <86box/fdc.h>
 #include <86box/pci.h>
 #include <86box/keyboard.h>
+#include <86box/snapshot.h>
 
 #define STAT_PARITY        0x80
 #define STAT_RTIMEOUT      0x40
@@ -2878,6 +2880,65 @@ kbc_at_set_irq(int num, uint16_t irq, void *priv)
     dev->irq[num] = irq;
 }
 
+static void
+kbc_at_save(void *priv, snapshot_t *snap)
+{
+    atkbc_t *dev = (atkbc_t *) priv;
+
+    snapshot_write(snap, dev, offsetof(atkbc_t, kbc_poll_timer));
+    timer_save_state(snap, &dev->kbc_poll_timer);
+    timer_save_state(snap, &dev->kbc_dev_poll_timer);
+    timer_save_state(snap, &dev->pulse_cb);
+    snapshot_write_var(snap, fast_reset);
+
+    for (int i = 0; i < 2; i++) {
+        if (kbc_at_ports[i] != NULL) {
+            snapshot_write_var(snap, kbc_at_ports[i]->wantcmd);
+            snapshot_write_var(snap, kbc_at_ports[i]->dat);
+            snapshot_write_var(snap, kbc_at_ports[i]->out_new);
+        }
+    }
+}
+
+static void
+kbc_at_load(void *priv, snapshot_t *snap)
+{
+    atkbc_t *dev = (atkbc_t *) priv;
+    uint8_t  enable[2];
+    uint16_t base[2];
+
+    /* The port handlers have to be moved by hand, so keep the current
+       mapping around until the saved one has been read. */
+    for (int i = 0; i < 2; i++) {
+        enable[i] = dev->handler_enable[i];
+        base[i]   = dev->base_addr[i];
+    }
+
+    snapshot_read(snap, dev, offsetof(atkbc_t, kbc_poll_timer));
+    timer_load_state(snap, &dev->kbc_poll_timer);
+    timer_load_state(snap, &dev->kbc_dev_poll_timer);
+    timer_load_state(snap, &dev->pulse_cb);
+    snapshot_read_var(snap, fast_reset);
+
+    for (int i = 0; i < 2; i++) {
+        if (kbc_at_ports[i] != NULL) {
+            snapshot_read_var(snap, kbc_at_ports[i]->wantcmd);
+            snapshot_read_var(snap, kbc_at_ports[i]->dat);
+            snapshot_read_var(snap, kbc_at_ports[i]->out_new);
+        }
+    }
+
+    for (int i = 0; i < 2; i++) {
+        uint8_t  new_enable = dev->handler_enable[i];
+        uint16_t new_base   = dev->base_addr[i];
+
+        dev->handler_enable[i] = enable[i];
+        dev->base_addr[i]      = base[i];
+        if ((new_enable != enable[i]) || (new_base != base[i]))
+            kbc_at_port_handler(i, new_enable, new_base, dev);
+    }
+}
+
 static void *
 kbc_at_init(const device_t *info)
 {
@@ -3052,5 +3113,7 @@ const device_t kbc_at_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = kbc_at_save,
+    .load          = kbc_at_load
 };
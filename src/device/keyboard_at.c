@@ -15,6 +15,7 @@
  *          Copyright 2017-2023 Fred N. van Kempen.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -26,6 +27,7 @@
 #include <86box/keyboard.h>
 #include <86box/mouse.h>
 #include <86box/machine.h>
+#include <86box/snapshot.h>
 
 #define FIFO_SIZE      16
 
@@ -6180,6 +6182,41 @@ keyboard_at_close(void *priv)
     free(dev);
 }
 
+/* Everything from the type up to the pointers set up at init, and the
+   scan code set globals. */
+static void
+keyboard_at_save(void *priv, snapshot_t *snap)
+{
+    atkbc_dev_t *dev = (atkbc_dev_t *) priv;
+
+    snapshot_write(snap, &dev->type, offsetof(atkbc_dev_t, scan) - offsetof(atkbc_dev_t, type));
+    snapshot_write_var(snap, keyboard_set3_flags);
+    snapshot_write_var(snap, keyboard_set3_all_repeat);
+    snapshot_write_var(snap, keyboard_set3_all_break);
+    snapshot_write_var(snap, keyboard_mode);
+    snapshot_write_var(snap, keyboard_scan);
+    snapshot_write_var(snap, is_special);
+    snapshot_write_var(snap, bat_counter);
+}
+
+static void
+keyboard_at_load(void *priv, snapshot_t *snap)
+{
+    atkbc_dev_t *dev = (atkbc_dev_t *) priv;
+
+    snapshot_read(snap, &dev->type, offsetof(atkbc_dev_t, scan) - offsetof(atkbc_dev_t, type));
+    snapshot_read_var(snap, keyboard_set3_flags);
+    snapshot_read_var(snap, keyboard_set3_all_repeat);
+    snapshot_read_var(snap, keyboard_set3_all_break);
+    snapshot_read_var(snap, keyboard_mode);
+    snapshot_read_var(snap, keyboard_scan);
+    snapshot_read_var(snap, is_special);
+    if (snapshot_read_var(snap, bat_counter))
+        return;
+
+    keyboard_at_set_scancode_set(dev);
+}
+
 static const device_config_t keyboard_at_config[] = {
   // clang-format off
     {
@@ -6242,7 +6279,9 @@ const device_t keyboard_at_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = keyboard_at_config
+    .config        = keyboard_at_config,
+    .save          = keyboard_at_save,
+    .load          = keyboard_at_load
 };
 
 const device_t keyboard_ax_device = {
@@ -6256,7 +6295,9 @@ const device_t keyboard_ax_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = keyboard_at_save,
+    .load          = keyboard_at_load
 };
 
 const device_t keyboard_ps2_device = {
@@ -6270,7 +6311,9 @@ const device_t keyboard_ps2_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = keyboard_ps2_config
+    .config        = keyboard_ps2_config,
+    .save          = keyboard_at_save,
+    .load          = keyboard_at_load
 };
 
 const device_t keyboard_ps55_device = {
@@ -6284,7 +6327,9 @@ const device_t keyboard_ps55_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = keyboard_at_save,
+    .load          = keyboard_at_load
 };
 
 const device_t keyboard_at_generic_device = {
@@ -6298,6 +6343,8 @@ const device_t keyboard_at_generic_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = keyboard_at_config
+    .config        = keyboard_at_config,
+    .save          = keyboard_at_save,
+    .load          = keyboard_at_load
 };
 
@@ -2,6 +2,7 @@
    see COPYING for more details
 */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,6 +23,7 @@
 #include <86box/device.h>
 #include <86box/machine.h>
 #include <86box/plat_fallthrough.h>
+#include <86box/snapshot.h>
 
 static int    next_inst               = 0;
 static int    lpt_3bc_used            = 0;
@@ -1013,6 +1015,47 @@ lpt_reset(void *priv)
     }
 }
 
+static void
+lpt_save(void *priv, snapshot_t *snap)
+{
+    lpt_t *dev = (lpt_t *) priv;
+
+    snapshot_write(snap, dev, offsetof(lpt_t, dt));
+    snapshot_write_var(snap, dev->char_read);
+    snapshot_write_var(snap, dev->char_write);
+    if (dev->fifo != NULL) {
+        snapshot_write(snap, dev->fifo, offsetof(fifo16_t, priv));
+        snapshot_write_var(snap, dev->fifo->tag);
+        snapshot_write_var(snap, dev->fifo->buf);
+    }
+    timer_save_state(snap, &dev->fifo_out_timer);
+    timer_save_state(snap, &dev->char_in_timer);
+}
+
+static void
+lpt_load(void *priv, snapshot_t *snap)
+{
+    lpt_t   *dev  = (lpt_t *) priv;
+    uint16_t addr = dev->addr;
+    uint16_t new_addr;
+
+    snapshot_read(snap, dev, offsetof(lpt_t, dt));
+    snapshot_read_var(snap, dev->char_read);
+    snapshot_read_var(snap, dev->char_write);
+    if (dev->fifo != NULL) {
+        snapshot_read(snap, dev->fifo, offsetof(fifo16_t, priv));
+        snapshot_read_var(snap, dev->fifo->tag);
+        snapshot_read_var(snap, dev->fifo->buf);
+    }
+    timer_load_state(snap, &dev->fifo_out_timer);
+    timer_load_state(snap, &dev->char_in_timer);
+
+    /* The EPP and ECP ranges depend on the mode, so always map again. */
+    new_addr  = dev->addr;
+    dev->addr = addr;
+    lpt_port_setup(dev, new_addr);
+}
+
 static void *
 lpt_init(const device_t *info)
 {
@@ -1135,5 +1178,7 @@ const device_t lpt_port_device = {
     .available     = NULL,
     .speed_changed = lpt_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = lpt_save,
+    .load          = lpt_load
 };
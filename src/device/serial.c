@@ -17,6 +17,7 @@
  *          Copyright 2017-2020 Fred N. van Kempen.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -35,6 +36,7 @@
 #include <86box/fifo.h>
 #include <86box/serial.h>
 #include <86box/mouse.h>
+#include <86box/snapshot.h>
 
 serial_port_t com_ports[SERIAL_MAX];
 
@@ -972,6 +974,65 @@ serial_reset(void *priv)
     }
 }
 
+static void
+serial_fifo_save(snapshot_t *snap, fifo64_t *fifo)
+{
+    if (fifo != NULL) {
+        snapshot_write(snap, fifo, offsetof(fifo64_t, priv));
+        snapshot_write_var(snap, fifo->tag);
+        snapshot_write_var(snap, fifo->buf);
+    }
+}
+
+static void
+serial_fifo_load(snapshot_t *snap, fifo64_t *fifo)
+{
+    if (fifo != NULL) {
+        snapshot_read(snap, fifo, offsetof(fifo64_t, priv));
+        snapshot_read_var(snap, fifo->tag);
+        snapshot_read_var(snap, fifo->buf);
+    }
+}
+
+static void
+serial_save(void *priv, snapshot_t *snap)
+{
+    serial_t *dev = (serial_t *) priv;
+
+    snapshot_write(snap, dev, offsetof(serial_t, rcvr_fifo));
+    serial_fifo_save(snap, (fifo64_t *) dev->rcvr_fifo);
+    serial_fifo_save(snap, (fifo64_t *) dev->xmit_fifo);
+    timer_save_state(snap, &dev->transmit_timer);
+    timer_save_state(snap, &dev->timeout_timer);
+    timer_save_state(snap, &dev->receive_timer);
+    snapshot_write_var(snap, dev->clock_src);
+    snapshot_write_var(snap, dev->transmit_period);
+}
+
+static void
+serial_load(void *priv, snapshot_t *snap)
+{
+    serial_t *dev  = (serial_t *) priv;
+    uint16_t  base = dev->base_address;
+    uint16_t  new_base;
+
+    snapshot_read(snap, dev, offsetof(serial_t, rcvr_fifo));
+    serial_fifo_load(snap, (fifo64_t *) dev->rcvr_fifo);
+    serial_fifo_load(snap, (fifo64_t *) dev->xmit_fifo);
+    timer_load_state(snap, &dev->transmit_timer);
+    timer_load_state(snap, &dev->timeout_timer);
+    timer_load_state(snap, &dev->receive_timer);
+    snapshot_read_var(snap, dev->clock_src);
+    snapshot_read_var(snap, dev->transmit_period);
+
+    /* A Super I/O chip may have moved the port since the snapshot. */
+    new_base = dev->base_address;
+    if (new_base != base) {
+        dev->base_address = base;
+        serial_setup(dev, new_base, dev->irq);
+    }
+}
+
 static void *
 serial_init(const device_t *info)
 {
@@ -1084,7 +1145,9 @@ const device_t ns8250_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = serial_save,
+    .load          = serial_load
 };
 
 const device_t ns8250_pcjr_3f8_device = {
@@ -1098,7 +1161,9 @@ const device_t ns8250_pcjr_3f8_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = serial_save,
+    .load          = serial_load
 };
 
 const device_t ns8250_pcjr_2f8_device = {
@@ -1112,7 +1177,9 @@ const device_t ns8250_pcjr_2f8_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = serial_save,
+    .load          = serial_load
 };
 
 const device_t ns16450_device = {
@@ -1126,7 +1193,9 @@ const device_t ns16450_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = serial_save,
+    .load          = serial_load
 };
 
 const device_t ns16550_device = {
@@ -1140,7 +1209,9 @@ const device_t ns16550_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = serial_save,
+    .load          = serial_load
 };
 
 const device_t ns16650_device = {
@@ -1154,7 +1225,9 @@ const device_t ns16650_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = serial_save,
+    .load          = serial_load
 };
 
 const device_t ns16750_device = {
@@ -1168,7 +1241,9 @@ const device_t ns16750_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = serial_save,
+    .load          = serial_load
 };
 
 const device_t ns16850_device = {
@@ -1182,7 +1257,9 @@ const device_t ns16850_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = serial_save,
+    .load          = serial_load
 };
 
 const device_t ns16950_device = {
@@ -1196,5 +1273,7 @@ const device_t ns16950_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = serial_save,
+    .load          = serial_load
 };
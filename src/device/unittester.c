@@ -290,9 +290,13 @@ unittester_write(uint16_t port, uint8_t val, UNUSED(void *priv))
                         if (unittester.exit_code > 0x7F)
                             unittester.exit_code = 0x7F;
 
-                        /* Exit somewhat quickly! */
+                        /* Exit somewhat quickly! A batch run still has to report, so
+                           let it end the run instead. */
                         unittester_log("[UT] Exit enabled, exiting with code %02X\n", unittester.exit_code);
-                        exit(unittester.exit_code);
+                        if (batch_mode)
+                            pc_batch_stop(unittester.exit_code);
+                        else
+                            exit(unittester.exit_code);
 
                     } else {
                         /* No - report successful command completion and continue program execution */
@@ -17,6 +17,7 @@
  */
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -46,6 +47,7 @@
 #include <86box/hdd.h>
 #include <86box/rdisk.h>
 #include <86box/version.h>
+#include <86box/snapshot.h>
 
 /* Bits of 'atastat' */
 #define ERR_STAT     0x01 /* Error */
@@ -1783,6 +1785,9 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
                         ui_sb_update_icon(SB_HDD | hdd[ide->hdd_num].bus_type, 1);
                         uint32_t sec_count;
                         double   wait_time;
+                        if ((val != WIN_READ) || (prev != WIN_SETIDLE1))
+                            hdd_image_prefetch(ide->hdd_num, ide_get_sector(ide),
+                                               ide->tf->secount ? ide->tf->secount : 256);
                         if ((val == WIN_READ) && (prev == WIN_SETIDLE1)) {
                             /* Do the callback instantly - this happens on the Intel Monsoon. */
                             (void) hdd_timing_read(&hdd[ide->hdd_num], ide_get_sector(ide), 1);
@@ -3071,6 +3076,129 @@ ide_pnp_config_changed(uint8_t ld, isapnp_device_config_t *config, void *priv)
     }
 }
 
+/* Hard disks only, the ATAPI devices keep their state in their own modules
+   and have no handlers for it yet. The contents of the disk images are not
+   part of a snapshot, they must not have been written to since it was
+   taken. */
+static void
+ide_board_save(snapshot_t *snap, int board)
+{
+    ide_board_t *dev = ide_boards[board];
+    ide_t       *ide;
+
+    snapshot_write(snap, dev, offsetof(ide_board_t, timer));
+    timer_save_state(snap, &dev->timer);
+
+    for (uint8_t d = 0; d < 2; d++) {
+        ide = ide_drives[(board << 1) + d];
+
+        if ((ide->type & ~IDE_SHADOW) == IDE_ATAPI) {
+            snapshot_fail(snap, "ATAPI devices have no save state support");
+            return;
+        }
+
+        snapshot_write(snap, ide, offsetof(ide_t, buffer));
+        if (ide->buffer != NULL)
+            snapshot_write(snap, ide->buffer, 65536 * sizeof(uint16_t));
+        if (ide->sector_buffer != NULL)
+            snapshot_write(snap, ide->sector_buffer, 256 * 512);
+        timer_save_state(snap, &ide->timer);
+        if (!(ide->type & IDE_SHADOW))
+            snapshot_write(snap, ide->tf, sizeof(ide_tf_t));
+        snapshot_write_var(snap, ide->interrupt_drq);
+        snapshot_write_var(snap, ide->pending_delay);
+    }
+}
+
+static void
+ide_board_load(snapshot_t *snap, int board)
+{
+    ide_board_t *dev = ide_boards[board];
+    ide_t       *ide;
+    uint16_t     base[2];
+    int          type;
+
+    base[0] = dev->base[0];
+    base[1] = dev->base[1];
+
+    snapshot_read(snap, dev, offsetof(ide_board_t, timer));
+    timer_load_state(snap, &dev->timer);
+
+    /* The handlers are keyed on the base addresses, move them by hand. */
+    if ((dev->base[0] != base[0]) || (dev->base[1] != base[1])) {
+        uint16_t new_base[2] = { dev->base[0], dev->base[1] };
+
+        dev->base[0] = base[0];
+        dev->base[1] = base[1];
+        ide_remove_handlers(board);
+        dev->base[0] = new_base[0];
+        dev->base[1] = new_base[1];
+        ide_set_handlers(board);
+    }
+
+    for (uint8_t d = 0; d < 2; d++) {
+        ide  = ide_drives[(board << 1) + d];
+        type = ide->type;
+
+        snapshot_read(snap, ide, offsetof(ide_t, buffer));
+        if (snapshot_failed(snap))
+            return;
+        if (ide->type != type) {
+            ide->type = type;
+            snapshot_fail(snap, "IDE drive layout mismatch");
+            return;
+        }
+
+        if (ide->buffer != NULL)
+            snapshot_read(snap, ide->buffer, 65536 * sizeof(uint16_t));
+        if (ide->sector_buffer != NULL)
+            snapshot_read(snap, ide->sector_buffer, 256 * 512);
+        timer_load_state(snap, &ide->timer);
+        if (!(ide->type & IDE_SHADOW))
+            snapshot_read(snap, ide->tf, sizeof(ide_tf_t));
+        snapshot_read_var(snap, ide->interrupt_drq);
+        snapshot_read_var(snap, ide->pending_delay);
+    }
+}
+
+static void
+ide_save(UNUSED(void *priv), snapshot_t *snap)
+{
+    ide_board_save(snap, 0);
+}
+
+static void
+ide_load(UNUSED(void *priv), snapshot_t *snap)
+{
+    ide_board_load(snap, 0);
+}
+
+static void
+ide_2ch_save(UNUSED(void *priv), snapshot_t *snap)
+{
+    ide_board_save(snap, 0);
+    ide_board_save(snap, 1);
+}
+
+static void
+ide_2ch_load(UNUSED(void *priv), snapshot_t *snap)
+{
+    ide_board_load(snap, 0);
+    ide_board_load(snap, 1);
+}
+
+static void
+ide_sec_save(UNUSED(void *priv), snapshot_t *snap)
+{
+    ide_board_save(snap, 1);
+}
+
+static void
+ide_sec_load(UNUSED(void *priv), snapshot_t *snap)
+{
+    ide_board_load(snap, 1);
+}
+
 static void *
 ide_sec_init(const device_t *info)
 {
@@ -3476,7 +3604,9 @@ const device_t ide_isa_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = ide_save,
+    .load          = ide_load
 };
 
 const device_t ide_isa_sec_device = {
@@ -3490,7 +3620,9 @@ const device_t ide_isa_sec_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = ide_sec_save,
+    .load          = ide_sec_load
 };
 
 const device_t ide_isa_2ch_device = {
@@ -3504,7 +3636,9 @@ const device_t ide_isa_2ch_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = ide_2ch_save,
+    .load          = ide_2ch_load
 };
 
 const device_t ide_vlb_device = {
@@ -3518,7 +3652,9 @@ const device_t ide_vlb_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = ide_save,
+    .load          = ide_load
 };
 
 const device_t ide_vlb_sec_device = {
@@ -3532,7 +3668,9 @@ const device_t ide_vlb_sec_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = ide_sec_save,
+    .load          = ide_sec_load
 };
 
 const device_t ide_vlb_2ch_device = {
@@ -3546,7 +3684,9 @@ const device_t ide_vlb_2ch_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = ide_2ch_save,
+    .load          = ide_2ch_load
 };
 
 const device_t ide_pci_device = {
@@ -3560,7 +3700,9 @@ const device_t ide_pci_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = ide_save,
+    .load          = ide_load
 };
 
 const device_t ide_pci_sec_device = {
@@ -3574,7 +3716,9 @@ const device_t ide_pci_sec_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = ide_sec_save,
+    .load          = ide_sec_load
 };
 
 const device_t ide_pci_2ch_device = {
@@ -3588,7 +3732,9 @@ const device_t ide_pci_2ch_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = ide_2ch_save,
+    .load          = ide_2ch_load
 };
 
 const device_t mcide_device = {
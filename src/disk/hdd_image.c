@@ -26,9 +26,11 @@
 #include <errno.h>
 #if defined(__unix__) || defined(__APPLE__)
 #include <unistd.h>
+#include <sys/mman.h>
 #endif
 #ifdef _WIN32
 #include <io.h>
+#include <windows.h>
 #define fsync(fd) _commit(fd)
 #endif
 #define HAVE_STDARG_H
@@ -36,7 +38,9 @@
 #include <86box/path.h>
 #include <86box/plat.h>
 #include <86box/random.h>
+#include <86box/thread.h>
 #include <86box/hdd.h>
+#include <86box/hdd_overlay.h>
 #include "minivhd/minivhd.h"
 #include "minivhd/internal.h"
 
@@ -44,6 +48,121 @@
 #define HDD_IMAGE_HDI 1
 #define HDD_IMAGE_HDX 2
 #define HDD_IMAGE_VHD 3
+#define HDD_IMAGE_OVL 4
+
+#define HDD_IMAGE_REQ_READ    0
+#define HDD_IMAGE_REQ_WRITE   1
+#define HDD_IMAGE_REQ_BARRIER 2 /* Completes once everything before it has. */
+
+#define HDD_IMAGE_PREFETCH_MAX 256       /* Largest prefetch, in sectors. */
+#define HDD_IMAGE_READAHEAD    128       /* Sequential read-ahead, in sectors. */
+#define HDD_IMAGE_WRITE_QUEUE  (4 << 20) /* Queued write bytes before throttling. */
+
+/* Asynchronous image I/O.
+
+   When enabled, each loaded image gets a worker thread which runs the
+   requests queued for it in order. Writes are copied and queued, and the
+   emulation thread carries on right away. Reads can be submitted ahead of
+   time with hdd_image_prefetch(), typically when a controller accepts a
+   command, and are then picked up by hdd_image_read() from the controller's
+   completion callback, which is still scheduled on the emulated drive timing,
+   so what the guest sees does not depend on how fast the host disk is.
+   Sequential reads also get read-ahead.
+
+   Any other access waits for the queue to drain and then runs on the calling
+   thread, so the image file is never used by two threads at once. A failed
+   queued write is logged along with its sectors, and reported by the next
+   hdd_image_sync() of the same image. */
+typedef struct hdd_image_req_t {
+    struct hdd_image_req_t *next;
+    int                     op;
+    uint32_t                sector;
+    uint32_t                count;
+    int                     ret;
+    int                     done;
+    int                     orphan; /* Dropped prefetch, freed by the worker. */
+    uint8_t                *buffer;
+    event_t                *event; /* Set once done is, for reads and barriers. */
+} hdd_image_req_t;
+
+typedef struct hdd_image_async_t {
+    uint8_t          id;
+    int              run;
+    int              busy;
+    int              write_error;
+    uint32_t         queued_bytes;
+    uint32_t         last_end; /* Sector following the last read. */
+    uint32_t         hits;
+    uint32_t         misses;
+    thread_t        *thread;
+    mutex_t         *mutex;
+    event_t         *wake;
+    hdd_image_req_t *head;
+    hdd_image_req_t *tail;
+    hdd_image_req_t *prefetch; /* Only touched by the emulation thread. */
+} hdd_image_async_t;
+
+/* Sector cache for raw, HDI and HDX images.
+
+   The image is cached in blocks of HDD_IMAGE_CACHE_SECTORS sectors, kept in
+   LRU order. Each block tracks which of its sectors are valid and which still
+   have to be written to the image, so a write never has to read the rest of
+   its block first. In write-through mode written blocks go to the image right
+   away. In write-back mode they are written when they are evicted, when the
+   image is synced or closed and, for HDD_IMAGE_CACHE_WRITE_BACK, every
+   hdd_image_cache_flush_interval seconds from pc_onesec(). Misses over
+   several blocks are filled with a single read.
+
+   The cache has its own lock, as the periodic flush and hdd_image_sync()
+   come from the UI thread. */
+#define HDD_IMAGE_CACHE_SHIFT   3
+#define HDD_IMAGE_CACHE_SECTORS (1 << HDD_IMAGE_CACHE_SHIFT)
+#define HDD_IMAGE_CACHE_BLOCK   (HDD_IMAGE_CACHE_SECTORS << 9)
+#define HDD_IMAGE_CACHE_FULL    ((1 << HDD_IMAGE_CACHE_SECTORS) - 1)
+#define HDD_IMAGE_CACHE_RUN     32 /* Most blocks filled by one read. */
+#define HDD_IMAGE_CACHE_FREE    0xffffffff
+
+typedef struct hdd_image_cache_block_t {
+    uint32_t block; /* First sector >> HDD_IMAGE_CACHE_SHIFT, or HDD_IMAGE_CACHE_FREE. */
+    uint8_t  valid; /* One bit per sector. */
+    uint8_t  dirty;
+    int32_t  hash_next;
+    int32_t  prev;
+    int32_t  next;
+} hdd_image_cache_block_t;
+
+typedef struct hdd_image_cache_stats_t {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t writebacks;
+    uint32_t dirty_blocks;
+} hdd_image_cache_stats_t;
+
+typedef struct hdd_image_cache_t {
+    mutex_t                 *mutex;
+    uint32_t                 num_blocks;
+    uint32_t                 run;
+    uint32_t                 hash_mask;
+    int32_t                 *hash;
+    hdd_image_cache_block_t *blocks;
+    uint8_t                 *data;
+    uint8_t                 *run_buf;
+    int32_t                  head; /* Most recently used. */
+    int32_t                  tail; /* Least recently used, evicted first. */
+    int                      secs;
+    hdd_image_cache_stats_t  stats;
+} hdd_image_cache_t;
+
+/* Read-only base image of an overlay, or the target of a commit. */
+typedef struct hdd_image_base_t {
+    FILE     *file;
+    MVHDMeta *vhd;
+    uint32_t  base;
+    uint32_t  sectors;
+    uint32_t  spt;
+    uint32_t  hpc;
+    uint32_t  tracks;
+} hdd_image_base_t;
 
 typedef struct hdd_image_t {
     FILE     *file; /* Used for HDD_IMAGE_RAW, HDD_IMAGE_HDI, and HDD_IMAGE_HDX. */
@@ -51,13 +170,33 @@ typedef struct hdd_image_t {
     uint32_t  base;
     uint32_t  pos;
     uint32_t  last_sector;
-    uint8_t   type; /* HDD_IMAGE_RAW, HDD_IMAGE_HDI, HDD_IMAGE_HDX, or HDD_IMAGE_VHD */
+    uint8_t   type; /* HDD_IMAGE_RAW, HDD_IMAGE_HDI, HDD_IMAGE_HDX, HDD_IMAGE_VHD or HDD_IMAGE_OVL */
     uint8_t   loaded;
     uint8_t   is_block_device; /* 1 if this is a raw block device (e.g., /dev/disk4s1) */
+
+    hdd_image_async_t *async;
+    hdd_image_cache_t *cache;
+
+    hdd_overlay_t    *ovl; /* Used for HDD_IMAGE_OVL. */
+    hdd_image_base_t *ovl_base;
+
+    /* Mapping of the whole image file, see hdd_image_map(). */
+    uint8_t *map;
+    uint64_t map_size;
+    int      map_ro; /* Write-protected images are mapped read-only. */
+#ifdef _WIN32
+    HANDLE map_handle;
+#endif
 } hdd_image_t;
 
 hdd_image_t hdd_images[HDD_NUM];
 
+int hdd_image_async                = 0;
+int hdd_image_cache_size           = 0; /* In MB per image, 0 to disable. */
+int hdd_image_cache_policy         = HDD_IMAGE_CACHE_WRITE_THROUGH;
+int hdd_image_cache_flush_interval = 5;
+int hdd_image_mmap                 = 0;
+
 static char  empty_sector[512];
 #ifndef __unix__
 static char *empty_sector_1mb;
@@ -136,120 +275,1242 @@ image_is_vhd(const char *s, int check_signature)
             if (!fp)
                 return 0;
 
-            bool is_vhd = mvhd_file_is_vhd(fp);
-            fclose(fp);
-            return is_vhd ? 1 : 0;
-        } else
-            return 1;
-    } else
-        return 0;
+            bool is_vhd = mvhd_file_is_vhd(fp);
+            fclose(fp);
+            return is_vhd ? 1 : 0;
+        } else
+            return 1;
+    } else
+        return 0;
+}
+
+int
+image_is_ovl(const char *s, int check_signature)
+{
+    if (!strcasecmp(path_get_extension((char *) s), "OVL"))
+        return check_signature ? hdd_overlay_probe(s) : 1;
+    else
+        return 0;
+}
+
+/* Open an image as the base of an overlay. Overlays can not be stacked. */
+static hdd_image_base_t *
+hdd_image_base_open(const char *fn, int readonly)
+{
+    hdd_image_base_t *base = (hdd_image_base_t *) calloc(1, sizeof(hdd_image_base_t));
+    uint64_t          size = 0;
+    int               vhd_error;
+
+    if (image_is_ovl(fn, 1)) {
+        hdd_image_log("Overlay base %s: can not be an overlay itself\n", fn);
+        free(base);
+        return NULL;
+    }
+
+    if (image_is_vhd(fn, 1)) {
+        base->vhd = mvhd_open(fn, readonly, &vhd_error);
+        if (base->vhd == NULL) {
+            free(base);
+            return NULL;
+        }
+        base->sectors = (uint32_t) (base->vhd->footer.curr_sz >> 9);
+        base->spt     = base->vhd->footer.geom.spt;
+        base->hpc     = base->vhd->footer.geom.heads;
+        base->tracks  = base->vhd->footer.geom.cyl;
+        return base;
+    }
+
+    base->file = plat_fopen(fn, readonly ? "rb" : "rb+");
+    if (base->file == NULL) {
+        free(base);
+        return NULL;
+    }
+
+    if (image_is_hdi(fn)) {
+        if ((fseeko64(base->file, 0x8, SEEK_SET) == -1) || (fread(&base->base, 1, 4, base->file) != 4) ||
+            (fread(&size, 1, 4, base->file) != 4) || (fseeko64(base->file, 0x14, SEEK_SET) == -1) ||
+            (fread(&base->spt, 1, 4, base->file) != 4) || (fread(&base->hpc, 1, 4, base->file) != 4) ||
+            (fread(&base->tracks, 1, 4, base->file) != 4))
+            goto fail;
+    } else if (image_is_hdx(fn, 1)) {
+        base->base = 0x28;
+        if ((fseeko64(base->file, 0x8, SEEK_SET) == -1) || (fread(&size, 1, 8, base->file) != 8) ||
+            (fseeko64(base->file, 0x14, SEEK_SET) == -1) || (fread(&base->spt, 1, 4, base->file) != 4) ||
+            (fread(&base->hpc, 1, 4, base->file) != 4) || (fread(&base->tracks, 1, 4, base->file) != 4))
+            goto fail;
+    } else {
+        if (fseeko64(base->file, 0, SEEK_END) == -1)
+            goto fail;
+        size = ftello64(base->file);
+    }
+    base->sectors = (uint32_t) (size >> 9);
+
+    return base;
+
+fail:
+    fclose(base->file);
+    free(base);
+    return NULL;
+}
+
+static void
+hdd_image_base_close(hdd_image_base_t *base)
+{
+    if (base == NULL)
+        return;
+
+    if (base->vhd != NULL)
+        mvhd_close(base->vhd);
+    else if (base->file != NULL)
+        fclose(base->file);
+    free(base);
+}
+
+static int
+hdd_image_base_read(void *priv, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_base_t *base = (hdd_image_base_t *) priv;
+    size_t            num_read;
+
+    if (base->vhd != NULL) {
+        base->vhd->error = 0;
+        mvhd_read_sectors(base->vhd, sector, count, buffer);
+        return base->vhd->error ? -1 : 0;
+    }
+
+    if (fseeko64(base->file, ((uint64_t) sector << 9) + base->base, SEEK_SET) == -1)
+        return -1;
+    num_read = fread(buffer, 512, count, base->file);
+    if (num_read < count) {
+        /* Past the end of the base, which reads as zeroes. */
+        memset(buffer + (num_read << 9), 0, (size_t) (count - num_read) << 9);
+        if (!feof(base->file))
+            return -1;
+    }
+
+    return 0;
+}
+
+static int
+hdd_image_base_write(void *priv, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_base_t *base = (hdd_image_base_t *) priv;
+
+    if (base->vhd != NULL) {
+        base->vhd->error = 0;
+        mvhd_write_sectors(base->vhd, sector, count, buffer);
+        return base->vhd->error ? -1 : 0;
+    }
+
+    if (fseeko64(base->file, ((uint64_t) sector << 9) + base->base, SEEK_SET) == -1)
+        return -1;
+
+    return (fwrite(buffer, 512, count, base->file) == count) ? 0 : -1;
+}
+
+/* Open an overlay image along with its base, creating it first if asked
+   to, over hdd[id].vhd_parent. */
+static int
+hdd_image_load_overlay(int id, const char *fn, int create)
+{
+    hdd_image_base_t *base;
+    char              base_fn[1024];
+    uint32_t          spt;
+    uint32_t          hpc;
+    uint32_t          tracks;
+
+    if (create) {
+        base = hdd_image_base_open(hdd[id].vhd_parent, 1);
+        if (base == NULL) {
+            hdd_image_log("Overlay %s: unable to open base image '%s'\n", fn, hdd[id].vhd_parent);
+            return 0;
+        }
+        if (!hdd[id].spt || !hdd[id].hpc || !hdd[id].tracks) {
+            hdd[id].spt    = base->spt;
+            hdd[id].hpc    = base->hpc;
+            hdd[id].tracks = base->tracks;
+        }
+        if (!hdd[id].spt || !hdd[id].hpc || !hdd[id].tracks)
+            hdd_image_calc_chs(&hdd[id].tracks, &hdd[id].hpc, &hdd[id].spt, base->sectors >> 11);
+        hdd_image_base_close(base);
+
+        if (hdd_overlay_create(fn, hdd[id].vhd_parent, hdd[id].spt * hdd[id].hpc * hdd[id].tracks,
+                               hdd[id].spt, hdd[id].hpc, hdd[id].tracks) < 0)
+            return 0;
+    }
+
+    hdd_images[id].ovl = hdd_overlay_open(fn, hdd[id].wp);
+    if (hdd_images[id].ovl == NULL)
+        return 0;
+
+    hdd_overlay_get_base_path(hdd_images[id].ovl, base_fn, sizeof(base_fn));
+    hdd_images[id].ovl_base = hdd_image_base_open(base_fn, 1);
+    if (hdd_images[id].ovl_base == NULL) {
+        pclog("hdd_image_load(): Overlay: Unable to open base image '%s' of '%s'\n", base_fn, fn);
+        hdd_overlay_close(hdd_images[id].ovl);
+        hdd_images[id].ovl = NULL;
+        return 0;
+    }
+    hdd_overlay_set_base(hdd_images[id].ovl, hdd_image_base_read, NULL, hdd_images[id].ovl_base);
+
+    hdd_overlay_get_geometry(hdd_images[id].ovl, &spt, &hpc, &tracks);
+    if (spt && hpc && tracks) {
+        hdd[id].spt    = spt;
+        hdd[id].hpc    = hpc;
+        hdd[id].tracks = tracks;
+    }
+    strncpy(hdd[id].vhd_parent, base_fn, sizeof(hdd[id].vhd_parent) - 1);
+
+    hdd_images[id].type        = HDD_IMAGE_OVL;
+    hdd_images[id].last_sector = hdd_overlay_get_sectors(hdd_images[id].ovl) - 1;
+    hdd_images[id].loaded      = 1;
+
+    return 1;
+}
+
+static void
+hdd_image_close_overlay(uint8_t id)
+{
+    hdd_overlay_close(hdd_images[id].ovl);
+    hdd_image_base_close(hdd_images[id].ovl_base);
+    hdd_images[id].ovl      = NULL;
+    hdd_images[id].ovl_base = NULL;
+}
+
+void
+hdd_image_calc_chs(uint32_t *c, uint32_t *h, uint32_t *s, uint32_t size)
+{
+    /* Calculate the geometry from size (in MB), using the algorithm provided in
+    "Virtual Hard Disk Image Format Specification, Appendix: CHS Calculation" */
+    uint64_t ts = ((uint64_t) size) << 11LL;
+    uint32_t spt;
+    uint32_t heads;
+    uint32_t cyl;
+    uint32_t cth;
+
+    if (ts > 65535 * 16 * 255)
+        ts = 65535 * 16 * 255;
+
+    if (ts >= 65535 * 16 * 63) {
+        spt   = 255;
+        heads = 16;
+        cth   = (uint32_t) (ts / spt);
+    } else {
+        spt   = 17;
+        cth   = (uint32_t) (ts / spt);
+        heads = (cth + 1023) / 1024;
+        if (heads < 4)
+            heads = 4;
+        if ((cth >= (heads * 1024)) || (heads > 16)) {
+            spt   = 31;
+            heads = 16;
+            cth   = (uint32_t) (ts / spt);
+        }
+        if (cth >= (heads * 1024)) {
+            spt   = 63;
+            heads = 16;
+            cth   = (uint32_t) (ts / spt);
+        }
+    }
+    cyl = cth / heads;
+    *c  = cyl;
+    *h  = heads;
+    *s  = spt;
+}
+
+static int
+prepare_new_hard_disk(uint8_t id, uint64_t full_size)
+{
+    if (!hdd_images[id].file)
+        return -1;
+
+    /* Skip file creation/expansion for block devices */
+    if (hdd_images[id].is_block_device) {
+        hdd_images[id].last_sector = (uint32_t) (full_size >> 9) - 1;
+        hdd_images[id].loaded = 1;
+        return 1;
+    }
+
+    uint64_t target_size = (full_size + hdd_images[id].base) - ftello64(hdd_images[id].file);
+
+#ifndef __unix__
+    uint32_t size;
+    uint32_t t;
+
+    t    = (uint32_t) (target_size >> 20);     /* Amount of 1 MB blocks. */
+    size = (uint32_t) (target_size & 0xfffff); /* 1 MB mask. */
+
+    empty_sector_1mb = (char *) calloc(1, 1048576);
+
+    /* Temporarily switch off suppression of seen messages so that the
+       progress gets displayed. */
+    pclog_toggle_suppr();
+    pclog("Writing image sectors: [");
+
+    /* First, write all the 1 MB blocks. */
+    if (t > 0) {
+        for (uint32_t i = 0; i < t; i++) {
+            fseek(hdd_images[id].file, 0, SEEK_END);
+            fwrite(empty_sector_1mb, 1, 1048576, hdd_images[id].file);
+            pclog("#");
+        }
+    }
+
+    /* Then, write the remainder. */
+    if (size > 0) {
+        fseek(hdd_images[id].file, 0, SEEK_END);
+        fwrite(empty_sector_1mb, 1, size, hdd_images[id].file);
+        pclog("#");
+    }
+    pclog("]\n");
+    /* Switch the suppression of seen messages back on. */
+    pclog_toggle_suppr();
+
+    free(empty_sector_1mb);
+#else
+    pclog("Creating hard disk image: ");
+    int ret = ftruncate(fileno(hdd_images[id].file), (size_t) target_size);
+
+    if (ret) {
+        pclog("failed\n");
+        fatal("Could not create hard disk image\n");
+    }
+    pclog("OK!\n");
+#endif
+    hdd_images[id].last_sector = (uint32_t) (full_size >> 9) - 1;
+
+    hdd_images[id].loaded = 1;
+
+    return 1;
+}
+
+/* Memory-mapped images.
+
+   When enabled, raw, HDI and HDX image files are mapped whole once they are
+   loaded, and sector reads, writes and zeroing become plain copies into the
+   mapping, with no seek, stdio buffering or flush per command. The host
+   writes the pages back on its own, hdd_image_sync() forces it. Images that
+   can not be mapped (block devices, or too large for the address space) keep
+   using stdio. */
+static void
+hdd_image_unmap(uint8_t id)
+{
+    if (hdd_images[id].map == NULL)
+        return;
+
+#ifdef _WIN32
+    FlushViewOfFile(hdd_images[id].map, 0);
+    UnmapViewOfFile(hdd_images[id].map);
+    CloseHandle(hdd_images[id].map_handle);
+    hdd_images[id].map_handle = NULL;
+#else
+    if (!hdd_images[id].map_ro)
+        msync(hdd_images[id].map, hdd_images[id].map_size, MS_SYNC);
+    munmap(hdd_images[id].map, hdd_images[id].map_size);
+#endif
+
+    hdd_images[id].map      = NULL;
+    hdd_images[id].map_size = 0;
+}
+
+static void
+hdd_image_map(uint8_t id)
+{
+    uint64_t size;
+    uint64_t file_size;
+    void    *map;
+
+    if (!hdd_image_mmap || (hdd_images[id].file == NULL) || (hdd_images[id].type == HDD_IMAGE_VHD) ||
+        hdd_images[id].is_block_device)
+        return;
+
+    /* Never map past the end of the file, touching those pages would fault. */
+    size = ((uint64_t) hdd_images[id].last_sector + 1) << 9;
+    size += hdd_images[id].base;
+    fflush(hdd_images[id].file);
+    if (fseeko64(hdd_images[id].file, 0, SEEK_END) == -1)
+        return;
+    file_size = ftello64(hdd_images[id].file);
+    if (file_size < size)
+        size = file_size;
+    if ((size == 0) || (size != (uint64_t) (size_t) size))
+        return;
+    hdd_images[id].map_ro = !!hdd[id].wp;
+
+#ifdef _WIN32
+    hdd_images[id].map_handle = CreateFileMapping((HANDLE) _get_osfhandle(_fileno(hdd_images[id].file)),
+                                                  NULL, hdd_images[id].map_ro ? PAGE_READONLY : PAGE_READWRITE,
+                                                  (DWORD) (size >> 32), (DWORD) size, NULL);
+    if (hdd_images[id].map_handle == NULL) {
+        hdd_image_log("Hard disk image %i: Unable to map the image\n", id);
+        return;
+    }
+    map = MapViewOfFile(hdd_images[id].map_handle, hdd_images[id].map_ro ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS,
+                        0, 0, (SIZE_T) size);
+    if (map == NULL) {
+        hdd_image_log("Hard disk image %i: Unable to map the image\n", id);
+        CloseHandle(hdd_images[id].map_handle);
+        hdd_images[id].map_handle = NULL;
+        return;
+    }
+#else
+    map = mmap(NULL, (size_t) size, PROT_READ | (hdd_images[id].map_ro ? 0 : PROT_WRITE), MAP_SHARED,
+               fileno(hdd_images[id].file), 0);
+    if (map == MAP_FAILED) {
+        hdd_image_log("Hard disk image %i: Unable to map the image (%s)\n", id, strerror(errno));
+        return;
+    }
+#endif
+
+    hdd_images[id].map      = (uint8_t *) map;
+    hdd_images[id].map_size = size;
+
+    hdd_image_log("Hard disk image %i: Mapped %" PRIu64 " bytes\n", id, size);
+}
+
+static int hdd_image_file_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
+static int hdd_image_file_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
+
+/* Whole sectors of the mapping at a sector, at most count of them. The
+   mapping ends with the file, which may be shorter than the image. */
+static uint32_t
+hdd_image_map_avail(uint8_t id, uint32_t sector, uint32_t count)
+{
+    uint64_t offset = ((uint64_t) sector << 9) + hdd_images[id].base;
+    uint64_t avail  = (offset < hdd_images[id].map_size) ? ((hdd_images[id].map_size - offset) >> 9) : 0;
+
+    return (avail < count) ? (uint32_t) avail : count;
+}
+
+/* Copy sectors out of or into the mapping. Sectors past its end go through
+   stdio, which extends the file on writes, as it does without a mapping. */
+static int
+hdd_image_map_rw(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer, int write)
+{
+    uint64_t offset = ((uint64_t) sector << 9) + hdd_images[id].base;
+    uint32_t avail  = hdd_image_map_avail(id, sector, count);
+    int      ret;
+
+    if (write && hdd_images[id].map_ro)
+        return -1;
+
+    if (write)
+        memcpy(hdd_images[id].map + offset, buffer, (size_t) avail << 9);
+    else
+        memcpy(buffer, hdd_images[id].map + offset, (size_t) avail << 9);
+
+    hdd_images[id].pos = sector + avail;
+
+    if (avail == count)
+        return 0;
+
+    sector += avail;
+    count -= avail;
+    buffer += (size_t) avail << 9;
+
+    if (write) {
+        ret = hdd_image_file_write(id, sector, count, buffer);
+        fflush(hdd_images[id].file);
+        return ret;
+    }
+
+    memset(buffer, 0, (size_t) count << 9);
+    return hdd_image_file_read(id, sector, count, buffer);
+}
+
+static int
+hdd_image_file_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    size_t num_read;
+
+    if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
+        hdd_image_log("Hard disk image %i: Read error during seek\n", id);
+        return -1;
+    }
+
+    num_read           = fread(buffer, 512, count, hdd_images[id].file);
+    hdd_images[id].pos = sector + num_read;
+    if ((num_read < count) && !feof(hdd_images[id].file))
+        return -1;
+
+    return 0;
+}
+
+static int
+hdd_image_file_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    size_t num_write;
+
+    if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
+        hdd_image_log("Hard disk image %i: Write error during seek\n", id);
+        return -1;
+    }
+
+    num_write          = fwrite(buffer, 512, count, hdd_images[id].file);
+    hdd_images[id].pos = sector + num_write;
+    if (num_write < count)
+        return -1;
+
+    return 0;
+}
+
+static uint8_t *
+hdd_image_cache_data(hdd_image_cache_t *cache, int32_t idx)
+{
+    return &cache->data[(size_t) idx * HDD_IMAGE_CACHE_BLOCK];
+}
+
+static int32_t
+hdd_image_cache_find(hdd_image_cache_t *cache, uint32_t block)
+{
+    int32_t idx = cache->hash[block & cache->hash_mask];
+
+    while ((idx != -1) && (cache->blocks[idx].block != block))
+        idx = cache->blocks[idx].hash_next;
+
+    return idx;
+}
+
+static void
+hdd_image_cache_unlink(hdd_image_cache_t *cache, int32_t idx)
+{
+    hdd_image_cache_block_t *blk = &cache->blocks[idx];
+
+    if (blk->prev != -1)
+        cache->blocks[blk->prev].next = blk->next;
+    else
+        cache->head = blk->next;
+    if (blk->next != -1)
+        cache->blocks[blk->next].prev = blk->prev;
+    else
+        cache->tail = blk->prev;
+}
+
+static void
+hdd_image_cache_touch(hdd_image_cache_t *cache, int32_t idx)
+{
+    hdd_image_cache_block_t *blk = &cache->blocks[idx];
+
+    if (cache->head == idx)
+        return;
+
+    hdd_image_cache_unlink(cache, idx);
+    blk->prev = -1;
+    blk->next = cache->head;
+    cache->blocks[cache->head].prev = idx;
+    cache->head                     = idx;
+}
+
+static void
+hdd_image_cache_unhash(hdd_image_cache_t *cache, int32_t idx)
+{
+    int32_t *p = &cache->hash[cache->blocks[idx].block & cache->hash_mask];
+
+    while (*p != idx)
+        p = &cache->blocks[*p].hash_next;
+    *p = cache->blocks[idx].hash_next;
+}
+
+/* Write the dirty sectors of a block to the image, in runs. */
+static int
+hdd_image_cache_write_back(uint8_t id, hdd_image_cache_t *cache, int32_t idx)
+{
+    hdd_image_cache_block_t *blk    = &cache->blocks[idx];
+    uint8_t                 *data   = hdd_image_cache_data(cache, idx);
+    uint32_t                 sector = blk->block << HDD_IMAGE_CACHE_SHIFT;
+    int                      ret    = 0;
+    int                      start;
+    int                      end;
+
+    if (!blk->dirty)
+        return 0;
+
+    for (start = 0; start < HDD_IMAGE_CACHE_SECTORS; start = end) {
+        if (!(blk->dirty & (1 << start))) {
+            end = start + 1;
+            continue;
+        }
+        for (end = start + 1; (end < HDD_IMAGE_CACHE_SECTORS) && (blk->dirty & (1 << end)); end++)
+            ;
+        if (hdd_image_file_write(id, sector + start, end - start, data + (start << 9)) < 0)
+            ret = -1;
+    }
+
+    blk->dirty = 0;
+    cache->stats.dirty_blocks--;
+    cache->stats.writebacks++;
+
+    return ret;
+}
+
+/* Take the least recently used block for a new block number. */
+static int32_t
+hdd_image_cache_alloc(uint8_t id, hdd_image_cache_t *cache, uint32_t block, int *ret)
+{
+    int32_t                  idx = cache->tail;
+    hdd_image_cache_block_t *blk = &cache->blocks[idx];
+
+    if (blk->block != HDD_IMAGE_CACHE_FREE) {
+        if (hdd_image_cache_write_back(id, cache, idx) < 0)
+            *ret = -1;
+        hdd_image_cache_unhash(cache, idx);
+    }
+
+    blk->block     = block;
+    blk->valid     = 0;
+    blk->dirty     = 0;
+    blk->hash_next = cache->hash[block & cache->hash_mask];
+    cache->hash[block & cache->hash_mask] = idx;
+    hdd_image_cache_touch(cache, idx);
+
+    return idx;
+}
+
+/* Fill in the sectors of a block that are not valid yet. */
+static int
+hdd_image_cache_fill(uint8_t id, hdd_image_cache_t *cache, int32_t idx)
+{
+    hdd_image_cache_block_t *blk  = &cache->blocks[idx];
+    uint8_t                 *data = hdd_image_cache_data(cache, idx);
+
+    memset(cache->run_buf, 0, HDD_IMAGE_CACHE_BLOCK);
+    if (hdd_image_file_read(id, blk->block << HDD_IMAGE_CACHE_SHIFT, HDD_IMAGE_CACHE_SECTORS, cache->run_buf) < 0)
+        return -1;
+
+    for (int c = 0; c < HDD_IMAGE_CACHE_SECTORS; c++) {
+        if (!(blk->valid & (1 << c)))
+            memcpy(data + (c << 9), cache->run_buf + (c << 9), 512);
+    }
+    blk->valid = HDD_IMAGE_CACHE_FULL;
+
+    return 0;
+}
+
+/* Bring in a run of missing blocks, starting at block, with one read. */
+static int
+hdd_image_cache_fill_run(uint8_t id, hdd_image_cache_t *cache, uint32_t block, uint32_t max_blocks)
+{
+    uint32_t num = 1;
+    int      ret = 0;
+    int32_t  idx;
+
+    if (max_blocks > cache->run)
+        max_blocks = cache->run;
+    while ((num < max_blocks) && (hdd_image_cache_find(cache, block + num) == -1))
+        num++;
+
+    memset(cache->run_buf, 0, num * HDD_IMAGE_CACHE_BLOCK);
+    if (hdd_image_file_read(id, block << HDD_IMAGE_CACHE_SHIFT, num << HDD_IMAGE_CACHE_SHIFT, cache->run_buf) < 0)
+        return -1;
+
+    for (uint32_t c = 0; c < num; c++) {
+        idx = hdd_image_cache_alloc(id, cache, block + c, &ret);
+        memcpy(hdd_image_cache_data(cache, idx), cache->run_buf + (c * HDD_IMAGE_CACHE_BLOCK), HDD_IMAGE_CACHE_BLOCK);
+        cache->blocks[idx].valid = HDD_IMAGE_CACHE_FULL;
+    }
+
+    return ret;
+}
+
+static int
+hdd_image_cache_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_cache_t *cache = hdd_images[id].cache;
+    int                ret   = 0;
+
+    thread_wait_mutex(cache->mutex);
+
+    while (count > 0) {
+        uint32_t block  = sector >> HDD_IMAGE_CACHE_SHIFT;
+        uint32_t offset = sector & (HDD_IMAGE_CACHE_SECTORS - 1);
+        uint32_t num    = HDD_IMAGE_CACHE_SECTORS - offset;
+        uint8_t  mask;
+        int32_t  idx;
+
+        if (num > count)
+            num = count;
+        mask = ((1 << num) - 1) << offset;
+
+        idx = hdd_image_cache_find(cache, block);
+        if ((idx != -1) && ((cache->blocks[idx].valid & mask) == mask))
+            cache->stats.hits++;
+        else {
+            cache->stats.misses++;
+            if (idx == -1) {
+                uint32_t blocks = ((offset + count + HDD_IMAGE_CACHE_SECTORS - 1) >> HDD_IMAGE_CACHE_SHIFT);
+
+                if (hdd_image_cache_fill_run(id, cache, block, blocks) < 0) {
+                    ret = -1;
+                    break;
+                }
+                idx = hdd_image_cache_find(cache, block);
+            } else if (hdd_image_cache_fill(id, cache, idx) < 0) {
+                ret = -1;
+                break;
+            }
+        }
+
+        memcpy(buffer, hdd_image_cache_data(cache, idx) + (offset << 9), num << 9);
+        hdd_image_cache_touch(cache, idx);
+
+        buffer += num << 9;
+        sector += num;
+        count -= num;
+    }
+    hdd_images[id].pos = sector;
+
+    thread_release_mutex(cache->mutex);
+
+    return ret;
+}
+
+static int
+hdd_image_cache_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_cache_t *cache = hdd_images[id].cache;
+    int                ret   = 0;
+
+    thread_wait_mutex(cache->mutex);
+
+    while (count > 0) {
+        uint32_t block  = sector >> HDD_IMAGE_CACHE_SHIFT;
+        uint32_t offset = sector & (HDD_IMAGE_CACHE_SECTORS - 1);
+        uint32_t num    = HDD_IMAGE_CACHE_SECTORS - offset;
+        uint8_t  mask;
+        int32_t  idx;
+
+        if (num > count)
+            num = count;
+        mask = ((1 << num) - 1) << offset;
+
+        idx = hdd_image_cache_find(cache, block);
+        if (idx == -1)
+            idx = hdd_image_cache_alloc(id, cache, block, &ret);
+        else
+            hdd_image_cache_touch(cache, idx);
+
+        memcpy(hdd_image_cache_data(cache, idx) + (offset << 9), buffer, num << 9);
+        if (!cache->blocks[idx].dirty)
+            cache->stats.dirty_blocks++;
+        cache->blocks[idx].valid |= mask;
+        cache->blocks[idx].dirty |= mask;
+
+        if ((hdd_image_cache_policy == HDD_IMAGE_CACHE_WRITE_THROUGH) &&
+            (hdd_image_cache_write_back(id, cache, idx) < 0))
+            ret = -1;
+
+        buffer += num << 9;
+        sector += num;
+        count -= num;
+    }
+    hdd_images[id].pos = sector;
+
+    if (hdd_image_cache_policy == HDD_IMAGE_CACHE_WRITE_THROUGH)
+        fflush(hdd_images[id].file);
+
+    thread_release_mutex(cache->mutex);
+
+    return ret;
+}
+
+static int
+hdd_image_cache_compare(const void *a, const void *b)
+{
+    const hdd_image_cache_block_t *blk_a = *(const hdd_image_cache_block_t * const *) a;
+    const hdd_image_cache_block_t *blk_b = *(const hdd_image_cache_block_t * const *) b;
+
+    return (blk_a->block > blk_b->block) - (blk_a->block < blk_b->block);
+}
+
+/* Write all dirty blocks back, in image order. Called with the lock held. */
+static int
+hdd_image_cache_flush_locked(uint8_t id, hdd_image_cache_t *cache)
+{
+    hdd_image_cache_block_t **dirty;
+    uint32_t                  num = 0;
+    int                       ret = 0;
+
+    cache->secs = 0;
+    if (cache->stats.dirty_blocks == 0)
+        return 0;
+
+    dirty = (hdd_image_cache_block_t **) malloc(cache->stats.dirty_blocks * sizeof(hdd_image_cache_block_t *));
+    for (uint32_t c = 0; c < cache->num_blocks; c++) {
+        if (cache->blocks[c].dirty)
+            dirty[num++] = &cache->blocks[c];
+    }
+    qsort(dirty, num, sizeof(hdd_image_cache_block_t *), hdd_image_cache_compare);
+
+    for (uint32_t c = 0; c < num; c++) {
+        if (hdd_image_cache_write_back(id, cache, (int32_t) (dirty[c] - cache->blocks)) < 0)
+            ret = -1;
+    }
+    free(dirty);
+
+    fflush(hdd_images[id].file);
+
+    hdd_image_log("Hard disk image %i: cache flushed %u blocks, %" PRIu64 " hits, %" PRIu64 " misses\n",
+                  id, num, cache->stats.hits, cache->stats.misses);
+
+    return ret;
+}
+
+static int
+hdd_image_cache_flush(uint8_t id)
+{
+    hdd_image_cache_t *cache = hdd_images[id].cache;
+    int                ret   = 0;
+
+    if (cache != NULL) {
+        thread_wait_mutex(cache->mutex);
+        ret = hdd_image_cache_flush_locked(id, cache);
+        thread_release_mutex(cache->mutex);
+    }
+
+    return ret;
+}
+
+/* Forget the cached copy of a range that is about to be written around the
+   cache. Called with the lock held, after a flush. */
+static void
+hdd_image_cache_discard(hdd_image_cache_t *cache, uint32_t sector, uint32_t count)
+{
+    uint32_t first = sector >> HDD_IMAGE_CACHE_SHIFT;
+    uint32_t last  = (uint32_t) (((uint64_t) sector + count - 1) >> HDD_IMAGE_CACHE_SHIFT);
+
+    for (int32_t idx = 0; idx < (int32_t) cache->num_blocks; idx++) {
+        hdd_image_cache_block_t *blk = &cache->blocks[idx];
+
+        if ((blk->block == HDD_IMAGE_CACHE_FREE) || (blk->block < first) || (blk->block > last))
+            continue;
+
+        hdd_image_cache_unhash(cache, idx);
+        blk->block = HDD_IMAGE_CACHE_FREE;
+
+        /* Move it to the tail so that it gets reused first. */
+        hdd_image_cache_unlink(cache, idx);
+        blk->next = -1;
+        blk->prev = cache->tail;
+        if (cache->tail != -1)
+            cache->blocks[cache->tail].next = idx;
+        else
+            cache->head = idx;
+        cache->tail = idx;
+    }
+}
+
+static void
+hdd_image_cache_init(uint8_t id)
+{
+    hdd_image_cache_t *cache;
+    uint32_t           hash_size = 1;
+    int                size      = hdd_image_cache_size;
+
+    if ((size <= 0) || (hdd_images[id].file == NULL) || (hdd_images[id].type == HDD_IMAGE_VHD))
+        return;
+
+    /* Clamped here only, so that the configured value is saved as is. */
+    if (size > 2048)
+        size = 2048;
+
+    cache = (hdd_image_cache_t *) calloc(1, sizeof(hdd_image_cache_t));
+    if (cache == NULL) {
+        hdd_image_log("Hard disk image %i: Unable to allocate a %i MB cache\n", id, size);
+        return;
+    }
+    cache->num_blocks = (uint32_t) (((uint64_t) size << 20) / HDD_IMAGE_CACHE_BLOCK);
+    cache->run        = cache->num_blocks / 2;
+    if (cache->run > HDD_IMAGE_CACHE_RUN)
+        cache->run = HDD_IMAGE_CACHE_RUN;
+    while (hash_size < cache->num_blocks)
+        hash_size <<= 1;
+    cache->hash_mask = hash_size - 1;
+
+    cache->hash    = (int32_t *) malloc(hash_size * sizeof(int32_t));
+    cache->blocks  = (hdd_image_cache_block_t *) calloc(cache->num_blocks, sizeof(hdd_image_cache_block_t));
+    cache->data    = (uint8_t *) malloc((size_t) cache->num_blocks * HDD_IMAGE_CACHE_BLOCK);
+    cache->run_buf = (uint8_t *) malloc(HDD_IMAGE_CACHE_RUN * HDD_IMAGE_CACHE_BLOCK);
+    if (!cache->hash || !cache->blocks || !cache->data || !cache->run_buf) {
+        hdd_image_log("Hard disk image %i: Unable to allocate a %i MB cache\n", id, size);
+        free(cache->hash);
+        free(cache->blocks);
+        free(cache->data);
+        free(cache->run_buf);
+        free(cache);
+        return;
+    }
+
+    memset(cache->hash, 0xff, hash_size * sizeof(int32_t));
+    for (uint32_t c = 0; c < cache->num_blocks; c++) {
+        cache->blocks[c].block     = HDD_IMAGE_CACHE_FREE;
+        cache->blocks[c].hash_next = -1;
+        cache->blocks[c].prev      = (int32_t) c - 1;
+        cache->blocks[c].next      = (c == (cache->num_blocks - 1)) ? -1 : (int32_t) c + 1;
+    }
+    cache->head  = 0;
+    cache->tail  = cache->num_blocks - 1;
+    cache->mutex = thread_create_mutex();
+
+    hdd_images[id].cache = cache;
+}
+
+static void
+hdd_image_cache_close(uint8_t id)
+{
+    hdd_image_cache_t *cache = hdd_images[id].cache;
+
+    if (cache == NULL)
+        return;
+
+    hdd_image_cache_flush(id);
+
+    hdd_image_log("Hard disk image %i: cache closed, %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " write-backs\n",
+                  id, cache->stats.hits, cache->stats.misses, cache->stats.writebacks);
+
+    thread_close_mutex(cache->mutex);
+    free(cache->hash);
+    free(cache->blocks);
+    free(cache->data);
+    free(cache->run_buf);
+    free(cache);
+
+    hdd_images[id].cache = NULL;
+}
+
+static void
+hdd_image_async_free_req(hdd_image_req_t *req)
+{
+    if (req->event != NULL)
+        thread_destroy_event(req->event);
+    free(req->buffer);
+    free(req);
+}
+
+static int hdd_image_do_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
+static int hdd_image_do_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
+
+static void
+hdd_image_async_thread(void *priv)
+{
+    hdd_image_async_t *async = (hdd_image_async_t *) priv;
+    hdd_image_req_t   *req;
+    int                ret;
+    int                free_req;
+
+    while (1) {
+        thread_wait_mutex(async->mutex);
+        req = async->head;
+        if (req != NULL) {
+            async->head = req->next;
+            if (async->head == NULL)
+                async->tail = NULL;
+            async->busy = 1;
+        } else if (!async->run) {
+            thread_release_mutex(async->mutex);
+            break;
+        } else
+            thread_reset_event(async->wake);
+        thread_release_mutex(async->mutex);
+
+        if (req == NULL) {
+            thread_wait_event(async->wake, -1);
+            continue;
+        }
+
+        if (req->op == HDD_IMAGE_REQ_READ)
+            ret = hdd_image_do_read(async->id, req->sector, req->count, req->buffer);
+        else if (req->op == HDD_IMAGE_REQ_WRITE) {
+            ret = hdd_image_do_write(async->id, req->sector, req->count, req->buffer);
+            if (ret < 0)
+                pclog("Hard disk image %i: Queued write of sectors %u-%u failed\n",
+                      async->id, req->sector, req->sector + req->count - 1);
+        } else
+            ret = 0;
+
+        /* The event is set with the lock held, as the waiter may free the
+           request as soon as it sees it done. */
+        thread_wait_mutex(async->mutex);
+        async->busy = 0;
+        if (req->op == HDD_IMAGE_REQ_WRITE) {
+            if (ret < 0)
+                async->write_error = 1;
+            async->queued_bytes -= req->count << 9;
+            free_req = 1;
+        } else {
+            req->ret  = ret;
+            req->done = 1;
+            free_req  = req->orphan;
+            if (!free_req && (req->event != NULL))
+                thread_set_event(req->event);
+        }
+        thread_release_mutex(async->mutex);
+
+        if (free_req)
+            hdd_image_async_free_req(req);
+    }
+}
+
+static void hdd_image_async_submit(hdd_image_async_t *async, hdd_image_req_t *req);
+
+/* Wait for a request to complete, or for the whole queue to drain if req
+   is NULL. Every wait is on an event of its own, so that waiters on
+   different threads can not miss each other's wakeups. */
+static void
+hdd_image_async_wait(hdd_image_async_t *async, hdd_image_req_t *req)
+{
+    hdd_image_req_t barrier;
+    int             ready;
+
+    if (req == NULL) {
+        thread_wait_mutex(async->mutex);
+        ready = (async->head == NULL) && !async->busy;
+        thread_release_mutex(async->mutex);
+        if (ready)
+            return;
+
+        memset(&barrier, 0, sizeof(hdd_image_req_t));
+        barrier.op    = HDD_IMAGE_REQ_BARRIER;
+        barrier.event = thread_create_event();
+        req           = &barrier;
+        hdd_image_async_submit(async, req);
+    }
+
+    while (1) {
+        thread_wait_mutex(async->mutex);
+        ready = req->done;
+        thread_release_mutex(async->mutex);
+
+        if (ready)
+            break;
+        thread_wait_event(req->event, -1);
+    }
+
+    if (req == &barrier)
+        thread_destroy_event(barrier.event);
+}
+
+/* Return and clear the error of a failed queued write. */
+static int
+hdd_image_async_take_error(hdd_image_async_t *async)
+{
+    int error;
+
+    thread_wait_mutex(async->mutex);
+    error              = async->write_error;
+    async->write_error = 0;
+    thread_release_mutex(async->mutex);
+
+    return error ? -1 : 0;
+}
+
+static void
+hdd_image_async_submit(hdd_image_async_t *async, hdd_image_req_t *req)
+{
+    thread_wait_mutex(async->mutex);
+    if (req->op == HDD_IMAGE_REQ_WRITE)
+        async->queued_bytes += req->count << 9;
+    if (async->tail != NULL)
+        async->tail->next = req;
+    else
+        async->head = req;
+    async->tail = req;
+    thread_release_mutex(async->mutex);
+
+    thread_set_event(async->wake);
+}
+
+static void
+hdd_image_async_drop_prefetch(hdd_image_async_t *async)
+{
+    hdd_image_req_t *req = async->prefetch;
+    int              free_req;
+
+    if (req == NULL)
+        return;
+    async->prefetch = NULL;
+
+    thread_wait_mutex(async->mutex);
+    free_req = req->done;
+    if (!free_req)
+        req->orphan = 1;
+    thread_release_mutex(async->mutex);
+
+    if (free_req)
+        hdd_image_async_free_req(req);
+}
+
+/* Wait until the image is no longer used by the worker, so that it can be
+   accessed directly. */
+static void
+hdd_image_async_flush(uint8_t id)
+{
+    hdd_image_async_t *async = hdd_images[id].async;
+
+    if (async != NULL) {
+        hdd_image_async_drop_prefetch(async);
+        hdd_image_async_wait(async, NULL);
+    }
+}
+
+static void
+hdd_image_async_queue_read(hdd_image_async_t *async, uint32_t sector, uint32_t count)
+{
+    uint32_t         last_sector = hdd_images[async->id].last_sector;
+    hdd_image_req_t *req;
+
+    if (sector > last_sector)
+        return;
+    if (count > HDD_IMAGE_PREFETCH_MAX)
+        count = HDD_IMAGE_PREFETCH_MAX;
+    if (count > (last_sector - sector + 1))
+        count = last_sector - sector + 1;
+    if (count == 0)
+        return;
+
+    hdd_image_async_drop_prefetch(async);
+
+    /* A prefetch is only a hint, skip it when out of memory. */
+    req = (hdd_image_req_t *) calloc(1, sizeof(hdd_image_req_t));
+    if (req == NULL)
+        return;
+    req->buffer = (uint8_t *) malloc(count << 9);
+    if (req->buffer == NULL) {
+        free(req);
+        return;
+    }
+    req->op     = HDD_IMAGE_REQ_READ;
+    req->sector = sector;
+    req->count  = count;
+    req->event  = thread_create_event();
+
+    async->prefetch = req;
+    hdd_image_async_submit(async, req);
+}
+
+static int
+hdd_image_async_covers(const hdd_image_req_t *req, uint32_t sector, uint32_t count)
+{
+    return (req != NULL) && (sector >= req->sector) &&
+           ((uint64_t) sector + count <= (uint64_t) req->sector + req->count);
 }
 
-void
-hdd_image_calc_chs(uint32_t *c, uint32_t *h, uint32_t *s, uint32_t size)
+static int
+hdd_image_async_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
-    /* Calculate the geometry from size (in MB), using the algorithm provided in
-    "Virtual Hard Disk Image Format Specification, Appendix: CHS Calculation" */
-    uint64_t ts = ((uint64_t) size) << 11LL;
-    uint32_t spt;
-    uint32_t heads;
-    uint32_t cyl;
-    uint32_t cth;
+    hdd_image_async_t *async = hdd_images[id].async;
+    hdd_image_req_t   *req   = async->prefetch;
+    int                ret   = -1;
+    int                hit   = 0;
+
+    if (hdd_image_async_covers(req, sector, count)) {
+        hdd_image_async_wait(async, req);
+        if (req->ret >= 0) {
+            memcpy(buffer, req->buffer + ((sector - req->sector) << 9), count << 9);
+            hdd_images[id].pos = sector + count;
+            ret                = 0;
+            hit                = 1;
+        }
+    }
 
-    if (ts > 65535 * 16 * 255)
-        ts = 65535 * 16 * 255;
+    if (hit)
+        async->hits++;
+    else {
+        async->misses++;
+        hdd_image_async_flush(id);
+        ret = hdd_image_do_read(id, sector, count, buffer);
+    }
 
-    if (ts >= 65535 * 16 * 63) {
-        spt   = 255;
-        heads = 16;
-        cth   = (uint32_t) (ts / spt);
-    } else {
-        spt   = 17;
-        cth   = (uint32_t) (ts / spt);
-        heads = (cth + 1023) / 1024;
-        if (heads < 4)
-            heads = 4;
-        if ((cth >= (heads * 1024)) || (heads > 16)) {
-            spt   = 31;
-            heads = 16;
-            cth   = (uint32_t) (ts / spt);
-        }
-        if (cth >= (heads * 1024)) {
-            spt   = 63;
-            heads = 16;
-            cth   = (uint32_t) (ts / spt);
-        }
+    /* Read ahead once a sequential stream runs past what has been fetched. */
+    if ((ret >= 0) && (sector == async->last_end)) {
+        req = async->prefetch;
+        if ((req == NULL) || (sector + count < req->sector) || (sector + count >= req->sector + req->count))
+            hdd_image_async_queue_read(async, sector + count, HDD_IMAGE_READAHEAD);
     }
-    cyl = cth / heads;
-    *c  = cyl;
-    *h  = heads;
-    *s  = spt;
+    async->last_end = sector + count;
+
+    return ret;
 }
 
 static int
-prepare_new_hard_disk(uint8_t id, uint64_t full_size)
+hdd_image_async_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
-    if (!hdd_images[id].file)
-        return -1;
-
-    /* Skip file creation/expansion for block devices */
-    if (hdd_images[id].is_block_device) {
-        hdd_images[id].last_sector = (uint32_t) (full_size >> 9) - 1;
-        hdd_images[id].loaded = 1;
-        return 1;
+    hdd_image_async_t *async = hdd_images[id].async;
+    hdd_image_req_t   *req   = async->prefetch;
+    uint32_t           queued;
+
+    /* Do not let a pending prefetch return what this write replaces. */
+    if ((req != NULL) && (sector < (req->sector + req->count)) && ((sector + count) > req->sector))
+        hdd_image_async_drop_prefetch(async);
+
+    thread_wait_mutex(async->mutex);
+    queued = async->queued_bytes;
+    thread_release_mutex(async->mutex);
+    if (queued >= HDD_IMAGE_WRITE_QUEUE)
+        hdd_image_async_wait(async, NULL);
+
+    req = (hdd_image_req_t *) calloc(1, sizeof(hdd_image_req_t));
+    if (req != NULL)
+        req->buffer = (uint8_t *) malloc(count << 9);
+    if ((req == NULL) || (req->buffer == NULL)) {
+        /* Out of memory, write it out right away instead. */
+        free(req);
+        hdd_image_async_flush(id);
+        return hdd_image_do_write(id, sector, count, buffer);
     }
+    req->op     = HDD_IMAGE_REQ_WRITE;
+    req->sector = sector;
+    req->count  = count;
+    memcpy(req->buffer, buffer, count << 9);
 
-    uint64_t target_size = (full_size + hdd_images[id].base) - ftello64(hdd_images[id].file);
+    hdd_image_async_submit(async, req);
 
-#ifndef __unix__
-    uint32_t size;
-    uint32_t t;
+    return 0;
+}
 
-    t    = (uint32_t) (target_size >> 20);     /* Amount of 1 MB blocks. */
-    size = (uint32_t) (target_size & 0xfffff); /* 1 MB mask. */
+static void
+hdd_image_async_start(uint8_t id)
+{
+    hdd_image_async_t *async;
 
-    empty_sector_1mb = (char *) calloc(1, 1048576);
+    if (!hdd_image_async || !hdd_images[id].loaded || (hdd_images[id].async != NULL))
+        return;
+    if ((hdd_images[id].file == NULL) && (hdd_images[id].vhd == NULL) && (hdd_images[id].ovl == NULL))
+        return;
 
-    /* Temporarily switch off suppression of seen messages so that the
-       progress gets displayed. */
-    pclog_toggle_suppr();
-    pclog("Writing image sectors: [");
+    async           = (hdd_image_async_t *) calloc(1, sizeof(hdd_image_async_t));
+    async->id       = id;
+    async->run      = 1;
+    async->last_end = (uint32_t) -1;
+    async->mutex    = thread_create_mutex();
+    async->wake     = thread_create_event();
+    async->thread   = thread_create(hdd_image_async_thread, async);
 
-    /* First, write all the 1 MB blocks. */
-    if (t > 0) {
-        for (uint32_t i = 0; i < t; i++) {
-            fseek(hdd_images[id].file, 0, SEEK_END);
-            fwrite(empty_sector_1mb, 1, 1048576, hdd_images[id].file);
-            pclog("#");
-        }
-    }
+    hdd_images[id].async = async;
+}
 
-    /* Then, write the remainder. */
-    if (size > 0) {
-        fseek(hdd_images[id].file, 0, SEEK_END);
-        fwrite(empty_sector_1mb, 1, size, hdd_images[id].file);
-        pclog("#");
-    }
-    pclog("]\n");
-    /* Switch the suppression of seen messages back on. */
-    pclog_toggle_suppr();
+static void
+hdd_image_async_stop(uint8_t id)
+{
+    hdd_image_async_t *async = hdd_images[id].async;
 
-    free(empty_sector_1mb);
-#else
-    pclog("Creating hard disk image: ");
-    int ret = ftruncate(fileno(hdd_images[id].file), (size_t) target_size);
+    if (async == NULL)
+        return;
 
-    if (ret) {
-        pclog("failed\n");
-        fatal("Could not create hard disk image\n");
-    }
-    pclog("OK!\n");
-#endif
-    hdd_images[id].last_sector = (uint32_t) (full_size >> 9) - 1;
+    hdd_image_async_flush(id);
 
-    hdd_images[id].loaded = 1;
+    thread_wait_mutex(async->mutex);
+    async->run = 0;
+    thread_release_mutex(async->mutex);
+    thread_set_event(async->wake);
+    thread_wait(async->thread);
 
-    return 1;
+    hdd_image_log("Hard disk image %i: %u prefetch hits, %u misses\n", id, async->hits, async->misses);
+
+    thread_destroy_event(async->wake);
+    thread_close_mutex(async->mutex);
+    free(async);
+
+    hdd_images[id].async = NULL;
 }
 
 void
@@ -259,8 +1520,8 @@ hdd_image_init(void)
         memset(&hdd_images[i], 0, sizeof(hdd_image_t));
 }
 
-int
-hdd_image_load(int id)
+static int
+hdd_image_load_file(int id)
 {
     uint32_t sector_size = 512;
     uint32_t zero        = 0;
@@ -274,6 +1535,7 @@ hdd_image_load(int id)
     char    *fn        = hdd[id].fn;
     int      is_hdx[2] = { 0, 0 };
     int      is_vhd[2] = { 0, 0 };
+    int      is_ovl[2] = { 0, 0 };
     int      vhd_error = 0;
 
     memset(empty_sector, 0, sizeof(empty_sector));
@@ -291,7 +1553,8 @@ hdd_image_load(int id)
         } else if (hdd_images[id].vhd) {
             mvhd_close(hdd_images[id].vhd);
             hdd_images[id].vhd = NULL;
-        }
+        } else if (hdd_images[id].ovl)
+            hdd_image_close_overlay(id);
         hdd_images[id].loaded = 0;
     }
 
@@ -339,6 +1602,9 @@ hdd_image_load(int id)
     is_vhd[0] = image_is_vhd(fn, 0);
     is_vhd[1] = image_is_vhd(fn, 1);
 
+    is_ovl[0] = image_is_ovl(fn, 0);
+    is_ovl[1] = image_is_ovl(fn, 1);
+
     hdd_images[id].pos = 0;
 
     /* Try to open existing hard disk image */
@@ -429,6 +1695,16 @@ retry_vhd:
                     }
                     hdd_images[id].type = HDD_IMAGE_VHD;
 
+                    return 1;
+                } else if (is_ovl[0]) {
+                    fclose(hdd_images[id].file);
+                    hdd_images[id].file = NULL;
+                    if (!hdd_image_load_overlay(id, fn, 1)) {
+                        hdd_image_log("Unable to create overlay image\n");
+                        memset(hdd[id].fn, 0, sizeof(hdd[id].fn));
+                        goto fail_raw;
+                    }
+
                     return 1;
                 } else {
                     hdd_images[id].type = HDD_IMAGE_RAW;
@@ -511,6 +1787,13 @@ fail_raw:
             hdd[id].hpc         = hpc;
             hdd[id].tracks      = tracks;
             hdd_images[id].type = HDD_IMAGE_HDX;
+        } else if (is_ovl[1]) {
+            fclose(hdd_images[id].file);
+            hdd_images[id].file = NULL;
+            if (!hdd_image_load_overlay(id, fn, 0))
+                fatal("hdd_image_load(): Overlay: Error opening overlay file '%s'\n", fn);
+
+            return 1;
         } else if (is_vhd[1]) {
             fclose(hdd_images[id].file);
             hdd_images[id].file = NULL;
@@ -558,14 +1841,49 @@ fail_raw:
     return ret;
 }
 
+int
+hdd_image_load(int id)
+{
+    int ret;
+
+    hdd_image_async_stop(id);
+    hdd_image_cache_close(id);
+    hdd_image_unmap(id);
+
+    ret = hdd_image_load_file(id);
+    if (ret > 0) {
+        hdd_image_map(id);
+        /* A mapped image has no use for the sector cache. */
+        if (hdd_images[id].map == NULL)
+            hdd_image_cache_init(id);
+        hdd_image_async_start(id);
+    }
+
+    return ret;
+}
+
+/* Hint that a read of these sectors is about to follow, so that it can
+   proceed while the emulated drive is seeking. */
+void
+hdd_image_prefetch(uint8_t id, uint32_t sector, uint32_t count)
+{
+    hdd_image_async_t *async = hdd_images[id].async;
+
+    if ((async != NULL) && !hdd_image_async_covers(async->prefetch, sector, count))
+        hdd_image_async_queue_read(async, sector, count);
+}
+
 int
 hdd_image_seek(uint8_t id, uint32_t sector)
 {
     off64_t addr = sector;
     addr         = (uint64_t) sector << 9LL;
 
+    hdd_image_async_flush(id);
+
     hdd_images[id].pos = sector;
-    if (hdd_images[id].type != HDD_IMAGE_VHD) {
+    if ((hdd_images[id].type != HDD_IMAGE_VHD) && (hdd_images[id].type != HDD_IMAGE_OVL) &&
+        (hdd_images[id].cache == NULL) && (hdd_images[id].map == NULL)) {
         if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, addr + hdd_images[id].base, SEEK_SET) == -1)) {
             hdd_image_log("hdd_image_seek(): Error seeking\n");
             return -1;
@@ -575,11 +1893,10 @@ hdd_image_seek(uint8_t id, uint32_t sector)
     return 0;
 }
 
-int
-hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+static int
+hdd_image_do_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
-    int    non_transferred_sectors;
-    size_t num_read;
+    int non_transferred_sectors;
 
     if (hdd_images[id].type == HDD_IMAGE_VHD) {
         hdd_images[id].vhd->error = 0;
@@ -587,21 +1904,28 @@ hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
         hdd_images[id].pos        = sector + count - non_transferred_sectors - 1;
         if (hdd_images[id].vhd->error)
             return -1;
-    } else {
-        if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
-            hdd_image_log("Hard disk image %i: Read error during seek\n", id);
-            return -1;
-        }
-
-        num_read           = fread(buffer, 512, count, hdd_images[id].file);
-        hdd_images[id].pos = sector + num_read;
-        if ((num_read < count) && !feof(hdd_images[id].file))
-            return -1;
-    }
+    } else if (hdd_images[id].type == HDD_IMAGE_OVL) {
+        hdd_images[id].pos = sector + count;
+        return hdd_overlay_read(hdd_images[id].ovl, sector, count, buffer);
+    } else if (hdd_images[id].map != NULL)
+        return hdd_image_map_rw(id, sector, count, buffer, 0);
+    else if (hdd_images[id].cache != NULL)
+        return hdd_image_cache_read(id, sector, count, buffer);
+    else
+        return hdd_image_file_read(id, sector, count, buffer);
 
     return 0;
 }
 
+int
+hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    if (hdd_images[id].async != NULL)
+        return hdd_image_async_read(id, sector, count, buffer);
+
+    return hdd_image_do_read(id, sector, count, buffer);
+}
+
 uint32_t
 hdd_image_get_last_sector(uint8_t id)
 {
@@ -631,11 +1955,11 @@ hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
-int
-hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+static int
+hdd_image_do_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
-    int    non_transferred_sectors;
-    size_t num_write;
+    int non_transferred_sectors;
+    int ret;
 
     if (hdd_images[id].type == HDD_IMAGE_VHD) {
         hdd_images[id].vhd->error = 0;
@@ -643,22 +1967,32 @@ hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
         hdd_images[id].pos        = sector + count - non_transferred_sectors - 1;
         if (hdd_images[id].vhd->error)
             return -1;
-    } else {
-        if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
-            hdd_image_log("Hard disk image %i: Write error during seek\n", id);
-            return -1;
-        }
-
-        num_write          = fwrite(buffer, 512, count, hdd_images[id].file);
-        hdd_images[id].pos = sector + num_write;
-        fflush(hdd_images[id].file);
-        if (num_write < count)
-            return -1;
+    } else if (hdd_images[id].type == HDD_IMAGE_OVL) {
+        hdd_images[id].pos = sector + count;
+        return hdd_overlay_write(hdd_images[id].ovl, sector, count, buffer);
+    } else if (hdd_images[id].map != NULL)
+        return hdd_image_map_rw(id, sector, count, buffer, 1);
+    else if (hdd_images[id].cache != NULL)
+        return hdd_image_cache_write(id, sector, count, buffer);
+    else {
+        ret = hdd_image_file_write(id, sector, count, buffer);
+        if (hdd_images[id].file != NULL)
+            fflush(hdd_images[id].file);
+        return ret;
     }
 
     return 0;
 }
 
+int
+hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    if (hdd_images[id].async != NULL)
+        return hdd_image_async_write(id, sector, count, buffer);
+
+    return hdd_image_do_write(id, sector, count, buffer);
+}
+
 int
 hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
@@ -679,30 +2013,68 @@ hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 int
 hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
 {
+    hdd_image_async_flush(id);
+
     if (hdd_images[id].type == HDD_IMAGE_VHD) {
         hdd_images[id].vhd->error   = 0;
         int non_transferred_sectors = mvhd_format_sectors(hdd_images[id].vhd, sector, count);
         hdd_images[id].pos          = sector + count - non_transferred_sectors - 1;
         if (hdd_images[id].vhd->error)
             return -1;
+    } else if (hdd_images[id].type == HDD_IMAGE_OVL) {
+        hdd_images[id].pos = sector + count;
+        return hdd_overlay_zero(hdd_images[id].ovl, sector, count);
     } else {
+        hdd_image_cache_t *cache = hdd_images[id].cache;
+        int                ret   = 0;
+
+        if (hdd_images[id].map != NULL) {
+            uint32_t avail = hdd_image_map_avail(id, sector, count);
+
+            if (hdd_images[id].map_ro)
+                return -1;
+
+            memset(hdd_images[id].map + ((uint64_t) sector << 9) + hdd_images[id].base, 0, (size_t) avail << 9);
+            hdd_images[id].pos = sector + avail;
+            if (avail == count)
+                return 0;
+
+            /* The rest is past the end of the file, extend it below. */
+            sector += avail;
+            count -= avail;
+        }
+
         memset(empty_sector, 0, 512);
 
+        if (cache != NULL) {
+            thread_wait_mutex(cache->mutex);
+            if (hdd_image_cache_flush_locked(id, cache) < 0)
+                ret = -1;
+            hdd_image_cache_discard(cache, sector, count);
+        }
+
         if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
             hdd_image_log("Hard disk image %i: Zero error during seek\n", id);
-            return -1;
-        }
+            ret = -1;
+        } else {
+            for (uint32_t i = 0; i < count; i++) {
+                if (feof(hdd_images[id].file))
+                    break;
 
-        for (uint32_t i = 0; i < count; i++) {
-            if (feof(hdd_images[id].file))
-                break;
+                if (!fwrite(empty_sector, 512, 1, hdd_images[id].file)) {
+                    ret = -1;
+                    break;
+                }
+                hdd_images[id].pos = sector + i + 1;
+            }
 
-            hdd_images[id].pos = sector + i;
-            if (!fwrite(empty_sector, 512, 1, hdd_images[id].file))
-                return -1;
+            fflush(hdd_images[id].file);
         }
 
-        fflush(hdd_images[id].file);
+        if (cache != NULL)
+            thread_release_mutex(cache->mutex);
+
+        return ret;
     }
 
     return 0;
@@ -727,6 +2099,8 @@ hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count)
 uint32_t
 hdd_image_get_pos(uint8_t id)
 {
+    hdd_image_async_flush(id);
+
     return hdd_images[id].pos;
 }
 
@@ -742,6 +2116,10 @@ hdd_image_unload(uint8_t id, UNUSED(int fn_preserve))
     if (strlen(hdd[id].fn) == 0)
         return;
 
+    hdd_image_async_stop(id);
+    hdd_image_cache_close(id);
+    hdd_image_unmap(id);
+
     if (hdd_images[id].loaded) {
         if (hdd_images[id].file != NULL) {
             fclose(hdd_images[id].file);
@@ -749,7 +2127,8 @@ hdd_image_unload(uint8_t id, UNUSED(int fn_preserve))
         } else if (hdd_images[id].vhd != NULL) {
             mvhd_close(hdd_images[id].vhd);
             hdd_images[id].vhd = NULL;
-        }
+        } else if (hdd_images[id].ovl != NULL)
+            hdd_image_close_overlay(id);
         hdd_images[id].loaded = 0;
     }
 
@@ -766,27 +2145,56 @@ hdd_image_close(uint8_t id)
     if (!hdd_images[id].loaded)
         return;
 
+    hdd_image_async_stop(id);
+    hdd_image_cache_close(id);
+    hdd_image_unmap(id);
+
     if (hdd_images[id].file != NULL) {
         fclose(hdd_images[id].file);
         hdd_images[id].file = NULL;
     } else if (hdd_images[id].vhd != NULL) {
         mvhd_close(hdd_images[id].vhd);
         hdd_images[id].vhd = NULL;
-    }
+    } else if (hdd_images[id].ovl != NULL)
+        hdd_image_close_overlay(id);
 
     memset(&hdd_images[id], 0, sizeof(hdd_image_t));
     hdd_images[id].loaded = 0;
 }
 
-void
+/* Returns -1 if a write failed since the last sync, including queued ones. */
+int
 hdd_image_sync(uint8_t id)
 {
+    int ret = 0;
+
     if (!hdd_images[id].loaded)
-        return;
+        return 0;
 
-    if (hdd_images[id].file != NULL) {
-        fflush(hdd_images[id].file);
+    /* This can be called from outside the emulation thread, so leave a
+       pending prefetch alone and only wait for the queue to drain. */
+    if (hdd_images[id].async != NULL) {
+        hdd_image_async_wait(hdd_images[id].async, NULL);
+        ret = hdd_image_async_take_error(hdd_images[id].async);
+    }
+
+    if (hdd_images[id].ovl != NULL)
+        hdd_overlay_sync(hdd_images[id].ovl);
+    else if (hdd_images[id].map != NULL) {
+#ifdef _WIN32
+        FlushViewOfFile(hdd_images[id].map, 0);
+#else
+        msync(hdd_images[id].map, hdd_images[id].map_size, MS_SYNC);
+#endif
+    } else if (hdd_images[id].cache != NULL) {
+        if (hdd_image_cache_flush(id) < 0)
+            ret = -1;
+    } else if (hdd_images[id].file != NULL) {
+        if (fflush(hdd_images[id].file) != 0)
+            ret = -1;
     }
+
+    return ret;
 }
 
 void
@@ -794,7 +2202,97 @@ hdd_image_sync_all(void)
 {
     hdd_image_log("hdd_image_sync_all: syncing all disk images\n");
     for (uint8_t i = 0; i < HDD_NUM; i++) {
-        if (hdd_images[i].loaded)
-            hdd_image_sync(i);
+        if (hdd_images[i].loaded && (hdd_image_sync(i) < 0))
+            pclog("Hard disk image %i: Sync failed, the image may be incomplete\n", i);
+    }
+}
+
+/* Called once a second, writes back the write-back caches that are due. */
+void
+hdd_image_onesec(void)
+{
+    hdd_image_cache_t *cache;
+
+    if (hdd_image_cache_policy != HDD_IMAGE_CACHE_WRITE_BACK)
+        return;
+
+    for (uint8_t i = 0; i < HDD_NUM; i++) {
+        cache = hdd_images[i].cache;
+        if (!hdd_images[i].loaded || (cache == NULL))
+            continue;
+
+        thread_wait_mutex(cache->mutex);
+        if (++cache->secs >= hdd_image_cache_flush_interval)
+            hdd_image_cache_flush_locked(i, cache);
+        thread_release_mutex(cache->mutex);
     }
 }
+
+/* Overlay maintenance, for use from the command line. The overlay must not
+   be in use by a running machine. */
+int
+hdd_image_overlay_create(const char *fn, const char *base_fn)
+{
+    hdd_image_base_t *base = hdd_image_base_open(base_fn, 1);
+    uint32_t          spt;
+    uint32_t          hpc;
+    uint32_t          tracks;
+    int               ret;
+
+    if (base == NULL)
+        return -1;
+
+    spt    = base->spt;
+    hpc    = base->hpc;
+    tracks = base->tracks;
+    if (!spt || !hpc || !tracks)
+        hdd_image_calc_chs(&tracks, &hpc, &spt, base->sectors >> 11);
+
+    ret = hdd_overlay_create(fn, base_fn, base->sectors, spt, hpc, tracks);
+    hdd_image_base_close(base);
+
+    return ret;
+}
+
+static int
+hdd_image_overlay_op(const char *fn, int commit)
+{
+    hdd_overlay_t    *ovl = hdd_overlay_open(fn, 0);
+    hdd_image_base_t *base;
+    char              base_fn[1024];
+    int               ret;
+
+    if (ovl == NULL)
+        return -1;
+
+    if (commit) {
+        hdd_overlay_get_base_path(ovl, base_fn, sizeof(base_fn));
+        base = hdd_image_base_open(base_fn, 0);
+        if (base == NULL) {
+            hdd_overlay_close(ovl);
+            return -1;
+        }
+        hdd_overlay_set_base(ovl, hdd_image_base_read, hdd_image_base_write, base);
+        ret = hdd_overlay_commit(ovl);
+        if (base->file != NULL)
+            fflush(base->file);
+        hdd_image_base_close(base);
+    } else
+        ret = hdd_overlay_discard(ovl);
+
+    hdd_overlay_close(ovl);
+
+    return ret;
+}
+
+int
+hdd_image_overlay_commit(const char *fn)
+{
+    return hdd_image_overlay_op(fn, 1);
+}
+
+int
+hdd_image_overlay_discard(const char *fn)
+{
+    return hdd_image_overlay_op(fn, 0);
+}
@@ -0,0 +1,673 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Implementation of the copy-on-write overlay hard disk images.
+ *
+ *          The file starts with a header, padded to 4 KB, followed by
+ *          the L1 table. Every other cluster in the file is either an
+ *          L2 table or data. Table entries are 64-bit file offsets, 0
+ *          meaning the cluster is not in the overlay (read it from the
+ *          base image) and HDD_OVERLAY_ZERO meaning it reads as zeroes.
+ *          Data is always written before the table entry pointing to
+ *          it, so an interrupted write at worst leaves an unused
+ *          cluster behind. All fields are little-endian.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+#include <86box/bswap.h>
+#include <86box/hdd_overlay.h>
+
+#define HDD_OVERLAY_HEADER_SIZE 4096
+#define HDD_OVERLAY_ZERO        1ULL
+
+typedef struct hdd_overlay_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t cluster_bits;
+    uint32_t sectors;
+    uint32_t spt;
+    uint32_t hpc;
+    uint32_t tracks;
+    uint32_t l1_entries;
+    uint32_t reserved;
+    uint64_t l1_offset;
+    char     base[1024]; /* Absolute, or relative to the overlay's directory. */
+} hdd_overlay_header_t;
+
+struct hdd_overlay_t {
+    FILE                *fp;
+    char                 fn[1024];
+    int                  readonly;
+    hdd_overlay_header_t hdr;
+
+    uint32_t cluster_size;
+    uint32_t cluster_shift; /* Sectors to clusters. */
+    uint32_t cluster_sectors;
+    uint32_t l2_bits;
+    uint32_t l2_entries;
+    uint64_t data_start;
+    uint64_t next_free;
+
+    uint64_t  *l1;
+    uint64_t **l2; /* Loaded on first use. */
+    uint8_t   *buf;
+
+    hdd_overlay_io_t base_read;
+    hdd_overlay_io_t base_write;
+    void            *base_priv;
+};
+
+#ifdef ENABLE_HDD_OVERLAY_LOG
+int hdd_overlay_do_log = ENABLE_HDD_OVERLAY_LOG;
+
+static void
+hdd_overlay_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (hdd_overlay_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define hdd_overlay_log(fmt, ...)
+#endif
+
+static uint64_t
+hdd_overlay_align(uint64_t offset, uint32_t size)
+{
+    return (offset + size - 1) & ~((uint64_t) size - 1);
+}
+
+static int
+hdd_overlay_pread(hdd_overlay_t *ovl, uint64_t offset, void *data, size_t size)
+{
+    if (fseeko64(ovl->fp, offset, SEEK_SET) == -1)
+        return -1;
+
+    return (fread(data, 1, size, ovl->fp) == size) ? 0 : -1;
+}
+
+static int
+hdd_overlay_pwrite(hdd_overlay_t *ovl, uint64_t offset, const void *data, size_t size)
+{
+    if (fseeko64(ovl->fp, offset, SEEK_SET) == -1)
+        return -1;
+
+    return (fwrite(data, 1, size, ovl->fp) == size) ? 0 : -1;
+}
+
+/* The header has no padding, so only the byte order of each field needs
+   converting between the file and the host. */
+static void
+hdd_overlay_header_swap(hdd_overlay_header_t *hdr)
+{
+    hdr->version      = le32_to_cpu(hdr->version);
+    hdr->cluster_bits = le32_to_cpu(hdr->cluster_bits);
+    hdr->sectors      = le32_to_cpu(hdr->sectors);
+    hdr->spt          = le32_to_cpu(hdr->spt);
+    hdr->hpc          = le32_to_cpu(hdr->hpc);
+    hdr->tracks       = le32_to_cpu(hdr->tracks);
+    hdr->l1_entries   = le32_to_cpu(hdr->l1_entries);
+    hdr->reserved     = le32_to_cpu(hdr->reserved);
+    hdr->l1_offset    = le64_to_cpu(hdr->l1_offset);
+}
+
+static void
+hdd_overlay_table_to_cpu(uint64_t *table, uint32_t entries)
+{
+    for (uint32_t i = 0; i < entries; i++)
+        table[i] = le64_to_cpu(table[i]);
+}
+
+/* Write the header and an empty L1 table, making the file an empty overlay. */
+static int
+hdd_overlay_write_empty(FILE *fp, const hdd_overlay_header_t *hdr)
+{
+    hdd_overlay_header_t le_hdr                         = *hdr;
+    uint8_t              block[HDD_OVERLAY_HEADER_SIZE] = { 0 };
+    uint64_t             size                           = (uint64_t) hdr->l1_entries * sizeof(uint64_t);
+
+    hdd_overlay_header_swap(&le_hdr);
+    memcpy(block, &le_hdr, sizeof(hdd_overlay_header_t));
+    if (fwrite(block, 1, sizeof(block), fp) != sizeof(block))
+        return -1;
+
+    memset(block, 0, sizeof(block));
+    while (size > 0) {
+        size_t n = (size > sizeof(block)) ? sizeof(block) : (size_t) size;
+
+        if (fwrite(block, 1, n, fp) != n)
+            return -1;
+        size -= n;
+    }
+
+    fflush(fp);
+
+    return 0;
+}
+
+static void
+hdd_overlay_init_header(hdd_overlay_header_t *hdr, const char *base_fn, uint32_t sectors,
+                        uint32_t spt, uint32_t hpc, uint32_t tracks)
+{
+    uint32_t clusters;
+    uint32_t l2_entries = 1 << (HDD_OVERLAY_CLUSTER_BITS - 3);
+
+    memset(hdr, 0, sizeof(hdd_overlay_header_t));
+    memcpy(hdr->magic, HDD_OVERLAY_MAGIC, sizeof(HDD_OVERLAY_MAGIC));
+    hdr->version      = HDD_OVERLAY_VERSION;
+    hdr->cluster_bits = HDD_OVERLAY_CLUSTER_BITS;
+    hdr->sectors      = sectors;
+    hdr->spt          = spt;
+    hdr->hpc          = hpc;
+    hdr->tracks       = tracks;
+    clusters          = (uint32_t) (((uint64_t) sectors + (1 << (HDD_OVERLAY_CLUSTER_BITS - 9)) - 1) >> (HDD_OVERLAY_CLUSTER_BITS - 9));
+    hdr->l1_entries   = (clusters + l2_entries - 1) / l2_entries;
+    hdr->l1_offset    = HDD_OVERLAY_HEADER_SIZE;
+    strncpy(hdr->base, base_fn, sizeof(hdr->base) - 1);
+}
+
+int
+hdd_overlay_probe(const char *fn)
+{
+    char  magic[8];
+    FILE *fp = plat_fopen(fn, "rb");
+    int   ret;
+
+    if (fp == NULL)
+        return 0;
+
+    ret = (fread(magic, 1, sizeof(magic), fp) == sizeof(magic)) && !memcmp(magic, HDD_OVERLAY_MAGIC, sizeof(HDD_OVERLAY_MAGIC));
+    fclose(fp);
+
+    return ret;
+}
+
+/* Creating an overlay only writes its header and L1 table, a few KB at most.
+   A relative base path is taken from the current directory, and stored as
+   an absolute one, so that the overlay can be opened from anywhere. */
+int
+hdd_overlay_create(const char *fn, const char *base_fn, uint32_t sectors,
+                   uint32_t spt, uint32_t hpc, uint32_t tracks)
+{
+    hdd_overlay_header_t hdr;
+    char                 base[1024];
+    char                 cwd[1024] = { 0 };
+    FILE                *fp;
+    int                  ret;
+
+    if ((base_fn == NULL) || (base_fn[0] == '\0') || (sectors == 0))
+        return -1;
+
+    if (path_abs((char *) base_fn))
+        ret = snprintf(base, sizeof(base), "%s", base_fn);
+    else {
+        plat_getcwd(cwd, sizeof(cwd) - 1);
+        if (cwd[0] == '\0')
+            return -1;
+        ret = snprintf(base, sizeof(base), "%s/%s", cwd, base_fn);
+    }
+    if ((ret < 0) || (ret >= (int) sizeof(hdr.base)))
+        return -1;
+
+    fp = plat_fopen(fn, "wb");
+    if (fp == NULL)
+        return -1;
+
+    hdd_overlay_init_header(&hdr, base, sectors, spt, hpc, tracks);
+    ret = hdd_overlay_write_empty(fp, &hdr);
+    fclose(fp);
+
+    hdd_overlay_log("Overlay %s: created over %s, %u sectors\n", fn, base, sectors);
+
+    return ret;
+}
+
+static void
+hdd_overlay_free_tables(hdd_overlay_t *ovl)
+{
+    if (ovl->l2 != NULL) {
+        for (uint32_t i = 0; i < ovl->hdr.l1_entries; i++)
+            free(ovl->l2[i]);
+        memset(ovl->l2, 0, ovl->hdr.l1_entries * sizeof(uint64_t *));
+    }
+}
+
+hdd_overlay_t *
+hdd_overlay_open(const char *fn, int readonly)
+{
+    hdd_overlay_t *ovl = (hdd_overlay_t *) calloc(1, sizeof(hdd_overlay_t));
+    uint64_t       size;
+
+    if (ovl == NULL)
+        return NULL;
+
+    strncpy(ovl->fn, fn, sizeof(ovl->fn) - 1);
+    ovl->readonly = readonly;
+    ovl->fp       = plat_fopen(fn, readonly ? "rb" : "rb+");
+    if (ovl->fp == NULL)
+        goto fail;
+
+    if (fread(&ovl->hdr, 1, sizeof(hdd_overlay_header_t), ovl->fp) != sizeof(hdd_overlay_header_t))
+        goto fail;
+    hdd_overlay_header_swap(&ovl->hdr);
+    if (memcmp(ovl->hdr.magic, HDD_OVERLAY_MAGIC, sizeof(HDD_OVERLAY_MAGIC)) || (ovl->hdr.version != HDD_OVERLAY_VERSION) ||
+        (ovl->hdr.cluster_bits < 12) || (ovl->hdr.cluster_bits > 24) || (ovl->hdr.l1_entries == 0)) {
+        hdd_overlay_log("Overlay %s: not a supported overlay image\n", fn);
+        goto fail;
+    }
+    ovl->hdr.base[sizeof(ovl->hdr.base) - 1] = '\0';
+
+    ovl->cluster_size    = 1 << ovl->hdr.cluster_bits;
+    ovl->cluster_shift   = ovl->hdr.cluster_bits - 9;
+    ovl->cluster_sectors = 1 << ovl->cluster_shift;
+    ovl->l2_bits         = ovl->hdr.cluster_bits - 3;
+    ovl->l2_entries      = 1 << ovl->l2_bits;
+    ovl->data_start      = hdd_overlay_align(ovl->hdr.l1_offset + (uint64_t) ovl->hdr.l1_entries * sizeof(uint64_t), ovl->cluster_size);
+
+    ovl->l1  = (uint64_t *) calloc(ovl->hdr.l1_entries, sizeof(uint64_t));
+    ovl->l2  = (uint64_t **) calloc(ovl->hdr.l1_entries, sizeof(uint64_t *));
+    ovl->buf = (uint8_t *) malloc(ovl->cluster_size);
+    if ((ovl->l1 == NULL) || (ovl->l2 == NULL) || (ovl->buf == NULL)) {
+        hdd_overlay_log("Overlay %s: out of memory\n", fn);
+        goto fail;
+    }
+    if (hdd_overlay_pread(ovl, ovl->hdr.l1_offset, ovl->l1, ovl->hdr.l1_entries * sizeof(uint64_t)) < 0)
+        goto fail;
+    hdd_overlay_table_to_cpu(ovl->l1, ovl->hdr.l1_entries);
+
+    if (fseeko64(ovl->fp, 0, SEEK_END) == -1)
+        goto fail;
+    size           = ftello64(ovl->fp);
+    ovl->next_free = hdd_overlay_align((size > ovl->data_start) ? size : ovl->data_start, ovl->cluster_size);
+
+    hdd_overlay_log("Overlay %s: opened, base %s, %" PRIu64 " bytes in use\n", fn, ovl->hdr.base, ovl->next_free);
+
+    return ovl;
+
+fail:
+    hdd_overlay_close(ovl);
+    return NULL;
+}
+
+void
+hdd_overlay_close(hdd_overlay_t *ovl)
+{
+    if (ovl == NULL)
+        return;
+
+    if (ovl->fp != NULL)
+        fclose(ovl->fp);
+    hdd_overlay_free_tables(ovl);
+    free(ovl->l2);
+    free(ovl->l1);
+    free(ovl->buf);
+    free(ovl);
+}
+
+void
+hdd_overlay_set_base(hdd_overlay_t *ovl, hdd_overlay_io_t read, hdd_overlay_io_t write, void *priv)
+{
+    ovl->base_read  = read;
+    ovl->base_write = write;
+    ovl->base_priv  = priv;
+}
+
+void
+hdd_overlay_get_base_path(hdd_overlay_t *ovl, char *dest, size_t size)
+{
+    char dir[1024];
+
+    if (path_abs(ovl->hdr.base)) {
+        snprintf(dest, size, "%s", ovl->hdr.base);
+        return;
+    }
+
+    path_get_dirname(dir, ovl->fn);
+    if (dir[0] == '\0')
+        snprintf(dest, size, "%s", ovl->hdr.base);
+    else
+        snprintf(dest, size, "%s/%s", dir, ovl->hdr.base);
+}
+
+void
+hdd_overlay_get_geometry(hdd_overlay_t *ovl, uint32_t *spt, uint32_t *hpc, uint32_t *tracks)
+{
+    *spt    = ovl->hdr.spt;
+    *hpc    = ovl->hdr.hpc;
+    *tracks = ovl->hdr.tracks;
+}
+
+uint32_t
+hdd_overlay_get_sectors(hdd_overlay_t *ovl)
+{
+    return ovl->hdr.sectors;
+}
+
+/* Get the L2 table covering an L1 entry, optionally allocating it. */
+static uint64_t *
+hdd_overlay_get_l2(hdd_overlay_t *ovl, uint32_t l1_index, int alloc)
+{
+    uint64_t *l2;
+    uint64_t  offset;
+    uint64_t  le_offset;
+
+    if (l1_index >= ovl->hdr.l1_entries)
+        return NULL;
+    if (ovl->l2[l1_index] != NULL)
+        return ovl->l2[l1_index];
+
+    if (ovl->l1[l1_index] == 0) {
+        if (!alloc)
+            return NULL;
+
+        l2 = (uint64_t *) calloc(ovl->l2_entries, sizeof(uint64_t));
+        if (l2 == NULL)
+            return NULL;
+
+        /* The table goes to disk before the L1 entry pointing to it. On
+           failure, leave the L1 table and the allocation point as they were,
+           so that the next attempt starts over. */
+        offset = ovl->next_free;
+        if (hdd_overlay_pwrite(ovl, offset, l2, ovl->cluster_size) < 0) {
+            free(l2);
+            return NULL;
+        }
+
+        le_offset = cpu_to_le64(offset);
+        if (hdd_overlay_pwrite(ovl, ovl->hdr.l1_offset + (uint64_t) l1_index * sizeof(uint64_t), &le_offset, sizeof(uint64_t)) < 0) {
+            free(l2);
+            return NULL;
+        }
+
+        ovl->l1[l1_index] = offset;
+        ovl->next_free += ovl->cluster_size;
+    } else {
+        l2 = (uint64_t *) malloc(ovl->cluster_size);
+        if (l2 == NULL)
+            return NULL;
+
+        if (hdd_overlay_pread(ovl, ovl->l1[l1_index], l2, ovl->cluster_size) < 0) {
+            free(l2);
+            return NULL;
+        }
+        hdd_overlay_table_to_cpu(l2, ovl->l2_entries);
+    }
+
+    ovl->l2[l1_index] = l2;
+
+    return l2;
+}
+
+static uint64_t
+hdd_overlay_get_entry(hdd_overlay_t *ovl, uint32_t cluster)
+{
+    const uint64_t *l2 = hdd_overlay_get_l2(ovl, cluster >> ovl->l2_bits, 0);
+
+    return (l2 == NULL) ? 0 : l2[cluster & (ovl->l2_entries - 1)];
+}
+
+static int
+hdd_overlay_set_entry(hdd_overlay_t *ovl, uint32_t cluster, uint64_t entry)
+{
+    uint32_t  l1_index = cluster >> ovl->l2_bits;
+    uint32_t  l2_index = cluster & (ovl->l2_entries - 1);
+    uint64_t *l2       = hdd_overlay_get_l2(ovl, l1_index, 1);
+    uint64_t  le_entry = cpu_to_le64(entry);
+
+    if (l2 == NULL)
+        return -1;
+
+    if (hdd_overlay_pwrite(ovl, ovl->l1[l1_index] + (uint64_t) l2_index * sizeof(uint64_t), &le_entry, sizeof(uint64_t)) < 0)
+        return -1;
+
+    l2[l2_index] = entry;
+
+    return 0;
+}
+
+static int
+hdd_overlay_read_base(hdd_overlay_t *ovl, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    if (sector >= ovl->hdr.sectors) {
+        memset(buffer, 0, (size_t) count << 9);
+        return 0;
+    }
+    if (count > (ovl->hdr.sectors - sector)) {
+        memset(buffer + ((size_t) (ovl->hdr.sectors - sector) << 9), 0, (size_t) (count - (ovl->hdr.sectors - sector)) << 9);
+        count = ovl->hdr.sectors - sector;
+    }
+
+    if (ovl->base_read == NULL) {
+        memset(buffer, 0, (size_t) count << 9);
+        return -1;
+    }
+
+    return ovl->base_read(ovl->base_priv, sector, count, buffer);
+}
+
+int
+hdd_overlay_read(hdd_overlay_t *ovl, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    int ret = 0;
+
+    while (count > 0) {
+        uint32_t cluster = sector >> ovl->cluster_shift;
+        uint32_t offset  = sector & (ovl->cluster_sectors - 1);
+        uint32_t num     = ovl->cluster_sectors - offset;
+        uint64_t entry   = hdd_overlay_get_entry(ovl, cluster);
+        uint64_t expect  = entry;
+
+        /* Extend the extent over the following clusters of the same kind,
+           as long as they are contiguous in the overlay file. */
+        while (num < count) {
+            if (entry > HDD_OVERLAY_ZERO)
+                expect += ovl->cluster_size;
+            if (hdd_overlay_get_entry(ovl, cluster + 1) != expect)
+                break;
+            cluster++;
+            num += ovl->cluster_sectors;
+        }
+        if (num > count)
+            num = count;
+
+        if (entry == 0) {
+            if (hdd_overlay_read_base(ovl, sector, num, buffer) < 0)
+                ret = -1;
+        } else if (entry == HDD_OVERLAY_ZERO)
+            memset(buffer, 0, (size_t) num << 9);
+        else if (hdd_overlay_pread(ovl, entry + ((uint64_t) offset << 9), buffer, (size_t) num << 9) < 0)
+            ret = -1;
+
+        buffer += (size_t) num << 9;
+        sector += num;
+        count -= num;
+    }
+
+    return ret;
+}
+
+/* Copy a cluster into the overlay before its first write. The part not
+   being written comes from the base image, or is zero. */
+static int
+hdd_overlay_alloc_cluster(hdd_overlay_t *ovl, uint32_t cluster, uint64_t entry, uint32_t offset, uint32_t num, const uint8_t *buffer)
+{
+    uint32_t first = cluster << ovl->cluster_shift;
+    uint64_t new_entry;
+
+    if (num < ovl->cluster_sectors) {
+        if (entry == HDD_OVERLAY_ZERO)
+            memset(ovl->buf, 0, ovl->cluster_size);
+        else if (hdd_overlay_read_base(ovl, first, ovl->cluster_sectors, ovl->buf) < 0)
+            return -1;
+    }
+    memcpy(ovl->buf + ((size_t) offset << 9), buffer, (size_t) num << 9);
+
+    new_entry = ovl->next_free;
+    if (hdd_overlay_pwrite(ovl, new_entry, ovl->buf, ovl->cluster_size) < 0)
+        return -1;
+    ovl->next_free += ovl->cluster_size;
+
+    if (hdd_overlay_set_entry(ovl, cluster, new_entry) < 0) {
+        /* Nothing points to the new cluster, hand it out again. */
+        if (ovl->next_free == (new_entry + ovl->cluster_size))
+            ovl->next_free = new_entry;
+        return -1;
+    }
+
+    return 0;
+}
+
+int
+hdd_overlay_write(hdd_overlay_t *ovl, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    int ret = 0;
+
+    if (ovl->readonly)
+        return -1;
+
+    while (count > 0) {
+        uint32_t cluster = sector >> ovl->cluster_shift;
+        uint32_t offset  = sector & (ovl->cluster_sectors - 1);
+        uint32_t num     = ovl->cluster_sectors - offset;
+        uint64_t entry   = hdd_overlay_get_entry(ovl, cluster);
+
+        if (num > count)
+            num = count;
+
+        if (entry <= HDD_OVERLAY_ZERO) {
+            if (hdd_overlay_alloc_cluster(ovl, cluster, entry, offset, num, buffer) < 0)
+                ret = -1;
+        } else if (hdd_overlay_pwrite(ovl, entry + ((uint64_t) offset << 9), buffer, (size_t) num << 9) < 0)
+            ret = -1;
+
+        buffer += (size_t) num << 9;
+        sector += num;
+        count -= num;
+    }
+
+    fflush(ovl->fp);
+
+    return ret;
+}
+
+/* Whole clusters are just marked as zero, partial ones are written. The
+   space used by clusters that get zeroed is not reclaimed. */
+int
+hdd_overlay_zero(hdd_overlay_t *ovl, uint32_t sector, uint32_t count)
+{
+    uint8_t *zero;
+    int      ret = 0;
+
+    if (ovl->readonly)
+        return -1;
+
+    zero = (uint8_t *) calloc(1, ovl->cluster_size);
+    if (zero == NULL)
+        return -1;
+
+    while (count > 0) {
+        uint32_t cluster = sector >> ovl->cluster_shift;
+        uint32_t offset  = sector & (ovl->cluster_sectors - 1);
+        uint32_t num     = ovl->cluster_sectors - offset;
+
+        if (num > count)
+            num = count;
+
+        if (num == ovl->cluster_sectors) {
+            if ((hdd_overlay_get_entry(ovl, cluster) != HDD_OVERLAY_ZERO) &&
+                (hdd_overlay_set_entry(ovl, cluster, HDD_OVERLAY_ZERO) < 0))
+                ret = -1;
+        } else if (hdd_overlay_write(ovl, sector, num, zero) < 0)
+            ret = -1;
+
+        sector += num;
+        count -= num;
+    }
+
+    free(zero);
+    fflush(ovl->fp);
+
+    return ret;
+}
+
+void
+hdd_overlay_sync(hdd_overlay_t *ovl)
+{
+    fflush(ovl->fp);
+}
+
+int
+hdd_overlay_discard(hdd_overlay_t *ovl)
+{
+    if (ovl->readonly)
+        return -1;
+
+    /* Reopening truncates the file. */
+    fclose(ovl->fp);
+    ovl->fp = plat_fopen(ovl->fn, "wb+");
+    if (ovl->fp == NULL)
+        return -1;
+
+    hdd_overlay_free_tables(ovl);
+    memset(ovl->l1, 0, ovl->hdr.l1_entries * sizeof(uint64_t));
+    ovl->next_free = ovl->data_start;
+
+    hdd_overlay_log("Overlay %s: discarded\n", ovl->fn);
+
+    return hdd_overlay_write_empty(ovl->fp, &ovl->hdr);
+}
+
+int
+hdd_overlay_commit(hdd_overlay_t *ovl)
+{
+    uint32_t clusters = (ovl->hdr.sectors + ovl->cluster_sectors - 1) >> ovl->cluster_shift;
+    uint32_t written  = 0;
+    uint32_t first;
+    uint32_t num;
+    uint64_t entry;
+
+    if (ovl->readonly || (ovl->base_write == NULL))
+        return -1;
+
+    for (uint32_t cluster = 0; cluster < clusters; cluster++) {
+        entry = hdd_overlay_get_entry(ovl, cluster);
+        if (entry == 0)
+            continue;
+
+        first = cluster << ovl->cluster_shift;
+        num   = ovl->hdr.sectors - first;
+        if (num > ovl->cluster_sectors)
+            num = ovl->cluster_sectors;
+
+        if (entry == HDD_OVERLAY_ZERO)
+            memset(ovl->buf, 0, ovl->cluster_size);
+        else if (hdd_overlay_pread(ovl, entry, ovl->buf, (size_t) num << 9) < 0)
+            return -1;
+
+        if (ovl->base_write(ovl->base_priv, first, num, ovl->buf) < 0)
+            return -1;
+        written++;
+    }
+
+    hdd_overlay_log("Overlay %s: committed %u clusters\n", ovl->fn, written);
+
+    return hdd_overlay_discard(ovl);
+}
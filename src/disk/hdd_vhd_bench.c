@@ -0,0 +1,182 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          VHD read benchmark.
+ *
+ *          --vhdbench builds a fragmented dynamic VHD and a differencing
+ *          child over it in the given directory, then times sequential
+ *          and random reads through MiniVHD on both and reports the
+ *          throughput, along with a checksum of the data read, which
+ *          must not change between builds.
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+#include <86box/hdd.h>
+#include "minivhd/minivhd.h"
+
+/* 130 x 16 x 63, about 64 MB. */
+#define BENCH_CYL     130
+#define BENCH_HEADS   16
+#define BENCH_SPT     63
+#define BENCH_SECTORS (BENCH_CYL * BENCH_HEADS * BENCH_SPT)
+
+#define BENCH_WRITES  4000 /* writes of 1-16 sectors, per image */
+#define BENCH_READS   20000
+#define BENCH_MAX_LEN 256 /* sectors per read */
+
+static uint32_t bench_seed;
+
+static uint32_t
+bench_rand(void)
+{
+    bench_seed = (bench_seed * 1103515245u) + 12345u;
+
+    return bench_seed >> 8;
+}
+
+static uint32_t
+bench_sum(uint32_t sum, const uint8_t *buf, uint32_t len)
+{
+    /* FNV-1a. */
+    for (uint32_t i = 0; i < len; i++)
+        sum = (sum ^ buf[i]) * 16777619u;
+
+    return sum;
+}
+
+/* Scatter small writes over the image, so that its blocks are allocated out
+   of order and their bitmaps are a mix of present and absent runs. */
+static int
+bench_fill(MVHDMeta *vhdm, uint8_t *buf)
+{
+    for (int i = 0; i < BENCH_WRITES; i++) {
+        uint32_t sector = bench_rand() % (BENCH_SECTORS - 16);
+        int      count  = 1 + (bench_rand() % 16);
+
+        for (int j = 0; j < (count * 512); j++)
+            buf[j] = bench_rand();
+
+        if (mvhd_write_sectors(vhdm, sector, count, buf) != 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+static void
+bench_run(const char *name, MVHDMeta *vhdm, uint8_t *buf)
+{
+    uint64_t start;
+    uint64_t seq   = 0;
+    uint64_t rnd   = 0;
+    uint64_t bytes = 0;
+    uint32_t sum   = 2166136261u;
+
+    /* Only the reads are timed, the checksum is far slower than them. */
+    for (uint32_t sector = 0; sector < BENCH_SECTORS; sector += BENCH_MAX_LEN) {
+        int count = BENCH_MAX_LEN;
+
+        if ((sector + count) > BENCH_SECTORS)
+            count = BENCH_SECTORS - sector;
+
+        start = plat_timer_read();
+        mvhd_read_sectors(vhdm, sector, count, buf);
+        seq += plat_timer_read() - start;
+
+        sum = bench_sum(sum, buf, count * 512);
+    }
+
+    for (int i = 0; i < BENCH_READS; i++) {
+        uint32_t sector = bench_rand() % (BENCH_SECTORS - BENCH_MAX_LEN);
+        int      count  = 1 + (bench_rand() % BENCH_MAX_LEN);
+
+        start = plat_timer_read();
+        mvhd_read_sectors(vhdm, sector, count, buf);
+        rnd += plat_timer_read() - start;
+
+        sum = bench_sum(sum, buf, count * 512);
+        bytes += count * 512;
+    }
+
+    always_log("%-14s sequential %8.1f MB/s, random %8.1f MB/s, checksum %08X\n", name,
+               (BENCH_SECTORS * 512.0 * plat_timer_freq()) / (seq * 1048576.0),
+               (bytes * (double) plat_timer_freq()) / (rnd * 1048576.0), sum);
+}
+
+/* Time reads from dynamic and differencing VHDs created in 'dir'. Returns 0,
+   so that the emulator exits. */
+int
+vhd_bench(const char *dir)
+{
+    MVHDGeom  geom = { .cyl = BENCH_CYL, .heads = BENCH_HEADS, .spt = BENCH_SPT };
+    MVHDMeta *vhdm;
+    char      path[1024];
+    char      base_fn[1024];
+    char      diff_fn[1024];
+    uint8_t  *buf;
+    int       err;
+
+    buf = malloc(BENCH_MAX_LEN * 512);
+    if (buf == NULL)
+        fatal("VHD benchmark: out of memory\n");
+
+    /* MiniVHD wants an absolute path to the parent of a differencing image. */
+    if (path_abs((char *) dir))
+        snprintf(path, sizeof(path), "%s", dir);
+    else
+        path_append_filename(path, usr_path, dir);
+    path_append_filename(base_fn, path, "vhdbench_base.vhd");
+    path_append_filename(diff_fn, path, "vhdbench_diff.vhd");
+    plat_remove(base_fn);
+    plat_remove(diff_fn);
+
+    bench_seed = 1;
+
+    always_log("VHD benchmark: %d sectors, %d random reads of 1-%d sectors\n",
+               BENCH_SECTORS, BENCH_READS, BENCH_MAX_LEN);
+
+    vhdm = mvhd_create_sparse(base_fn, geom, &err);
+    if (vhdm == NULL) {
+        always_log("VHD benchmark: unable to create '%s': %s\n", base_fn, mvhd_strerr(err));
+        goto done;
+    }
+    if (!bench_fill(vhdm, buf)) {
+        always_log("VHD benchmark: write error on '%s'\n", base_fn);
+        goto done;
+    }
+    bench_run("dynamic:", vhdm, buf);
+    mvhd_close(vhdm);
+
+    vhdm = mvhd_create_diff(diff_fn, base_fn, &err);
+    if (vhdm == NULL) {
+        always_log("VHD benchmark: unable to create '%s': %s\n", diff_fn, mvhd_strerr(err));
+        goto done;
+    }
+    if (!bench_fill(vhdm, buf)) {
+        always_log("VHD benchmark: write error on '%s'\n", diff_fn);
+        goto done;
+    }
+    bench_run("differencing:", vhdm, buf);
+
+done:
+    if (vhdm != NULL)
+        mvhd_close(vhdm);
+
+    plat_remove(diff_fn);
+    plat_remove(base_fn);
+    free(buf);
+
+    return 0;
+}
@@ -61,10 +61,17 @@
 #define MVHD_START_TS          946684800
 
 
+#define MVHD_BITMAP_CACHE_SIZE 64
+
 typedef struct MVHDSectorBitmap {
     uint8_t* curr_bitmap;
     int      sector_count;
     int      curr_block;
+    /* Recently used bitmaps, for reads. Entries are -1 when unused. */
+    uint8_t* cache;
+    int      cache_block[MVHD_BITMAP_CACHE_SIZE];
+    uint32_t cache_used[MVHD_BITMAP_CACHE_SIZE];
+    uint32_t cache_clock;
 } MVHDSectorBitmap;
 
 typedef struct MVHDFooter {
@@ -118,9 +118,71 @@ read_sect_bitmap(MVHDMeta *vhdm, int blk)
     vhdm->bitmap.curr_block = blk;
 }
 
+/**
+ * \brief Find a block's sector bitmap in the bitmap cache
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] blk The block to look for
+ *
+ * \return The cache slot holding the bitmap, or -1 if it is not cached
+ */
+static int
+find_cached_bitmap(MVHDMeta *vhdm, int blk)
+{
+    for (int i = 0; i < MVHD_BITMAP_CACHE_SIZE; i++) {
+        if (vhdm->bitmap.cache_block[i] == blk)
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+ * \brief Get the sector bitmap of an allocated block, for reading
+ *
+ * Bitmaps are kept in a small cache, so that reads going back and forth
+ * between a few blocks do not have to read them again every time. The least
+ * recently used one is replaced on a miss.
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] blk The block for which to get the sector bitmap, must not be sparse
+ *
+ * \return A pointer to the bitmap, or NULL if it could not be read
+ */
+static uint8_t*
+get_sect_bitmap(MVHDMeta *vhdm, int blk)
+{
+    size_t   size = (size_t) vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE;
+    uint8_t* bitmap;
+    int      slot = find_cached_bitmap(vhdm, blk);
+
+    if (slot < 0) {
+        slot = 0;
+        for (int i = 1; i < MVHD_BITMAP_CACHE_SIZE; i++) {
+            if (vhdm->bitmap.cache_used[i] < vhdm->bitmap.cache_used[slot])
+                slot = i;
+        }
+
+        bitmap = vhdm->bitmap.cache + (slot * size);
+        vhdm->bitmap.cache_block[slot] = -1;
+        if ((mvhd_fseeko64(vhdm->f, (uint64_t)vhdm->block_offset[blk] * MVHD_SECTOR_SIZE, SEEK_SET) == -1) ||
+            !fread(bitmap, size, 1, vhdm->f)) {
+            vhdm->error = 1;
+            return NULL;
+        }
+        vhdm->bitmap.cache_block[slot] = blk;
+    }
+
+    vhdm->bitmap.cache_used[slot] = ++vhdm->bitmap.cache_clock;
+
+    return vhdm->bitmap.cache + (slot * size);
+}
+
 /**
  * \brief Write the current sector bitmap in memory to file
  *
+ * The cached copy of the bitmap, if any, is updated as well.
+ *
  * \param [in] vhdm MiniVHD data structure
  */
 static void
@@ -132,9 +194,73 @@ write_curr_sect_bitmap(MVHDMeta* vhdm)
             vhdm->error = 1;
         if (!fwrite(vhdm->bitmap.curr_bitmap, MVHD_SECTOR_SIZE, vhdm->bitmap.sector_count, vhdm->f))
             vhdm->error = 1;
+
+        int slot = find_cached_bitmap(vhdm, vhdm->bitmap.curr_block);
+        if (slot >= 0) {
+            size_t size = (size_t) vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE;
+            memcpy(vhdm->bitmap.cache + (slot * size), vhdm->bitmap.curr_bitmap, size);
+        }
     }
 }
 
+/**
+ * \brief Count how many sectors in a row have the same bitmap state
+ *
+ * \param [in] bitmap The sector bitmap of the block, NULL for a sparse block
+ * \param [in] sib The first sector in the block
+ * \param [in] max The most sectors to look at
+ * \param [out] present Set to whether the sectors are present in this image
+ *
+ * \return The length of the run, at least 1
+ */
+static int
+sect_run(const uint8_t *bitmap, int sib, int max, bool *present)
+{
+    uint8_t whole;
+    int     k = sib + 1;
+    int     end = sib + max;
+
+    if (bitmap == NULL) {
+        *present = false;
+        return max;
+    }
+
+    *present = VHD_TESTBIT(bitmap, sib) != 0;
+    whole = *present ? 0xff : 0x00;
+    while (k < end) {
+        /* Skip over whole bytes of the bitmap when possible */
+        if (!(k & 7) && ((end - k) >= 8) && (bitmap[k >> 3] == whole)) {
+            k += 8;
+            continue;
+        }
+        if ((VHD_TESTBIT(bitmap, k) != 0) != *present)
+            break;
+        k++;
+    }
+
+    return k - sib;
+}
+
+/**
+ * \brief Read a run of present sectors from a block with a single read
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] blk The block to read from
+ * \param [in] sib The first sector within the block
+ * \param [in] count The number of sectors
+ * \param [out] buff The buffer to read the sectors into
+ */
+static void
+read_block_run(MVHDMeta *vhdm, int blk, int sib, int count, uint8_t *buff)
+{
+    int64_t addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) * MVHD_SECTOR_SIZE;
+
+    if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
+        vhdm->error = 1;
+    if (!fread(buff, (size_t) count * MVHD_SECTOR_SIZE, 1, vhdm->f) && !feof(vhdm->f))
+        vhdm->error = 1;
+}
+
 /**
  * \brief Write block offset from memory into file
  *
@@ -236,6 +362,65 @@ mvhd_fixed_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buff
     return truncated_sectors;
 }
 
+/**
+ * \brief Read sectors from a sparse or differencing image, one extent at a time
+ *
+ * The range is split at block boundaries, then into runs of sectors that
+ * are either all present in this image or all absent. Present runs are read
+ * with a single read. Absent runs are zeroed for a dynamic image, or read
+ * from the parent image for a differencing one, which may split them further.
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] offset The first sector to read
+ * \param [in] count The number of sectors, must be within the image
+ * \param [out] buff The buffer to read the sectors into
+ */
+static void
+sparse_diff_read_extents(MVHDMeta *vhdm, uint32_t offset, int count, uint8_t *buff)
+{
+    MVHDMeta *parent = (vhdm->footer.disk_type == MVHD_TYPE_DIFF) ? vhdm->parent : NULL;
+
+    while (count > 0) {
+        int blk = offset / vhdm->sect_per_block;
+        int sib = offset % vhdm->sect_per_block;
+        int n   = vhdm->sect_per_block - sib;
+        uint8_t *bitmap = NULL;
+
+        if (n > count)
+            n = count;
+
+        if (vhdm->block_offset[blk] != MVHD_SPARSE_BLK) {
+            bitmap = get_sect_bitmap(vhdm, blk);
+            if (bitmap == NULL) {
+                memset(buff, 0, (size_t) count * MVHD_SECTOR_SIZE);
+                return;
+            }
+        }
+
+        while (n > 0) {
+            bool present;
+            int  run = sect_run(bitmap, sib, n, &present);
+
+            if (present)
+                read_block_run(vhdm, blk, sib, run, buff);
+            else if (parent != NULL) {
+                parent->read_sectors(parent, offset, run, buff);
+                if (parent->error) {
+                    parent->error = 0;
+                    vhdm->error = 1;
+                }
+            } else
+                memset(buff, 0, (size_t) run * MVHD_SECTOR_SIZE);
+
+            buff += (size_t) run * MVHD_SECTOR_SIZE;
+            offset += run;
+            sib += run;
+            n -= run;
+            count -= run;
+        }
+    }
+}
+
 int
 mvhd_sparse_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buff)
 {
@@ -245,41 +430,8 @@ mvhd_sparse_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buf
 
     check_sectors(offset, num_sectors, total_sectors, &transfer_sectors, &truncated_sectors);
 
-    uint8_t* buff = (uint8_t*)out_buff;
-    int64_t addr = 0ULL;
-    uint32_t s = 0;
-    uint32_t ls = 0;
-    int blk = 0;
-    int prev_blk = -1;
-    int sib = 0;
-    ls = offset + transfer_sectors;
-
-    for (s = offset; s < ls; s++) {
-        blk = s / vhdm->sect_per_block;
-        sib = s % vhdm->sect_per_block;
-        if (blk != prev_blk) {
-            prev_blk = blk;
-            if (vhdm->bitmap.curr_block != blk) {
-                read_sect_bitmap(vhdm, blk);
-                if (mvhd_fseeko64(vhdm->f, (uint64_t)sib * MVHD_SECTOR_SIZE, SEEK_CUR) == -1)
-                    vhdm->error = 1;
-            } else {
-                addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) *
-                       MVHD_SECTOR_SIZE;
-                if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
-                    vhdm->error = 1;
-            }
-        }
-
-        if (VHD_TESTBIT(vhdm->bitmap.curr_bitmap, sib)) {
-            if (!fread(buff, MVHD_SECTOR_SIZE, 1, vhdm->f) && !feof(vhdm->f))
-                vhdm->error = 1;
-        } else {
-            memset(buff, 0, MVHD_SECTOR_SIZE);
-            mvhd_fseeko64(vhdm->f, MVHD_SECTOR_SIZE, SEEK_CUR);
-        }
-        buff += MVHD_SECTOR_SIZE;
-    }
+    if (transfer_sectors > 0)
+        sparse_diff_read_extents(vhdm, offset, transfer_sectors, (uint8_t *) out_buff);
 
     return truncated_sectors;
 }
@@ -293,41 +445,10 @@ mvhd_diff_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buff)
 
     check_sectors(offset, num_sectors, total_sectors, &transfer_sectors, &truncated_sectors);
 
-    uint8_t *buff = (uint8_t*)out_buff;
-    MVHDMeta *curr_vhdm = vhdm;
-    uint32_t s = 0;
-    uint32_t ls = 0;
-    int blk = 0;
-    int sib = 0;
-    ls = offset + transfer_sectors;
-
-    for (s = offset; s < ls; s++) {
-        while (curr_vhdm->footer.disk_type == MVHD_TYPE_DIFF) {
-            blk = s / curr_vhdm->sect_per_block;
-            sib = s % curr_vhdm->sect_per_block;
-            if (curr_vhdm->bitmap.curr_block != blk) {
-                read_sect_bitmap(curr_vhdm, blk);
-            }
-            if (!VHD_TESTBIT(curr_vhdm->bitmap.curr_bitmap, sib)) {
-                curr_vhdm = curr_vhdm->parent;
-            } else { break; }
-        }
-
-        /* We handle actual sector reading using the fixed or sparse functions,
-           as a differencing VHD is also a sparse VHD */
-        if ((curr_vhdm->footer.disk_type == MVHD_TYPE_DIFF) ||
-            (curr_vhdm->footer.disk_type == MVHD_TYPE_DYNAMIC))
-            mvhd_sparse_read(curr_vhdm, s, 1, buff);
-        else
-            mvhd_fixed_read(curr_vhdm, s, 1, buff);
-        if (curr_vhdm->error) {
-            curr_vhdm->error = 0;
-            vhdm->error = 1;
-        }
-
-        curr_vhdm = vhdm;
-        buff += MVHD_SECTOR_SIZE;
-    }
+    /* Sectors not present in this image come from the parent, so walking
+       the chain is done per extent by sparse_diff_read_extents() */
+    if (transfer_sectors > 0)
+        sparse_diff_read_extents(vhdm, offset, transfer_sectors, (uint8_t *) out_buff);
 
     return truncated_sectors;
 }
@@ -31,6 +31,7 @@
 #include <86box/io.h>
 #include <86box/pic.h>
 #include <86box/dma.h>
+#include <86box/snapshot.h>
 #include <86box/plat_unused.h>
 
 dma_t   dma[8];
@@ -1879,10 +1880,23 @@ dma_bm_read(uint32_t PhysAddress, uint8_t *DataRead, uint32_t TotalSize, int Tra
     n  = TotalSize & ~(TransferSize - 1);
     n2 = TotalSize - n;
 
-    /* Do the divisible block, if there is one. */
-    if (n) {
-        for (uint32_t i = 0; i < n; i += TransferSize)
-            mem_read_phys((void *) &(DataRead[i]), PhysAddress + i, TransferSize);
+    /* Do the divisible block, if there is one. Plain memory is copied a
+       granule at a time, anything else goes through the mapping handlers
+       in TransferSize units. */
+    for (uint32_t i = 0; i < n;) {
+        uint32_t       chunk = MEM_GRANULARITY_SIZE - ((PhysAddress + i) & MEM_GRANULARITY_MASK);
+        const uint8_t *p     = mem_get_phys_ptr(PhysAddress + i, 0);
+
+        if (chunk > (n - i))
+            chunk = n - i;
+
+        if (p != NULL) {
+            memcpy(&(DataRead[i]), p, chunk);
+            i += chunk;
+        } else {
+            for (uint32_t end = i + chunk; i < end; i += TransferSize)
+                mem_read_phys((void *) &(DataRead[i]), PhysAddress + i, TransferSize);
+        }
     }
 
     /* Do the non-divisible block, if there is one. */
@@ -1902,10 +1916,21 @@ dma_bm_write(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize,
     n  = TotalSize & ~(TransferSize - 1);
     n2 = TotalSize - n;
 
-    /* Do the divisible block, if there is one. */
-    if (n) {
-        for (uint32_t i = 0; i < n; i += TransferSize)
-            mem_write_phys((void *) &(DataWrite[i]), PhysAddress + i, TransferSize);
+    /* Do the divisible block, if there is one, as in dma_bm_read(). */
+    for (uint32_t i = 0; i < n;) {
+        uint32_t chunk = MEM_GRANULARITY_SIZE - ((PhysAddress + i) & MEM_GRANULARITY_MASK);
+        uint8_t *p     = mem_get_phys_ptr(PhysAddress + i, 1);
+
+        if (chunk > (n - i))
+            chunk = n - i;
+
+        if (p != NULL) {
+            memcpy(p, &(DataWrite[i]), chunk);
+            i += chunk;
+        } else {
+            for (uint32_t end = i + chunk; i < end; i += TransferSize)
+                mem_write_phys((void *) &(DataWrite[i]), PhysAddress + i, TransferSize);
+        }
     }
 
     /* Do the non-divisible block, if there is one. */
@@ -1918,3 +1943,47 @@ dma_bm_write(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize,
     if (dma_at)
         mem_invalidate_range(PhysAddress, PhysAddress + TotalSize - 1);
 }
+
+void
+dma_save_state(snapshot_t *snap)
+{
+    snapshot_write(snap, dma, sizeof(dma));
+    snapshot_write_var(snap, dma_e);
+    snapshot_write_var(snap, dma_m);
+
+    snapshot_write(snap, dmaregs, sizeof(dmaregs));
+    snapshot_write(snap, dma_wp, sizeof(dma_wp));
+    snapshot_write_var(snap, dma_stat);
+    snapshot_write_var(snap, dma_stat_rq);
+    snapshot_write_var(snap, dma_stat_rq_pc);
+    snapshot_write_var(snap, dma_stat_adv_pend);
+    snapshot_write(snap, dma_command, sizeof(dma_command));
+    snapshot_write_var(snap, dma_req_is_soft);
+    snapshot_write_var(snap, dma_advanced);
+    snapshot_write_var(snap, dma_at);
+    snapshot_write_var(snap, dma_sg_base);
+    snapshot_write_var(snap, dma_mask);
+    snapshot_write_var(snap, dma_ps2);
+}
+
+void
+dma_load_state(snapshot_t *snap)
+{
+    snapshot_read(snap, dma, sizeof(dma));
+    snapshot_read_var(snap, dma_e);
+    snapshot_read_var(snap, dma_m);
+
+    snapshot_read(snap, dmaregs, sizeof(dmaregs));
+    snapshot_read(snap, dma_wp, sizeof(dma_wp));
+    snapshot_read_var(snap, dma_stat);
+    snapshot_read_var(snap, dma_stat_rq);
+    snapshot_read_var(snap, dma_stat_rq_pc);
+    snapshot_read_var(snap, dma_stat_adv_pend);
+    snapshot_read(snap, dma_command, sizeof(dma_command));
+    snapshot_read_var(snap, dma_req_is_soft);
+    snapshot_read_var(snap, dma_advanced);
+    snapshot_read_var(snap, dma_at);
+    snapshot_read_var(snap, dma_sg_base);
+    snapshot_read_var(snap, dma_mask);
+    snapshot_read_var(snap, dma_ps2);
+}
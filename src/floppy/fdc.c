@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <wchar.h>
 #define HAVE_STDARG_H
 #include <86box/86box.h>
@@ -39,6 +40,7 @@
 #include <86box/plat_fallthrough.h>
 #include <86box/plat_unused.h>
 #include <86box/fifo.h>
+#include <86box/snapshot.h>
 
 extern uint64_t motoron[FDD_NUM];
 
@@ -2630,6 +2632,52 @@ fdc_close(void *priv)
     free(fdc);
 }
 
+static void
+fdc_save(void *priv, snapshot_t *snap)
+{
+    fdc_t    *fdc  = (fdc_t *) priv;
+    fifo16_t *fifo = (fifo16_t *) fdc->fifo_p;
+
+    snapshot_write(snap, fdc, offsetof(fdc_t, fifo_p));
+    snapshot_write(snap, &fdc->fifointest, offsetof(fdc_t, timer) - offsetof(fdc_t, fifointest));
+    snapshot_write(snap, fifo, offsetof(fifo16_t, priv));
+    snapshot_write_var(snap, fifo->tag);
+    snapshot_write_var(snap, fifo->buf);
+    snapshot_write_var(snap, current_drive);
+    snapshot_write_var(snap, lastbyte);
+    timer_save_state(snap, &fdc->timer);
+    timer_save_state(snap, &fdc->watchdog_timer);
+    fdd_save_state(snap);
+}
+
+static void
+fdc_load(void *priv, snapshot_t *snap)
+{
+    fdc_t    *fdc  = (fdc_t *) priv;
+    fifo16_t *fifo = (fifo16_t *) fdc->fifo_p;
+    uint16_t  base = fdc->base_address;
+    uint16_t  new_base;
+
+    snapshot_read(snap, fdc, offsetof(fdc_t, fifo_p));
+    snapshot_read(snap, &fdc->fifointest, offsetof(fdc_t, timer) - offsetof(fdc_t, fifointest));
+    snapshot_read(snap, fifo, offsetof(fifo16_t, priv));
+    snapshot_read_var(snap, fifo->tag);
+    snapshot_read_var(snap, fifo->buf);
+    snapshot_read_var(snap, current_drive);
+    snapshot_read_var(snap, lastbyte);
+    timer_load_state(snap, &fdc->timer);
+    timer_load_state(snap, &fdc->watchdog_timer);
+    fdd_load_state(snap);
+
+    /* A Super I/O chip may have moved the FDC since the snapshot. */
+    new_base = fdc->base_address;
+    if (new_base != base) {
+        fdc->base_address = base;
+        fdc_remove(fdc);
+        fdc_set_base(fdc, new_base);
+    }
+}
+
 static void *
 fdc_init(const device_t *info)
 {
@@ -2696,7 +2744,9 @@ const device_t fdc_xt_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_xt_sec_device = {
@@ -2710,7 +2760,9 @@ const device_t fdc_xt_sec_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_xt_ter_device = {
@@ -2724,7 +2776,9 @@ const device_t fdc_xt_ter_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_xt_qua_device = {
@@ -2738,7 +2792,9 @@ const device_t fdc_xt_qua_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_xt_t1x00_device = {
@@ -2752,7 +2808,9 @@ const device_t fdc_xt_t1x00_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_xt_amstrad_device = {
@@ -2766,7 +2824,9 @@ const device_t fdc_xt_amstrad_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_xt_tandy_device = {
@@ -2780,7 +2840,9 @@ const device_t fdc_xt_tandy_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_xt_umc_um8398_device = {
@@ -2794,7 +2856,9 @@ const device_t fdc_xt_umc_um8398_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_xt_5550_device = {
@@ -2808,7 +2872,9 @@ const device_t fdc_xt_5550_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_pcjr_device = {
@@ -2822,7 +2888,9 @@ const device_t fdc_pcjr_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_at_device = {
@@ -2836,7 +2904,9 @@ const device_t fdc_at_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_at_sec_device = {
@@ -2850,7 +2920,9 @@ const device_t fdc_at_sec_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_at_ter_device = {
@@ -2864,7 +2936,9 @@ const device_t fdc_at_ter_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_at_qua_device = {
@@ -2878,7 +2952,9 @@ const device_t fdc_at_qua_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_at_actlow_device = {
@@ -2892,7 +2968,9 @@ const device_t fdc_at_actlow_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_at_smc_661_device = {
@@ -2906,7 +2984,9 @@ const device_t fdc_at_smc_661_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_at_smc_device = {
@@ -2920,7 +3000,9 @@ const device_t fdc_at_smc_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_at_ali_device = {
@@ -2934,7 +3016,9 @@ const device_t fdc_at_ali_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_at_winbond_device = {
@@ -2948,7 +3032,9 @@ const device_t fdc_at_winbond_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_at_nsc_device = {
@@ -2962,7 +3048,9 @@ const device_t fdc_at_nsc_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_at_nsc_dp8473_device = {
@@ -2976,7 +3064,9 @@ const device_t fdc_at_nsc_dp8473_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_ps2_device = {
@@ -2991,7 +3081,9 @@ const device_t fdc_ps2_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
 
 const device_t fdc_ps2_mca_device = {
@@ -3006,5 +3098,7 @@ const device_t fdc_ps2_mca_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = fdc_save,
+    .load          = fdc_load
 };
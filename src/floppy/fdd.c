@@ -43,6 +43,7 @@
 #include <86box/fdc.h>
 #include <86box/fdd_audio.h>
 #include <86box/plat_floppy_ioctl.h>
+#include <86box/snapshot.h>
 
 /* Flags:
    Bit  0:  300 rpm supported;
@@ -862,6 +863,55 @@ fdd_reset(void)
     }
 }
 
+/* Only the drive mechanics are saved: a snapshot can not be taken in the
+   middle of a seek or a sector operation, and the image layer reloads the
+   track the head is on. Where in the track the disk has rotated to is not
+   kept, so the index pulse timing restarts. */
+void
+fdd_save_state(snapshot_t *snap)
+{
+    for (uint8_t i = 0; i < FDD_NUM; i++) {
+        if (fdd_seek_in_progress[i] || fdd_pending[i].pending || d86f_busy(i)) {
+            snapshot_fail(snap, "floppy drive busy");
+            return;
+        }
+    }
+
+    snapshot_write_var(snap, fdd);
+    snapshot_write_var(snap, motoron);
+    snapshot_write_var(snap, fdd_changed);
+    snapshot_write_var(snap, fdd_notfound);
+    snapshot_write_var(snap, bios_boot_status);
+    for (uint8_t i = 0; i < FDD_NUM; i++)
+        timer_save_state(snap, &fdd_poll_time[i]);
+}
+
+void
+fdd_load_state(snapshot_t *snap)
+{
+    snapshot_read_var(snap, fdd);
+    snapshot_read_var(snap, motoron);
+    snapshot_read_var(snap, fdd_changed);
+    snapshot_read_var(snap, fdd_notfound);
+    snapshot_read_var(snap, bios_boot_status);
+    for (uint8_t i = 0; i < FDD_NUM; i++)
+        timer_load_state(snap, &fdd_poll_time[i]);
+
+    if (snapshot_failed(snap))
+        return;
+
+    /* Drop whatever the running machine was in the middle of. */
+    for (uint8_t i = 0; i < FDD_NUM; i++) {
+        timer_disable(&fdd_seek_timer[i]);
+        fdd_seek_in_progress[i] = 0;
+        fdd_pending[i].pending  = 0;
+        fdd_pending[i].op       = FDD_OP_NONE;
+        d86f_stop(i);
+        if (!drive_empty[i])
+            fdd_do_seek(i, fdd[i].track);
+    }
+}
+
 void
 fdd_readsector(int drive, int sector, int track, int side, int density, int sector_size)
 {
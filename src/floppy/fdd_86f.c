@@ -3234,6 +3234,15 @@ d86f_stop(int drive)
         dev->state = STATE_IDLE;
 }
 
+/* Whether a command is running on the drive. */
+int
+d86f_busy(int drive)
+{
+    const d86f_t *dev = d86f[drive];
+
+    return (dev != NULL) && (dev->state != STATE_IDLE);
+}
+
 int
 d86f_common_command(int drive, int sector, int track, int side, UNUSED(int rate), int sector_size)
 {
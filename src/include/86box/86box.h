@@ -40,6 +40,7 @@
 /* Filename and pathname info. */
 #define CONFIG_FILE        "86box.cfg"
 #define GLOBAL_CONFIG_FILE "86box_global.cfg"
+#define SNAPSHOT_FILE      "86box.snp"
 #define NVR_PATH           "nvr"
 #define SCREENSHOT_PATH    "screenshots"
 #define VMM_PATH		   "Virtual Machines"
@@ -229,6 +230,14 @@ extern int      other_scsi_present;         /* SCSI controllers from non-SCSI ca
 extern int      is_pcjr;                    /* The current machine is PCjr. */
 
 extern int    hard_reset_pending;
+extern char   snapshot_path[1024];          /* (O) machine snapshot file */
+extern int    snapshot_interval;            /* (O) seconds of guest time between checkpoints */
+extern char   jit_cache_path[1024];         /* (O) dynarec block profile file */
+extern int    batch_mode;                   /* (O) headless, unthrottled batch run */
+extern uint32_t batch_time;                 /* (O) guest seconds to run for, 0 = no limit */
+extern uint16_t batch_exit_port;            /* (O) I/O port whose writes end the batch run */
+extern int    batch_exit_code;              /* exit code of the batch run */
+extern volatile int batch_stop;             /* the guest asked to end the batch run */
 extern int    fixed_size_x;
 extern int    fixed_size_y;
 extern int    sound_muted;                  /* (C) Is sound muted? */
@@ -242,6 +251,8 @@ extern _Atomic double mouse_y_error;        /* Mouse error accumulator - Y */
 #endif
 extern int    pit_mode;                     /* (C) force setting PIT mode */
 extern int    fm_driver;                    /* (C) select FM sound driver */
+extern int    fm_thread;                    /* (C) render FM on its own thread */
+extern int    vid_render_thread;            /* (C) render SVGA lines on their own thread */
 extern int    hook_enabled;                 /* (C) Keyboard hook is enabled */
 extern int    vmm_disabled;                 /* (G) disable built-in manager */
 extern char   vmm_path_cfg[1024];           /* (G) VMs path (unless -E is used) */
@@ -295,6 +306,9 @@ extern void pc_close(void *threadid);
 extern void pc_reset_hard_close(void);
 extern void pc_reset_hard_init(void);
 extern void pc_reset_hard(void);
+extern void pc_snapshot_save(void);
+extern void pc_snapshot_load(void);
+extern void pc_batch_stop(int code);
 extern void pc_full_speed(void);
 extern void pc_speed_changed(void);
 extern void pc_send_cad(void);
@@ -162,6 +162,8 @@ typedef struct _device_config_ {
     const device_config_bios_t       bios[32];
 } device_config_t;
 
+struct snapshot_t;
+
 typedef struct _device_ {
     const char *name;
     const char *internal_name;
@@ -181,6 +183,10 @@ typedef struct _device_ {
     const char *alias;
     const char *machine;
     const device_config_t *config;
+
+    /* Optional machine snapshot handlers, see snapshot.h. */
+    void (*save)(void *priv, struct snapshot_t *snap);
+    void (*load)(void *priv, struct snapshot_t *snap);
 } device_t;
 
 typedef struct device_context_t {
@@ -217,6 +223,11 @@ extern void *device_get_priv(const device_t *dev);
 extern int   device_available(const device_t *dev);
 extern void  device_speed_changed(void);
 extern void  device_force_redraw(void);
+extern const char *device_find_unsaved(void);
+extern void  device_save_state(struct snapshot_t *snap);
+extern void  device_load_state_begin(void);
+extern void  device_load_state(struct snapshot_t *snap, int slot);
+extern void  device_load_state_end(struct snapshot_t *snap);
 extern const char *device_get_bus_name(const device_t *dev);
 extern void  device_get_name(const device_t *dev, int bus, char *name);
 extern int   device_has_config(const device_t *dev);
@@ -120,4 +120,8 @@ void dma_set_sg_base(uint8_t sg_base);
 
 extern int dma_channel_readable(int channel);
 
+struct snapshot_t;
+extern void dma_save_state(struct snapshot_t *snap);
+extern void dma_load_state(struct snapshot_t *snap);
+
 #endif /*EMU_DMA_H*/
@@ -124,6 +124,11 @@ extern int  fdd_hole(int drive);
 extern void fdd_stop(int drive);
 extern void fdd_do_writeback(int drive);
 
+/* Save or restore the drive state, for the FDC's snapshot handlers. */
+struct snapshot_t;
+extern void fdd_save_state(struct snapshot_t *snap);
+extern void fdd_load_state(struct snapshot_t *snap);
+
 /* BIOS boot status functions */
 extern bios_boot_status_t fdd_get_boot_status(void);
 extern void fdd_set_boot_status(bios_boot_status_t status);
@@ -55,6 +55,7 @@ extern void     d86f_seek(int drive, int track);
 extern int      d86f_hole(int drive);
 extern uint64_t d86f_byteperiod(int drive);
 extern void     d86f_stop(int drive);
+extern int      d86f_busy(int drive);
 extern void     d86f_poll(int drive);
 extern int      d86f_realtrack(int track, int drive);
 extern void     d86f_reset(int drive, int side);
@@ -136,6 +136,13 @@ typedef struct hdd_zone_t {
     uint32_t start_track;
 } hdd_zone_t;
 
+/* Host-side sector cache for raw, HDI and HDX images. */
+enum {
+    HDD_IMAGE_CACHE_WRITE_THROUGH = 0,
+    HDD_IMAGE_CACHE_WRITE_BACK,      /* Flushed periodically and on sync. */
+    HDD_IMAGE_CACHE_WRITE_BACK_SYNC  /* Flushed on sync only. */
+};
+
 /* Define the virtual Hard Disk. */
 typedef struct hard_disk_t {
     uint8_t           id;
@@ -203,6 +210,11 @@ typedef struct hard_disk_t {
 
 extern hard_disk_t  hdd[HDD_NUM];
 extern unsigned int hdd_table[128][3];
+extern int          hdd_image_async;
+extern int          hdd_image_cache_size;
+extern int          hdd_image_cache_policy;
+extern int          hdd_image_cache_flush_interval;
+extern int          hdd_image_mmap;
 
 extern int   hdd_init(void);
 extern int   hdd_string_to_bus(char *str, int cdrom);
@@ -212,6 +224,7 @@ extern int   hdd_is_valid(int c);
 extern void     hdd_image_init(void);
 extern int      hdd_image_load(int id);
 extern int      hdd_image_seek(uint8_t id, uint32_t sector);
+extern void     hdd_image_prefetch(uint8_t id, uint32_t sector, uint32_t count);
 extern int      hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
 extern int      hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
 extern int      hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
@@ -223,13 +236,21 @@ extern uint32_t hdd_image_get_pos(uint8_t id);
 extern uint8_t  hdd_image_get_type(uint8_t id);
 extern void     hdd_image_unload(uint8_t id, int fn_preserve);
 extern void     hdd_image_close(uint8_t id);
-extern void     hdd_image_sync(uint8_t id);
+extern int      hdd_image_sync(uint8_t id);
 extern void     hdd_image_sync_all(void);
+extern void     hdd_image_onesec(void);
 extern void     hdd_image_calc_chs(uint32_t *c, uint32_t *h, uint32_t *s, uint32_t size);
 
+extern int hdd_image_overlay_create(const char *fn, const char *base_fn);
+extern int hdd_image_overlay_commit(const char *fn);
+extern int hdd_image_overlay_discard(const char *fn);
+
 extern int image_is_hdi(const char *s);
 extern int image_is_hdx(const char *s, int check_signature);
 extern int image_is_vhd(const char *s, int check_signature);
+extern int image_is_ovl(const char *s, int check_signature);
+
+extern int vhd_bench(const char *dir);
 
 extern double      hdd_timing_write(hard_disk_t *hdd, uint32_t addr, uint32_t len);
 extern double      hdd_timing_read(hard_disk_t *hdd, uint32_t addr, uint32_t len);
@@ -0,0 +1,62 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the copy-on-write overlay hard disk images.
+ *
+ *          An overlay only holds the clusters written since it was
+ *          created, everything else is read from its base image, which
+ *          is never written to, so any number of overlays can share it.
+ *          Clusters are found through a two level table: the L1 table
+ *          follows the header and points to L2 tables, which in turn
+ *          point to the data clusters. Both are allocated on first
+ *          write, at the end of the file.
+ */
+#ifndef EMU_HDD_OVERLAY_H
+#define EMU_HDD_OVERLAY_H
+
+#define HDD_OVERLAY_MAGIC        "86BxOvl"
+#define HDD_OVERLAY_VERSION      1
+#define HDD_OVERLAY_CLUSTER_BITS 16 /* 64 KB clusters by default. */
+
+typedef struct hdd_overlay_t hdd_overlay_t;
+
+/* Access to the base image, provided by the caller. write is only used by
+   hdd_overlay_commit() and may be NULL otherwise. */
+typedef int (*hdd_overlay_io_t)(void *priv, uint32_t sector, uint32_t count, uint8_t *buffer);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int            hdd_overlay_probe(const char *fn);
+extern int            hdd_overlay_create(const char *fn, const char *base_fn, uint32_t sectors,
+                                         uint32_t spt, uint32_t hpc, uint32_t tracks);
+extern hdd_overlay_t *hdd_overlay_open(const char *fn, int readonly);
+extern void           hdd_overlay_close(hdd_overlay_t *ovl);
+
+extern void     hdd_overlay_set_base(hdd_overlay_t *ovl, hdd_overlay_io_t read, hdd_overlay_io_t write, void *priv);
+extern void     hdd_overlay_get_base_path(hdd_overlay_t *ovl, char *dest, size_t size);
+extern void     hdd_overlay_get_geometry(hdd_overlay_t *ovl, uint32_t *spt, uint32_t *hpc, uint32_t *tracks);
+extern uint32_t hdd_overlay_get_sectors(hdd_overlay_t *ovl);
+
+extern int  hdd_overlay_read(hdd_overlay_t *ovl, uint32_t sector, uint32_t count, uint8_t *buffer);
+extern int  hdd_overlay_write(hdd_overlay_t *ovl, uint32_t sector, uint32_t count, uint8_t *buffer);
+extern int  hdd_overlay_zero(hdd_overlay_t *ovl, uint32_t sector, uint32_t count);
+extern void hdd_overlay_sync(hdd_overlay_t *ovl);
+
+/* Write all the clusters held by the overlay into the base image, then
+   empty the overlay. */
+extern int hdd_overlay_commit(hdd_overlay_t *ovl);
+/* Throw away everything written to the overlay. */
+extern int hdd_overlay_discard(hdd_overlay_t *ovl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_HDD_OVERLAY_H*/
@@ -195,6 +195,21 @@ typedef struct _mem_mapping_ {
     void *priv; /* backpointer to device */
 } mem_mapping_t;
 
+/* Soft TLB counters. Hits are not counted, as they never leave the inline
+   fast paths and the recompiled code. */
+typedef struct mmu_tlb_stats_t {
+    uint64_t fills;     /* Entries added after a lookup miss. */
+    uint64_t evictions; /* Entries replaced to make room for a fill. */
+    uint64_t flushes;   /* Full flushes, CR0, CR4, INVLPG, SMM... */
+    uint64_t switches;  /* CR3 loads. */
+    uint64_t kept;      /* Global entries kept across CR3 loads. */
+    uint64_t restored;  /* Entries brought back with an address space. */
+} mmu_tlb_stats_t;
+
+#define MMU_TLB_MIN     256
+#define MMU_TLB_MAX     65536
+#define MMU_TLB_DEFAULT 8192
+
 #ifdef USE_NEW_DYNAREC
 extern uint64_t *byte_dirty_mask;
 extern uint64_t *byte_code_present_mask;
@@ -261,13 +276,8 @@ extern uint8_t *rom;
 extern uint32_t biosmask;
 extern uint32_t biosaddr;
 
-extern int        readlookup[256];
 extern uintptr_t  old_rl2;
 extern uint8_t    uncached;
-extern int        readlnext;
-extern int        writelookup[256];
-
-extern int        writelnext;
 extern uint32_t   ram_mapped_addr[64];
 extern uint8_t    page_ff[4096];
 
@@ -296,6 +306,11 @@ extern int shadowbios_write;
 extern int readlnum;
 extern int writelnum;
 
+extern mmu_tlb_stats_t mmu_tlb_stats;
+extern mmu_tlb_stats_t mmu_tlb_stats_sec; /* Over the last second. */
+extern mmu_tlb_stats_t mmu_tlb_stats_total;
+extern int             mem_tlb_size;
+
 extern int memspeed[11];
 
 extern uint8_t high_page; /* if a high (> 4 gb) page was detected */
@@ -417,6 +432,7 @@ extern void     mem_writeb_phys(uint32_t addr, uint8_t val);
 extern void     mem_writew_phys(uint32_t addr, uint16_t val);
 extern void     mem_writel_phys(uint32_t addr, uint32_t val);
 extern void     mem_write_phys(void *src, uint32_t addr, int tranfer_size);
+extern uint8_t *mem_get_phys_ptr(uint32_t addr, int write);
 
 extern uint8_t  mem_read_ram(uint32_t addr, void *priv);
 extern uint16_t mem_read_ramw(uint32_t addr, void *priv);
@@ -446,9 +462,13 @@ extern void mem_flush_write_page(uint32_t addr, uint32_t virt);
 extern void mem_reset_page_blocks(void);
 
 extern void flushmmucache(void);
+extern void flushmmucache_cr3(uint32_t val);
 extern void flushmmucache_write(void);
 extern void flushmmucache_pc(void);
 extern void flushmmucache_nopc(void);
+extern void mmu_tlb_onesec(void);
+extern void mmu_tlb_print_stats(void);
+extern int  mem_tlb_bench(void);
 
 extern void mem_debug_check_addr(uint32_t addr, int write);
 
@@ -464,6 +484,31 @@ extern void mem_remap_top_ex_nomid(int kb, uint32_t start);
 extern void mem_remap_top(int kb);
 extern void mem_remap_top_nomid(int kb);
 
+struct snapshot_t;
+extern void mem_save_state(struct snapshot_t *snap);
+extern void mem_save_state_delta(struct snapshot_t *snap);
+extern void mem_load_state(struct snapshot_t *snap);
+
+/* One bit per 4K page of RAM, set when the page was written since the last
+   snapshot. Only allocated once a snapshot has been taken. */
+extern uint8_t *mem_snap_dirty;
+
+/* Anything writing to ram[] without going through the RAM mappings has to
+   call this, or the page will be missing from incremental snapshots. */
+static __inline void
+mem_snap_mark(uint32_t addr)
+{
+    if (mem_snap_dirty)
+        mem_snap_dirty[addr >> 15] |= (1 << ((addr >> 12) & 7));
+}
+
+static __inline void
+mem_snap_mark_range(uint32_t addr, uint32_t len)
+{
+    mem_snap_mark(addr);
+    mem_snap_mark(addr + len - 1);
+}
+
 extern void pcjr_waitstates(void *);
 
 extern mem_mapping_t *read_mapping[MEM_MAPPINGS_NO];
@@ -103,4 +103,8 @@ extern uint8_t pic_irq_ack(void);
 
 extern void    pic_toggle_latch(int is_ps2);
 
+struct snapshot_t;
+extern void    pic_save_state(struct snapshot_t *snap);
+extern void    pic_load_state(struct snapshot_t *snap);
+
 #endif /*EMU_PIC_H*/
@@ -0,0 +1,82 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the machine snapshot (save state) module.
+ *
+ *          A snapshot file starts with an 8-byte magic and a 32-bit
+ *          version, followed by a sequence of chunks. Each chunk has
+ *          a 4-character ID, a 32-bit instance number and a 64-bit
+ *          payload length, so readers can skip chunks they do not
+ *          know about. Headers are stored little-endian, payloads are
+ *          the raw host-order state of each subsystem.
+ *
+ *          Snapshots are only valid for the exact configuration and
+ *          emulator build they were taken with: they are restored into
+ *          an already running machine, which must have been set up from
+ *          the same config.
+ */
+#ifndef EMU_SNAPSHOT_H
+#define EMU_SNAPSHOT_H
+
+#define SNAPSHOT_MAGIC   "86BxSnap"
+/* Version 2 requires the SEQ chunk and has a delta flag in the MEM chunk,
+   version 3 drops the has-data flag from DEV chunks, as every device must
+   now have its state in there. Older files can not be read anymore. */
+#define SNAPSHOT_VERSION 3
+
+/* Make a chunk ID out of 4 characters. */
+#define SNAPSHOT_ID(a, b, c, d) ((uint32_t) (a) | ((uint32_t) (b) << 8) | \
+                                 ((uint32_t) (c) << 16) | ((uint32_t) (d) << 24))
+
+#define SNAPSHOT_CHUNK_CONF SNAPSHOT_ID('C', 'O', 'N', 'F')
+#define SNAPSHOT_CHUNK_SEQ  SNAPSHOT_ID('S', 'E', 'Q', ' ')
+#define SNAPSHOT_CHUNK_CPU  SNAPSHOT_ID('C', 'P', 'U', ' ')
+#define SNAPSHOT_CHUNK_MEM  SNAPSHOT_ID('M', 'E', 'M', ' ')
+#define SNAPSHOT_CHUNK_PIC  SNAPSHOT_ID('P', 'I', 'C', ' ')
+#define SNAPSHOT_CHUNK_DMA  SNAPSHOT_ID('D', 'M', 'A', ' ')
+#define SNAPSHOT_CHUNK_DEV  SNAPSHOT_ID('D', 'E', 'V', ' ')
+#define SNAPSHOT_CHUNK_END  SNAPSHOT_ID('E', 'N', 'D', ' ')
+
+typedef struct snapshot_t snapshot_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Save or restore the whole machine, returns 0 on success. These must be
+   called from the emulation thread, between two pc_run() calls. */
+extern int snapshot_save(const char *fn);
+extern int snapshot_load(const char *fn);
+
+/* Incremental checkpoints: the first one (or the first after a full save to
+   another file) is a full snapshot in fn, the following ones only have the
+   RAM pages written since the previous one and are stored as fn.0001,
+   fn.0002 and so on. snapshot_load_chain() restores fn and all its deltas. */
+extern int snapshot_checkpoint(const char *fn);
+extern int snapshot_load_chain(const char *fn);
+
+/* Chunk data access, for use by the subsystem and device state handlers.
+   Reads past the end of the chunk fail and mark the snapshot as bad. */
+extern void     snapshot_write(snapshot_t *snap, const void *data, size_t size);
+extern int      snapshot_read(snapshot_t *snap, void *data, size_t size);
+extern uint64_t snapshot_left(snapshot_t *snap);
+extern void     snapshot_fail(snapshot_t *snap, const char *reason);
+extern int      snapshot_failed(snapshot_t *snap);
+
+/* Chunk framing when saving, for subsystems that emit several chunks. */
+extern void snapshot_chunk_begin(snapshot_t *snap, uint32_t id, uint32_t instance);
+extern void snapshot_chunk_end(snapshot_t *snap);
+
+#define snapshot_write_var(snap, var) snapshot_write((snap), &(var), sizeof(var))
+#define snapshot_read_var(snap, var)  snapshot_read((snap), &(var), sizeof(var))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_SNAPSHOT_H*/
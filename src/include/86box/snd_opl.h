@@ -65,12 +65,21 @@ typedef struct fm_drv_t {
     void     (*reset_buffer)(void *priv);
     void     (*set_do_cycles)(void *priv, int8_t do_cycles);
     void      *priv;
-    void     (*generate)(void *priv, int32_t *data, uint32_t num_samples); /* daughterboard only. */
+
+    /* Block rendering, for callers that keep their own time rather than
+       following the sound streams: generate renders num_samples stereo
+       samples of raw chip output into data, write_reg writes a register
+       (bit 8 selects the second bank) from the next sample on, without
+       first rendering up to the current time. */
+    void     (*generate)(void *priv, int32_t *data, uint32_t num_samples);
+    void     (*write_reg)(void *priv, uint16_t reg, uint8_t val);
 } fm_drv_t;
 
 extern uint8_t fm_driver_get_ex(int chip_id, fm_drv_t *drv, int is_48k);
 extern uint8_t fm_driver_get(int chip_id, fm_drv_t *drv);
 
+extern int opl_bench(const char *fn);
+
 extern const fm_drv_t nuked_opl2_drv;
 extern const fm_drv_t nuked_opl2_drv_48k;
 extern const fm_drv_t nuked_opl3_drv;
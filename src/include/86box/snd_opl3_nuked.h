@@ -119,6 +119,8 @@ struct _opl3_chip {
     uint32_t     noise;
     int16_t      zeromod;
     int32_t      mixbuff[4];
+    int16_t      mixmask[4][18]; /* Output enables, per output. */
+    int16_t      mixaccm[18];    /* Channel sums of the current sample. */
     uint8_t      rm_hh_bit2;
     uint8_t      rm_hh_bit3;
     uint8_t      rm_hh_bit7;
@@ -159,6 +161,11 @@ typedef struct {
     int     pos;
     int32_t buffer[MUSICBUFLEN * 2];
 
+    /* Set when the chip is rendered on the music synthesis thread, the
+       emulation thread then keeps its own copy of the NEW bit. */
+    music_synth_t *synth;
+    uint8_t        newm;
+
     int32_t *(*update)(void *priv);
 } nuked_opl3_drv_t;
 
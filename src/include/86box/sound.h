@@ -71,6 +71,16 @@ extern void wavetable_add_handler(void (*get_buffer)(int32_t *buffer,
                                                      int len, void *priv),
                                   void *priv);
 
+/* Chips rendered on the music synthesis thread. */
+typedef struct music_synth_t music_synth_t;
+
+extern music_synth_t *music_synth_add(void (*generate)(void *priv, int32_t *buffer, int len),
+                                      void (*write)(void *priv, uint16_t reg, uint8_t val),
+                                      void *priv, int32_t *buffer);
+extern void           music_synth_remove(music_synth_t *synth);
+extern void           music_synth_write(music_synth_t *synth, uint16_t reg, uint8_t val);
+extern void           music_synth_sync(music_synth_t *synth);
+
 extern void sound_set_cd_audio_filter(void (*filter)(int     channel,
                                                      double *buffer, void *priv),
                                       void *priv);
@@ -93,6 +103,9 @@ extern void        sound_set_cd_volume(unsigned int vol_l, unsigned int vol_r);
 
 extern void sound_speed_changed(void);
 
+/* Host time spent in each sound handler, printed to stdout. */
+extern void sound_print_handler_times(void);
+
 extern void sound_init(void);
 extern void sound_reset(void);
 
@@ -116,6 +129,11 @@ extern void givealbuffer_wt(const void *buf);
 extern void givealbuffer_cd(const void *buf);
 extern void givealbuffer_fdd(const void *buf, const uint32_t size);
 extern void givealbuffer_hdd(const void *buf, const uint32_t size);
+extern void givealbuffer_midi(const void *buf, const uint32_t size);
+extern void al_set_midi(const int freq, const int buf_size);
+
+extern void sound_set_midi_rate(int freq, int buf_size);
+extern void sound_give_midi_buffer(const void *buf, uint32_t size);
 
 #define sb_vibra16c_onboard_relocate_base sb_vibra16s_onboard_relocate_base
 #define sb_vibra16cl_onboard_relocate_base sb_vibra16s_onboard_relocate_base
@@ -0,0 +1,48 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the offline sound capture.
+ *
+ *          The capture writes the final main stream, and optionally the
+ *          output of every sound handler, to WAV files as the guest
+ *          produces it, without any real time pacing, so two builds can
+ *          be compared sample by sample. Cue points mark every second of
+ *          guest time in the main file.
+ */
+#ifndef EMU_SOUND_CAPTURE_H
+#define EMU_SOUND_CAPTURE_H
+
+enum {
+    SOUND_CAPTURE_SOUND = 0,
+    SOUND_CAPTURE_MUSIC,
+    SOUND_CAPTURE_WT,
+    SOUND_CAPTURE_STREAMS
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int  sound_capture_enabled;    /* (O) capture the sound output */
+extern int  sound_capture_split;      /* (O) also capture each handler */
+extern char sound_capture_path[1024]; /* (O) path of the main stream file */
+
+/* Append len stereo frames of the main stream, float or int16 following
+   sound_is_float. */
+extern void sound_capture_write(const void *buf, int len);
+/* Append len stereo frames rendered by handler idx of a stream. */
+extern void sound_capture_handler(int stream, int idx, const char *name, const int32_t *buf, int len);
+/* Add a cue point at the current position of the main stream. */
+extern void sound_capture_mark(const char *label);
+extern void sound_capture_close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_SOUND_CAPTURE_H*/
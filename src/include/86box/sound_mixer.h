@@ -0,0 +1,56 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the sound mixer.
+ *
+ *          The mixer resamples every secondary stream (music, wavetable,
+ *          CD audio, drive sounds and MIDI) to SOUND_FREQ and adds it to
+ *          the main stream, so the audio backend only ever gets a single
+ *          stream.
+ */
+#ifndef EMU_SOUND_MIXER_H
+#define EMU_SOUND_MIXER_H
+
+enum {
+    SOUND_MIXER_MUSIC = 0,
+    SOUND_MIXER_WT,
+    SOUND_MIXER_CD,
+    SOUND_MIXER_FDD,
+    SOUND_MIXER_HDD,
+    SOUND_MIXER_MIDI,
+    SOUND_MIXER_SOURCES
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int sound_mixer_enabled; /* (C) mix all streams into one */
+
+extern void sound_mixer_init(void);
+extern void sound_mixer_set_rate(int src, int freq);
+
+/* Queue size stereo samples (float or int16, following sound_is_float) on a
+   source. Each source may be fed from any thread, as long as it is always
+   the same one. */
+extern void sound_mixer_push(int src, const void *buf, int size);
+
+/* Add len stereo frames of every source to buffer, called from the
+   emulation thread once per main stream buffer. */
+extern void sound_mixer_mix(float *buffer, int len);
+
+/* Conversions between the 32-bit integer, float and 16-bit output formats,
+   size is in samples. */
+extern void sound_mixer_int32_to_float(const int32_t *src, float *dest, int size);
+extern void sound_mixer_float_to_int16(const float *src, int16_t *dest, int size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_SOUND_MIXER_H*/
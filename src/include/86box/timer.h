@@ -44,6 +44,12 @@ typedef struct pc_timer_t {
 
     struct pc_timer_t *prev;
     struct pc_timer_t *next;
+
+    /* Used by the heap scheduler (USE_TIMER_HEAP) only: 1-based position in
+       the heap (0 = not queued) and insertion sequence number, used to break
+       ties the same way the linked list does. */
+    uint32_t heap_pos;
+    uint64_t heap_seq;
 } pc_timer_t;
 
 #ifdef __cplusplus
@@ -194,6 +200,25 @@ extern void timer_on_auto(pc_timer_t *timer, double period);
 /* Change TSC, taking into account the timers. */
 extern void timer_set_new_tsc(uint64_t new_tsc);
 
+/* Timer queue trace (--timertrace) and its replay (--timerbench). */
+enum {
+    TIMER_TRACE_ENABLE = 0,
+    TIMER_TRACE_DISABLE,
+    TIMER_TRACE_PROCESS,
+    TIMER_TRACE_SET_TSC
+};
+
+extern int  timer_trace_on;
+extern void timer_trace_event(int type, pc_timer_t *timer, uint64_t val);
+extern void timer_trace_open(const char *fn);
+extern void timer_trace_close(void);
+extern int  timer_bench(const char *fn);
+
+/* Save or restore a timer's state to or from a snapshot. */
+struct snapshot_t;
+extern void timer_save_state(struct snapshot_t *snap, pc_timer_t *timer);
+extern void timer_load_state(struct snapshot_t *snap, pc_timer_t *timer);
+
 #ifdef __cplusplus
 }
 #endif
@@ -331,6 +331,13 @@ typedef struct svga_t {
     void *     priv_parent;
 
     void *     local;
+
+    /* Set when the scanlines are rendered on their own thread. */
+    struct svga_render_thread_t *render_thread;
+
+    /* Overscan colour of the last frame blitted, the overscan is redrawn
+       every frame so a change to it dirties the whole frame. */
+    uint32_t blit_overscan_color;
 } svga_t;
 
 extern void     ibm8514_set_poll(svga_t *svga);
@@ -376,6 +383,12 @@ extern int  svga_init(const device_t *info, svga_t *svga, void *priv, int memsiz
 extern void svga_recalctimings(svga_t *svga);
 extern void svga_close(svga_t *svga);
 
+struct snapshot_t;
+extern void svga_save_state(svga_t *svga, struct snapshot_t *snap);
+extern void svga_load_state(svga_t *svga, struct snapshot_t *snap);
+
+extern uint32_t svga_conv_16to32(struct svga_t *svga, uint16_t color, uint8_t bpp);
+
 uint8_t  svga_read(uint32_t addr, void *priv);
 uint16_t svga_readw(uint32_t addr, void *priv);
 uint32_t svga_readl(uint32_t addr, void *priv);
@@ -83,4 +83,20 @@ extern void ibm8514_render_RGBA8888(svga_t *svga);
 
 extern void (*svga_render)(svga_t *svga);
 
+/* Line converters, count pixels from packed VRAM at src to p. They never
+   read past the end of the line. */
+typedef struct svga_render_conv_t {
+    const char *name;
+    void (*line_8bpp)(uint32_t *p, const uint8_t *src, const uint32_t *pal, uint32_t mask, int count);
+    void (*line_15bpp)(uint32_t *p, const uint8_t *src, int count);
+    void (*line_16bpp)(uint32_t *p, const uint8_t *src, int count);
+    void (*line_24bpp)(uint32_t *p, const uint8_t *src, int count);
+    void (*line_32bpp)(uint32_t *p, const uint8_t *src, int count);
+} svga_render_conv_t;
+
+extern const svga_render_conv_t *svga_render_conv;
+
+extern void svga_render_conv_init(void);
+extern int  svga_render_bench(void);
+
 #endif /*VID_SVGA_RENDER_H*/
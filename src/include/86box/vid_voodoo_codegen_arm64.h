@@ -147,7 +147,7 @@ typedef struct voodoo_arm64_data_t {
     int      rejected;
 } voodoo_arm64_data_t;
 
-/* LRU generation counter per partition (4 partitions = odd_even).
+/* LRU generation counter per partition (one partition per render thread).
  * Per-instance in voodoo_t so SLI cards don't share eviction state.
  * Thread-safe: each partition is touched by exactly one render thread. */
 
@@ -160,7 +160,7 @@ static int arm64_jit_rwx = 1;  /* Linux: born RWX, skip mprotect */
 static int arm64_jit_rwx = 0;
 #endif
 
-/* jit_last_block[4] is in voodoo_t for MRU-hint fast probe. */
+/* jit_last_block[] is in voodoo_t for MRU-hint fast probe. */
 
 /* ========================================================================
  * Emission primitive -- ARM64 instructions are always 4 bytes
@@ -4516,7 +4516,7 @@ arm64_codegen_store_cache_key(voodoo_arm64_data_t *data, voodoo_t *voodoo, voodo
  *      slot is evicted first on the next miss.
  *   5. Return the compiled code_block pointer, or NULL for interpreter fallback.
  *
- * odd_even selects the partition (0-3). Array layout is contiguous:
+ * odd_even selects the partition (one per render thread). Array layout is contiguous:
  * slot index = odd_even * BLOCK_NUM + probe.
  */
 static inline void *
@@ -4634,14 +4634,14 @@ voodoo_codegen_init(voodoo_t *voodoo)
     voodoo_arm64_data_t *voodoo_arm64_data;
     uint32_t             slot;
 
-    voodoo->codegen_data = plat_mmap(sizeof(voodoo_arm64_data_t) * BLOCK_NUM * 4, 0);
+    voodoo->codegen_data = plat_mmap(sizeof(voodoo_arm64_data_t) * BLOCK_NUM * voodoo->render_threads, 0);
     if (!voodoo->codegen_data) {
         fatal("ARM64 JIT: failed to allocate codegen metadata buffer\n");
     }
     voodoo_arm64_data = voodoo->codegen_data;
-    memset(voodoo_arm64_data, 0, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * 4);
+    memset(voodoo_arm64_data, 0, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * voodoo->render_threads);
 
-    for (slot = 0; slot < (uint32_t) (BLOCK_NUM * 4); slot++) {
+    for (slot = 0; slot < (uint32_t) (BLOCK_NUM * voodoo->render_threads); slot++) {
         voodoo_arm64_data[slot].code_block = plat_mmap(BLOCK_SIZE, 1);
         if (!voodoo_arm64_data[slot].code_block) {
             while (slot > 0) {
@@ -4651,7 +4651,7 @@ voodoo_codegen_init(voodoo_t *voodoo)
                     voodoo_arm64_data[slot].code_block = NULL;
                 }
             }
-            plat_munmap(voodoo_arm64_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * 4);
+            plat_munmap(voodoo_arm64_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * voodoo->render_threads);
             voodoo->codegen_data = NULL;
             fatal("ARM64 JIT: failed to allocate executable code block\n");
         }
@@ -4666,7 +4666,7 @@ voodoo_codegen_init(voodoo_t *voodoo)
                     voodoo_arm64_data[slot].code_block = NULL;
                 }
             }
-            plat_munmap(voodoo_arm64_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * 4);
+            plat_munmap(voodoo_arm64_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * voodoo->render_threads);
             voodoo->codegen_data = NULL;
             fatal("ARM64 JIT: failed to set code block executable\n");
         }
@@ -4775,14 +4775,14 @@ voodoo_codegen_close(voodoo_t *voodoo)
         return;
     }
 
-    for (slot = 0; slot < (uint32_t) (BLOCK_NUM * 4); slot++) {
+    for (slot = 0; slot < (uint32_t) (BLOCK_NUM * voodoo->render_threads); slot++) {
         if (voodoo_arm64_data[slot].code_block) {
             plat_munmap(voodoo_arm64_data[slot].code_block, BLOCK_SIZE);
             voodoo_arm64_data[slot].code_block = NULL;
         }
     }
 
-    plat_munmap(voodoo_arm64_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * 4);
+    plat_munmap(voodoo_arm64_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * voodoo->render_threads);
     voodoo->codegen_data = NULL;
 }
 
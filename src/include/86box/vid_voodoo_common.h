@@ -93,6 +93,10 @@ enum {
     FIFO_WRITEL_2DREG = (0x05 << 24)
 };
 
+/* Upper bound for the "render_threads" option. Each render thread owns the
+   scanlines whose index modulo the thread count is its own index. */
+#define VOODOO_MAX_RENDER_THREADS 16
+
 #define PARAM_SIZE       1024
 #define PARAM_MASK       (PARAM_SIZE - 1)
 #define PARAM_ENTRY_SIZE (1 << 31)
@@ -245,7 +249,7 @@ typedef struct texture_t {
     uint32_t   base;
     uint32_t   tLOD;
     ATOMIC_INT refcount;
-    ATOMIC_INT refcount_r[4];
+    ATOMIC_INT refcount_r[VOODOO_MAX_RENDER_THREADS];
     int        is16;
     uint32_t   palette_checksum;
     uint32_t   addr_start[4];
@@ -277,6 +281,13 @@ typedef struct clip_t {
     int y_max;
 } clip_t;
 
+/* Argument handed to each render thread: the card and the index of the
+   scanlines it owns. */
+typedef struct voodoo_render_thread_t {
+    struct voodoo_t *voodoo;
+    int              odd_even;
+} voodoo_render_thread_t;
+
 typedef struct voodoo_t {
     mem_mapping_t mapping;
 
@@ -373,14 +384,15 @@ typedef struct voodoo_t {
     int    ncc_dirty[2];
 
     thread_t *fifo_thread;
-    thread_t *render_thread[4];
+    thread_t *render_thread[VOODOO_MAX_RENDER_THREADS];
+    voodoo_render_thread_t render_thread_data[VOODOO_MAX_RENDER_THREADS];
     event_t  *wake_fifo_thread;
     event_t  *wake_main_thread;
     event_t  *fifo_not_full_event;
     event_t  *fifo_empty_event;
     ATOMIC_INT fifo_empty_signaled;
-    event_t  *render_not_full_event[4];
-    event_t  *wake_render_thread[4];
+    event_t  *render_not_full_event[VOODOO_MAX_RENDER_THREADS];
+    event_t  *wake_render_thread[VOODOO_MAX_RENDER_THREADS];
 
     int voodoo_busy;
 #if (defined __aarch64__ || defined _M_ARM64)
@@ -389,20 +401,19 @@ typedef struct voodoo_t {
     struct {
         int value;
         char pad[128 - sizeof(int)];
-    } render_voodoo_busy[4];
+    } render_voodoo_busy[VOODOO_MAX_RENDER_THREADS];
 #else
-    int render_voodoo_busy[4];
+    int render_voodoo_busy[VOODOO_MAX_RENDER_THREADS];
 #endif
 
     int render_threads;
-    int odd_even_mask;
 
-    int pixel_count[4];
-    int texel_count[4];
+    int pixel_count[VOODOO_MAX_RENDER_THREADS];
+    int texel_count[VOODOO_MAX_RENDER_THREADS];
     int tri_count;
     int frame_count;
-    int pixel_count_old[4];
-    int texel_count_old[4];
+    int pixel_count_old[VOODOO_MAX_RENDER_THREADS];
+    int texel_count_old[VOODOO_MAX_RENDER_THREADS];
     int wr_count;
     int rd_count;
     int tex_count;
@@ -441,13 +452,13 @@ typedef struct voodoo_t {
     struct {
         ATOMIC_INT value;
         char       pad[128 - sizeof(ATOMIC_INT)];
-    } params_read_idx[4];
+    } params_read_idx[VOODOO_MAX_RENDER_THREADS];
     struct {
         ATOMIC_INT value;
         char       pad[128 - sizeof(ATOMIC_INT)];
     } params_write_idx;
 #else
-    ATOMIC_INT      params_read_idx[4];
+    ATOMIC_INT      params_read_idx[VOODOO_MAX_RENDER_THREADS];
     ATOMIC_INT      params_write_idx;
 #endif
 
@@ -709,7 +720,7 @@ typedef struct voodoo_t {
     int      palette_dirty[2];
 
     uint64_t time;
-    int      render_time[4];
+    int      render_time[VOODOO_MAX_RENDER_THREADS];
     uint64_t fifo_full_waits;
     uint64_t fifo_full_wait_ticks;
     uint64_t fifo_full_spin_checks;
@@ -745,14 +756,14 @@ typedef struct voodoo_t {
     void *codegen_data;
 
     /* JIT cache state -- per-instance to avoid races between render threads */
-    int jit_last_block[4];
-    uint64_t jit_generation[4];
+    int jit_last_block[VOODOO_MAX_RENDER_THREADS];
+    uint64_t jit_generation[VOODOO_MAX_RENDER_THREADS];
     struct voodoo_set_t *set;
 
     uint32_t launch_pending;
 
     uint8_t fifo_thread_run;
-    uint8_t render_thread_run[4];
+    uint8_t render_thread_run[VOODOO_MAX_RENDER_THREADS];
 
     uint32_t vram_max;
 
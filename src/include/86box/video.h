@@ -281,6 +281,9 @@ extern void video_blit_memtoscreen_8(int x, int y, int w, int h);
 extern void video_blend_monitor(int x, int y, int monitor_index);
 extern void video_process_8_monitor(int x, int y, int monitor_index);
 extern void video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index);
+extern void video_blit_memtoscreen_dirty_monitor(int x, int y, int w, int h, int dirty_y1, int dirty_y2, int monitor_index);
+extern void video_blit_get_dirty_monitor(int monitor_index, int *y1, int *y2);
+extern void video_blit_invalidate_monitor(int monitor_index);
 extern void video_blit_complete_monitor(int monitor_index);
 extern void video_wait_for_blit_monitor(int monitor_index);
 extern void video_wait_for_buffer_monitor(int monitor_index);
@@ -307,6 +310,8 @@ extern void    video_update_timing(void);
 #define LOAD_FONT_NO_OFFSET       0
 extern void     video_load_font(char *fn, int format, int offset);
 extern uint32_t video_color_transform(uint32_t color);
+extern int      calc_15to32(int c);
+extern int      calc_16to32(int c);
 
 #define video_inform(type, video_timings_ptr) video_inform_monitor(type, video_timings_ptr, monitor_index_global)
 #define video_get_type()                      video_get_type_monitor(0)
@@ -46,6 +46,30 @@ typedef struct _io_ {
     struct _io_ *prev, *next;
 } io_t;
 
+/* Direct dispatch entry for a port. A handler is only set when that access
+   width is served by exactly one native handler and no neighbouring port needs
+   the access split into narrower ones, in which case it can be called without
+   walking the handler lists; otherwise it is NULL and the lists are walked. */
+typedef struct io_fast_t {
+    uint8_t (*inb)(uint16_t port, void *priv);
+    uint16_t (*inw)(uint16_t port, void *priv);
+    uint32_t (*inl)(uint16_t port, void *priv);
+
+    void (*outb)(uint16_t port, uint8_t val, void *priv);
+    void (*outw)(uint16_t port, uint16_t val, void *priv);
+    void (*outl)(uint16_t port, uint32_t val, void *priv);
+
+    void *priv;
+} io_fast_t;
+
+/* Handlers on a port that force a wider access to be split. */
+#define IO_SPLIT_INB_W  0x01 /* inb without inw. */
+#define IO_SPLIT_INB_L  0x02 /* inb without inw and inl. */
+#define IO_SPLIT_INW_L  0x04 /* inw without inl. */
+#define IO_SPLIT_OUTB_W 0x08 /* outb without outw. */
+#define IO_SPLIT_OUTB_L 0x10 /* outb without outw and outl. */
+#define IO_SPLIT_OUTW_L 0x20 /* outw without outl. */
+
 typedef struct io_trap_s {
     uint8_t   enable;
     uint16_t  base;
@@ -58,6 +82,8 @@ uint8_t initialized = 0;
 io_t   *io[NPORTS];
 io_t   *io_last[NPORTS];
 
+static io_fast_t io_fast[NPORTS];
+
 #ifdef ENABLE_IO_LOG
 uint8_t io_do_log = ENABLE_IO_LOG;
 
@@ -76,6 +102,73 @@ io_log(const char *fmt, ...)
 #    define io_log(fmt, ...)
 #endif
 
+static uint8_t
+io_split_mask(uint16_t port)
+{
+    uint8_t ret = 0x00;
+
+    for (io_t *p = io[port]; p != NULL; p = p->next) {
+        if (p->inb && !p->inw)
+            ret |= IO_SPLIT_INB_W;
+        if (p->inb && !p->inw && !p->inl)
+            ret |= IO_SPLIT_INB_L;
+        if (p->inw && !p->inl)
+            ret |= IO_SPLIT_INW_L;
+
+        if (p->outb && !p->outw)
+            ret |= IO_SPLIT_OUTB_W;
+        if (p->outb && !p->outw && !p->outl)
+            ret |= IO_SPLIT_OUTB_L;
+        if (p->outw && !p->outl)
+            ret |= IO_SPLIT_OUTW_L;
+    }
+
+    return ret;
+}
+
+static void
+io_fast_update(uint16_t port)
+{
+    io_fast_t *f = &io_fast[port];
+    io_t      *p = io[port];
+    uint8_t    m1;
+    uint8_t    m2;
+    uint8_t    m3;
+
+    memset(f, 0x00, sizeof(io_fast_t));
+
+    /* No handler or more than one handler - walk the lists. */
+    if ((p == NULL) || (p->next != NULL))
+        return;
+
+    m1 = io_split_mask(port + 1);
+    m2 = io_split_mask(port + 2);
+    m3 = io_split_mask(port + 3);
+
+    f->priv = p->priv;
+
+    f->inb  = p->inb;
+    f->outb = p->outb;
+
+    if (!(m1 & IO_SPLIT_INB_W))
+        f->inw = p->inw;
+    if (!(m1 & IO_SPLIT_OUTB_W))
+        f->outw = p->outw;
+
+    if (!((m1 | m2 | m3) & IO_SPLIT_INB_L) && !(m2 & IO_SPLIT_INW_L))
+        f->inl = p->inl;
+    if (!((m1 | m2 | m3) & IO_SPLIT_OUTB_L) && !(m2 & IO_SPLIT_OUTW_L))
+        f->outl = p->outl;
+}
+
+/* Ports base-3 to base+size-1 can see their dispatch entries change. */
+static void
+io_fast_update_range(uint16_t base, uint16_t size)
+{
+    for (uint32_t c = 0; c < ((uint32_t) size + 3); c++)
+        io_fast_update(base - 3 + c);
+}
+
 void
 io_init(void)
 {
@@ -104,6 +197,8 @@ io_init(void)
         /* io[c] should be NULL. */
         io[c] = io_last[c] = NULL;
     }
+
+    memset(io_fast, 0x00, sizeof(io_fast));
 }
 
 void
@@ -145,6 +240,8 @@ io_sethandler_common(uint16_t base, uint16_t size,
 
         q = NULL;
     }
+
+    io_fast_update_range(base, size);
 }
 
 void
@@ -182,6 +279,8 @@ io_removehandler_common(uint16_t base, uint16_t size,
             p = q;
         }
     }
+
+    io_fast_update_range(base, size);
 }
 
 void
@@ -356,6 +455,12 @@ inb(uint16_t port)
         found = 1;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (io_fast[port].inb) {
+        ret = io_fast[port].inb(port, io_fast[port].priv);
+        found = 1;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
         p = io[port];
@@ -423,6 +528,12 @@ outb(uint16_t port, uint8_t val)
         found = 1;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (io_fast[port].outb) {
+        io_fast[port].outb(port, val, io_fast[port].priv);
+        found = 1;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
         p = io[port];
@@ -481,6 +592,12 @@ inw(uint16_t port)
         found = 2;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (io_fast[port].inw) {
+        ret = io_fast[port].inw(port, io_fast[port].priv);
+        found = 2;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
         p = io[port];
@@ -560,6 +677,12 @@ outw(uint16_t port, uint16_t val)
         found = 2;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (io_fast[port].outw) {
+        io_fast[port].outw(port, val, io_fast[port].priv);
+        found = 2;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
         p = io[port];
@@ -634,6 +757,12 @@ inl(uint16_t port)
         found = 4;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (io_fast[port].inl) {
+        ret = io_fast[port].inl(port, io_fast[port].priv);
+        found = 4;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
         p = io[port];
@@ -744,6 +873,12 @@ outl(uint16_t port, uint32_t val)
         found = 4;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (io_fast[port].outl) {
+        io_fast[port].outl(port, val, io_fast[port].priv);
+        found = 4;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
         p = io[port];
@@ -76,6 +76,8 @@ ioapic_write(UNUSED(uint16_t port), uint8_t val, UNUSED(void *priv))
         ioapic_log("IOAPIC: Patching _MP_ [%08x] and PCMP [%08x] tables\n", addr, pcmp);
         ram[addr] = ram[addr + 1] = ram[addr + 2] = ram[addr + 3] = 0xff;
         ram[pcmp] = ram[pcmp + 1] = ram[pcmp + 2] = ram[pcmp + 3] = 0xff;
+        mem_snap_mark(addr);
+        mem_snap_mark(pcmp);
 
         break;
     }
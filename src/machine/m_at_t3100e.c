@@ -705,6 +705,7 @@ ems_write_ram(uint32_t addr, uint8_t val, void *priv)
     if (pg < 0)
         return;
     addr      = regs->page_exec[pg] + (addr & 0x3FFF);
+    mem_snap_mark(addr);
     ram[addr] = val;
 }
 
@@ -724,6 +725,7 @@ ems_write_ramw(uint32_t addr, uint16_t val, void *priv)
     t3100e_log("-> %06x val=%04x\n", addr, val);
 #endif
 
+    mem_snap_mark_range(addr, 2);
     *(uint16_t *) &ram[addr] = val;
 }
 
@@ -736,6 +738,7 @@ ems_write_raml(uint32_t addr, uint32_t val, void *priv)
     if (pg < 0)
         return;
     addr                     = regs->page_exec[pg] + (addr & 0x3FFF);
+    mem_snap_mark_range(addr, 4);
     *(uint32_t *) &ram[addr] = val;
 }
 
@@ -774,6 +777,7 @@ upper_write_ram(uint32_t addr, uint8_t val, void *priv)
     const struct t3100e_ems_regs *regs = (struct t3100e_ems_regs *) priv;
 
     addr      = (addr - (1024 * mem_size)) + regs->upper_base;
+    mem_snap_mark(addr);
     ram[addr] = val;
 }
 
@@ -783,6 +787,7 @@ upper_write_ramw(uint32_t addr, uint16_t val, void *priv)
     const struct t3100e_ems_regs *regs = (struct t3100e_ems_regs *) priv;
 
     addr                     = (addr - (1024 * mem_size)) + regs->upper_base;
+    mem_snap_mark_range(addr, 2);
     *(uint16_t *) &ram[addr] = val;
 }
 
@@ -792,6 +797,7 @@ upper_write_raml(uint32_t addr, uint32_t val, void *priv)
     const struct t3100e_ems_regs *regs = (struct t3100e_ems_regs *) priv;
 
     addr                     = (addr - (1024 * mem_size)) + regs->upper_base;
+    mem_snap_mark_range(addr, 4);
     *(uint32_t *) &ram[addr] = val;
 }
 
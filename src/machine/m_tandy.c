@@ -850,6 +850,7 @@ write_ram(uint32_t addr, uint8_t val, void *priv)
 {
     const tandy_t *dev = (tandy_t *) priv;
 
+    mem_snap_mark(dev->base + (addr & dev->mask));
     ram[dev->base + (addr & dev->mask)] = val;
 }
 
@@ -523,6 +523,7 @@ ems_write_ram(uint32_t addr, uint8_t val, void *priv)
     if (ram[addr] != val)
         nvr_dosave = 1;
 
+    mem_snap_mark(addr);
     ram[addr] = val;
 }
 
@@ -547,6 +548,7 @@ ems_write_ramw(uint32_t addr, uint16_t val, void *priv)
     if (*(uint16_t *) &ram[addr] != val)
         nvr_dosave = 1;
 
+    mem_snap_mark_range(addr, 2);
     *(uint16_t *) &ram[addr] = val;
 }
 
@@ -563,6 +565,7 @@ ems_write_raml(uint32_t addr, uint32_t val, void *priv)
     if (*(uint32_t *) &ram[addr] != val)
         nvr_dosave = 1;
 
+    mem_snap_mark_range(addr, 4);
     *(uint32_t *) &ram[addr] = val;
 }
 
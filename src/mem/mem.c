@@ -38,6 +38,7 @@
 #include <86box/plat.h>
 #include <86box/rom.h>
 #include <86box/gdbstub.h>
+#include <86box/snapshot.h>
 #ifdef USE_DYNAREC
 #    include "codegen_public.h"
 #else
@@ -82,12 +83,59 @@ uint32_t biosaddr;
 uint32_t pccache;
 uint8_t *pccache2;
 
-int        readlnext;
-int        readlookup[256];
 uintptr_t  old_rl2;
 uint8_t    uncached = 0;
-int        writelnext;
-int        writelookup[256];
+
+/* The soft TLB keeps track of the entries set in readlookup2, writelookup2 and
+   page_lookup, which are looked up directly by the CPU and the recompiled
+   code, so that they can be removed again. It is set associative, a way is
+   picked by a clock that spares pages evicted recently and missed again, and
+   it is flushed by bumping its generation rather than by clearing it. */
+#define MMU_TLB_WAYS 4
+
+typedef struct mmu_tlb_entry_t {
+    uint32_t page;
+    uint32_t gen;
+    uint32_t pos; /* Position in the list of ways in use. */
+    uint8_t  ref;
+    uint8_t  global;
+} mmu_tlb_entry_t;
+
+typedef struct mmu_tlb_t {
+    mmu_tlb_entry_t *entries;
+    uint32_t        *ghosts; /* Pages last evicted from each way. */
+    uint32_t        *list;   /* Ways in use, roughly in fill order. */
+    uint8_t         *hands;
+    uint32_t         num;
+    uint32_t         gen;
+    uint32_t         size;
+    uint32_t         set_mask;
+    int              write;
+} mmu_tlb_t;
+
+static mmu_tlb_t tlb_read  = { .write = 0 };
+static mmu_tlb_t tlb_write = { .write = 1 };
+
+/* Address spaces whose lookup entries are kept across CR3 reloads. */
+#define MMU_CTX_NUM     4
+#define MMU_CTX_ENTRIES 64
+
+typedef struct mmu_ctx_t {
+    uint32_t cr3;
+    uint32_t stamp;
+    int      num_read;
+    int      num_write;
+    uint32_t read[MMU_CTX_ENTRIES];
+    uint32_t write[MMU_CTX_ENTRIES];
+} mmu_ctx_t;
+
+static mmu_ctx_t mmu_ctx[MMU_CTX_NUM];
+static uint32_t  mmu_ctx_stamp;
+static uint32_t  mmu_global_page = 0xffffffff;
+
+mmu_tlb_stats_t mmu_tlb_stats;
+mmu_tlb_stats_t mmu_tlb_stats_sec;
+mmu_tlb_stats_t mmu_tlb_stats_total;
 
 /* The lookup tables. */
 page_t *page_lookup[1048576] = { 0 };
@@ -101,7 +149,7 @@ int shadowbios = 0;
 int shadowbios_write;
 int readlnum  = 0;
 int writelnum = 0;
-int cachesize = 256;
+int mem_tlb_size = MMU_TLB_DEFAULT; /* (C) soft TLB entries */
 
 uint32_t get_phys_virt;
 uint32_t get_phys_phys;
@@ -140,6 +188,9 @@ static uint32_t       remap_start_addr;
 static uint32_t       remap_start_addr2;
 static size_t ram_size = 0;
 
+uint8_t        *mem_snap_dirty = NULL;
+static size_t   mem_snap_dirty_len;
+
 #ifdef ENABLE_MEM_LOG
 int mem_do_log = ENABLE_MEM_LOG;
 
@@ -167,44 +218,181 @@ mem_addr_is_ram(uint32_t addr)
            (mapping == &ram_mid_mapping2) || (mapping == &ram_remapped_mapping);
 }
 
+static void
+mmu_tlb_alloc(mmu_tlb_t *tlb, uint32_t size)
+{
+    free(tlb->entries);
+    free(tlb->ghosts);
+    free(tlb->list);
+    free(tlb->hands);
+
+    tlb->entries  = (mmu_tlb_entry_t *) calloc(size, sizeof(mmu_tlb_entry_t));
+    tlb->ghosts   = (uint32_t *) malloc(size * sizeof(uint32_t));
+    tlb->list     = (uint32_t *) malloc(size * sizeof(uint32_t));
+    tlb->hands    = (uint8_t *) calloc(size / MMU_TLB_WAYS, sizeof(uint8_t));
+    if ((tlb->entries == NULL) || (tlb->ghosts == NULL) || (tlb->list == NULL) || (tlb->hands == NULL))
+        fatal("Unable to allocate the soft TLB\n");
+
+    tlb->size     = size;
+    tlb->set_mask = (size / MMU_TLB_WAYS) - 1;
+}
+
+static void
+mmu_tlb_reset(mmu_tlb_t *tlb)
+{
+    uint32_t size = mem_tlb_size;
+
+    /* Power of two, so that sets can be masked. */
+    if (size < MMU_TLB_MIN)
+        size = MMU_TLB_MIN;
+    else if (size > MMU_TLB_MAX)
+        size = MMU_TLB_MAX;
+    while (size & (size - 1))
+        size &= size - 1;
+
+    if (tlb->size != size)
+        mmu_tlb_alloc(tlb, size);
+
+    memset(tlb->entries, 0x00, tlb->size * sizeof(mmu_tlb_entry_t));
+    memset(tlb->ghosts, 0xff, tlb->size * sizeof(uint32_t));
+    memset(tlb->hands, 0x00, tlb->size / MMU_TLB_WAYS);
+    tlb->num = 0;
+    tlb->gen = 1;
+}
+
+/* Clear the direct lookup entry of a page. */
+static __inline void
+mmu_tlb_clear_page(const mmu_tlb_t *tlb, uint32_t page)
+{
+    if (tlb->write) {
+        page_lookup[page]  = NULL;
+        writelookup2[page] = LOOKUP_INV;
+    } else
+        readlookup2[page] = LOOKUP_INV;
+}
+
+static __inline void
+mmu_tlb_remove(mmu_tlb_t *tlb, mmu_tlb_entry_t *entry)
+{
+    uint32_t last = tlb->list[--tlb->num];
+
+    tlb->list[entry->pos]  = last;
+    tlb->entries[last].pos = entry->pos;
+    entry->gen             = 0;
+}
+
+static __inline uint32_t
+mmu_tlb_set(const mmu_tlb_t *tlb, uint32_t page)
+{
+    return ((page ^ (page >> 10)) & tlb->set_mask) * MMU_TLB_WAYS;
+}
+
+/* Return the way holding a page, or NULL. */
+static mmu_tlb_entry_t *
+mmu_tlb_find(mmu_tlb_t *tlb, uint32_t page)
+{
+    mmu_tlb_entry_t *ways = &tlb->entries[mmu_tlb_set(tlb, page)];
+
+    for (int c = 0; c < MMU_TLB_WAYS; c++) {
+        if ((ways[c].gen == tlb->gen) && (ways[c].page == page))
+            return &ways[c];
+    }
+
+    return NULL;
+}
+
+/* Find a way for a page, evicting one if the set is full, and return it
+   with the page it held, or 0xffffffff. */
+static mmu_tlb_entry_t *
+mmu_tlb_insert(mmu_tlb_t *tlb, uint32_t page, uint32_t *old)
+{
+    uint32_t         set   = mmu_tlb_set(tlb, page);
+    mmu_tlb_entry_t *ways  = &tlb->entries[set];
+    uint8_t          ghost = 0;
+    int              way   = -1;
+
+    for (int c = 0; c < MMU_TLB_WAYS; c++) {
+        if (tlb->ghosts[set + c] == page) {
+            tlb->ghosts[set + c] = 0xffffffff;
+            ghost                = 1;
+        }
+        if ((way == -1) && (ways[c].gen != tlb->gen))
+            way = c;
+    }
+
+    *old = 0xffffffff;
+    if (way == -1) {
+        /* Second chance for pages that came back right after eviction. */
+        while (1) {
+            way = tlb->hands[set / MMU_TLB_WAYS];
+            tlb->hands[set / MMU_TLB_WAYS] = (way + 1) & (MMU_TLB_WAYS - 1);
+            if (!ways[way].ref)
+                break;
+            ways[way].ref = 0;
+        }
+
+        *old                   = ways[way].page;
+        tlb->ghosts[set + way] = ways[way].page;
+        mmu_tlb_remove(tlb, &ways[way]);
+        mmu_tlb_stats.evictions++;
+    }
+
+    ways[way].page   = page;
+    ways[way].gen    = tlb->gen;
+    ways[way].ref    = ghost;
+    ways[way].global = (mmu_global_page == page);
+    ways[way].pos    = tlb->num;
+
+    tlb->list[tlb->num++] = set + way;
+
+    return &ways[way];
+}
+
+/* Drop every entry. The ways themselves are invalidated all at once by
+   moving to the next generation. */
+static void
+mmu_tlb_flush(mmu_tlb_t *tlb)
+{
+    for (uint32_t c = 0; c < tlb->num; c++)
+        mmu_tlb_clear_page(tlb, tlb->entries[tlb->list[c]].page);
+
+    tlb->num = 0;
+    if (++tlb->gen == 0) {
+        memset(tlb->entries, 0x00, tlb->size * sizeof(mmu_tlb_entry_t));
+        tlb->gen = 1;
+    }
+}
+
 void
 resetreadlookup(void)
 {
     /* Initialize the page lookup table. */
     memset(page_lookup, 0x00, (1 << 20) * sizeof(page_t *));
 
-    /* Initialize the tables for lower (<= 1024K) RAM. */
-    for (uint16_t c = 0; c < 256; c++) {
-        readlookup[c]  = 0xffffffff;
-        writelookup[c] = 0xffffffff;
-    }
-
     /* Initialize the tables for high (> 1024K) RAM. */
     memset(readlookup2, 0xff, (1 << 20) * sizeof(uintptr_t));
 
     memset(writelookup2, 0xff, (1 << 20) * sizeof(uintptr_t));
 
-    readlnext  = 0;
-    writelnext = 0;
-    pccache    = 0xffffffff;
-    high_page  = 0;
+    mmu_tlb_reset(&tlb_read);
+    mmu_tlb_reset(&tlb_write);
+
+    pccache   = 0xffffffff;
+    high_page = 0;
+
+    /* Forget the saved address spaces as well. */
+    memset(mmu_ctx, 0x00, sizeof(mmu_ctx));
+    mmu_global_page = 0xffffffff;
 }
 
 void
 flushmmucache(void)
 {
-    for (uint16_t c = 0; c < 256; c++) {
-        if (readlookup[c] != (int) 0xffffffff) {
-            readlookup2[readlookup[c]] = LOOKUP_INV;
-            readlookup[c]              = 0xffffffff;
-        }
-        if (writelookup[c] != (int) 0xffffffff) {
-            page_lookup[writelookup[c]]  = NULL;
-            writelookup2[writelookup[c]] = LOOKUP_INV;
-            writelookup[c]               = 0xffffffff;
-        }
-    }
+    mmu_tlb_flush(&tlb_read);
+    mmu_tlb_flush(&tlb_write);
     mmuflush++;
+    mmu_tlb_stats.flushes++;
+    mmu_global_page = 0xffffffff;
 
     pccache  = (uint32_t) 0xffffffff;
     pccache2 = (uint8_t *) 0xffffffff;
@@ -217,14 +405,9 @@ flushmmucache(void)
 void
 flushmmucache_write(void)
 {
-    for (uint16_t c = 0; c < 256; c++) {
-        if (writelookup[c] != (int) 0xffffffff) {
-            page_lookup[writelookup[c]]  = NULL;
-            writelookup2[writelookup[c]] = LOOKUP_INV;
-            writelookup[c]               = 0xffffffff;
-        }
-    }
+    mmu_tlb_flush(&tlb_write);
     mmuflush++;
+    mmu_tlb_stats.flushes++;
 }
 
 void
@@ -243,34 +426,28 @@ flushmmucache_pc(void)
 void
 flushmmucache_nopc(void)
 {
-    for (uint16_t c = 0; c < 256; c++) {
-        if (readlookup[c] != (int) 0xffffffff) {
-            readlookup2[readlookup[c]] = LOOKUP_INV;
-            readlookup[c]              = 0xffffffff;
-        }
-        if (writelookup[c] != (int) 0xffffffff) {
-            page_lookup[writelookup[c]]  = NULL;
-            writelookup2[writelookup[c]] = LOOKUP_INV;
-            writelookup[c]               = 0xffffffff;
-        }
-    }
+    mmu_tlb_flush(&tlb_read);
+    mmu_tlb_flush(&tlb_write);
+    mmu_tlb_stats.flushes++;
+    mmu_global_page = 0xffffffff;
 }
 
+/* Drop the direct write entry of a page that now holds code, so that writes
+   to it go through the checks for self-modifying code. Entries that already
+   go through page_lookup are checked anyway, and are left alone. */
 void
 mem_flush_write_page(uint32_t addr, uint32_t virt)
 {
-    const page_t *page_target = &pages[addr >> 12];
+    uintptr_t        target = (uintptr_t) &ram[(uintptr_t) (addr & ~0xfff) - (virt & ~0xfff)];
+    mmu_tlb_entry_t *entry;
 
-    for (uint16_t c = 0; c < 256; c++) {
-        if (writelookup[c] != (int) 0xffffffff) {
-            uintptr_t target = (uintptr_t) &ram[(uintptr_t) (addr & ~0xfff) - (virt & ~0xfff)];
-            if (writelookup2[writelookup[c]] == target || page_lookup[writelookup[c]] == page_target) {
-                writelookup2[writelookup[c]] = LOOKUP_INV;
-                page_lookup[writelookup[c]]  = NULL;
-                writelookup[c]               = 0xffffffff;
-            }
-        }
-    }
+    if (writelookup2[virt >> 12] != target)
+        return;
+
+    entry = mmu_tlb_find(&tlb_write, virt >> 12);
+    mmu_tlb_clear_page(&tlb_write, virt >> 12);
+    if (entry != NULL)
+        mmu_tlb_remove(&tlb_write, entry);
 }
 
 #define mmutranslate_read(addr)  mmutranslatereal(addr, 0)
@@ -278,6 +455,306 @@ mem_flush_write_page(uint32_t addr, uint32_t virt)
 #define rammap(x)                ((uint32_t *) (_mem_exec[(x) >> MEM_GRANULARITY_BITS]))[((x) >> 2) & MEM_GRANULARITY_QMASK]
 #define rammap64(x)              ((uint64_t *) (_mem_exec[(x) >> MEM_GRANULARITY_BITS]))[((x) >> 3) & MEM_GRANULARITY_PMASK]
 
+/* Keep track of the last page translated through a global (PGE) entry, so
+   that the lookup entry added for it survives CR3 reloads. */
+static __inline void
+mmu_set_global(uint32_t addr, uint32_t entry)
+{
+    mmu_global_page = ((entry & 0x100) && (cr4 & CR4_PGE)) ? (addr >> 12) : 0xffffffff;
+}
+
+static int
+mmu_mapping_is_ram(const mem_mapping_t *mapping)
+{
+    /* Only the mappings where RAM offset and physical address are the same. */
+    return (mapping == &ram_low_mapping) || (mapping == &ram_high_mapping) || (mapping == &ram_mid_mapping) ||
+           (mapping == &ram_mid_mapping2);
+}
+
+static __inline int
+mmu_table_is_ram(uint64_t addr)
+{
+    return (addr <= 0xffffffffULL) && (_mem_exec[addr >> MEM_GRANULARITY_BITS] != NULL);
+}
+
+/* Walk the page tables without updating them, and only accept a translation
+   the guest has already used: present, accessed, and for writes writable and
+   dirty, so that entering it into the lookup tables is invisible to it. */
+static uint32_t
+mmu_peek(uint32_t addr, int rw)
+{
+    uint64_t need = rw ? 0x63 : 0x21;
+    uint64_t dir  = rw ? 0x23 : 0x21;
+    uint64_t table;
+    uint64_t entry;
+    uint64_t phys;
+
+    if (cr4 & CR4_PAE) {
+        table = (cr3 & ~0x1f) + ((addr >> 27) & 0x18);
+        if (!mmu_table_is_ram(table))
+            return 0xffffffff;
+        entry = rammap64(table) & 0x000000ffffffffffULL;
+        if (!(entry & 1))
+            return 0xffffffff;
+
+        table = (entry & ~0xfffULL) + ((addr >> 18) & 0xff8);
+        if (!mmu_table_is_ram(table))
+            return 0xffffffff;
+        entry = rammap64(table) & 0x000000ffffffffffULL;
+        if (entry & 0x80) {
+            /*2MB page*/
+            if ((entry & need) != need)
+                return 0xffffffff;
+            phys = (entry & ~0x1fffffULL) + (addr & 0x1fffff);
+        } else {
+            if ((entry & dir) != dir)
+                return 0xffffffff;
+            table = (entry & ~0xfffULL) + ((addr >> 9) & 0xff8);
+            if (!mmu_table_is_ram(table))
+                return 0xffffffff;
+            entry = rammap64(table) & 0x000000ffffffffffULL;
+            if ((entry & need) != need)
+                return 0xffffffff;
+            phys = (entry & ~0xfffULL) + (addr & 0xfff);
+        }
+    } else {
+        table = (cr3 & ~0xfff) + ((addr >> 20) & 0xffc);
+        if (!mmu_table_is_ram(table))
+            return 0xffffffff;
+        entry = rammap(table);
+        if ((entry & 0x80) && (cr4 & CR4_PSE)) {
+            /*4MB page*/
+            if ((entry & need) != need)
+                return 0xffffffff;
+            phys = (entry & ~0x3fffff) + (addr & 0x3fffff);
+            if (cpu_features & CPU_FEATURE_PSE36)
+                phys |= (entry & 0x1e000) << 19;
+        } else {
+            if ((entry & dir) != dir)
+                return 0xffffffff;
+            table = (entry & ~0xfff) + ((addr >> 10) & 0xffc);
+            if (!mmu_table_is_ram(table))
+                return 0xffffffff;
+            entry = rammap(table);
+            if ((entry & need) != need)
+                return 0xffffffff;
+            phys = (entry & ~0xfff) + (addr & 0xfff);
+        }
+    }
+
+    if (phys > 0xffffffffULL)
+        return 0xffffffff;
+
+    return ((uint32_t) phys) & rammask;
+}
+
+static mmu_ctx_t *
+mmu_ctx_find(uint32_t val, int alloc)
+{
+    mmu_ctx_t *oldest = &mmu_ctx[0];
+
+    for (int c = 0; c < MMU_CTX_NUM; c++) {
+        if (mmu_ctx[c].stamp && (mmu_ctx[c].cr3 == val))
+            return &mmu_ctx[c];
+        if (mmu_ctx[c].stamp < oldest->stamp)
+            oldest = &mmu_ctx[c];
+    }
+
+    if (!alloc)
+        return NULL;
+
+    oldest->cr3       = val;
+    oldest->num_read  = 0;
+    oldest->num_write = 0;
+
+    return oldest;
+}
+
+/* Remember the most recent non-global lookup entries of the address space
+   being switched away from. */
+static void
+mmu_ctx_save(uint32_t val)
+{
+    mmu_ctx_t       *ctx = mmu_ctx_find(val, 1);
+    mmu_tlb_entry_t *entry;
+
+    ctx->stamp     = ++mmu_ctx_stamp;
+    ctx->num_read  = 0;
+    ctx->num_write = 0;
+
+    /* The end of the list holds the most recent entries. */
+    for (uint32_t c = tlb_read.num; (c-- > 0) && (ctx->num_read < MMU_CTX_ENTRIES);) {
+        entry = &tlb_read.entries[tlb_read.list[c]];
+        if (!entry->global)
+            ctx->read[ctx->num_read++] = entry->page;
+    }
+
+    for (uint32_t c = tlb_write.num; (c-- > 0) && (ctx->num_write < MMU_CTX_ENTRIES);) {
+        entry = &tlb_write.entries[tlb_write.list[c]];
+        if (!entry->global)
+            ctx->write[ctx->num_write++] = entry->page;
+    }
+}
+
+#ifndef USE_DEBUG_REGS_486
+static void addreadlookup_int(uint32_t virt, uint32_t phys);
+static void addwritelookup_int(uint32_t virt, uint32_t phys);
+
+/* Bring back the entries of an address space seen before, each one checked
+   against its current page tables, since the guest is free to change them
+   while the address space is not active. */
+static void
+mmu_ctx_restore(uint32_t val)
+{
+    mmu_ctx_t *ctx = mmu_ctx_find(val, 0);
+    uint32_t   phys;
+
+    if (ctx == NULL)
+        return;
+
+    ctx->stamp = ++mmu_ctx_stamp;
+
+    /* Oldest first, so that the fill order is kept. */
+    for (int c = ctx->num_read - 1; c >= 0; c--) {
+        phys = mmu_peek(ctx->read[c] << 12, 0);
+        if ((phys != 0xffffffff) && mmu_mapping_is_ram(read_mapping[phys >> MEM_GRANULARITY_BITS])) {
+            addreadlookup_int(ctx->read[c] << 12, phys);
+            mmu_tlb_stats.restored++;
+        }
+    }
+
+    for (int c = ctx->num_write - 1; c >= 0; c--) {
+        phys = mmu_peek(ctx->write[c] << 12, 1);
+        if ((phys != 0xffffffff) && mmu_mapping_is_ram(write_mapping[phys >> MEM_GRANULARITY_BITS])) {
+            addwritelookup_int(ctx->write[c] << 12, phys);
+            mmu_tlb_stats.restored++;
+        }
+    }
+}
+#endif
+
+/* Drop every entry but those of global pages. */
+static void
+mmu_tlb_flush_local(mmu_tlb_t *tlb)
+{
+    mmu_tlb_entry_t *entry;
+
+    for (uint32_t c = tlb->num; c-- > 0;) {
+        entry = &tlb->entries[tlb->list[c]];
+        if (entry->global)
+            mmu_tlb_stats.kept++;
+        else {
+            mmu_tlb_clear_page(tlb, entry->page);
+            mmu_tlb_remove(tlb, entry);
+        }
+    }
+}
+
+/* Load CR3. Unlike a full flush, entries for global pages are kept when
+   CR4.PGE is set, as on real hardware, and the recent entries of the
+   address space being loaded are brought back if it was active before. */
+void
+flushmmucache_cr3(uint32_t val)
+{
+    int paging = (cr0 >> 31) && cpu_use_exec;
+    int keep   = paging && (cr4 & CR4_PGE);
+
+    if (paging)
+        mmu_ctx_save(cr3);
+
+    cr3 = val;
+
+    if (keep) {
+        mmu_tlb_flush_local(&tlb_read);
+        mmu_tlb_flush_local(&tlb_write);
+    } else {
+        mmu_tlb_flush(&tlb_read);
+        mmu_tlb_flush(&tlb_write);
+    }
+    mmuflush++;
+    mmu_tlb_stats.switches++;
+
+    pccache  = (uint32_t) 0xffffffff;
+    pccache2 = (uint8_t *) 0xffffffff;
+
+    mmu_global_page = 0xffffffff;
+
+#ifndef USE_DEBUG_REGS_486
+    /* With the debug registers every access goes through the slow path, so
+       there is nothing to bring back. */
+    if (paging)
+        mmu_ctx_restore(val);
+#endif
+
+#ifdef USE_DYNAREC
+    codegen_flush();
+#endif
+}
+
+/* Called once a second, to make the counters of the last second available. */
+void
+mmu_tlb_onesec(void)
+{
+    mmu_tlb_stats_sec = mmu_tlb_stats;
+    memset(&mmu_tlb_stats, 0x00, sizeof(mmu_tlb_stats_t));
+
+    mmu_tlb_stats_total.fills     += mmu_tlb_stats_sec.fills;
+    mmu_tlb_stats_total.evictions += mmu_tlb_stats_sec.evictions;
+    mmu_tlb_stats_total.flushes   += mmu_tlb_stats_sec.flushes;
+    mmu_tlb_stats_total.switches  += mmu_tlb_stats_sec.switches;
+    mmu_tlb_stats_total.kept      += mmu_tlb_stats_sec.kept;
+    mmu_tlb_stats_total.restored  += mmu_tlb_stats_sec.restored;
+
+    readlnum  = tlb_read.num;
+    writelnum = tlb_write.num;
+
+    mem_log("TLB: %" PRIu64 " fills, %" PRIu64 " evictions, %" PRIu64 " flushes, %" PRIu64 " CR3 loads, "
+            "%" PRIu64 " global entries kept, %" PRIu64 " entries restored\n",
+            mmu_tlb_stats_sec.fills, mmu_tlb_stats_sec.evictions, mmu_tlb_stats_sec.flushes,
+            mmu_tlb_stats_sec.switches, mmu_tlb_stats_sec.kept, mmu_tlb_stats_sec.restored);
+}
+
+/* Print the counters of the whole run, to compare TLB sizes. */
+void
+mmu_tlb_print_stats(void)
+{
+    printf("Soft TLB, %u entries: %" PRIu64 " fills, %" PRIu64 " evictions, %" PRIu64 " flushes, "
+           "%" PRIu64 " CR3 loads, %" PRIu64 " global entries kept, %" PRIu64 " entries restored\n",
+           tlb_read.size, mmu_tlb_stats_total.fills, mmu_tlb_stats_total.evictions,
+           mmu_tlb_stats_total.flushes, mmu_tlb_stats_total.switches, mmu_tlb_stats_total.kept,
+           mmu_tlb_stats_total.restored);
+}
+
+/* Stop tracking written pages. The next snapshot has to be a full one. */
+static void
+mem_snap_untrack(void)
+{
+    free(mem_snap_dirty);
+    mem_snap_dirty     = NULL;
+    mem_snap_dirty_len = 0;
+}
+
+/* Mark the RAM page behind a host pointer as dirty, for writes that go
+   through _mem_exec or page->mem rather than a RAM offset. */
+static __inline void
+mem_snap_mark_ptr(const uint8_t *p)
+{
+    if ((mem_snap_dirty != NULL) && (p >= ram) && (p < (ram + ram_size)))
+        mem_snap_mark((uint32_t) (p - ram));
+}
+
+/* The accessed/dirty bits are set behind the back of the write handlers. */
+#define rammap_or(x, v)                                 \
+    do {                                                \
+        rammap(x) |= (v);                               \
+        mem_snap_mark_ptr((uint8_t *) &rammap(x));      \
+    } while (0)
+#define rammap64_or(x, v)                               \
+    do {                                                \
+        rammap64(x) |= (v);                             \
+        mem_snap_mark_ptr((uint8_t *) &rammap64(x));    \
+    } while (0)
+
 static __inline uint64_t
 mmutranslatereal_normal(uint32_t addr, int rw)
 {
@@ -318,7 +795,8 @@ mmutranslatereal_normal(uint32_t addr, int rw)
             return 0xffffffffffffffffULL;
         }
 
-        rammap(addr2) |= (rw ? 0x60 : 0x20);
+        rammap_or(addr2, (rw ? 0x60 : 0x20));
+        mmu_set_global(addr, temp);
 
         uint64_t page = temp & ~0x3fffff;
         if (cpu_features & CPU_FEATURE_PSE36)
@@ -340,8 +818,9 @@ mmutranslatereal_normal(uint32_t addr, int rw)
         return 0xffffffffffffffffULL;
     }
 
-    rammap(addr2) |= 0x20;
-    rammap((temp2 & ~0xfff) + ((addr >> 10) & 0xffc)) |= (rw ? 0x60 : 0x20);
+    rammap_or(addr2, 0x20);
+    rammap_or((temp2 & ~0xfff) + ((addr >> 10) & 0xffc), (rw ? 0x60 : 0x20));
+    mmu_set_global(addr, temp);
 
     return (uint64_t) ((temp & ~0xfff) + (addr & 0xfff));
 }
@@ -403,7 +882,8 @@ mmutranslatereal_pae(uint32_t addr, int rw)
 
             return 0xffffffffffffffffULL;
         }
-        rammap64(addr3) |= (rw ? 0x60 : 0x20);
+        rammap64_or(addr3, (rw ? 0x60 : 0x20));
+        mmu_set_global(addr, (uint32_t) temp);
 
         return ((temp & ~0x1fffffULL) + (addr & 0x1fffffULL)) & 0x000000ffffffffffULL;
     }
@@ -423,8 +903,9 @@ mmutranslatereal_pae(uint32_t addr, int rw)
         return 0xffffffffffffffffULL;
     }
 
-    rammap64(addr3) |= 0x20;
-    rammap64(addr4) |= (rw ? 0x60 : 0x20);
+    rammap64_or(addr3, 0x20);
+    rammap64_or(addr4, (rw ? 0x60 : 0x20));
+    mmu_set_global(addr, (uint32_t) temp);
 
     return ((temp & ~0xfffULL) + ((uint64_t) (addr & 0xfff))) & 0x000000ffffffffffULL;
 }
@@ -568,45 +1049,56 @@ mem_addr_translate(uint32_t addr, uint32_t chunk_start, uint32_t len)
     return chunk_start + (addr & mask);
 }
 
-void
-addreadlookup(uint32_t virt, uint32_t phys)
-{
 #ifndef USE_DEBUG_REGS_486
-    if (virt == 0xffffffff)
-        return;
+static void
+addreadlookup_int(uint32_t virt, uint32_t phys)
+{
+    uint32_t old;
 
     if (readlookup2[virt >> 12] != (uintptr_t) LOOKUP_INV)
         return;
 
-    if (readlookup[readlnext] != (int) 0xffffffff) {
-        if ((readlookup[readlnext] == ((es + DI) >> 12)) || (readlookup[readlnext] == ((es + EDI) >> 12)))
+    mmu_tlb_insert(&tlb_read, virt >> 12, &old);
+    if (old != 0xffffffff) {
+        if ((old == ((es + DI) >> 12)) || (old == ((es + EDI) >> 12)))
             uncached = 1;
-        readlookup2[readlookup[readlnext]] = LOOKUP_INV;
+        readlookup2[old] = LOOKUP_INV;
     }
 
     readlookup2[virt >> 12] = (uintptr_t) &ram[(uintptr_t) (phys & ~0xFFF) - (uintptr_t) (virt & ~0xfff)];
-
-    readlookup[readlnext++] = virt >> 12;
-    readlnext &= (cachesize - 1);
+}
 #endif
 
-    cycles -= 9;
-}
 
 void
-addwritelookup(uint32_t virt, uint32_t phys)
+addreadlookup(uint32_t virt, uint32_t phys)
 {
 #ifndef USE_DEBUG_REGS_486
     if (virt == 0xffffffff)
         return;
 
-    if (page_lookup[virt >> 12])
+    if (readlookup2[virt >> 12] != (uintptr_t) LOOKUP_INV)
         return;
 
-    if (writelookup[writelnext] != -1) {
-        page_lookup[writelookup[writelnext]]  = NULL;
-        writelookup2[writelookup[writelnext]] = LOOKUP_INV;
-    }
+    addreadlookup_int(virt, phys);
+    mmu_tlb_stats.fills++;
+#endif
+
+    cycles -= 9;
+}
+
+#ifndef USE_DEBUG_REGS_486
+static void
+addwritelookup_int(uint32_t virt, uint32_t phys)
+{
+    uint32_t old;
+
+    if (page_lookup[virt >> 12] || (writelookup2[virt >> 12] != (uintptr_t) LOOKUP_INV))
+        return;
+
+    mmu_tlb_insert(&tlb_write, virt >> 12, &old);
+    if (old != 0xffffffff)
+        mmu_tlb_clear_page(&tlb_write, old);
 
 #ifdef USE_NEW_DYNAREC
 #    ifdef USE_DYNAREC
@@ -623,12 +1115,27 @@ addwritelookup(uint32_t virt, uint32_t phys)
 #endif
         page_lookup[virt >> 12]  = &pages[phys >> 12];
     } else {
-
+        /* Writes through writelookup2 bypass everything, so the page is
+           marked dirty once here, when the direct mapping is set up. */
+        mem_snap_mark(phys);
         writelookup2[virt >> 12] = (uintptr_t) &ram[(uintptr_t) (phys & ~0xFFF) - (uintptr_t) (virt & ~0xfff)];
     }
+}
+#endif
+
+
+void
+addwritelookup(uint32_t virt, uint32_t phys)
+{
+#ifndef USE_DEBUG_REGS_486
+    if (virt == 0xffffffff)
+        return;
+
+    if (page_lookup[virt >> 12] || (writelookup2[virt >> 12] != (uintptr_t) LOOKUP_INV))
+        return;
 
-    writelookup[writelnext++] = virt >> 12;
-    writelnext &= (cachesize - 1);
+    addwritelookup_int(virt, phys);
+    mmu_tlb_stats.fills++;
 #endif
 
     cycles -= 9;
@@ -1701,9 +2208,10 @@ mem_writeb_phys(uint32_t addr, uint8_t val)
     mem_logical_addr = 0xffffffff;
 
     if (map) {
-        if (cpu_use_exec && map->exec)
+        if (cpu_use_exec && map->exec) {
             map->exec[(addr - map->base) & map->mask] = val;
-        else if (map->write_b)
+            mem_snap_mark_ptr(&map->exec[(addr - map->base) & map->mask]);
+        } else if (map->write_b)
             map->write_b(addr, val, map->priv);
     }
 }
@@ -1719,6 +2227,7 @@ mem_writew_phys(uint32_t addr, uint16_t val)
     if (cpu_use_exec && ((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->exec)) {
         p  = (uint16_t *) &(map->exec[(addr - map->base) & map->mask]);
         *p = val;
+        mem_snap_mark_ptr((uint8_t *) p);
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->write_w))
         map->write_w(addr, val, map->priv);
     else {
@@ -1738,6 +2247,7 @@ mem_writel_phys(uint32_t addr, uint32_t val)
     if (cpu_use_exec && ((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->exec)) {
         p  = (uint32_t *) &(map->exec[(addr - map->base) & map->mask]);
         *p = val;
+        mem_snap_mark_ptr((uint8_t *) p);
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->write_l))
         map->write_l(addr, val, map->priv);
     else {
@@ -1765,6 +2275,29 @@ mem_write_phys(void *src, uint32_t addr, int transfer_size)
     }
 }
 
+/* Get a direct pointer to the memory behind a physical address, valid up to
+   the end of its granule, for bulk copies. Returns NULL if the address is
+   not backed by plain memory, and has to go through the mapping handlers. */
+uint8_t *
+mem_get_phys_ptr(uint32_t addr, int write)
+{
+    mem_mapping_t *map = write ? write_mapping_bus[addr >> MEM_GRANULARITY_BITS] : read_mapping_bus[addr >> MEM_GRANULARITY_BITS];
+    uint8_t       *p;
+
+    mem_logical_addr = 0xffffffff;
+
+    /* The granule must not wrap around within the mapping's buffer. */
+    if (!cpu_use_exec || !map || !map->exec || (map->base & MEM_GRANULARITY_MASK) ||
+        ((map->mask & MEM_GRANULARITY_MASK) != MEM_GRANULARITY_MASK))
+        return NULL;
+
+    p = &map->exec[(addr - map->base) & map->mask];
+    if (write)
+        mem_snap_mark_ptr(p);
+
+    return p;
+}
+
 uint8_t
 mem_read_ram(uint32_t addr, UNUSED(void *priv))
 {
@@ -1897,6 +2430,7 @@ mem_write_ramb_page(uint32_t addr, uint8_t val, page_t *page)
         uint64_t byte_mask   = (uint64_t) 1 << (addr & PAGE_BYTE_MASK_MASK);
 
         page->mem[addr & 0xfff] = val;
+        mem_snap_mark_ptr(&page->mem[addr & 0xfff]);
         page->dirty_mask |= mask;
         if ((page->code_present_mask & mask) && !page_in_evict_list(page))
             page_add_to_evict_list(page);
@@ -1924,6 +2458,8 @@ mem_write_ramw_page(uint32_t addr, uint16_t val, page_t *page)
         if ((addr & 0xf) == 0xf)
             mask |= (mask << 1);
         *(uint16_t *) &page->mem[addr & 0xfff] = val;
+        mem_snap_mark_ptr(&page->mem[addr & 0xfff]);
+        mem_snap_mark_ptr(&page->mem[(addr + 1) & 0xfff]);
         page->dirty_mask |= mask;
         if ((page->code_present_mask & mask) && !page_in_evict_list(page))
             page_add_to_evict_list(page);
@@ -1959,6 +2495,8 @@ mem_write_raml_page(uint32_t addr, uint32_t val, page_t *page)
         if ((addr & 0xf) >= 0xd)
             mask |= (mask << 1);
         *(uint32_t *) &page->mem[addr & 0xfff] = val;
+        mem_snap_mark_ptr(&page->mem[addr & 0xfff]);
+        mem_snap_mark_ptr(&page->mem[(addr + 3) & 0xfff]);
         page->dirty_mask |= mask;
         page->byte_dirty_mask[byte_offset] |= byte_mask;
         if (!page_in_evict_list(page) && ((page->code_present_mask & mask) || (page->byte_code_present_mask[byte_offset] & byte_mask)))
@@ -1987,6 +2525,7 @@ mem_write_ramb_page(uint32_t addr, uint8_t val, page_t *page)
         uint64_t mask = (uint64_t) 1 << ((addr >> PAGE_MASK_SHIFT) & PAGE_MASK_MASK);
         page->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
         page->mem[addr & 0xfff] = val;
+        mem_snap_mark_ptr(&page->mem[addr & 0xfff]);
     }
 }
 
@@ -2006,6 +2545,8 @@ mem_write_ramw_page(uint32_t addr, uint16_t val, page_t *page)
             mask |= (mask << 1);
         page->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
         *(uint16_t *) &page->mem[addr & 0xfff] = val;
+        mem_snap_mark_ptr(&page->mem[addr & 0xfff]);
+        mem_snap_mark_ptr(&page->mem[(addr + 1) & 0xfff]);
     }
 }
 
@@ -2025,6 +2566,8 @@ mem_write_raml_page(uint32_t addr, uint32_t val, page_t *page)
             mask |= (mask << 1);
         page->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
         *(uint32_t *) &page->mem[addr & 0xfff] = val;
+        mem_snap_mark_ptr(&page->mem[addr & 0xfff]);
+        mem_snap_mark_ptr(&page->mem[(addr + 3) & 0xfff]);
     }
 }
 #endif
@@ -2042,8 +2585,10 @@ mem_write_ram(uint32_t addr, uint8_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramb_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
+        mem_snap_mark(addr);
         ram[addr] = val;
+    }
 }
 
 void
@@ -2056,8 +2601,11 @@ mem_write_ramw(uint32_t addr, uint16_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramw_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
+        mem_snap_mark(addr);
+        mem_snap_mark(addr + 1);
         *(uint16_t *) &ram[addr] = val;
+    }
 }
 
 void
@@ -2070,8 +2618,11 @@ mem_write_raml(uint32_t addr, uint32_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_raml_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
+        mem_snap_mark(addr);
+        mem_snap_mark(addr + 3);
         *(uint32_t *) &ram[addr] = val;
+    }
 }
 
 static uint8_t
@@ -2136,8 +2687,10 @@ mem_write_remapped(uint32_t addr, uint8_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramb_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
+        mem_snap_mark(addr);
         ram[addr] = val;
+    }
 }
 
 static void
@@ -2148,8 +2701,11 @@ mem_write_remappedw(uint32_t addr, uint16_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramw_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
+        mem_snap_mark(addr);
+        mem_snap_mark(addr + 1);
         *(uint16_t *) &ram[addr] = val;
+    }
 }
 
 static void
@@ -2160,8 +2716,11 @@ mem_write_remappedl(uint32_t addr, uint32_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_raml_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
+        mem_snap_mark(addr);
+        mem_snap_mark(addr + 3);
         *(uint32_t *) &ram[addr] = val;
+    }
 }
 
 static void
@@ -2172,8 +2731,10 @@ mem_write_remapped2(uint32_t addr, uint8_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramb_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
+        mem_snap_mark(addr);
         ram[addr] = val;
+    }
 }
 
 static void
@@ -2184,8 +2745,11 @@ mem_write_remappedw2(uint32_t addr, uint16_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramw_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
+        mem_snap_mark(addr);
+        mem_snap_mark(addr + 1);
         *(uint16_t *) &ram[addr] = val;
+    }
 }
 
 static void
@@ -2196,8 +2760,11 @@ mem_write_remappedl2(uint32_t addr, uint32_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_raml_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
+        mem_snap_mark(addr);
+        mem_snap_mark(addr + 3);
         *(uint32_t *) &ram[addr] = val;
+    }
 }
 
 void
@@ -2714,6 +3281,8 @@ mem_close(void)
     }
 
     base_mapping = last_mapping = 0;
+
+    mem_snap_untrack();
 }
 
 static void
@@ -2770,6 +3339,9 @@ mem_reset(void)
         ram_size = 0;
     }
 
+    /* The page tracking belongs to the old RAM block. */
+    mem_snap_untrack();
+
     m = 1024UL * (size_t) mem_size;
 
     ram_size = m;
@@ -3099,3 +3671,173 @@ mem_a20_recalc(void)
 
     mem_a20_state = state;
 }
+
+/* Start tracking the pages written from now on, for the next incremental
+   snapshot. The direct write lookups are flushed, so that the first write
+   to each page goes through the write handlers again and marks it. */
+static void
+mem_snap_track(void)
+{
+    size_t len = ((ram_size >> 12) + 7) >> 3;
+
+    if (mem_snap_dirty_len != len)
+        mem_snap_untrack();
+    if (mem_snap_dirty == NULL) {
+        mem_snap_dirty = (uint8_t *) malloc(len);
+        if (mem_snap_dirty == NULL) {
+            pclog("Unable to allocate the snapshot page map, incremental snapshots are disabled\n");
+            return;
+        }
+        mem_snap_dirty_len = len;
+    }
+    memset(mem_snap_dirty, 0x00, len);
+
+    flushmmucache_write();
+}
+
+static int
+mem_page_is_zero(const uint64_t *p)
+{
+    for (int i = 0; i < 512; i++) {
+        if (p[i])
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Save the RAM contents, memory states and mapping layout to a snapshot.
+   A full save skips all-zero pages, which keeps snapshots of mostly idle
+   RAM small, a delta save only has the pages written since the last save. */
+static void
+mem_save_state_common(snapshot_t *snap, uint8_t delta)
+{
+    uint64_t       size  = ram_size;
+    uint32_t       pages_no;
+    uint32_t       count = 0;
+    uint32_t       end   = 0xffffffff;
+    mem_mapping_t *map;
+
+    snapshot_write_var(snap, size);
+    snapshot_write_var(snap, delta);
+
+    pages_no = (uint32_t) (ram_size >> 12);
+    for (uint32_t c = 0; c < pages_no; c++) {
+        const uint64_t *p = (uint64_t *) &ram[(uint64_t) c << 12];
+
+        if (delta ? (mem_snap_dirty[c >> 3] & (1 << (c & 7))) : !mem_page_is_zero(p)) {
+            snapshot_write_var(snap, c);
+            snapshot_write(snap, p, 4096);
+        }
+    }
+    snapshot_write_var(snap, end);
+
+    snapshot_write(snap, _mem_state, sizeof(_mem_state));
+    snapshot_write(snap, _mem_wp, sizeof(_mem_wp));
+    snapshot_write(snap, _mem_wp_bus, sizeof(_mem_wp_bus));
+
+    for (map = base_mapping; map != NULL; map = map->next)
+        count++;
+    snapshot_write_var(snap, count);
+
+    /* The mappings are registered in the same order by the same configuration,
+       so only their placement has to be saved. */
+    for (map = base_mapping; map != NULL; map = map->next) {
+        snapshot_write_var(snap, map->enable);
+        snapshot_write_var(snap, map->base);
+        snapshot_write_var(snap, map->size);
+        snapshot_write_var(snap, map->base_ignore);
+        snapshot_write_var(snap, map->mask);
+        snapshot_write_var(snap, map->flags);
+    }
+
+    snapshot_write_var(snap, mem_a20_key);
+    snapshot_write_var(snap, mem_a20_alt);
+    snapshot_write_var(snap, mem_a20_chipset);
+    snapshot_write_var(snap, mem_a20_state);
+    snapshot_write_var(snap, rammask);
+
+    mem_snap_track();
+}
+
+void
+mem_save_state(snapshot_t *snap)
+{
+    mem_save_state_common(snap, 0);
+}
+
+/* Only valid after a full save or load, which starts the page tracking. */
+void
+mem_save_state_delta(snapshot_t *snap)
+{
+    if (mem_snap_dirty == NULL) {
+        snapshot_fail(snap, "no base snapshot for an incremental snapshot");
+        return;
+    }
+
+    mem_save_state_common(snap, 1);
+}
+
+void
+mem_load_state(snapshot_t *snap)
+{
+    uint64_t       size  = 0;
+    uint8_t        delta = 0;
+    uint32_t       page  = 0;
+    uint32_t       count = 0;
+    uint32_t       c     = 0;
+    mem_mapping_t *map;
+
+    snapshot_read_var(snap, size);
+    if (size != ram_size) {
+        snapshot_fail(snap, "RAM size mismatch");
+        return;
+    }
+
+    /* A delta only patches the pages that changed since its parent. */
+    if (snapshot_read_var(snap, delta))
+        return;
+    if (!delta)
+        memset(ram, 0x00, ram_size);
+    while (!snapshot_read_var(snap, page) && (page != 0xffffffff)) {
+        if (page >= (ram_size >> 12)) {
+            snapshot_fail(snap, "RAM page out of range");
+            return;
+        }
+        snapshot_read(snap, &ram[(uint64_t) page << 12], 4096);
+    }
+
+    snapshot_read(snap, _mem_state, sizeof(_mem_state));
+    snapshot_read(snap, _mem_wp, sizeof(_mem_wp));
+    snapshot_read(snap, _mem_wp_bus, sizeof(_mem_wp_bus));
+
+    for (map = base_mapping; map != NULL; map = map->next)
+        c++;
+    snapshot_read_var(snap, count);
+    if (count != c) {
+        snapshot_fail(snap, "memory mapping layout mismatch");
+        return;
+    }
+
+    for (map = base_mapping; map != NULL; map = map->next) {
+        snapshot_read_var(snap, map->enable);
+        snapshot_read_var(snap, map->base);
+        snapshot_read_var(snap, map->size);
+        snapshot_read_var(snap, map->base_ignore);
+        snapshot_read_var(snap, map->mask);
+        snapshot_read_var(snap, map->flags);
+    }
+
+    snapshot_read_var(snap, mem_a20_key);
+    snapshot_read_var(snap, mem_a20_alt);
+    snapshot_read_var(snap, mem_a20_chipset);
+    snapshot_read_var(snap, mem_a20_state);
+    snapshot_read_var(snap, rammask);
+
+    mem_mapping_recalc(0x0000000000000000ULL, 0x0000000100000000ULL);
+
+    resetreadlookup();
+    flushmmucache();
+
+    mem_snap_track();
+}
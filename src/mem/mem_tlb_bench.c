@@ -0,0 +1,164 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Soft TLB benchmark.
+ *
+ *          --tlbbench replays synthetic page traces through the soft TLB
+ *          at every size from MMU_TLB_MIN to 16384 entries, and reports
+ *          the time per access along with the number of misses. A hit is
+ *          the same readlookup2 check the CPU does inline, a miss walks
+ *          a two level page table in host memory and then goes through
+ *          addreadlookup(), and flushes go through flushmmucache_nopc(),
+ *          so the cost of clearing the entries in use at each flush is
+ *          included.
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+#include <86box/plat.h>
+
+#define BENCH_ACCESSES (8 << 20)
+#define BENCH_HOT      64    /* pages of code, stack and kernel data */
+#define BENCH_RANDOM   4096  /* pages of random accesses, 16 MB */
+#define BENCH_TLB_MAX  16384
+
+static const uint32_t bench_flush_every[] = { 2500, 25000, 250000 };
+static const uint32_t bench_working_set[] = { 256, 1024, 4096 };
+
+static uint32_t bench_seed;
+static uint32_t bench_dir[1024];
+static uint32_t *bench_tables;
+
+static uint32_t
+bench_rand(void)
+{
+    bench_seed = (bench_seed * 1103515245u) + 12345u;
+
+    return bench_seed >> 8;
+}
+
+/* Half the accesses go to the hot pages, 45% sweep over the working set
+   four pages at a time, and the rest are random. Pages are spread out over
+   the address space, as they are in a guest. */
+static void
+bench_trace(uint32_t *trace, uint32_t working_set)
+{
+    for (uint32_t i = 0; i < BENCH_ACCESSES; i++) {
+        uint32_t kind = bench_rand() % 20;
+
+        if (kind < 10)
+            trace[i] = 0xc0000 + (bench_rand() % BENCH_HOT);
+        else if (kind < 19)
+            trace[i] = 0x00400 + ((i >> 2) % working_set);
+        else
+            trace[i] = 0x10000 + ((bench_rand() % BENCH_RANDOM) << 2);
+    }
+}
+
+/* Two dependent loads and the accessed bit, as mmutranslatereal() does. */
+static __inline uint32_t
+bench_walk(uint32_t page)
+{
+    uint32_t *entry = &bench_tables[bench_dir[page >> 10] + (page & 0x3ff)];
+
+    *entry |= 0x20;
+
+    return *entry & ~0xfff;
+}
+
+static double
+bench_run(const uint32_t *trace, uint32_t flush_every, uint64_t *misses)
+{
+    uintptr_t sum   = 0;
+    uint32_t  flush = flush_every;
+    uint64_t  start;
+    uint64_t  miss  = 0;
+    uint32_t  page;
+
+    resetreadlookup();
+
+    start = plat_timer_read();
+    for (uint32_t i = 0; i < BENCH_ACCESSES; i++) {
+        page = trace[i];
+
+        if (readlookup2[page] == (uintptr_t) LOOKUP_INV) {
+            addreadlookup(page << 12, bench_walk(page));
+            miss++;
+        }
+        sum += readlookup2[page];
+
+        if (--flush == 0) {
+            flushmmucache_nopc();
+            flush = flush_every;
+        }
+    }
+    start = plat_timer_read() - start;
+
+    /* Keep the lookups from being optimized away. */
+    if (sum == 1)
+        always_log("\n");
+
+    *misses = miss;
+
+    return ((double) start * 1000000000.0) / ((double) plat_timer_freq() * BENCH_ACCESSES);
+}
+
+/* Returns 0, so that the emulator exits. */
+int
+mem_tlb_bench(void)
+{
+    uint32_t *trace;
+    uint64_t  misses;
+    double    ns;
+    int       old_size = mem_tlb_size;
+
+    trace        = malloc(BENCH_ACCESSES * sizeof(uint32_t));
+    bench_tables = malloc(1024 * 1024 * sizeof(uint32_t));
+    if ((trace == NULL) || (bench_tables == NULL))
+        fatal("TLB benchmark: out of memory\n");
+
+    /* Page tables scattered the way an allocator would hand them out. */
+    bench_seed = 1;
+    for (uint32_t i = 0; i < 1024; i++)
+        bench_dir[i] = ((i * 389) & 0x3ff) << 10;
+    for (uint32_t i = 0; i < (1024 * 1024); i++)
+        bench_tables[i] = (bench_rand() << 12) | 0x07;
+
+    always_log("TLB benchmark: %u accesses per run, ns per access (misses in thousands)\n",
+               BENCH_ACCESSES);
+
+    for (size_t f = 0; f < (sizeof(bench_flush_every) / sizeof(bench_flush_every[0])); f++) {
+        for (size_t w = 0; w < (sizeof(bench_working_set) / sizeof(bench_working_set[0])); w++) {
+            bench_seed = 1;
+            bench_trace(trace, bench_working_set[w]);
+
+            always_log("flush every %6u, %4u pages:", bench_flush_every[f], bench_working_set[w]);
+            for (mem_tlb_size = MMU_TLB_MIN; mem_tlb_size <= BENCH_TLB_MAX; mem_tlb_size <<= 1) {
+                ns = bench_run(trace, bench_flush_every[f], &misses);
+                always_log(" %5i: %5.2f (%5llu)", mem_tlb_size, ns,
+                           (unsigned long long) (misses / 1000));
+            }
+            always_log("\n");
+        }
+    }
+
+    mem_tlb_size = old_size;
+    resetreadlookup();
+
+    free(bench_tables);
+    bench_tables = NULL;
+    free(trace);
+
+    return 0;
+}
@@ -218,6 +218,7 @@
  *   USA.
  */
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -236,6 +237,7 @@
 #include <86box/rom.h>
 #include <86box/device.h>
 #include <86box/nvr.h>
+#include <86box/snapshot.h>
 
 /* RTC registers and bit definitions. */
 #define RTC_SECONDS                  0
@@ -1238,6 +1240,63 @@ nvr_at_close(void *priv)
         nvr_at_inited = 0;
 }
 
+/* The registers, the chip state up to the lock table pointer, the lock
+   table and the internal clock, which carries the time across seconds. */
+static void
+nvr_at_save(void *priv, snapshot_t *snap)
+{
+    nvr_t    *nvr   = (nvr_t *) priv;
+    local_t  *local = (local_t *) nvr->data;
+    struct tm tm;
+    int32_t   clk[6];
+
+    nvr_time_get(&tm);
+    clk[0] = tm.tm_sec;
+    clk[1] = tm.tm_min;
+    clk[2] = tm.tm_hour;
+    clk[3] = tm.tm_mday;
+    clk[4] = tm.tm_mon;
+    clk[5] = tm.tm_year;
+
+    snapshot_write(snap, nvr->regs, nvr->size);
+    snapshot_write_var(snap, nvr->onesec_cnt);
+    timer_save_state(snap, &nvr->onesec_time);
+    snapshot_write(snap, local, offsetof(local_t, lock));
+    snapshot_write(snap, local->lock, nvr->size);
+    snapshot_write(snap, &local->count, offsetof(local_t, update_timer) - offsetof(local_t, count));
+    timer_save_state(snap, &local->update_timer);
+    timer_save_state(snap, &local->rtc_timer);
+    snapshot_write_var(snap, clk);
+}
+
+static void
+nvr_at_load(void *priv, snapshot_t *snap)
+{
+    nvr_t    *nvr   = (nvr_t *) priv;
+    local_t  *local = (local_t *) nvr->data;
+    struct tm tm    = { 0 };
+    int32_t   clk[6];
+
+    snapshot_read(snap, nvr->regs, nvr->size);
+    snapshot_read_var(snap, nvr->onesec_cnt);
+    timer_load_state(snap, &nvr->onesec_time);
+    snapshot_read(snap, local, offsetof(local_t, lock));
+    snapshot_read(snap, local->lock, nvr->size);
+    snapshot_read(snap, &local->count, offsetof(local_t, update_timer) - offsetof(local_t, count));
+    timer_load_state(snap, &local->update_timer);
+    timer_load_state(snap, &local->rtc_timer);
+    if (snapshot_read_var(snap, clk))
+        return;
+
+    tm.tm_sec  = clk[0];
+    tm.tm_min  = clk[1];
+    tm.tm_hour = clk[2];
+    tm.tm_mday = clk[3];
+    tm.tm_mon  = clk[4];
+    tm.tm_year = clk[5];
+    nvr_time_set(&tm);
+}
+
 const device_t nvr_at_device = {
     .name          = "PC/AT NVRAM",
     .internal_name = "at_nvr_old",
@@ -1249,5 +1308,7 @@ const device_t nvr_at_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = nvr_at_save,
+    .load          = nvr_at_load
 };
@@ -17,6 +17,7 @@
  */
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -35,6 +36,7 @@
 #include <86box/device.h>
 #include <86box/apm.h>
 #include <86box/nvr.h>
+#include <86box/snapshot.h>
 #include <86box/acpi.h>
 #include <86box/plat_unused.h>
 
@@ -926,3 +928,42 @@ picinterrupt(void)
 
     return ret;
 }
+
+void
+pic_save_state(snapshot_t *snap)
+{
+    /* The slave pointers are fixed by the machine and are not saved. */
+    snapshot_write(snap, &pic, offsetof(pic_t, slaves));
+    snapshot_write(snap, &pic2, offsetof(pic_t, slaves));
+
+    snapshot_write_var(snap, shadow);
+    snapshot_write_var(snap, elcr_enabled);
+    snapshot_write_var(snap, pic_pci);
+    snapshot_write_var(snap, kbd_latch);
+    snapshot_write_var(snap, mouse_latch);
+    snapshot_write_var(snap, smi_irq_mask);
+    snapshot_write_var(snap, smi_irq_status);
+    snapshot_write_var(snap, latched_irqs);
+
+    timer_save_state(snap, &pic_timer);
+}
+
+void
+pic_load_state(snapshot_t *snap)
+{
+    snapshot_read(snap, &pic, offsetof(pic_t, slaves));
+    snapshot_read(snap, &pic2, offsetof(pic_t, slaves));
+
+    snapshot_read_var(snap, shadow);
+    snapshot_read_var(snap, elcr_enabled);
+    snapshot_read_var(snap, pic_pci);
+    snapshot_read_var(snap, kbd_latch);
+    snapshot_read_var(snap, mouse_latch);
+    snapshot_read_var(snap, smi_irq_mask);
+    snapshot_read_var(snap, smi_irq_status);
+    snapshot_read_var(snap, latched_irqs);
+
+    timer_load_state(snap, &pic_timer);
+
+    update_pending();
+}
@@ -16,6 +16,7 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -36,6 +37,7 @@
 #include <86box/pit_fast.h>
 #include <86box/ppi.h>
 #include <86box/machine.h>
+#include <86box/snapshot.h>
 #include <86box/sound.h>
 #include <86box/snd_speaker.h>
 #include <86box/video.h>
@@ -946,6 +948,32 @@ pit_close(void *priv)
         free(dev);
 }
 
+/* Only the counter state up to the callbacks is saved, those are set up
+   by whoever owns the PIT and are still valid in the running machine. */
+static void
+pit_save(void *priv, snapshot_t *snap)
+{
+    pit_t *dev = (pit_t *) priv;
+
+    for (int i = 0; i < NUM_COUNTERS; i++)
+        snapshot_write(snap, &dev->counters[i], offsetof(ctr_t, load_func));
+    snapshot_write_var(snap, dev->ctrl);
+    snapshot_write_var(snap, dev->clock);
+    timer_save_state(snap, &dev->callback_timer);
+}
+
+static void
+pit_load(void *priv, snapshot_t *snap)
+{
+    pit_t *dev = (pit_t *) priv;
+
+    for (int i = 0; i < NUM_COUNTERS; i++)
+        snapshot_read(snap, &dev->counters[i], offsetof(ctr_t, load_func));
+    snapshot_read_var(snap, dev->ctrl);
+    snapshot_read_var(snap, dev->clock);
+    timer_load_state(snap, &dev->callback_timer);
+}
+
 static void *
 pit_init(const device_t *info)
 {
@@ -983,7 +1011,9 @@ const device_t i8253_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = pit_save,
+    .load          = pit_load
 };
 
 const device_t i8253_ext_io_device = {
@@ -997,7 +1027,9 @@ const device_t i8253_ext_io_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = pit_save,
+    .load          = pit_load
 };
 
 const device_t i8254_device = {
@@ -1011,7 +1043,9 @@ const device_t i8254_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = pit_save,
+    .load          = pit_load
 };
 
 const device_t i8254_sec_device = {
@@ -1025,7 +1059,9 @@ const device_t i8254_sec_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = pit_save,
+    .load          = pit_load
 };
 
 const device_t i8254_ext_io_device = {
@@ -1039,7 +1075,9 @@ const device_t i8254_ext_io_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = pit_save,
+    .load          = pit_load
 };
 
 const device_t i8254_ps2_device = {
@@ -1053,7 +1091,9 @@ const device_t i8254_ps2_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = pit_save,
+    .load          = pit_load
 };
 
 pit_t *
@@ -16,6 +16,7 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -36,6 +37,7 @@
 #include <86box/pit_fast.h>
 #include <86box/ppi.h>
 #include <86box/machine.h>
+#include <86box/snapshot.h>
 #include <86box/sound.h>
 #include <86box/snd_speaker.h>
 #include <86box/video.h>
@@ -714,6 +716,32 @@ pitf_handler(int set, uint16_t base, int size, void *priv)
     io_handler(set, base, size, pitf_read, NULL, NULL, pitf_write, NULL, NULL, priv);
 }
 
+/* Only the counter state up to the PIT constant is saved, the constant and
+   the callbacks belong to the running machine. */
+static void
+pitf_save(void *priv, snapshot_t *snap)
+{
+    pitf_t *dev = (pitf_t *) priv;
+
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        snapshot_write(snap, &dev->counters[i], offsetof(ctrf_t, pit_const));
+        timer_save_state(snap, &dev->counters[i].timer);
+    }
+    snapshot_write_var(snap, dev->ctrl);
+}
+
+static void
+pitf_load(void *priv, snapshot_t *snap)
+{
+    pitf_t *dev = (pitf_t *) priv;
+
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        snapshot_read(snap, &dev->counters[i], offsetof(ctrf_t, pit_const));
+        timer_load_state(snap, &dev->counters[i].timer);
+    }
+    snapshot_read_var(snap, dev->ctrl);
+}
+
 static void *
 pitf_init(const device_t *info)
 {
@@ -752,7 +780,9 @@ const device_t i8253_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = pitf_save,
+    .load          = pitf_load
 };
 
 const device_t i8253_ext_io_fast_device = {
@@ -766,7 +796,9 @@ const device_t i8253_ext_io_fast_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = pitf_save,
+    .load          = pitf_load
 };
 
 const device_t i8254_fast_device = {
@@ -780,7 +812,9 @@ const device_t i8254_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = pitf_save,
+    .load          = pitf_load
 };
 
 const device_t i8254_sec_fast_device = {
@@ -794,7 +828,9 @@ const device_t i8254_sec_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = pitf_save,
+    .load          = pitf_load
 };
 
 const device_t i8254_ext_io_fast_device = {
@@ -808,7 +844,9 @@ const device_t i8254_ext_io_fast_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = pitf_save,
+    .load          = pitf_load
 };
 
 const device_t i8254_ps2_fast_device = {
@@ -822,7 +860,9 @@ const device_t i8254_ps2_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = pitf_save,
+    .load          = pitf_load
 };
 
 const pit_intf_t pit_fast_intf = {
@@ -38,6 +38,7 @@
 #include <86box/port_6x.h>
 #include <86box/plat_unused.h>
 #include <86box/random.h>
+#include <86box/snapshot.h>
 
 #define PS2_REFRESH_TIME (16 * TIMER_USEC)
 
@@ -176,6 +177,43 @@ port_6x_close(void *priv)
     free(dev);
 }
 
+/* Port 61h lives in the PPI and speaker globals, save those along with the
+   refresh toggle. */
+static void
+port_6x_save(void *priv, snapshot_t *snap)
+{
+    port_6x_t *dev   = (port_6x_t *) priv;
+    uint8_t    turbo = (dev->flags & PORT_6X_TURBO) ? xi8088_turbo_get() : 0;
+
+    snapshot_write_var(snap, dev->refresh);
+    snapshot_write_var(snap, ppi.pb);
+    snapshot_write_var(snap, ppispeakon);
+    snapshot_write_var(snap, speaker_gated);
+    snapshot_write_var(snap, speaker_enable);
+    snapshot_write_var(snap, was_speaker_enable);
+    snapshot_write_var(snap, turbo);
+    timer_save_state(snap, &dev->refresh_timer);
+}
+
+static void
+port_6x_load(void *priv, snapshot_t *snap)
+{
+    port_6x_t *dev   = (port_6x_t *) priv;
+    uint8_t    turbo = 0;
+
+    snapshot_read_var(snap, dev->refresh);
+    snapshot_read_var(snap, ppi.pb);
+    snapshot_read_var(snap, ppispeakon);
+    snapshot_read_var(snap, speaker_gated);
+    snapshot_read_var(snap, speaker_enable);
+    snapshot_read_var(snap, was_speaker_enable);
+    snapshot_read_var(snap, turbo);
+    timer_load_state(snap, &dev->refresh_timer);
+
+    if ((dev->flags & PORT_6X_TURBO) && !snapshot_failed(snap))
+        xi8088_turbo_set(turbo);
+}
+
 void *
 port_6x_init(const device_t *info)
 {
@@ -217,7 +255,9 @@ const device_t port_6x_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = port_6x_save,
+    .load          = port_6x_load
 };
 
 const device_t port_6x_xi8088_device = {
@@ -231,7 +271,9 @@ const device_t port_6x_xi8088_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = port_6x_save,
+    .load          = port_6x_load
 };
 
 const device_t port_6x_ps2_device = {
@@ -245,7 +287,9 @@ const device_t port_6x_ps2_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = port_6x_save,
+    .load          = port_6x_load
 };
 
 const device_t port_6x_olivetti_device = {
@@ -259,5 +303,7 @@ const device_t port_6x_olivetti_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = port_6x_save,
+    .load          = port_6x_load
 };
@@ -29,6 +29,7 @@
 #include <86box/port_92.h>
 #include <86box/plat_unused.h>
 #include <86box/machine.h>
+#include <86box/snapshot.h>
 
 #define PORT_92_INV   1
 #define PORT_92_WORD  2
@@ -202,6 +203,31 @@ port_92_close(void *priv)
     free(dev);
 }
 
+/* The A20 gate itself is part of the memory state. */
+static void
+port_92_save(void *priv, snapshot_t *snap)
+{
+    port_92_t *dev = (port_92_t *) priv;
+
+    snapshot_write_var(snap, dev->reg);
+    snapshot_write_var(snap, dev->flags);
+    snapshot_write_var(snap, dev->pulse_period);
+    snapshot_write_var(snap, cpu_alt_reset);
+    timer_save_state(snap, &dev->pulse_timer);
+}
+
+static void
+port_92_load(void *priv, snapshot_t *snap)
+{
+    port_92_t *dev = (port_92_t *) priv;
+
+    snapshot_read_var(snap, dev->reg);
+    snapshot_read_var(snap, dev->flags);
+    snapshot_read_var(snap, dev->pulse_period);
+    snapshot_read_var(snap, cpu_alt_reset);
+    timer_load_state(snap, &dev->pulse_timer);
+}
+
 void *
 port_92_init(const device_t *info)
 {
@@ -239,7 +265,9 @@ const device_t port_92_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = port_92_save,
+    .load          = port_92_load
 };
 
 const device_t port_92_key_device = {
@@ -253,7 +281,9 @@ const device_t port_92_key_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = port_92_save,
+    .load          = port_92_load
 };
 
 const device_t port_92_inv_device = {
@@ -267,7 +297,9 @@ const device_t port_92_inv_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = port_92_save,
+    .load          = port_92_load
 };
 
 const device_t port_92_word_device = {
@@ -281,7 +313,9 @@ const device_t port_92_word_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = port_92_save,
+    .load          = port_92_load
 };
 
 const device_t port_92_pci_device = {
@@ -295,5 +329,7 @@ const device_t port_92_pci_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save          = port_92_save,
+    .load          = port_92_load
 };
@@ -1184,6 +1184,18 @@ MainWindow::on_actionHard_Reset_triggered()
     pc_reset_hard();
 }
 
+void
+MainWindow::on_actionSave_state_triggered()
+{
+    pc_snapshot_save();
+}
+
+void
+MainWindow::on_actionLoad_state_triggered()
+{
+    pc_snapshot_load();
+}
+
 void
 MainWindow::on_actionCtrl_Alt_Del_triggered()
 {
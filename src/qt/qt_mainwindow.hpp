@@ -91,6 +91,8 @@ private slots:
     void on_actionCtrl_Alt_Del_triggered();
     void on_actionCtrl_Alt_Esc_triggered();
     void on_actionHard_Reset_triggered();
+    void on_actionSave_state_triggered();
+    void on_actionLoad_state_triggered();
     void on_actionRight_CTRL_is_left_ALT_triggered();
     void on_actionKeyboard_requires_capture_triggered();
     void on_actionResizable_window_triggered(bool checked);
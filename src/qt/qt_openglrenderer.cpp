@@ -1152,26 +1152,35 @@ OpenGLRenderer::finalize()
 extern void take_screenshot_clipboard_monitor(int sx, int sy, int sw, int sh, int i);
 
 void
-OpenGLRenderer::onBlit(int buf_idx, int x, int y, int w, int h)
+OpenGLRenderer::onBlit(int buf_idx, int x, int y, int w, int h, int dirty_y, int dirty_h)
 {
-    if (notReady())
+    if (notReady()) {
+        /* The texture missed these lines, have the next frame sent whole. */
+        video_blit_invalidate_monitor(r_monitor_index);
         return;
+    }
 
     context->makeCurrent(this);
 
+    /* The texture keeps the previous frame, only the lines that changed since
+       need uploading, unless it has to be reallocated. */
     if (source.width() != w || source.height() != h) {
         glw.glBindTexture(GL_TEXTURE_2D, scene_texture.id);
         glw.glTexImage2D(GL_TEXTURE_2D, 0, (GLenum) QOpenGLTexture::RGB8_UNorm, w, h, 0, (GLenum) QOpenGLTexture::BGRA, (GLenum) QOpenGLTexture::UInt32_RGBA8_Rev, NULL);
         glw.glBindTexture(GL_TEXTURE_2D, 0);
+        dirty_y = y;
+        dirty_h = h;
     }
 
     source.setRect(x, y, w, h);
 
-    glw.glBindTexture(GL_TEXTURE_2D, scene_texture.id);
-    glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, 2048);
-    glw.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, (GLenum) QOpenGLTexture::BGRA, (GLenum) QOpenGLTexture::UInt32_RGBA8_Rev, (const void *) ((uintptr_t) imagebufs[buf_idx].get() + (uintptr_t) (2048 * 4 * y + x * 4)));
-    glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-    glw.glBindTexture(GL_TEXTURE_2D, 0);
+    if (dirty_h > 0) {
+        glw.glBindTexture(GL_TEXTURE_2D, scene_texture.id);
+        glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, 2048);
+        glw.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, dirty_y - y, w, dirty_h, (GLenum) QOpenGLTexture::BGRA, (GLenum) QOpenGLTexture::UInt32_RGBA8_Rev, (const void *) ((uintptr_t) imagebufs[buf_idx].get() + (uintptr_t) (2048 * 4 * dirty_y + x * 4)));
+        glw.glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glw.glBindTexture(GL_TEXTURE_2D, 0);
+    }
 
     buf_usage[buf_idx].clear();
     source.setRect(x, y, w, h);
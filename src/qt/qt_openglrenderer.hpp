@@ -74,7 +74,7 @@ signals:
     void errorInitializing();
 
 public slots:
-    void onBlit(int buf_idx, int x, int y, int w, int h);
+    void onBlit(int buf_idx, int x, int y, int w, int h, int dirty_y, int dirty_h);
 
 protected:
     void exposeEvent(QExposeEvent *event) override;
@@ -230,7 +230,13 @@ plat_get_ticks(void)
 uint64_t
 plat_timer_read(void)
 {
-    return elapsed_timer.elapsed();
+    return elapsed_timer.nsecsElapsed();
+}
+
+uint64_t
+plat_timer_freq(void)
+{
+    return 1000000000ULL;
 }
 
 FILE *
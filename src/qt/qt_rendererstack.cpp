@@ -30,6 +30,7 @@
 
 #include "evdev_mouse.hpp"
 
+#include <algorithm>
 #include <cmath>
 
 #include <atomic>
@@ -502,10 +503,48 @@ take_screenshot_clipboard_monitor(int sx, int sy, int sw, int sh, int i)
     monitors[i].mon_screenshots_raw_clipboard--;
 }
 
+static std::pair<int, int>
+dirty_unite(const std::pair<int, int> &a, const std::pair<int, int> &b)
+{
+    if (a.first >= a.second)
+        return b;
+    if (b.first >= b.second)
+        return a;
+    return { std::min(a.first, b.first), std::max(a.second, b.second) };
+}
+
 // called from blitter thread
 void
 RendererStack::blit(int x, int y, int w, int h)
 {
+    std::pair<int, int> dirty;
+    bool                buffersChanged = (dirtyBufs.size() != imagebufs.size());
+
+    for (size_t i = 0; !buffersChanged && (i < imagebufs.size()); i++)
+        buffersChanged = (dirtyBufs[i] != std::get<uint8_t *>(imagebufs[i]));
+
+    /* New buffers have nothing in them yet. */
+    if (buffersChanged) {
+        dirtyBufs.clear();
+        for (auto &buf : imagebufs)
+            dirtyBufs.push_back(std::get<uint8_t *>(buf));
+        bufDirty.assign(imagebufs.size(), { 0, 2048 });
+        uploadDirty = { 0, 2048 };
+    }
+
+    /* Every buffer has to catch up with the lines this frame changed, even if
+       it is dropped below. */
+    video_blit_get_dirty_monitor(m_monitor_index, &dirty.first, &dirty.second);
+    for (auto &range : bufDirty)
+        range = dirty_unite(range, dirty);
+    uploadDirty = dirty_unite(uploadDirty, dirty);
+
+    /* Same frame as the one the renderer already has, nothing to do. */
+    if ((uploadDirty.first >= uploadDirty.second) && (x == sx) && (y == sy) && (w == sw) && (h == sh)) {
+        video_blit_complete_monitor(m_monitor_index);
+        return;
+    }
+
     if ((x < 0) || (y < 0) || (w <= 0) || (h <= 0) || (w > 2048) || (h > 2048) || ((w + y) > 2048) || ((h + x) > 2048) || (switchInProgress) || (monitors[m_monitor_index].target_buffer == NULL) || imagebufs.empty() || std::get<std::atomic_flag *>(imagebufs[currentBuf])->test_and_set()) {
         video_blit_complete_monitor(m_monitor_index);
         return;
@@ -515,17 +554,22 @@ RendererStack::blit(int x, int y, int w, int h)
     sw = this->w = w;
     sh = this->h       = h;
     uint8_t *imagebits = std::get<uint8_t *>(imagebufs[currentBuf]);
-    for (int y1 = y; y1 < (y + h); y1++) {
+    for (int y1 = std::max(y, bufDirty[currentBuf].first); y1 < std::min(y + h, bufDirty[currentBuf].second); y1++) {
         auto scanline = imagebits + (y1 * rendererWindow->getBytesPerRow()) + (x * 4);
         video_copy(scanline, &(monitors[m_monitor_index].target_buffer->line[y1][x]), w * 4);
     }
+    bufDirty[currentBuf] = { 0, 0 };
 
     if (monitors[m_monitor_index].mon_screenshots_raw) {
         video_screenshot_monitor((uint32_t *) imagebits, x, y, 2048, m_monitor_index);
     }
     video_blit_complete_monitor(m_monitor_index);
     screenshot_buf = (uint32_t *) imagebits;
-    emit blitToRenderer(currentBuf, sx, sy, sw, sh);
+
+    dirty.first  = std::max(y, uploadDirty.first);
+    dirty.second = std::min(y + h, uploadDirty.second);
+    uploadDirty  = { 0, 0 };
+    emit blitToRenderer(currentBuf, sx, sy, sw, sh, dirty.first, std::max(0, dirty.second - dirty.first));
     currentBuf = (currentBuf + 1) % imagebufs.size();
 }
 
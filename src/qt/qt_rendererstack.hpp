@@ -13,6 +13,7 @@
 #include <atomic>
 #include <memory>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include "qt_renderercommon.hpp"
@@ -108,7 +109,7 @@ public:
     void (*mouse_exit_func)() = nullptr;
 
 signals:
-    void blitToRenderer(int buf_idx, int x, int y, int w, int h);
+    void blitToRenderer(int buf_idx, int x, int y, int w, int h, int dirty_y, int dirty_h);
     void rendererChanged();
 
 public slots:
@@ -136,6 +137,13 @@ private:
 
     std::vector<std::tuple<uint8_t *, std::atomic_flag *>> imagebufs;
 
+    /* Lines each image buffer is missing from the frames blitted since it was
+       last filled, and lines changed since the last frame handed over to the
+       renderer, as [first, last) pairs. */
+    std::vector<uint8_t *>           dirtyBufs;
+    std::vector<std::pair<int, int>> bufDirty;
+    std::pair<int, int>              uploadDirty { 0, 0 };
+
     RendererCommon          *rendererWindow { nullptr };
     std::unique_ptr<QWidget> current;
 
@@ -817,6 +817,10 @@ scsi_disk_blocks(scsi_disk_t *dev, int32_t *len, const int out)
                           "Read", *len);
 
             dev->sector_len -= dev->requested_blocks;
+
+            /* Start fetching the next chunk while this one is transferred. */
+            if (!out && (dev->sector_len > 0))
+                hdd_image_prefetch(dev->id, dev->sector_pos, dev->sector_len);
         }
     } else {
         scsi_disk_command_complete(dev);
@@ -0,0 +1,577 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Implementation of the machine snapshot (save state) module.
+ *
+ *          The core machine state (CPU, memory, PIC, DMA) is always
+ *          saved, everything else is saved per device, through the
+ *          save/load handlers in device_t. A machine with a device that
+ *          has no handlers can not be saved or restored, as the device
+ *          would not match the rest of the machine afterwards.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include "x86.h"
+#include "x87_sf.h"
+#include <86box/device.h>
+#include <86box/dma.h>
+#include <86box/machine.h>
+#include <86box/mem.h>
+#include <86box/nmi.h>
+#include <86box/pic.h>
+#include <86box/plat.h>
+#include <86box/snapshot.h>
+#include <86box/timer.h>
+
+struct snapshot_t {
+    FILE    *fp;
+    int      failed;
+
+    /* Saving: offset of the current chunk header. */
+    int64_t  chunk_pos;
+
+    /* Loading: payload bytes left in the current chunk. */
+    uint64_t left;
+};
+
+#ifdef ENABLE_SNAPSHOT_LOG
+int snapshot_do_log = ENABLE_SNAPSHOT_LOG;
+
+static void
+snapshot_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (snapshot_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define snapshot_log(fmt, ...)
+#endif
+
+void
+snapshot_fail(snapshot_t *snap, const char *reason)
+{
+    if (!snap->failed)
+        pclog("SNAPSHOT: %s\n", reason);
+
+    snap->failed = 1;
+}
+
+int
+snapshot_failed(snapshot_t *snap)
+{
+    return snap->failed;
+}
+
+void
+snapshot_write(snapshot_t *snap, const void *data, size_t size)
+{
+    if (snap->failed || (size == 0))
+        return;
+
+    if (fwrite(data, 1, size, snap->fp) != size)
+        snapshot_fail(snap, "write error");
+}
+
+int
+snapshot_read(snapshot_t *snap, void *data, size_t size)
+{
+    if (snap->failed)
+        return -1;
+
+    if (size > snap->left) {
+        snapshot_fail(snap, "truncated chunk");
+        return -1;
+    }
+
+    if (fread(data, 1, size, snap->fp) != size) {
+        snapshot_fail(snap, "read error");
+        return -1;
+    }
+
+    snap->left -= size;
+
+    return 0;
+}
+
+uint64_t
+snapshot_left(snapshot_t *snap)
+{
+    return snap->left;
+}
+
+static void
+snapshot_put(snapshot_t *snap, uint64_t val, int bytes)
+{
+    uint8_t buf[8];
+
+    for (int i = 0; i < bytes; i++)
+        buf[i] = (val >> (i << 3)) & 0xff;
+
+    snapshot_write(snap, buf, bytes);
+}
+
+static uint64_t
+snapshot_get(snapshot_t *snap, int bytes)
+{
+    uint8_t  buf[8];
+    uint64_t val = 0;
+
+    if (fread(buf, 1, bytes, snap->fp) != (size_t) bytes) {
+        snapshot_fail(snap, "read error");
+        return 0;
+    }
+
+    for (int i = 0; i < bytes; i++)
+        val |= ((uint64_t) buf[i]) << (i << 3);
+
+    return val;
+}
+
+void
+snapshot_chunk_begin(snapshot_t *snap, uint32_t id, uint32_t instance)
+{
+    snap->chunk_pos = ftello64(snap->fp);
+
+    snapshot_put(snap, id, 4);
+    snapshot_put(snap, instance, 4);
+    snapshot_put(snap, 0, 8);
+}
+
+void
+snapshot_chunk_end(snapshot_t *snap)
+{
+    int64_t end = ftello64(snap->fp);
+
+    if (snap->failed)
+        return;
+
+    /* Go back and fill in the payload length. */
+    if (fseeko64(snap->fp, snap->chunk_pos + 8, SEEK_SET)) {
+        snapshot_fail(snap, "seek error");
+        return;
+    }
+    snapshot_put(snap, end - snap->chunk_pos - 16, 8);
+    if (fseeko64(snap->fp, end, SEEK_SET))
+        snapshot_fail(snap, "seek error");
+}
+
+static void
+snapshot_save_conf(snapshot_t *snap)
+{
+    const char *name = machine_get_internal_name();
+    uint32_t    len  = (uint32_t) strlen(name);
+
+    snapshot_write_var(snap, len);
+    snapshot_write(snap, name, len);
+    name = cpu_f->internal_name;
+    len  = (uint32_t) strlen(name);
+    snapshot_write_var(snap, len);
+    snapshot_write(snap, name, len);
+    snapshot_write_var(snap, cpu);
+    snapshot_write_var(snap, mem_size);
+}
+
+static int
+snapshot_check_string(snapshot_t *snap, const char *str)
+{
+    char     buf[256];
+    uint32_t len;
+
+    if (snapshot_read_var(snap, len) || (len >= sizeof(buf)) || snapshot_read(snap, buf, len))
+        return 0;
+    buf[len] = '\0';
+
+    return !strcmp(buf, str);
+}
+
+static void
+snapshot_load_conf(snapshot_t *snap)
+{
+    int      saved_cpu;
+    uint32_t saved_mem_size;
+
+    if (!snapshot_check_string(snap, machine_get_internal_name()) ||
+        !snapshot_check_string(snap, cpu_f->internal_name) ||
+        snapshot_read_var(snap, saved_cpu) || snapshot_read_var(snap, saved_mem_size) ||
+        (saved_cpu != cpu) || (saved_mem_size != mem_size))
+        snapshot_fail(snap, "snapshot was taken with a different configuration");
+}
+
+static void
+snapshot_save_cpu(snapshot_t *snap)
+{
+    snapshot_write_var(snap, cpu_state);
+    snapshot_write_var(snap, fpu_state);
+    snapshot_write_var(snap, cr2);
+    snapshot_write_var(snap, cr3);
+    snapshot_write_var(snap, cr4);
+    snapshot_write_var(snap, dr);
+    snapshot_write_var(snap, msr);
+    snapshot_write_var(snap, gdt);
+    snapshot_write_var(snap, ldt);
+    snapshot_write_var(snap, idt);
+    snapshot_write_var(snap, tr);
+    snapshot_write_var(snap, cpu_cur_status);
+    snapshot_write_var(snap, use32);
+    snapshot_write_var(snap, stack32);
+    snapshot_write_var(snap, ccr0);
+    snapshot_write_var(snap, ccr1);
+    snapshot_write_var(snap, ccr2);
+    snapshot_write_var(snap, ccr3);
+    snapshot_write_var(snap, ccr4);
+    snapshot_write_var(snap, ccr5);
+    snapshot_write_var(snap, ccr6);
+    snapshot_write_var(snap, ccr7);
+    snapshot_write_var(snap, cxpmr);
+    snapshot_write_var(snap, cyrix);
+    snapshot_write_var(snap, smi_latched);
+    snapshot_write_var(snap, smm_in_hlt);
+    snapshot_write_var(snap, smi_block);
+    snapshot_write_var(snap, nmi);
+    snapshot_write_var(snap, nmi_mask);
+    snapshot_write_var(snap, tsc);
+}
+
+static void
+snapshot_load_cpu(snapshot_t *snap)
+{
+    uint64_t new_tsc;
+
+    snapshot_read_var(snap, cpu_state);
+    snapshot_read_var(snap, fpu_state);
+    snapshot_read_var(snap, cr2);
+    snapshot_read_var(snap, cr3);
+    snapshot_read_var(snap, cr4);
+    snapshot_read_var(snap, dr);
+    snapshot_read_var(snap, msr);
+    snapshot_read_var(snap, gdt);
+    snapshot_read_var(snap, ldt);
+    snapshot_read_var(snap, idt);
+    snapshot_read_var(snap, tr);
+    snapshot_read_var(snap, cpu_cur_status);
+    snapshot_read_var(snap, use32);
+    snapshot_read_var(snap, stack32);
+    snapshot_read_var(snap, ccr0);
+    snapshot_read_var(snap, ccr1);
+    snapshot_read_var(snap, ccr2);
+    snapshot_read_var(snap, ccr3);
+    snapshot_read_var(snap, ccr4);
+    snapshot_read_var(snap, ccr5);
+    snapshot_read_var(snap, ccr6);
+    snapshot_read_var(snap, ccr7);
+    snapshot_read_var(snap, cxpmr);
+    snapshot_read_var(snap, cyrix);
+    snapshot_read_var(snap, smi_latched);
+    snapshot_read_var(snap, smm_in_hlt);
+    snapshot_read_var(snap, smi_block);
+    snapshot_read_var(snap, nmi);
+    snapshot_read_var(snap, nmi_mask);
+    if (snapshot_read_var(snap, new_tsc))
+        return;
+
+    /* The pointer in the saved state is meaningless, point it back at DS. */
+    cpu_state.ea_seg = &cpu_state.seg_ds;
+
+    /* Moves all the running timers along with the TSC, device timers are
+       restored relative to the new value afterwards. */
+    timer_set_new_tsc(new_tsc);
+}
+
+/* Incremental snapshots: a full snapshot starts a chain, each delta only
+   has the RAM pages written since the previous link and must be restored
+   in order on top of it. */
+static uint64_t chain_id    = 0;
+static uint32_t chain_seq   = 0;
+static int      chain_valid = 0;
+static char     chain_fn[1024];
+
+static void
+snapshot_delta_name(char *dest, size_t size, const char *fn, uint32_t seq)
+{
+    snprintf(dest, size, "%s.%04u", fn, seq);
+}
+
+static void
+snapshot_save_seq(snapshot_t *snap)
+{
+    snapshot_write_var(snap, chain_id);
+    snapshot_write_var(snap, chain_seq);
+}
+
+static void
+snapshot_load_seq(snapshot_t *snap, uint64_t *id, uint32_t *seq)
+{
+    if (snapshot_read(snap, id, sizeof(uint64_t)) || snapshot_read(snap, seq, sizeof(uint32_t)))
+        return;
+
+    /* A delta is only valid on top of the link right before it. */
+    if (*seq && (!chain_valid || (*id != chain_id) || (*seq != (chain_seq + 1))))
+        snapshot_fail(snap, "incremental snapshot does not follow the loaded one");
+}
+
+static void
+snapshot_save_chunk(snapshot_t *snap, uint32_t id, void (*func)(snapshot_t *snap))
+{
+    snapshot_chunk_begin(snap, id, 0);
+    if (func != NULL)
+        func(snap);
+    snapshot_chunk_end(snap);
+}
+
+static int
+snapshot_save_common(const char *fn, int delta)
+{
+    snapshot_t  snap = { 0 };
+    const char *name = device_find_unsaved();
+
+    if (name != NULL) {
+        pclog("SNAPSHOT: \"%s\" has no save state support, not saving\n", name);
+        chain_valid = 0;
+        return -1;
+    }
+
+    snap.fp = plat_fopen64(fn, "wb");
+    if (snap.fp == NULL) {
+        pclog("SNAPSHOT: unable to create \"%s\"\n", fn);
+        chain_valid = 0;
+        return -1;
+    }
+
+    snapshot_write(&snap, SNAPSHOT_MAGIC, 8);
+    snapshot_put(&snap, SNAPSHOT_VERSION, 4);
+
+    snapshot_save_chunk(&snap, SNAPSHOT_CHUNK_CONF, snapshot_save_conf);
+    snapshot_save_chunk(&snap, SNAPSHOT_CHUNK_SEQ, snapshot_save_seq);
+    snapshot_save_chunk(&snap, SNAPSHOT_CHUNK_CPU, snapshot_save_cpu);
+    snapshot_save_chunk(&snap, SNAPSHOT_CHUNK_MEM, delta ? mem_save_state_delta : mem_save_state);
+    snapshot_save_chunk(&snap, SNAPSHOT_CHUNK_PIC, pic_save_state);
+    snapshot_save_chunk(&snap, SNAPSHOT_CHUNK_DMA, dma_save_state);
+    device_save_state(&snap);
+    snapshot_save_chunk(&snap, SNAPSHOT_CHUNK_END, NULL);
+
+    if (fclose(snap.fp))
+        snapshot_fail(&snap, "write error");
+
+    if (snap.failed) {
+        remove(fn);
+        /* The page tracking may already have been restarted, so the next
+           delta would miss pages. */
+        chain_valid = 0;
+        return -1;
+    }
+
+    pclog("SNAPSHOT: machine state saved to \"%s\"\n", fn);
+
+    return 0;
+}
+
+int
+snapshot_save(const char *fn)
+{
+    char delta_fn[1024 + 8];
+
+    /* Deltas left over from an older chain can no longer be applied. */
+    for (uint32_t seq = 1;; seq++) {
+        snapshot_delta_name(delta_fn, sizeof(delta_fn), fn, seq);
+        if (!plat_file_check(delta_fn))
+            break;
+        remove(delta_fn);
+    }
+
+    chain_id    = ((uint64_t) time(NULL) << 32) ^ plat_get_ticks() ^ (chain_id + 1);
+    chain_seq   = 0;
+    chain_valid = 0;
+
+    if (snapshot_save_common(fn, 0))
+        return -1;
+
+    snprintf(chain_fn, sizeof(chain_fn), "%s", fn);
+    chain_valid = 1;
+
+    return 0;
+}
+
+int
+snapshot_checkpoint(const char *fn)
+{
+    char delta_fn[1024 + 8];
+
+    if (!chain_valid || strcmp(chain_fn, fn))
+        return snapshot_save(fn);
+
+    chain_seq++;
+    snapshot_delta_name(delta_fn, sizeof(delta_fn), fn, chain_seq);
+
+    return snapshot_save_common(delta_fn, 1);
+}
+
+int
+snapshot_load(const char *fn)
+{
+    snapshot_t snap    = { 0 };
+    char       magic[8];
+    uint32_t   id;
+    uint32_t   instance;
+    uint64_t   seq_id  = 0;
+    uint32_t   seq     = 0;
+    uint32_t   version;
+    int        checked = 0;
+    int        touched = 0;
+    int        done    = 0;
+
+    const char *name    = device_find_unsaved();
+
+    /* Refuse before anything is touched. */
+    if (name != NULL) {
+        pclog("SNAPSHOT: \"%s\" has no save state support, not loading\n", name);
+        return -1;
+    }
+
+    snap.fp = plat_fopen64(fn, "rb");
+    if (snap.fp == NULL) {
+        pclog("SNAPSHOT: unable to open \"%s\"\n", fn);
+        return -1;
+    }
+
+    device_load_state_begin();
+
+    if ((fread(magic, 1, 8, snap.fp) != 8) || memcmp(magic, SNAPSHOT_MAGIC, 8))
+        snapshot_fail(&snap, "not a snapshot file");
+    else if ((version = (uint32_t) snapshot_get(&snap, 4)) != SNAPSHOT_VERSION) {
+        if (!snap.failed)
+            pclog("SNAPSHOT: \"%s\" is version %u, this build only reads version %u\n",
+                  fn, version, SNAPSHOT_VERSION);
+        snapshot_fail(&snap, (version < SNAPSHOT_VERSION) ? "snapshot made by an older version" :
+                                                            "snapshot made by a newer version");
+    }
+
+    while (!snap.failed && !done) {
+        id        = (uint32_t) snapshot_get(&snap, 4);
+        instance  = (uint32_t) snapshot_get(&snap, 4);
+        snap.left = snapshot_get(&snap, 8);
+        if (snap.failed)
+            break;
+
+        snapshot_log("SNAPSHOT: chunk %08X/%i, %" PRIu64 " bytes\n", id, instance, snap.left);
+
+        /* Nothing may be restored before the configuration and the chain
+           have been checked. */
+        if ((checked < 2) && (id != SNAPSHOT_CHUNK_CONF) && (id != SNAPSHOT_CHUNK_SEQ)) {
+            snapshot_fail(&snap, "missing configuration chunk");
+            break;
+        }
+
+        switch (id) {
+            case SNAPSHOT_CHUNK_CONF:
+                snapshot_load_conf(&snap);
+                checked++;
+                break;
+            case SNAPSHOT_CHUNK_SEQ:
+                snapshot_load_seq(&snap, &seq_id, &seq);
+                checked++;
+                break;
+            case SNAPSHOT_CHUNK_CPU:
+                touched = 1;
+                snapshot_load_cpu(&snap);
+                break;
+            case SNAPSHOT_CHUNK_MEM:
+                touched = 1;
+                mem_load_state(&snap);
+                break;
+            case SNAPSHOT_CHUNK_PIC:
+                touched = 1;
+                pic_load_state(&snap);
+                break;
+            case SNAPSHOT_CHUNK_DMA:
+                touched = 1;
+                dma_load_state(&snap);
+                break;
+            case SNAPSHOT_CHUNK_DEV:
+                touched = 1;
+                device_load_state(&snap, (int) instance);
+                break;
+            case SNAPSHOT_CHUNK_END:
+                done = 1;
+                break;
+            default:
+                snapshot_log("SNAPSHOT: skipping unknown chunk %08X\n", id);
+                break;
+        }
+
+        /* Skip whatever the handler did not consume. */
+        if (!snap.failed && snap.left) {
+            if (fseeko64(snap.fp, snap.left, SEEK_CUR))
+                snapshot_fail(&snap, "seek error");
+            snap.left = 0;
+        }
+    }
+
+    fclose(snap.fp);
+
+    if (!snap.failed && !done)
+        snapshot_fail(&snap, "truncated snapshot");
+    if (!snap.failed)
+        device_load_state_end(&snap);
+
+    if (snap.failed) {
+        chain_valid = 0;
+        /* A half-restored machine is of no use to anyone, start over. */
+        if (touched)
+            pc_reset_hard();
+        return -1;
+    }
+
+    /* Further checkpoints continue the chain that was just restored. */
+    chain_id    = seq_id;
+    chain_seq   = seq;
+    chain_valid = 1;
+    if (seq == 0)
+        snprintf(chain_fn, sizeof(chain_fn), "%s", fn);
+
+#ifdef USE_DYNAREC
+    codegen_reset();
+#endif
+    flushmmucache();
+
+    pclog("SNAPSHOT: machine state restored from \"%s\"\n", fn);
+
+    return 0;
+}
+
+int
+snapshot_load_chain(const char *fn)
+{
+    char delta_fn[1024 + 8];
+
+    if (snapshot_load(fn))
+        return -1;
+
+    for (uint32_t seq = 1;; seq++) {
+        snapshot_delta_name(delta_fn, sizeof(delta_fn), fn, seq);
+        if (!plat_file_check(delta_fn))
+            break;
+        if (snapshot_load(delta_fn))
+            return -1;
+    }
+
+    return 0;
+}
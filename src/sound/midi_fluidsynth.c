@@ -27,8 +27,6 @@
 #    define USE_OLD_FLUIDSYNTH_API
 #endif
 
-extern void givealbuffer_midi(void *buf, uint32_t size);
-extern void al_set_midi(int freq, int buf_size);
 
 typedef struct fluidsynth {
     fluid_settings_t *settings;
@@ -85,7 +83,7 @@ fluidsynth_thread(void *param)
                 fluid_synth_write_float(data->synth, buf_size / (2 * sizeof(float)), buf, 0, 2, buf, 1, 2);
             buf_pos += buf_size;
             if (buf_pos >= data->buf_size) {
-                givealbuffer_midi(data->buffer, data->buf_size / sizeof(float));
+                sound_give_midi_buffer(data->buffer, data->buf_size / sizeof(float));
                 buf_pos = 0;
             }
         } else {
@@ -95,7 +93,7 @@ fluidsynth_thread(void *param)
                 fluid_synth_write_s16(data->synth, buf_size / (2 * sizeof(int16_t)), buf, 0, 2, buf, 1, 2);
             buf_pos += buf_size;
             if (buf_pos >= data->buf_size) {
-                givealbuffer_midi(data->buffer_int16, data->buf_size / sizeof(int16_t));
+                sound_give_midi_buffer(data->buffer_int16, data->buf_size / sizeof(int16_t));
                 buf_pos = 0;
             }
         }
@@ -276,7 +274,7 @@ fluidsynth_init(UNUSED(const device_t *info))
         data->buffer_int16 = calloc(1, data->buf_size);
     }
 
-    al_set_midi(data->samplerate, data->buf_size);
+    sound_set_midi_rate(data->samplerate, data->buf_size);
 
     dev = calloc(1, sizeof(midi_device_t));
 
@@ -24,8 +24,6 @@
 #define CM32LN_CTRL_ROM   "roms/sound/cm32ln/CM32LN_CONTROL.ROM"
 #define CM32LN_PCM_ROM    "roms/sound/cm32ln/CM32LN_PCM.ROM"
 
-extern void givealbuffer_midi(void *buf, uint32_t size);
-extern void al_set_midi(int freq, int buf_size);
 
 static mt32emu_report_handler_version get_mt32_report_handler_version(mt32emu_report_handler_i i);
 static void                           display_mt32_message(void *instance_data, const char *message);
@@ -228,7 +226,7 @@ mt32_thread(UNUSED(void *param))
             mt32_stream(buf, bsize / (2 * sizeof(float)));
             buf_pos += bsize;
             if (buf_pos >= buf_size) {
-                givealbuffer_midi(buffer, buf_size / sizeof(float));
+                sound_give_midi_buffer(buffer, buf_size / sizeof(float));
                 buf_pos = 0;
             }
         } else {
@@ -237,7 +235,7 @@ mt32_thread(UNUSED(void *param))
             mt32_stream_int16(buf16, bsize / (2 * sizeof(int16_t)));
             buf_pos += bsize;
             if (buf_pos >= buf_size) {
-                givealbuffer_midi(buffer_int16, buf_size / sizeof(int16_t));
+                sound_give_midi_buffer(buffer_int16, buf_size / sizeof(int16_t));
                 buf_pos = 0;
             }
         }
@@ -296,7 +294,7 @@ mt32emu_init(char *control_rom, char *pcm_rom)
     mt32emu_set_reversed_stereo_enabled(context, device_get_config_int("reversed_stereo"));
     mt32emu_set_nice_amp_ramp_enabled(context, device_get_config_int("nice_ramp"));
 
-    al_set_midi(samplerate, buf_size);
+    sound_set_midi_rate(samplerate, buf_size);
 
     dev = calloc(1, sizeof(midi_device_t));
 
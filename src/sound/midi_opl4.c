@@ -568,7 +568,6 @@ opl4_midi_thread(UNUSED(void *arg))
 
     int32_t buffer[RENDER_RATE * 2];
 
-    extern void givealbuffer_midi(void *buf, uint32_t size);
     while (opl4_midi->on) {
         thread_wait_event(opl4_midi->wait_event, -1);
         thread_reset_event(opl4_midi->wait_event);
@@ -584,7 +583,7 @@ opl4_midi_thread(UNUSED(void *arg))
             }
             buf_pos += buf_size / 2;
             if (buf_pos >= (buf_size_segments / 2)) {
-                givealbuffer_midi(opl4_midi->buffer_float, buf_size_segments);
+                sound_give_midi_buffer(opl4_midi->buffer_float, buf_size_segments);
                 buf_pos = 0;
             }
         } else {
@@ -594,7 +593,7 @@ opl4_midi_thread(UNUSED(void *arg))
             }
             buf_pos += buf_size / 2;
             if (buf_pos >= (buf_size_segments / 2)) {
-                givealbuffer_midi(opl4_midi->buffer, buf_size_segments);
+                sound_give_midi_buffer(opl4_midi->buffer, buf_size_segments);
                 buf_pos = 0;
             }
         }
@@ -658,7 +657,6 @@ void *
 opl4_init(UNUSED(const device_t *info))
 {
     midi_device_t *dev;
-    extern void    al_set_midi(int freq, int buf_size);
 
     dev = calloc(1, sizeof(midi_device_t));
 
@@ -666,7 +664,7 @@ opl4_init(UNUSED(const device_t *info))
     dev->play_sysex = opl4_midi_sysex;
     dev->poll       = opl4_midi_poll;
 
-    al_set_midi(48000, 4800);
+    sound_set_midi_rate(48000, 4800);
 
     opl4_midi_cur = calloc(1, sizeof(opl4_midi_t));
 
@@ -31,6 +31,7 @@
 #include <86box/86box.h>
 #include <86box/midi.h>
 #include <86box/sound.h>
+#include <86box/sound_mixer.h>
 #include <86box/plat_unused.h>
 
 #define FREQ   SOUND_FREQ
@@ -121,10 +122,13 @@ closeal(void)
 
     if (sources >= 7)
         alDeleteBuffers(4, buffers_midi);
-    alDeleteBuffers(4, buffers_fdd);
-    alDeleteBuffers(4, buffers_hdd);
-    alDeleteBuffers(4, buffers_cd);
-    alDeleteBuffers(4, buffers_music);
+    if (sources > 1) {
+        alDeleteBuffers(4, buffers_fdd);
+        alDeleteBuffers(4, buffers_hdd);
+        alDeleteBuffers(4, buffers_cd);
+        alDeleteBuffers(4, buffers_wt);
+        alDeleteBuffers(4, buffers_music);
+    }
     alDeleteBuffers(4, buffers);
 
     alutExit();
@@ -163,7 +167,12 @@ inital(void)
         init_midi = 1; /* If the device is neither none, nor system MIDI, initialize the
                           MIDI buffer and source, otherwise, do not. */
 
-    sources = 6 + !!init_midi;
+    /* With the mixer, everything comes in through the main stream. */
+    if (sound_mixer_enabled) {
+        init_midi = 0;
+        sources   = 1;
+    } else
+        sources = 6 + !!init_midi;
     if (sound_is_float) {
         buf       = (float *) calloc((BUFLEN << 1), sizeof(float));
         music_buf = (float *) calloc((MUSICBUFLEN << 1), sizeof(float));
@@ -185,19 +194,18 @@ inital(void)
     }
 
     alGenBuffers(4, buffers);
-    alGenBuffers(4, buffers_cd);
-    alGenBuffers(4, buffers_fdd);
-    alGenBuffers(4, buffers_hdd);
-    alGenBuffers(4, buffers_music);
-    alGenBuffers(4, buffers_wt);
+    if (sources > 1) {
+        alGenBuffers(4, buffers_cd);
+        alGenBuffers(4, buffers_fdd);
+        alGenBuffers(4, buffers_hdd);
+        alGenBuffers(4, buffers_music);
+        alGenBuffers(4, buffers_wt);
+    }
     if (init_midi)
         alGenBuffers(4, buffers_midi);
 
     // Create sources: 0=main, 1=music, 2=wt, 3=cd, 4=fdd, 5=hdd, 6=midi(optional)
-    if (init_midi)
-        alGenSources(7, source);
-    else
-        alGenSources(6, source);
+    alGenSources(sources, source);
 
     alSource3f(source[I_NORMAL], AL_POSITION, 0.0f, 0.0f, 0.0f);
     alSource3f(source[I_NORMAL], AL_VELOCITY, 0.0f, 0.0f, 0.0f);
@@ -205,35 +213,37 @@ inital(void)
     alSourcef(source[I_NORMAL], AL_ROLLOFF_FACTOR, 0.0f);
     alSourcei(source[I_NORMAL], AL_SOURCE_RELATIVE, AL_TRUE);
 
-    alSource3f(source[I_MUSIC], AL_POSITION, 0.0f, 0.0f, 0.0f);
-    alSource3f(source[I_MUSIC], AL_VELOCITY, 0.0f, 0.0f, 0.0f);
-    alSource3f(source[I_MUSIC], AL_DIRECTION, 0.0f, 0.0f, 0.0f);
-    alSourcef(source[I_MUSIC], AL_ROLLOFF_FACTOR, 0.0f);
-    alSourcei(source[I_MUSIC], AL_SOURCE_RELATIVE, AL_TRUE);
-
-    alSource3f(source[I_WT], AL_POSITION, 0.0f, 0.0f, 0.0f);
-    alSource3f(source[I_WT], AL_VELOCITY, 0.0f, 0.0f, 0.0f);
-    alSource3f(source[I_WT], AL_DIRECTION, 0.0f, 0.0f, 0.0f);
-    alSourcef(source[I_WT], AL_ROLLOFF_FACTOR, 0.0f);
-    alSourcei(source[I_WT], AL_SOURCE_RELATIVE, AL_TRUE);
-
-    alSource3f(source[I_CD], AL_POSITION, 0.0f, 0.0f, 0.0f);
-    alSource3f(source[I_CD], AL_VELOCITY, 0.0f, 0.0f, 0.0f);
-    alSource3f(source[I_CD], AL_DIRECTION, 0.0f, 0.0f, 0.0f);
-    alSourcef(source[I_CD], AL_ROLLOFF_FACTOR, 0.0f);
-    alSourcei(source[I_CD], AL_SOURCE_RELATIVE, AL_TRUE);
-
-    alSource3f(source[I_FDD], AL_POSITION, 0.0f, 0.0f, 0.0f);
-    alSource3f(source[I_FDD], AL_VELOCITY, 0.0f, 0.0f, 0.0f);
-    alSource3f(source[I_FDD], AL_DIRECTION, 0.0f, 0.0f, 0.0f);
-    alSourcef(source[I_FDD], AL_ROLLOFF_FACTOR, 0.0f);
-    alSourcei(source[I_FDD], AL_SOURCE_RELATIVE, AL_TRUE);
-
-    alSource3f(source[I_HDD], AL_POSITION, 0.0f, 0.0f, 0.0f);
-    alSource3f(source[I_HDD], AL_VELOCITY, 0.0f, 0.0f, 0.0f);
-    alSource3f(source[I_HDD], AL_DIRECTION, 0.0f, 0.0f, 0.0f);
-    alSourcef(source[I_HDD], AL_ROLLOFF_FACTOR, 0.0f);
-    alSourcei(source[I_HDD], AL_SOURCE_RELATIVE, AL_TRUE);
+    if (sources > 1) {
+        alSource3f(source[I_MUSIC], AL_POSITION, 0.0f, 0.0f, 0.0f);
+        alSource3f(source[I_MUSIC], AL_VELOCITY, 0.0f, 0.0f, 0.0f);
+        alSource3f(source[I_MUSIC], AL_DIRECTION, 0.0f, 0.0f, 0.0f);
+        alSourcef(source[I_MUSIC], AL_ROLLOFF_FACTOR, 0.0f);
+        alSourcei(source[I_MUSIC], AL_SOURCE_RELATIVE, AL_TRUE);
+
+        alSource3f(source[I_WT], AL_POSITION, 0.0f, 0.0f, 0.0f);
+        alSource3f(source[I_WT], AL_VELOCITY, 0.0f, 0.0f, 0.0f);
+        alSource3f(source[I_WT], AL_DIRECTION, 0.0f, 0.0f, 0.0f);
+        alSourcef(source[I_WT], AL_ROLLOFF_FACTOR, 0.0f);
+        alSourcei(source[I_WT], AL_SOURCE_RELATIVE, AL_TRUE);
+
+        alSource3f(source[I_CD], AL_POSITION, 0.0f, 0.0f, 0.0f);
+        alSource3f(source[I_CD], AL_VELOCITY, 0.0f, 0.0f, 0.0f);
+        alSource3f(source[I_CD], AL_DIRECTION, 0.0f, 0.0f, 0.0f);
+        alSourcef(source[I_CD], AL_ROLLOFF_FACTOR, 0.0f);
+        alSourcei(source[I_CD], AL_SOURCE_RELATIVE, AL_TRUE);
+
+        alSource3f(source[I_FDD], AL_POSITION, 0.0f, 0.0f, 0.0f);
+        alSource3f(source[I_FDD], AL_VELOCITY, 0.0f, 0.0f, 0.0f);
+        alSource3f(source[I_FDD], AL_DIRECTION, 0.0f, 0.0f, 0.0f);
+        alSourcef(source[I_FDD], AL_ROLLOFF_FACTOR, 0.0f);
+        alSourcei(source[I_FDD], AL_SOURCE_RELATIVE, AL_TRUE);
+
+        alSource3f(source[I_HDD], AL_POSITION, 0.0f, 0.0f, 0.0f);
+        alSource3f(source[I_HDD], AL_VELOCITY, 0.0f, 0.0f, 0.0f);
+        alSource3f(source[I_HDD], AL_DIRECTION, 0.0f, 0.0f, 0.0f);
+        alSourcef(source[I_HDD], AL_ROLLOFF_FACTOR, 0.0f);
+        alSourcei(source[I_HDD], AL_SOURCE_RELATIVE, AL_TRUE);
+    }
 
     if (init_midi) {
         alSource3f(source[I_MIDI], AL_POSITION, 0.0f, 0.0f, 0.0f);
@@ -266,6 +276,8 @@ inital(void)
     for (uint8_t c = 0; c < 4; c++) {
         if (sound_is_float) {
             alBufferData(buffers[c], AL_FORMAT_STEREO_FLOAT32, buf, BUFLEN * 2 * sizeof(float), FREQ);
+            if (sources == 1)
+                continue;
             alBufferData(buffers_music[c], AL_FORMAT_STEREO_FLOAT32, music_buf, MUSICBUFLEN * 2 * sizeof(float), MUSIC_FREQ);
             alBufferData(buffers_wt[c], AL_FORMAT_STEREO_FLOAT32, wt_buf, WTBUFLEN * 2 * sizeof(float), WT_FREQ);
             alBufferData(buffers_cd[c], AL_FORMAT_STEREO_FLOAT32, cd_buf, CD_BUFLEN * 2 * sizeof(float), CD_FREQ);
@@ -275,6 +287,8 @@ inital(void)
                 alBufferData(buffers_midi[c], AL_FORMAT_STEREO_FLOAT32, midi_buf, midi_buf_size * (int) sizeof(float), midi_freq);
         } else {
             alBufferData(buffers[c], AL_FORMAT_STEREO16, buf_int16, BUFLEN * 2 * sizeof(int16_t), FREQ);
+            if (sources == 1)
+                continue;
             alBufferData(buffers_music[c], AL_FORMAT_STEREO16, music_buf_int16, MUSICBUFLEN * 2 * sizeof(int16_t), MUSIC_FREQ);
             alBufferData(buffers_wt[c], AL_FORMAT_STEREO16, wt_buf_int16, WTBUFLEN * 2 * sizeof(int16_t), WT_FREQ);
             alBufferData(buffers_cd[c], AL_FORMAT_STEREO16, cd_buf_int16, CD_BUFLEN * 2 * sizeof(int16_t), CD_FREQ);
@@ -286,19 +300,23 @@ inital(void)
     }
 
     alSourceQueueBuffers(source[I_NORMAL], 4, buffers);
-    alSourceQueueBuffers(source[I_MUSIC], 4, buffers_music);
-    alSourceQueueBuffers(source[I_WT], 4, buffers_wt);
-    alSourceQueueBuffers(source[I_CD], 4, buffers_cd);
-    alSourceQueueBuffers(source[I_FDD], 4, buffers_fdd);
-    alSourceQueueBuffers(source[I_HDD], 4, buffers_hdd);
+    if (sources > 1) {
+        alSourceQueueBuffers(source[I_MUSIC], 4, buffers_music);
+        alSourceQueueBuffers(source[I_WT], 4, buffers_wt);
+        alSourceQueueBuffers(source[I_CD], 4, buffers_cd);
+        alSourceQueueBuffers(source[I_FDD], 4, buffers_fdd);
+        alSourceQueueBuffers(source[I_HDD], 4, buffers_hdd);
+    }
     if (init_midi)
         alSourceQueueBuffers(source[I_MIDI], 4, buffers_midi);
     alSourcePlay(source[I_NORMAL]);
-    alSourcePlay(source[I_MUSIC]);
-    alSourcePlay(source[I_WT]);
-    alSourcePlay(source[I_CD]);
-    alSourcePlay(source[I_FDD]);
-    alSourcePlay(source[I_HDD]);
+    if (sources > 1) {
+        alSourcePlay(source[I_MUSIC]);
+        alSourcePlay(source[I_WT]);
+        alSourcePlay(source[I_CD]);
+        alSourcePlay(source[I_FDD]);
+        alSourcePlay(source[I_HDD]);
+    }
     if (init_midi)
         alSourcePlay(source[I_MIDI]);
 
@@ -333,7 +351,7 @@ givealbuffer_common(const void *buf, const uint8_t src, const int size, const in
     int    state;
     ALuint buffer;
 
-    if (!initialized || fast_forward)
+    if (!initialized || fast_forward || (src >= sources))
         return;
 
     alGetSourcei(source[src], AL_SOURCE_STATE, &state);
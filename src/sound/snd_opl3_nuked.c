@@ -950,6 +950,17 @@ OPL3_ChannelUpdateAlg(opl3_channel *channel)
         OPL3_ChannelSetupAlg(channel);
 }
 
+static void
+OPL3_ChannelUpdateMix(opl3_channel *channel)
+{
+    opl3_chip *chip = channel->chip;
+
+    chip->mixmask[0][channel->ch_num] = (int16_t) channel->cha;
+    chip->mixmask[1][channel->ch_num] = (int16_t) channel->chb;
+    chip->mixmask[2][channel->ch_num] = (int16_t) channel->chc;
+    chip->mixmask[3][channel->ch_num] = (int16_t) channel->chd;
+}
+
 static void
 OPL3_ChannelWriteC0(opl3_channel *channel, uint8_t data)
 {
@@ -968,6 +979,8 @@ OPL3_ChannelWriteC0(opl3_channel *channel, uint8_t data)
         channel->chc = channel->chd = 0;
     }
 
+    OPL3_ChannelUpdateMix(channel);
+
 #if OPL3_ENABLE_STEREOEXT
     if (!channel->chip->stereoext) {
         channel->leftpan  = channel->cha << 16;
@@ -1058,17 +1071,47 @@ OPL3_ProcessSlot(opl3_slot *slot)
     OPL3_SlotGenerate(slot);
 }
 
+/* Mix the channels into outputs A and C (half 0) or B and D (half 1). The
+   output enables are kept as one array per output, so once the channel
+   sums are gathered this is a masked sum over contiguous arrays, which
+   the compiler turns into vector code. */
+static inline void
+OPL3_ChannelMix(opl3_chip *chip, int32_t *mix, int half)
+{
+    const int16_t *mask0 = chip->mixmask[half];
+    const int16_t *mask1 = chip->mixmask[half + 2];
+    int16_t       *accm  = chip->mixaccm;
+    int16_t      **out;
+    int32_t        mix0 = 0;
+    int32_t        mix1 = 0;
+
+    for (uint8_t i = 0; i < 18; i++) {
+        out     = chip->channel[i].out;
+        accm[i] = *out[0] + *out[1] + *out[2] + *out[3];
+    }
+
+    for (uint8_t i = 0; i < 18; i++) {
+        mix0 += accm[i] & mask0[i];
+        mix1 += accm[i] & mask1[i];
+    }
+
+    mix[0] = mix0;
+    mix[1] = mix1;
+}
+
 static inline void
 OPL3_Generate4Ch(void *priv, int32_t *buf4)
 {
     opl3_chip     *chip = (opl3_chip *) priv;
-    opl3_channel  *channel;
     opl3_writebuf *writebuf;
-    int16_t      **out;
     int32_t        mix[2];
     uint8_t        i;
-    int16_t        accm;
     uint8_t        shift = 0;
+#if OPL3_ENABLE_STEREOEXT
+    opl3_channel  *channel;
+    int16_t      **out;
+    int16_t        accm;
+#endif
 
     buf4[1] = chip->mixbuff[1];
     buf4[3] = chip->mixbuff[3];
@@ -1080,19 +1123,19 @@ OPL3_Generate4Ch(void *priv, int32_t *buf4)
 #endif
         OPL3_ProcessSlot(&chip->slot[i]);
 
+#if OPL3_ENABLE_STEREOEXT
     mix[0] = mix[1] = 0;
 
     for (i = 0; i < 18; i++) {
         channel = &chip->channel[i];
         out     = channel->out;
         accm    = *out[0] + *out[1] + *out[2] + *out[3];
-#if OPL3_ENABLE_STEREOEXT
         mix[0] += (int16_t) ((accm * channel->leftpan) >> 16);
-#else
-        mix[0] += (int16_t) (accm & channel->cha);
-#endif
         mix[1] += (int16_t) (accm & channel->chc);
     }
+#else
+    OPL3_ChannelMix(chip, mix, 0);
+#endif
 
     chip->mixbuff[0] = mix[0];
     chip->mixbuff[2] = mix[1];
@@ -1110,19 +1153,19 @@ OPL3_Generate4Ch(void *priv, int32_t *buf4)
         OPL3_ProcessSlot(&chip->slot[i]);
 #endif
 
+#if OPL3_ENABLE_STEREOEXT
     mix[0] = mix[1] = 0;
 
     for (i = 0; i < 18; i++) {
         channel = &chip->channel[i];
         out     = channel->out;
         accm    = *out[0] + *out[1] + *out[2] + *out[3];
-#if OPL3_ENABLE_STEREOEXT
         mix[0] += (int16_t) ((accm * channel->rightpan) >> 16);
-#else
-        mix[0] += (int16_t) (accm & channel->chb);
-#endif
         mix[1] += (int16_t) (accm & channel->chd);
     }
+#else
+    OPL3_ChannelMix(chip, mix, 1);
+#endif
 
     chip->mixbuff[1] = mix[0];
     chip->mixbuff[3] = mix[1];
@@ -1275,6 +1318,7 @@ OPL3_Reset(opl3_chip *chip, uint32_t samplerate)
         channel->ch_num = channum;
 
         OPL3_ChannelSetupAlg(channel);
+        OPL3_ChannelUpdateMix(channel);
     }
 
     chip->noise        = 1;
@@ -1540,11 +1584,46 @@ nuked_opl3_drv_set_do_cycles(void *priv, int8_t do_cycles)
         dev->flags &= ~FLAG_CYCLES;
 }
 
+static void
+nuked_opl3_drv_generate_thread(void *priv, int32_t *buffer, int len)
+{
+    nuked_opl3_drv_t *dev = (nuked_opl3_drv_t *) priv;
+
+    OPL3_GenerateStream(&dev->opl, buffer, len);
+
+    for (int c = 0; c < (len * 2); c++)
+        buffer[c] /= 2;
+}
+
+static void
+nuked_opl3_drv_generate(void *priv, int32_t *data, uint32_t num_samples)
+{
+    nuked_opl3_drv_t *dev = (nuked_opl3_drv_t *) priv;
+
+    if (dev->is_48k)
+        OPL3_GenerateResampledStream(&dev->opl, data, num_samples);
+    else
+        OPL3_GenerateStream(&dev->opl, data, num_samples);
+}
+
+static void
+nuked_opl3_drv_write_reg(void *priv, uint16_t reg, uint8_t val)
+{
+    nuked_opl3_drv_t *dev = (nuked_opl3_drv_t *) priv;
+
+    OPL3_WriteRegBuffered(&dev->opl, reg, val);
+}
+
 static int32_t *
 nuked_opl3_drv_update(void *priv)
 {
     nuked_opl3_drv_t *dev = (nuked_opl3_drv_t *) priv;
 
+    if (dev->synth != NULL) {
+        music_synth_sync(dev->synth);
+        return dev->buffer;
+    }
+
     if (dev->pos >= music_pos_global)
         return dev->buffer;
 
@@ -1588,7 +1667,8 @@ nuked_opl3_drv_read(uint16_t port, void *priv)
     if (dev->flags & FLAG_CYCLES)
         cycles -= ((int) (isa_timing * 8));
 
-    dev->update(dev);
+    if (dev->synth == NULL)
+        dev->update(dev);
 
     uint8_t ret = 0xff;
 
@@ -1608,10 +1688,14 @@ nuked_opl3_drv_write(uint16_t port, uint8_t val, void *priv)
 {
     nuked_opl3_drv_t *dev = (nuked_opl3_drv_t *) priv;
 
-    dev->update(dev);
+    if (dev->synth == NULL)
+        dev->update(dev);
 
     if ((port & 0x0001) == 0x0001) {
-        OPL3_WriteRegBuffered(&dev->opl, dev->port, val);
+        if (dev->synth != NULL)
+            music_synth_write(dev->synth, dev->port, val);
+        else
+            OPL3_WriteRegBuffered(&dev->opl, dev->port, val);
 
         switch (dev->port) {
             case 0x002: // Timer 1
@@ -1637,14 +1721,22 @@ nuked_opl3_drv_write(uint16_t port, uint8_t val, void *priv)
                 break;
 
             case 0x105:
-                dev->opl.newm = val & 0x01;
+                dev->newm = val & 0x01;
+                if (dev->synth == NULL)
+                    dev->opl.newm = dev->newm;
                 break;
 
             default:
                 break;
         }
     } else {
-        dev->port = nuked_opl3_write_addr(&dev->opl, port, val) & 0x01ff;
+        if (dev->synth != NULL) {
+            /* Same as nuked_opl3_write_addr(), the chip itself belongs to the synthesis thread. */
+            dev->port = val;
+            if ((port & 0x0002) && ((dev->port == 0x0005) || dev->newm))
+                dev->port |= 0x0100;
+        } else
+            dev->port = nuked_opl3_write_addr(&dev->opl, port, val) & 0x01ff;
 
         if (!(dev->flags & FLAG_OPL3))
             dev->port &= 0x00ff;
@@ -1664,6 +1756,8 @@ nuked_opl3_drv_close(void *priv)
 {
     nuked_opl3_drv_t *dev = (nuked_opl3_drv_t *) priv;
 
+    music_synth_remove(dev->synth);
+
     free(dev);
 }
 
@@ -1686,6 +1780,11 @@ nuked_opl3_drv_init(const device_t *info)
     } else {
         dev->update      = nuked_opl3_drv_update;
         OPL3_Reset(&dev->opl, FREQ_49716);
+
+        /* The 48 kHz variant is part of the sound stream, which is not threaded. */
+        if (fm_thread)
+            dev->synth = music_synth_add(nuked_opl3_drv_generate_thread, nuked_opl3_drv_write_reg,
+                                         dev, dev->buffer);
     }
 
     timer_add(&dev->timers[0], nuked_opl3_timer_1, dev, 0);
@@ -1743,7 +1842,8 @@ const fm_drv_t nuked_opl3_drv = {
     .reset_buffer  = &nuked_opl3_drv_reset_buffer,
     .set_do_cycles = &nuked_opl3_drv_set_do_cycles,
     .priv          = NULL,
-    .generate      = NULL,
+    .generate      = &nuked_opl3_drv_generate,
+    .write_reg     = &nuked_opl3_drv_write_reg,
 };
 
 const fm_drv_t nuked_opl3_drv_48k = {
@@ -1753,5 +1853,6 @@ const fm_drv_t nuked_opl3_drv_48k = {
     .reset_buffer  = &nuked_opl3_drv_reset_buffer,
     .set_do_cycles = &nuked_opl3_drv_set_do_cycles,
     .priv          = NULL,
-    .generate      = NULL,
+    .generate      = &nuked_opl3_drv_generate,
+    .write_reg     = &nuked_opl3_drv_write_reg,
 };
@@ -0,0 +1,371 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          OPL3 benchmark.
+ *
+ *          Replays a register log, VGM (or VGZ) or DOSBox DRO, on every
+ *          OPL3 core through the block rendering interface, and reports
+ *          how many samples each one renders per second of host time,
+ *          along with a checksum of its output to compare builds.
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/plat.h>
+#include <86box/sound.h>
+#include <86box/snd_opl.h>
+
+#define BENCH_BLOCK 1024 /* Most samples rendered per call. */
+
+typedef struct bench_event_t {
+    uint32_t time; /* In samples at the OPL rate. */
+    uint16_t reg;
+    uint8_t  val;
+} bench_event_t;
+
+typedef struct bench_log_t {
+    bench_event_t *events;
+    int            num;
+    int            size;
+    uint32_t       length;
+} bench_log_t;
+
+typedef struct bench_core_t {
+    const char *name;
+    int         chip_id;
+    int         driver;
+} bench_core_t;
+
+static const bench_core_t bench_cores[] = {
+    { "Nuked OPL3", FM_YMF262, FM_DRV_NUKED },
+    { "YMFM",       FM_YMF262, FM_DRV_YMFM  },
+    { "ESFMu",      FM_ESFM,   FM_DRV_NUKED }
+};
+
+static uint32_t
+bench_get_le(const uint8_t *p, int size)
+{
+    uint32_t val = 0;
+
+    for (int i = size - 1; i >= 0; i--)
+        val = (val << 8) | p[i];
+
+    return val;
+}
+
+static void
+bench_add(bench_log_t *log, uint64_t time, uint16_t reg, uint8_t val)
+{
+    /* The timers do not affect the output and would need the timer
+       subsystem, which is not running yet. */
+    if ((reg >= 0x002) && (reg <= 0x004))
+        return;
+
+    if (log->num == log->size) {
+        log->size   = log->size ? (log->size << 1) : 4096;
+        log->events = realloc(log->events, log->size * sizeof(bench_event_t));
+        if (log->events == NULL)
+            fatal("OPL benchmark: out of memory\n");
+    }
+
+    log->events[log->num].time = (uint32_t) time;
+    log->events[log->num].reg  = reg;
+    log->events[log->num].val  = val;
+    log->num++;
+}
+
+static int
+bench_parse_vgm(bench_log_t *log, const uint8_t *data, uint32_t size)
+{
+    static const uint8_t dac_lens[6] = { 4, 4, 5, 10, 1, 4 };
+    uint64_t samples = 0;
+    uint32_t pos     = 0x40;
+    uint32_t len;
+    uint8_t  cmd;
+
+    if ((size >= 0x38) && (bench_get_le(&data[0x08], 4) >= 0x150) && bench_get_le(&data[0x34], 4))
+        pos = 0x34 + bench_get_le(&data[0x34], 4);
+
+    while (pos < size) {
+        cmd = data[pos++];
+
+        if ((pos + 4) > size)
+            break;
+
+        switch (cmd) {
+            case 0x5a: /* YM3812 */
+            case 0x5b: /* YM3526 */
+            case 0x5e: /* YMF262 port 0 */
+                bench_add(log, (samples * FREQ_49716) / 44100, data[pos], data[pos + 1]);
+                pos += 2;
+                break;
+
+            case 0x5f: /* YMF262 port 1 */
+                bench_add(log, (samples * FREQ_49716) / 44100, 0x100 | data[pos], data[pos + 1]);
+                pos += 2;
+                break;
+
+            case 0x61:
+                samples += bench_get_le(&data[pos], 2);
+                pos += 2;
+                break;
+
+            case 0x62:
+                samples += 735;
+                break;
+
+            case 0x63:
+                samples += 882;
+                break;
+
+            case 0x66:
+                pos = size;
+                break;
+
+            case 0x67: /* Data block */
+                /* A block running past the end of the file ends it. */
+                len = ((pos + 6) <= size) ? bench_get_le(&data[pos + 2], 4) : 0;
+                if (((pos + 6) > size) || (len > (size - pos - 6)))
+                    pos = size;
+                else
+                    pos += 6 + len;
+                break;
+
+            case 0x68: /* PCM RAM write */
+                pos += 11;
+                break;
+
+            default:
+                if ((cmd >= 0x70) && (cmd <= 0x8f))
+                    samples += (cmd & 0x0f) + ((cmd < 0x80) ? 1 : 0);
+                else if ((cmd >= 0x90) && (cmd <= 0x95))
+                    pos += dac_lens[cmd - 0x90];
+                else if ((cmd >= 0x30) && (cmd <= 0x3f))
+                    pos += 1;
+                else if ((cmd >= 0x40) && (cmd <= 0x4e))
+                    pos += 2;
+                else if ((cmd == 0x4f) || (cmd == 0x50))
+                    pos += 1;
+                else if (((cmd >= 0x51) && (cmd <= 0x5f)) || ((cmd >= 0xa0) && (cmd <= 0xbf)))
+                    pos += 2;
+                else if ((cmd >= 0xc0) && (cmd <= 0xdf))
+                    pos += 3;
+                else if (cmd >= 0xe0)
+                    pos += 4;
+                break;
+        }
+    }
+
+    log->length = (uint32_t) ((samples * FREQ_49716) / 44100);
+
+    return 1;
+}
+
+static int
+bench_parse_dro(bench_log_t *log, const uint8_t *data, uint32_t size)
+{
+    const uint8_t *codemap;
+    uint64_t       ms   = 0;
+    uint16_t       bank = 0;
+    uint32_t       pos;
+    uint8_t        cmd;
+    uint8_t        val;
+    uint8_t        short_delay;
+    uint8_t        long_delay;
+    uint8_t        codemap_len;
+
+    if (size < 0x1a)
+        return 0;
+
+    if (bench_get_le(&data[0x08], 2) == 2) {
+        /* Version 2.0, registers are given through a code map. */
+        short_delay = data[0x17];
+        long_delay  = data[0x18];
+        codemap_len = data[0x19];
+        codemap     = &data[0x1a];
+        pos         = 0x1a + codemap_len;
+
+        while ((pos + 2) <= size) {
+            cmd = data[pos++];
+            val = data[pos++];
+
+            if (cmd == short_delay)
+                ms += val + 1;
+            else if (cmd == long_delay)
+                ms += (val + 1) << 8;
+            else if ((cmd & 0x7f) < codemap_len)
+                bench_add(log, (ms * FREQ_49716) / 1000, ((cmd & 0x80) << 1) | codemap[cmd & 0x7f], val);
+        }
+    } else {
+        /* Version 0.1, the hardware type is a byte in some files and a
+           32-bit word in others. */
+        pos = ((data[0x15] | data[0x16] | data[0x17]) == 0x00) ? 0x18 : 0x15;
+
+        while (pos < size) {
+            cmd = data[pos++];
+
+            switch (cmd) {
+                case 0x00:
+                    if (pos < size)
+                        ms += data[pos++] + 1;
+                    break;
+
+                case 0x01:
+                    if ((pos + 2) <= size)
+                        ms += bench_get_le(&data[pos], 2) + 1;
+                    pos += 2;
+                    break;
+
+                case 0x02:
+                case 0x03:
+                    bank = (cmd & 1) << 8;
+                    break;
+
+                case 0x04:
+                    cmd = (pos < size) ? data[pos++] : 0;
+                    fallthrough;
+
+                default:
+                    if (pos < size)
+                        bench_add(log, (ms * FREQ_49716) / 1000, bank | cmd, data[pos++]);
+                    break;
+            }
+        }
+    }
+
+    log->length = (uint32_t) ((ms * FREQ_49716) / 1000);
+
+    return 1;
+}
+
+static int
+bench_load(bench_log_t *log, const char *fn)
+{
+    gzFile   fp;
+    uint8_t *data = NULL;
+    uint32_t size = 0;
+    int      len;
+    int      ret  = 0;
+
+    /* gzread() passes uncompressed files through, which covers VGZ. */
+    fp = gzopen(fn, "rb");
+    if (fp == NULL) {
+        always_log("OPL benchmark: unable to open '%s'\n", fn);
+        return 0;
+    }
+
+    do {
+        data = realloc(data, size + 65536);
+        if (data == NULL)
+            fatal("OPL benchmark: out of memory\n");
+        len = gzread(fp, &data[size], 65536);
+        if (len > 0)
+            size += len;
+    } while (len == 65536);
+    gzclose(fp);
+
+    if ((size >= 4) && !memcmp(data, "Vgm ", 4))
+        ret = bench_parse_vgm(log, data, size);
+    else if ((size >= 8) && !memcmp(data, "DBRAWOPL", 8))
+        ret = bench_parse_dro(log, data, size);
+    else
+        always_log("OPL benchmark: '%s' is neither a VGM nor a DRO file\n", fn);
+
+    free(data);
+
+    if (ret && (log->num == 0)) {
+        always_log("OPL benchmark: '%s' has no OPL register writes\n", fn);
+        ret = 0;
+    }
+
+    return ret;
+}
+
+static void
+bench_run(const bench_core_t *core, const bench_log_t *log)
+{
+    static int32_t buffer[BENCH_BLOCK * 2];
+    fm_drv_t       drv;
+    uint64_t       start;
+    uint64_t       ticks = 0;
+    uint32_t       sum   = 2166136261u;
+    uint32_t       pos   = 0;
+    uint32_t       end;
+    uint32_t       len;
+    int            old_driver = fm_driver;
+    int            ev         = 0;
+    double         secs;
+
+    fm_driver = core->driver;
+    if (!fm_driver_get(core->chip_id, &drv) || (drv.generate == NULL) || (drv.write_reg == NULL)) {
+        always_log("%-12s not available\n", core->name);
+        fm_driver = old_driver;
+        return;
+    }
+    fm_driver = old_driver;
+
+    while (pos < log->length) {
+        while ((ev < log->num) && (log->events[ev].time <= pos)) {
+            drv.write_reg(drv.priv, log->events[ev].reg, log->events[ev].val);
+            ev++;
+        }
+
+        end = (ev < log->num) ? log->events[ev].time : log->length;
+        while (pos < end) {
+            len = end - pos;
+            if (len > BENCH_BLOCK)
+                len = BENCH_BLOCK;
+
+            start = plat_timer_read();
+            drv.generate(drv.priv, buffer, len);
+            ticks += plat_timer_read() - start;
+
+            /* FNV-1a over the samples, outside of the timed section. */
+            for (uint32_t i = 0; i < (len * 2); i++)
+                sum = (sum ^ (uint32_t) buffer[i]) * 16777619u;
+
+            pos += len;
+        }
+    }
+
+    secs = (double) ticks / (double) plat_timer_freq();
+    always_log("%-12s %10u samples in %8.3f s, %12.0f samples/s, %7.1fx real time, checksum %08X\n",
+               core->name, log->length, secs, (secs > 0.0) ? (log->length / secs) : 0.0,
+               (secs > 0.0) ? ((log->length / (double) FREQ_49716) / secs) : 0.0, sum);
+}
+
+/* Run the benchmark on a register log. Returns 0, so that the emulator exits. */
+int
+opl_bench(const char *fn)
+{
+    bench_log_t log = { 0 };
+    int         old_thread = fm_thread;
+
+    if (bench_load(&log, fn)) {
+        always_log("OPL benchmark: %s, %i register writes, %.1f s of audio\n",
+                   fn, log.num, log.length / (double) FREQ_49716);
+
+        /* The chips are driven directly, not from the synthesis thread. */
+        fm_thread = 0;
+        for (uint32_t i = 0; i < (sizeof(bench_cores) / sizeof(bench_cores[0])); i++)
+            bench_run(&bench_cores[i], &log);
+        fm_thread = old_thread;
+
+        device_close_all();
+    }
+
+    free(log.events);
+
+    return 0;
+}
@@ -332,6 +332,22 @@ esfm_drv_write(uint16_t port, uint8_t val, void *priv)
     }
 }
 
+static void
+esfm_drv_generate(void *priv, int32_t *data, uint32_t num_samples)
+{
+    esfm_drv_t *dev = (esfm_drv_t *) priv;
+
+    esfm_drv_generate_stream(dev, data, num_samples);
+}
+
+static void
+esfm_drv_write_reg(void *priv, uint16_t reg, uint8_t val)
+{
+    esfm_drv_t *dev = (esfm_drv_t *) priv;
+
+    ESFM_write_reg_buffered_fast(&dev->opl, reg, val);
+}
+
 const device_t esfm_esfmu_device = {
     .name          = "ESS Technology ESFM (ESFMu)",
     .internal_name = "esfm_esfmu",
@@ -353,5 +369,6 @@ const fm_drv_t esfmu_opl_drv = {
     .reset_buffer  = &esfm_drv_reset_buffer,
     .set_do_cycles = &esfm_drv_set_do_cycles,
     .priv          = NULL,
-    .generate      = NULL,
+    .generate      = &esfm_drv_generate,
+    .write_reg     = &esfm_drv_write_reg,
 };
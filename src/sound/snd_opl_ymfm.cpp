@@ -536,6 +536,16 @@ ymfm_drv_generate(void *priv, int32_t *data, uint32_t num_samples)
         drv->generate(data, num_samples);
 }
 
+static void
+ymfm_drv_write_reg(void *priv, uint16_t reg, uint8_t val)
+{
+    YMFMChipBase *drv  = (YMFMChipBase *) priv;
+    uint16_t      port = (reg & 0x100) ? 2 : 0;
+
+    drv->write(port, reg & 0xff);
+    drv->write(port | 1, val);
+}
+
 const device_t ym2149_ymfm_device = {
     .name          = "Yamaha 2149 SSG (YMFM)",
     .internal_name = "ym2149_ymfm",
@@ -883,6 +893,7 @@ const fm_drv_t ymfm_drv {
     .set_do_cycles = &ymfm_drv_set_do_cycles,
     .priv          = NULL,
     .generate      = ymfm_drv_generate,
+    .write_reg     = ymfm_drv_write_reg,
 };
 
 #ifdef __clang__
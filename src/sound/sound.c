@@ -16,8 +16,10 @@
  *          Copyright 2016-2025 Miran Grca.
  *          Copyright 2024-2026 Jasmine Iwanek.
  */
+#include <inttypes.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -36,6 +38,8 @@
 #include <86box/timer.h>
 #include <86box/snd_mpu401.h>
 #include <86box/sound.h>
+#include <86box/sound_mixer.h>
+#include <86box/sound_capture.h>
 #include <86box/fdd_audio.h>
 #include <86box/hdd_audio.h>
 
@@ -45,9 +49,44 @@ typedef struct {
 
 typedef struct {
     void (*get_buffer)(int32_t *buffer, int len, void *priv);
-    void *priv;
+    void       *priv;
+    const char *name;
+
+    /* Host time spent rendering, in plat_timer_read() ticks. */
+    uint64_t time;
+    uint64_t calls;
 } sound_handler_t;
 
+/* Register writes waiting for the synthesis thread, must be a power of 2. */
+#define MUSIC_SYNTH_RING_SIZE 4096
+#define MUSIC_SYNTH_RING_MASK (MUSIC_SYNTH_RING_SIZE - 1)
+
+/* How often, in samples, the emulation thread wakes the synthesis thread up. */
+#define MUSIC_SYNTH_KICK 64
+
+typedef struct {
+    uint32_t time;
+    uint16_t reg;
+    uint8_t  val;
+} music_synth_event_t;
+
+struct music_synth_t {
+    void (*generate)(void *priv, int32_t *buffer, int len);
+    void (*write)(void *priv, uint16_t reg, uint8_t val);
+    void    *priv;
+    int32_t *buffer;
+
+    /* Only touched by the synthesis thread. */
+    int pos;
+
+    music_synth_event_t ring[MUSIC_SYNTH_RING_SIZE];
+    atomic_uint         head; /* Next event to be queued, emulation thread. */
+    atomic_uint         tail; /* Next event to be applied, synthesis thread. */
+    atomic_uint         time; /* Samples rendered so far, synthesis thread. */
+
+    struct music_synth_t *next;
+};
+
 int  sound_card_current[SOUND_CARD_MAX] = { 0, 0, 0, 0 };
 int  sound_pos_global                   = 0;
 int  music_pos_global                   = 0;
@@ -73,6 +112,7 @@ static int16_t   *outbuffer_m_ex_int16;
 static int32_t   *outbuffer_w;
 static float     *outbuffer_w_ex;
 static int16_t   *outbuffer_w_ex_int16;
+static int32_t    capture_buffer[MUSICBUFLEN * 2];
 static int        sound_handlers_num;
 static int        music_handlers_num;
 static int        wavetable_handlers_num;
@@ -104,6 +144,18 @@ static event_t      *sound_hdd_start_event;
 static volatile int hddaudioon = 0;
 static int          hdd_thread_enable = 0;
 
+static thread_t      *music_synth_thread_h;
+static event_t       *music_synth_event;
+static event_t       *music_synth_done_event;
+static event_t       *music_synth_start_event;
+static mutex_t       *music_synth_mutex;
+static music_synth_t *music_synths;
+static volatile int   music_synth_on = 0;
+static atomic_uint    music_synth_time; /* Samples elapsed on the music stream. */
+
+static void sound_fdd_render(void);
+static void sound_hdd_render(void);
+
 static void (*filter_cd_audio)(int channel, double *buffer, void *priv) = NULL;
 static void *filter_cd_audio_p                                          = NULL;
 
@@ -299,7 +351,7 @@ sound_cd_clean_buffers(void)
 }
 
 static void
-sound_cd_thread(UNUSED(void *param))
+sound_cd_render(void)
 {
     int      temp_buffer[2];
     int      channel_select[2];
@@ -307,111 +359,120 @@ sound_cd_thread(UNUSED(void *param))
     double   audio_vol_r;
     double   cd_buffer_temp[2] = { 0.0, 0.0 };
 
-    thread_set_event(sound_cd_start_event);
+    sound_cd_clean_buffers();
 
-    while (cdaudioon) {
-        thread_wait_event(sound_cd_event, -1);
-        thread_reset_event(sound_cd_event);
+    temp_buffer[0] = temp_buffer[1] = 0;
 
+    for (uint8_t i = 0; i < CDROM_NUM; i++) {
+        /* Just in case the thread is in a loop when it gets terminated. */
         if (!cdaudioon)
-            return;
+            break;
 
-        sound_cd_clean_buffers();
+        if ((cdrom[i].bus_type == CDROM_BUS_DISABLED) ||
+            (cdrom[i].cd_status != CD_STATUS_PLAYING))
+            continue;
+        const int ret = cdrom_audio_callback(&(cdrom[i]), cd_buffer[i],
+                                             CD_BUFLEN * 2);
+
+        if (ret) {
+            if (cdrom[i].get_volume) {
+                audio_vol_l = cd_audio_volume_lut[cdrom[i].get_volume(cdrom[i].priv, 0)];
+                audio_vol_r = cd_audio_volume_lut[cdrom[i].get_volume(cdrom[i].priv, 1)];
+            } else {
+                audio_vol_l = cd_audio_volume_lut[255];
+                audio_vol_r = cd_audio_volume_lut[255];
+            }
 
-        temp_buffer[0] = temp_buffer[1] = 0;
+            if (cdrom[i].get_channel) {
+                channel_select[0] = (int) cdrom[i].get_channel(cdrom[i].priv, 0);
+                channel_select[1] = (int) cdrom[i].get_channel(cdrom[i].priv, 1);
+            } else {
+                channel_select[0] = 1;
+                channel_select[1] = 2;
+            }
 
-        for (uint8_t i = 0; i < CDROM_NUM; i++) {
-            /* Just in case the thread is in a loop when it gets terminated. */
-            if (!cdaudioon)
-                break;
+            // uint16_t *cddab = (uint16_t *) cdrom[i].raw_buffer;
+            for (int c = 0; c < CD_BUFLEN * 2; c += 2) {
+                /* Apply ATAPI channel select */
+                cd_buffer_temp[0] = cd_buffer_temp[1] = 0.0;
+
+                if ((audio_vol_l != 0.0) && (channel_select[0] != 0)) {
+                    if (channel_select[0] & 1)
+                        /* Channel 0 => Port 0 */
+                        cd_buffer_temp[0] += ((double) cd_buffer[i][c]);
+                    if (channel_select[0] & 2)
+                        /* Channel 1 => Port 0 */
+                        cd_buffer_temp[0] += ((double) cd_buffer[i][c + 1]);
+
+                    /* Multiply Port 0 by Port 0 volume */
+                    cd_buffer_temp[0] *= audio_vol_l;
+                }
 
-            if ((cdrom[i].bus_type == CDROM_BUS_DISABLED) ||
-                (cdrom[i].cd_status != CD_STATUS_PLAYING))
-                continue;
-            const int ret = cdrom_audio_callback(&(cdrom[i]), cd_buffer[i],
-                                                 CD_BUFLEN * 2);
+                if ((audio_vol_r != 0.0) && (channel_select[1] != 0)) {
+                    if (channel_select[1] & 1)
+                        /* Channel 0 => Port 1 */
+                        cd_buffer_temp[1] += ((double) cd_buffer[i][c]);
+                    if (channel_select[1] & 2)
+                        /* Channel 1 => Port 1 */
+                        cd_buffer_temp[1] += ((double) cd_buffer[i][c + 1]);
 
-            if (ret) {
-                if (cdrom[i].get_volume) {
-                    audio_vol_l = cd_audio_volume_lut[cdrom[i].get_volume(cdrom[i].priv, 0)];
-                    audio_vol_r = cd_audio_volume_lut[cdrom[i].get_volume(cdrom[i].priv, 1)];
-                } else {
-                    audio_vol_l = cd_audio_volume_lut[255];
-                    audio_vol_r = cd_audio_volume_lut[255];
+                    /* Multiply Port 1 by Port 1 volume */
+                    cd_buffer_temp[1] *= audio_vol_r;
                 }
 
-                if (cdrom[i].get_channel) {
-                    channel_select[0] = (int) cdrom[i].get_channel(cdrom[i].priv, 0);
-                    channel_select[1] = (int) cdrom[i].get_channel(cdrom[i].priv, 1);
-                } else {
-                    channel_select[0] = 1;
-                    channel_select[1] = 2;
+                /* Apply sound card CD volume and filters */
+                if (filter_cd_audio != NULL) {
+                    filter_cd_audio(0, &(cd_buffer_temp[0]),
+                                    filter_cd_audio_p);
+                    filter_cd_audio(1, &(cd_buffer_temp[1]),
+                                    filter_cd_audio_p);
                 }
 
-                // uint16_t *cddab = (uint16_t *) cdrom[i].raw_buffer;
-                for (int c = 0; c < CD_BUFLEN * 2; c += 2) {
-                    /* Apply ATAPI channel select */
-                    cd_buffer_temp[0] = cd_buffer_temp[1] = 0.0;
-
-                    if ((audio_vol_l != 0.0) && (channel_select[0] != 0)) {
-                        if (channel_select[0] & 1)
-                            /* Channel 0 => Port 0 */
-                            cd_buffer_temp[0] += ((double) cd_buffer[i][c]);
-                        if (channel_select[0] & 2)
-                            /* Channel 1 => Port 0 */
-                            cd_buffer_temp[0] += ((double) cd_buffer[i][c + 1]);
-
-                        /* Multiply Port 0 by Port 0 volume */
-                        cd_buffer_temp[0] *= audio_vol_l;
-                    }
-
-                    if ((audio_vol_r != 0.0) && (channel_select[1] != 0)) {
-                        if (channel_select[1] & 1)
-                            /* Channel 0 => Port 1 */
-                            cd_buffer_temp[1] += ((double) cd_buffer[i][c]);
-                        if (channel_select[1] & 2)
-                            /* Channel 1 => Port 1 */
-                            cd_buffer_temp[1] += ((double) cd_buffer[i][c + 1]);
-
-                        /* Multiply Port 1 by Port 1 volume */
-                        cd_buffer_temp[1] *= audio_vol_r;
-                    }
-
-                    /* Apply sound card CD volume and filters */
-                    if (filter_cd_audio != NULL) {
-                        filter_cd_audio(0, &(cd_buffer_temp[0]),
-                                        filter_cd_audio_p);
-                        filter_cd_audio(1, &(cd_buffer_temp[1]),
-                                        filter_cd_audio_p);
-                    }
-
-                    if (sound_is_float) {
-                        cd_out_buffer[c] += (float) (cd_buffer_temp[0] / 32768.0);
-                        cd_out_buffer[c + 1] += (float) (cd_buffer_temp[1] / 32768.0);
-                    } else {
-                        temp_buffer[0] = (int) trunc(cd_buffer_temp[0]);
-                        temp_buffer[1] = (int) trunc(cd_buffer_temp[1]);
-
-                        if (temp_buffer[0] > 32767)
-                            temp_buffer[0] = 32767;
-                        if (temp_buffer[0] < -32768)
-                            temp_buffer[0] = -32768;
-                        if (temp_buffer[1] > 32767)
-                            temp_buffer[1] = 32767;
-                        if (temp_buffer[1] < -32768)
-                            temp_buffer[1] = -32768;
-
-                        cd_out_buffer_int16[c]     += (int16_t) temp_buffer[0];
-                        cd_out_buffer_int16[c + 1] += (int16_t) temp_buffer[1];
-                    }
+                if (sound_is_float) {
+                    cd_out_buffer[c] += (float) (cd_buffer_temp[0] / 32768.0);
+                    cd_out_buffer[c + 1] += (float) (cd_buffer_temp[1] / 32768.0);
+                } else {
+                    temp_buffer[0] = (int) trunc(cd_buffer_temp[0]);
+                    temp_buffer[1] = (int) trunc(cd_buffer_temp[1]);
+
+                    if (temp_buffer[0] > 32767)
+                        temp_buffer[0] = 32767;
+                    if (temp_buffer[0] < -32768)
+                        temp_buffer[0] = -32768;
+                    if (temp_buffer[1] > 32767)
+                        temp_buffer[1] = 32767;
+                    if (temp_buffer[1] < -32768)
+                        temp_buffer[1] = -32768;
+
+                    cd_out_buffer_int16[c]     += (int16_t) temp_buffer[0];
+                    cd_out_buffer_int16[c + 1] += (int16_t) temp_buffer[1];
                 }
             }
         }
+    }
 
-        if (sound_is_float)
-            givealbuffer_cd(cd_out_buffer);
-        else
-            givealbuffer_cd(cd_out_buffer_int16);
+    if (sound_mixer_enabled)
+        sound_mixer_push(SOUND_MIXER_CD, sound_is_float ? (void *) cd_out_buffer : (void *) cd_out_buffer_int16,
+                         CD_BUFLEN * 2);
+    else if (sound_is_float)
+        givealbuffer_cd(cd_out_buffer);
+    else
+        givealbuffer_cd(cd_out_buffer_int16);
+}
+
+static void
+sound_cd_thread(UNUSED(void *param))
+{
+    thread_set_event(sound_cd_start_event);
+
+    while (cdaudioon) {
+        thread_wait_event(sound_cd_event, -1);
+        thread_reset_event(sound_cd_event);
+
+        if (!cdaudioon)
+            return;
+
+        sound_cd_render();
     }
 }
 
@@ -428,10 +489,12 @@ sound_realloc_buffers(void)
         outbuffer_ex_int16 = NULL;
     }
 
-    if (sound_is_float) {
+    /* The mixer works in float, whatever the output format. */
+    if (sound_is_float || sound_mixer_enabled) {
         outbuffer_ex = calloc(SOUNDBUFLEN * 2, sizeof(float));
         memset(outbuffer_ex, 0x00, SOUNDBUFLEN * 2 * sizeof(float));
-    } else {
+    }
+    if (!sound_is_float) {
         outbuffer_ex_int16 = calloc(SOUNDBUFLEN * 2, sizeof(int16_t));
         memset(outbuffer_ex_int16, 0x00, SOUNDBUFLEN * 2 * sizeof(int16_t));
     }
@@ -543,27 +606,89 @@ sound_init(void)
     cd_thread_enable = available_cdrom_drives ? 1 : 0;
 }
 
+static void
+sound_handler_init(sound_handler_t *handler, void (*get_buffer)(int32_t *buffer, int len, void *priv), void *priv)
+{
+    const device_t *dev = device_context_get_device();
+
+    handler->get_buffer = get_buffer;
+    handler->priv       = priv;
+    handler->name       = ((dev != NULL) && (dev->internal_name != NULL)) ? dev->internal_name : "unknown";
+    handler->time       = 0;
+    handler->calls      = 0;
+}
+
+/* Render one buffer of every handler of a stream, keeping track of the
+   time each one takes. When the handlers are captured separately, each
+   one renders on its own into a scratch buffer first. */
+static void
+sound_handlers_render(sound_handler_t *handlers, int num, int stream, int32_t *buffer, int len)
+{
+    sound_handler_t *handler;
+    uint64_t         start;
+    int32_t         *dest = buffer;
+
+    for (int c = 0; c < num; c++) {
+        handler = &handlers[c];
+
+        if (sound_capture_split) {
+            dest = capture_buffer;
+            memset(dest, 0x00, len * 2 * sizeof(int32_t));
+        }
+
+        start = plat_timer_read();
+        handler->get_buffer(dest, len, handler->priv);
+        handler->time += plat_timer_read() - start;
+        handler->calls++;
+
+        if (dest != buffer) {
+            sound_capture_handler(stream, c, handler->name, dest, len);
+            for (int i = 0; i < len * 2; i++)
+                buffer[i] += dest[i];
+        }
+    }
+}
+
+static void
+sound_handlers_print(const char *stream, const sound_handler_t *handlers, int num)
+{
+    double secs;
+
+    for (int c = 0; c < num; c++) {
+        secs = (double) handlers[c].time / (double) timer_freq;
+        printf("  %-6s %-24s %9.3f s in %" PRIu64 " buffers (%.1f us each)\n",
+                stream, handlers[c].name, secs, handlers[c].calls,
+                handlers[c].calls ? ((secs * 1000000.0) / (double) handlers[c].calls) : 0.0);
+    }
+}
+
+void
+sound_print_handler_times(void)
+{
+    printf("Sound handler host time:\n");
+    sound_handlers_print("sound", sound_handlers, sound_handlers_num);
+    sound_handlers_print("music", music_handlers, music_handlers_num);
+    sound_handlers_print("wt", wavetable_handlers, wavetable_handlers_num);
+}
+
 void
 sound_add_handler(void (*get_buffer)(int32_t *buffer, int len, void *priv), void *priv)
 {
-    sound_handlers[sound_handlers_num].get_buffer = get_buffer;
-    sound_handlers[sound_handlers_num].priv       = priv;
+    sound_handler_init(&sound_handlers[sound_handlers_num], get_buffer, priv);
     sound_handlers_num++;
 }
 
 void
 music_add_handler(void (*get_buffer)(int32_t *buffer, int len, void *priv), void *priv)
 {
-    music_handlers[music_handlers_num].get_buffer = get_buffer;
-    music_handlers[music_handlers_num].priv       = priv;
+    sound_handler_init(&music_handlers[music_handlers_num], get_buffer, priv);
     music_handlers_num++;
 }
 
 void
 wavetable_add_handler(void (*get_buffer)(int32_t *buffer, int len, void *priv), void *priv)
 {
-    wavetable_handlers[wavetable_handlers_num].get_buffer = get_buffer;
-    wavetable_handlers[wavetable_handlers_num].priv       = priv;
+    sound_handler_init(&wavetable_handlers[wavetable_handlers_num], get_buffer, priv);
     wavetable_handlers_num++;
 }
 
@@ -598,41 +723,61 @@ sound_poll(UNUSED(void *priv))
 
         memset(outbuffer, 0x00, SOUNDBUFLEN * 2 * sizeof(int32_t));
 
-        for (c = 0; c < sound_handlers_num; c++)
-            sound_handlers[c].get_buffer(outbuffer, SOUNDBUFLEN, sound_handlers[c].priv);
-
-        for (c = 0; c < SOUNDBUFLEN * 2; c++) {
-            if (sound_is_float)
-                outbuffer_ex[c] = ((float) outbuffer[c]) / (float) 32768.0;
-            else {
-                if (outbuffer[c] > 32767)
-                    outbuffer[c] = 32767;
-                if (outbuffer[c] < -32768)
-                    outbuffer[c] = -32768;
-
-                outbuffer_ex_int16[c] = (int16_t) outbuffer[c];
+        sound_handlers_render(sound_handlers, sound_handlers_num, SOUND_CAPTURE_SOUND, outbuffer, SOUNDBUFLEN);
+
+        if (sound_mixer_enabled) {
+            sound_mixer_int32_to_float(outbuffer, outbuffer_ex, SOUNDBUFLEN * 2);
+            sound_mixer_mix(outbuffer_ex, SOUNDBUFLEN);
+            if (!sound_is_float)
+                sound_mixer_float_to_int16(outbuffer_ex, outbuffer_ex_int16, SOUNDBUFLEN * 2);
+        } else {
+            for (c = 0; c < SOUNDBUFLEN * 2; c++) {
+                if (sound_is_float)
+                    outbuffer_ex[c] = ((float) outbuffer[c]) / (float) 32768.0;
+                else {
+                    if (outbuffer[c] > 32767)
+                        outbuffer[c] = 32767;
+                    if (outbuffer[c] < -32768)
+                        outbuffer[c] = -32768;
+
+                    outbuffer_ex_int16[c] = (int16_t) outbuffer[c];
+                }
             }
         }
 
+        if (sound_capture_enabled)
+            sound_capture_write(sound_is_float ? (void *) outbuffer_ex : (void *) outbuffer_ex_int16, SOUNDBUFLEN);
+
         if (sound_is_float)
             givealbuffer(outbuffer_ex);
         else
             givealbuffer(outbuffer_ex_int16);
 
+        /* When capturing, render the drive streams right here, so they
+           always land at the same place in the output. */
         if (cd_thread_enable) {
             cd_buf_update--;
             if (!cd_buf_update) {
                 cd_buf_update = (SOUND_FREQ / SOUNDBUFLEN) / (CD_FREQ / CD_BUFLEN);
-                thread_set_event(sound_cd_event);
+                if (sound_capture_enabled)
+                    sound_cd_render();
+                else
+                    thread_set_event(sound_cd_event);
             }
         }
 
         if (fdd_thread_enable) {
-            thread_set_event(sound_fdd_event);
+            if (sound_capture_enabled)
+                sound_fdd_render();
+            else
+                thread_set_event(sound_fdd_event);
         }
 
         if (hdd_thread_enable) {
-            thread_set_event(sound_hdd_event);
+            if (sound_capture_enabled)
+                sound_hdd_render();
+            else
+                thread_set_event(sound_hdd_event);
         }
         sound_pos_global = 0;
     }
@@ -644,13 +789,17 @@ music_poll(UNUSED(void *priv))
     timer_advance_u64(&music_poll_timer, music_poll_latch);
 
     music_pos_global++;
+    atomic_store_explicit(&music_synth_time, atomic_load_explicit(&music_synth_time, memory_order_relaxed) + 1,
+                          memory_order_release);
+    if (music_synth_on && !(music_pos_global & (MUSIC_SYNTH_KICK - 1)))
+        thread_set_event(music_synth_event);
+
     if (music_pos_global == MUSICBUFLEN) {
         int c;
 
         memset(outbuffer_m, 0x00, MUSICBUFLEN * 2 * sizeof(int32_t));
 
-        for (c = 0; c < music_handlers_num; c++)
-            music_handlers[c].get_buffer(outbuffer_m, MUSICBUFLEN, music_handlers[c].priv);
+        sound_handlers_render(music_handlers, music_handlers_num, SOUND_CAPTURE_MUSIC, outbuffer_m, MUSICBUFLEN);
 
         for (c = 0; c < MUSICBUFLEN * 2; c++) {
             if (sound_is_float)
@@ -665,7 +814,10 @@ music_poll(UNUSED(void *priv))
             }
         }
 
-        if (sound_is_float)
+        if (sound_mixer_enabled)
+            sound_mixer_push(SOUND_MIXER_MUSIC, sound_is_float ? (void *) outbuffer_m_ex : (void *) outbuffer_m_ex_int16,
+                             MUSICBUFLEN * 2);
+        else if (sound_is_float)
             givealbuffer_music(outbuffer_m_ex);
         else
             givealbuffer_music(outbuffer_m_ex_int16);
@@ -685,8 +837,7 @@ wavetable_poll(UNUSED(void *priv))
 
         memset(outbuffer_w, 0x00, WTBUFLEN * 2 * sizeof(int32_t));
 
-        for (c = 0; c < wavetable_handlers_num; c++)
-            wavetable_handlers[c].get_buffer(outbuffer_w, WTBUFLEN, wavetable_handlers[c].priv);
+        sound_handlers_render(wavetable_handlers, wavetable_handlers_num, SOUND_CAPTURE_WT, outbuffer_w, WTBUFLEN);
 
         for (c = 0; c < WTBUFLEN * 2; c++) {
             if (sound_is_float)
@@ -701,7 +852,10 @@ wavetable_poll(UNUSED(void *priv))
             }
         }
 
-        if (sound_is_float)
+        if (sound_mixer_enabled)
+            sound_mixer_push(SOUND_MIXER_WT, sound_is_float ? (void *) outbuffer_w_ex : (void *) outbuffer_w_ex_int16,
+                             WTBUFLEN * 2);
+        else if (sound_is_float)
             givealbuffer_wt(outbuffer_w_ex);
         else
             givealbuffer_wt(outbuffer_w_ex_int16);
@@ -723,6 +877,11 @@ sound_speed_changed(void)
 void
 sound_reset(void)
 {
+    /* Before the MIDI devices, which set the rate of their stream. */
+    sound_mixer_init();
+
+    sound_capture_mark("reset");
+
     sound_realloc_buffers();
 
     music_realloc_buffers();
@@ -732,7 +891,9 @@ sound_reset(void)
     midi_out_device_init();
     midi_in_device_init();
 
-    inital();
+    /* Batch runs are headless, do not open an audio device at all. */
+    if (!batch_mode)
+        inital();
 
     timer_add(&sound_poll_timer, sound_poll, NULL, 1);
     sound_handlers_num = 0;
@@ -758,6 +919,23 @@ sound_reset(void)
     midi_in_handlers_clear();
 }
 
+/* Used by the MIDI synthesizers rendering on their own thread. */
+void
+sound_set_midi_rate(int freq, int buf_size)
+{
+    al_set_midi(freq, buf_size);
+    sound_mixer_set_rate(SOUND_MIXER_MIDI, freq);
+}
+
+void
+sound_give_midi_buffer(const void *buf, uint32_t size)
+{
+    if (sound_mixer_enabled)
+        sound_mixer_push(SOUND_MIXER_MIDI, buf, (int) size);
+    else
+        givealbuffer_midi(buf, size);
+}
+
 void
 sound_card_reset(void)
 {
@@ -820,6 +998,19 @@ sound_cd_thread_reset(void)
     cd_thread_enable = available_cdrom_drives ? 1 : 0;
 }
 
+static void
+sound_fdd_render(void)
+{
+    static float fdd_float_buffer[SOUNDBUFLEN * 2];
+
+    memset(fdd_float_buffer, 0, sizeof(fdd_float_buffer));
+    fdd_audio_callback((int16_t*)fdd_float_buffer, SOUNDBUFLEN * 2);
+    if (sound_mixer_enabled)
+        sound_mixer_push(SOUND_MIXER_FDD, fdd_float_buffer, SOUNDBUFLEN * 2);
+    else
+        givealbuffer_fdd(fdd_float_buffer, SOUNDBUFLEN * 2);
+}
+
 static void
 sound_fdd_thread(UNUSED(void *param))
 {
@@ -831,10 +1022,7 @@ sound_fdd_thread(UNUSED(void *param))
         if (!fddaudioon)
             break;
 
-        static float fdd_float_buffer[SOUNDBUFLEN * 2];
-        memset(fdd_float_buffer, 0, sizeof(fdd_float_buffer));
-        fdd_audio_callback((int16_t*)fdd_float_buffer, SOUNDBUFLEN * 2);
-        givealbuffer_fdd(fdd_float_buffer, SOUNDBUFLEN * 2);
+        sound_fdd_render();
     }
 }
 
@@ -878,6 +1066,19 @@ sound_fdd_thread_end(void)
     }
 }
 
+static void
+sound_hdd_render(void)
+{
+    static float hdd_float_buffer[SOUNDBUFLEN * 2];
+
+    memset(hdd_float_buffer, 0, sizeof(hdd_float_buffer));
+    hdd_audio_callback((int16_t*)hdd_float_buffer, SOUNDBUFLEN * 2);
+    if (sound_mixer_enabled)
+        sound_mixer_push(SOUND_MIXER_HDD, hdd_float_buffer, SOUNDBUFLEN * 2);
+    else
+        givealbuffer_hdd(hdd_float_buffer, SOUNDBUFLEN * 2);
+}
+
 static void
 sound_hdd_thread(UNUSED(void *param))
 {
@@ -889,10 +1090,7 @@ sound_hdd_thread(UNUSED(void *param))
         if (!hddaudioon)
             break;
 
-        static float hdd_float_buffer[SOUNDBUFLEN * 2];
-        memset(hdd_float_buffer, 0, sizeof(hdd_float_buffer));
-        hdd_audio_callback((int16_t*)hdd_float_buffer, SOUNDBUFLEN * 2);
-        givealbuffer_hdd(hdd_float_buffer, SOUNDBUFLEN * 2);
+        sound_hdd_render();
     }
 }
 
@@ -933,3 +1131,209 @@ sound_hdd_thread_end(void)
     }
 }
 
+
+/* Asynchronous music synthesis.
+
+   Instead of rendering a chip's output on the emulation thread, every time
+   a register is written to and at the end of every buffer, a device can
+   hand the chip over to the synthesis thread. Register writes are then
+   queued, stamped with the music stream sample they happened at, and the
+   synthesis thread renders the samples in between, applying each write at
+   the sample it was stamped with, so the output is the same as it would be
+   if rendered synchronously. The emulation thread only has to wait for the
+   synthesis thread to catch up at the end of each buffer. */
+static void
+music_synth_render(music_synth_t *synth, uint32_t target)
+{
+    uint32_t time = atomic_load_explicit(&synth->time, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&synth->tail, memory_order_relaxed);
+    uint32_t head;
+    uint32_t until;
+    int      len;
+
+    for (;;) {
+        head  = atomic_load_explicit(&synth->head, memory_order_acquire);
+        until = target;
+
+        while (tail != head) {
+            const music_synth_event_t *ev = &synth->ring[tail & MUSIC_SYNTH_RING_MASK];
+
+            if ((int32_t) (ev->time - time) > 0) {
+                /* The emulation thread may have moved on since target was read. */
+                if ((int32_t) (ev->time - target) < 0)
+                    until = ev->time;
+                break;
+            }
+
+            synth->write(synth->priv, ev->reg, ev->val);
+            tail++;
+        }
+        atomic_store_explicit(&synth->tail, tail, memory_order_release);
+
+        /* Writes due at the target are applied too, so the ring can always be drained. */
+        if (time == target)
+            break;
+
+        len = (int) (until - time);
+        if (len > (MUSICBUFLEN - synth->pos))
+            len = MUSICBUFLEN - synth->pos;
+
+        synth->generate(synth->priv, &synth->buffer[synth->pos * 2], len);
+        synth->pos += len;
+        if (synth->pos >= MUSICBUFLEN)
+            synth->pos = 0;
+
+        time += len;
+        atomic_store_explicit(&synth->time, time, memory_order_release);
+    }
+}
+
+static void
+music_synth_thread(UNUSED(void *param))
+{
+    thread_set_event(music_synth_start_event);
+    while (music_synth_on) {
+        thread_wait_event(music_synth_event, -1);
+        thread_reset_event(music_synth_event);
+
+        if (!music_synth_on)
+            break;
+
+        thread_wait_mutex(music_synth_mutex);
+        uint32_t target = atomic_load_explicit(&music_synth_time, memory_order_acquire);
+        for (music_synth_t *synth = music_synths; synth != NULL; synth = synth->next)
+            music_synth_render(synth, target);
+        thread_release_mutex(music_synth_mutex);
+
+        thread_set_event(music_synth_done_event);
+    }
+}
+
+static void
+music_synth_thread_init(void)
+{
+    music_synth_on = 1;
+
+    music_synth_mutex       = thread_create_mutex();
+    music_synth_start_event = thread_create_event();
+    music_synth_done_event  = thread_create_event();
+    music_synth_event       = thread_create_event();
+    music_synth_thread_h    = thread_create(music_synth_thread, NULL);
+
+    sound_log("Waiting for music synthesis start event...\n");
+    thread_wait_event(music_synth_start_event, -1);
+    thread_reset_event(music_synth_start_event);
+    sound_log("Done!\n");
+}
+
+static void
+music_synth_thread_end(void)
+{
+    music_synth_on = 0;
+
+    sound_log("Waiting for music synthesis thread to terminate...\n");
+    thread_set_event(music_synth_event);
+    thread_wait(music_synth_thread_h);
+    sound_log("Music synthesis thread terminated...\n");
+
+    thread_destroy_event(music_synth_event);
+    thread_destroy_event(music_synth_done_event);
+    thread_destroy_event(music_synth_start_event);
+    thread_close_mutex(music_synth_mutex);
+
+    music_synth_event       = NULL;
+    music_synth_done_event  = NULL;
+    music_synth_start_event = NULL;
+    music_synth_mutex       = NULL;
+    music_synth_thread_h    = NULL;
+}
+
+/* Hand a chip over to the synthesis thread. From then on, generate() and
+   write() are only called from that thread; generate() renders len samples
+   of the music stream into buffer, which holds MUSICBUFLEN stereo samples
+   and is filled in the same order as music_pos_global. */
+music_synth_t *
+music_synth_add(void (*generate)(void *priv, int32_t *buffer, int len),
+                void (*write)(void *priv, uint16_t reg, uint8_t val),
+                void *priv, int32_t *buffer)
+{
+    music_synth_t *synth = calloc(1, sizeof(music_synth_t));
+
+    synth->generate = generate;
+    synth->write    = write;
+    synth->priv     = priv;
+    synth->buffer   = buffer;
+    synth->pos      = music_pos_global;
+    atomic_init(&synth->head, 0);
+    atomic_init(&synth->tail, 0);
+    atomic_init(&synth->time, atomic_load(&music_synth_time));
+
+    if (!music_synth_on)
+        music_synth_thread_init();
+
+    thread_wait_mutex(music_synth_mutex);
+    synth->next  = music_synths;
+    music_synths = synth;
+    thread_release_mutex(music_synth_mutex);
+
+    return synth;
+}
+
+void
+music_synth_remove(music_synth_t *synth)
+{
+    music_synth_t **prev;
+
+    if (synth == NULL)
+        return;
+
+    thread_wait_mutex(music_synth_mutex);
+    for (prev = &music_synths; *prev != NULL; prev = &(*prev)->next) {
+        if (*prev == synth) {
+            *prev = synth->next;
+            break;
+        }
+    }
+    thread_release_mutex(music_synth_mutex);
+
+    free(synth);
+
+    if (music_synths == NULL)
+        music_synth_thread_end();
+}
+
+/* Queue a register write, it is applied before the sample at the current
+   music stream position is rendered. */
+void
+music_synth_write(music_synth_t *synth, uint16_t reg, uint8_t val)
+{
+    uint32_t             head = atomic_load_explicit(&synth->head, memory_order_relaxed);
+    music_synth_event_t *ev;
+
+    /* The ring is full, let the synthesis thread catch up. */
+    while ((head - atomic_load_explicit(&synth->tail, memory_order_acquire)) >= MUSIC_SYNTH_RING_SIZE) {
+        thread_set_event(music_synth_event);
+        thread_wait_event(music_synth_done_event, 1);
+        thread_reset_event(music_synth_done_event);
+    }
+
+    ev       = &synth->ring[head & MUSIC_SYNTH_RING_MASK];
+    ev->time = atomic_load_explicit(&music_synth_time, memory_order_relaxed);
+    ev->reg  = reg;
+    ev->val  = val;
+    atomic_store_explicit(&synth->head, head + 1, memory_order_release);
+}
+
+/* Wait for the synthesis thread to render up to the current music stream
+   position, the chip's buffer is then complete up to music_pos_global. */
+void
+music_synth_sync(music_synth_t *synth)
+{
+    uint32_t target = atomic_load_explicit(&music_synth_time, memory_order_relaxed);
+
+    while (atomic_load_explicit(&synth->time, memory_order_acquire) != target) {
+        thread_reset_event(music_synth_done_event);
+        thread_set_event(music_synth_event);
+        thread_wait_event(music_synth_done_event, -1);
+    }
+}
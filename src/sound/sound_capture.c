@@ -0,0 +1,315 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Offline sound capture.
+ *
+ *          Samples are written as they are produced, the RIFF sizes are
+ *          patched and the cue points appended when the file is closed.
+ *          The main stream is written in the output format, the handler
+ *          streams as 16-bit PCM, clamped the same way as the mix.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/timer.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+#include <86box/sound.h>
+#include <86box/sound_capture.h>
+
+#define CAPTURE_HANDLERS 8
+#define CAPTURE_CHUNK    1024 /* samples converted at a time */
+
+typedef struct capture_mark_t {
+    uint32_t pos;
+    char     label[64];
+} capture_mark_t;
+
+typedef struct capture_file_t {
+    FILE    *fp;
+    int      failed;
+    int      sample_size;
+    uint32_t frames;
+
+    capture_mark_t *marks;
+    int             marks_num;
+    int             marks_size;
+} capture_file_t;
+
+int  sound_capture_enabled = 0;
+int  sound_capture_split   = 0;
+char sound_capture_path[1024];
+
+static capture_file_t capture_main;
+static capture_file_t capture_handlers[SOUND_CAPTURE_STREAMS][CAPTURE_HANDLERS];
+static int16_t        capture_buf[CAPTURE_CHUNK];
+
+static const char *capture_stream_names[SOUND_CAPTURE_STREAMS] = { "sound", "music", "wt" };
+static const int   capture_stream_freqs[SOUND_CAPTURE_STREAMS] = { SOUND_FREQ, MUSIC_FREQ, WT_FREQ };
+
+#ifdef ENABLE_SOUND_CAPTURE_LOG
+int sound_capture_do_log = ENABLE_SOUND_CAPTURE_LOG;
+
+static void
+sound_capture_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (sound_capture_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define sound_capture_log(fmt, ...)
+#endif
+
+static void
+capture_put_le(uint8_t *p, uint32_t val, int size)
+{
+    for (int i = 0; i < size; i++)
+        p[i] = (val >> (i << 3)) & 0xff;
+}
+
+static void
+capture_write_chunk(FILE *fp, const char *id, uint32_t size)
+{
+    uint8_t hdr[8];
+
+    memcpy(hdr, id, 4);
+    capture_put_le(&hdr[4], size, 4);
+    fwrite(hdr, 1, 8, fp);
+}
+
+static int
+capture_open(capture_file_t *file, const char *fn, int freq, int format, int bits)
+{
+    uint8_t fmt[16];
+
+    file->fp = plat_fopen(fn, "wb");
+    if (file->fp == NULL) {
+        pclog("Sound capture: unable to create '%s'\n", fn);
+        return 0;
+    }
+
+    file->sample_size = bits >> 3;
+    file->frames      = 0;
+
+    /* The RIFF and data sizes are filled in on close. */
+    capture_write_chunk(file->fp, "RIFF", 0);
+    fwrite("WAVE", 1, 4, file->fp);
+
+    capture_put_le(&fmt[0], format, 2);
+    capture_put_le(&fmt[2], 2, 2);
+    capture_put_le(&fmt[4], freq, 4);
+    capture_put_le(&fmt[8], freq * 2 * file->sample_size, 4);
+    capture_put_le(&fmt[12], 2 * file->sample_size, 2);
+    capture_put_le(&fmt[14], bits, 2);
+    capture_write_chunk(file->fp, "fmt ", sizeof(fmt));
+    fwrite(fmt, 1, sizeof(fmt), file->fp);
+
+    capture_write_chunk(file->fp, "data", 0);
+
+    sound_capture_log("Sound capture: writing %i Hz, %i-bit to '%s'\n", freq, bits, fn);
+
+    return 1;
+}
+
+static void
+capture_add_mark(capture_file_t *file, uint32_t pos, const char *label)
+{
+    if (file->marks_num == file->marks_size) {
+        file->marks_size = file->marks_size ? (file->marks_size << 1) : 64;
+        file->marks      = realloc(file->marks, file->marks_size * sizeof(capture_mark_t));
+        if (file->marks == NULL)
+            fatal("Sound capture: out of memory\n");
+    }
+
+    file->marks[file->marks_num].pos = pos;
+    snprintf(file->marks[file->marks_num].label, sizeof(file->marks[0].label), "%s", label);
+    file->marks_num++;
+}
+
+/* Cue points go after the data chunk, with their labels in an associated
+   data list, which is where most editors look for them. */
+static void
+capture_write_marks(capture_file_t *file)
+{
+    uint8_t  cue[24];
+    uint32_t size;
+    int      len;
+
+    if (!file->marks_num)
+        return;
+
+    capture_write_chunk(file->fp, "cue ", 4 + (file->marks_num * 24));
+    capture_put_le(cue, file->marks_num, 4);
+    fwrite(cue, 1, 4, file->fp);
+    for (int i = 0; i < file->marks_num; i++) {
+        capture_put_le(&cue[0], i + 1, 4);
+        capture_put_le(&cue[4], file->marks[i].pos, 4);
+        memcpy(&cue[8], "data", 4);
+        capture_put_le(&cue[12], 0, 4);
+        capture_put_le(&cue[16], 0, 4);
+        capture_put_le(&cue[20], file->marks[i].pos, 4);
+        fwrite(cue, 1, 24, file->fp);
+    }
+
+    size = 4;
+    for (int i = 0; i < file->marks_num; i++) {
+        len = (int) strlen(file->marks[i].label) + 1;
+        size += 12 + ((len + 1) & ~1);
+    }
+
+    capture_write_chunk(file->fp, "LIST", size);
+    fwrite("adtl", 1, 4, file->fp);
+    for (int i = 0; i < file->marks_num; i++) {
+        len = (int) strlen(file->marks[i].label) + 1;
+        capture_write_chunk(file->fp, "labl", 4 + len);
+        capture_put_le(cue, i + 1, 4);
+        fwrite(cue, 1, 4, file->fp);
+        fwrite(file->marks[i].label, 1, len, file->fp);
+        if (len & 1)
+            fputc(0, file->fp);
+    }
+}
+
+static void
+capture_close(capture_file_t *file)
+{
+    uint8_t  size[4];
+    uint32_t data_size;
+    long     end;
+
+    if (file->fp == NULL)
+        return;
+
+    data_size = file->frames * 2 * file->sample_size;
+
+    fseek(file->fp, 0, SEEK_END);
+    capture_write_marks(file);
+    end = ftell(file->fp);
+
+    capture_put_le(size, (uint32_t) (end - 8), 4);
+    fseek(file->fp, 4, SEEK_SET);
+    fwrite(size, 1, 4, file->fp);
+
+    capture_put_le(size, data_size, 4);
+    fseek(file->fp, 40, SEEK_SET);
+    fwrite(size, 1, 4, file->fp);
+
+    fclose(file->fp);
+    file->fp = NULL;
+
+    free(file->marks);
+    file->marks      = NULL;
+    file->marks_num  = 0;
+    file->marks_size = 0;
+}
+
+void
+sound_capture_write(const void *buf, int len)
+{
+    char     label[64];
+    uint32_t second;
+
+    if (capture_main.fp == NULL) {
+        if (capture_main.failed)
+            return;
+        if (sound_is_float)
+            capture_main.failed = !capture_open(&capture_main, sound_capture_path, SOUND_FREQ, 3, 32);
+        else
+            capture_main.failed = !capture_open(&capture_main, sound_capture_path, SOUND_FREQ, 1, 16);
+        if (capture_main.failed)
+            return;
+    }
+
+    /* Mark every second of guest time with the time stamp counter, to
+       line the audio up with the rest of the emulation. */
+    second = capture_main.frames / SOUND_FREQ;
+    if ((capture_main.frames + len) / SOUND_FREQ != second) {
+        snprintf(label, sizeof(label), "%u s, tsc %" PRIu64, second + 1, tsc);
+        capture_add_mark(&capture_main, (second + 1) * SOUND_FREQ, label);
+    }
+
+    fwrite(buf, 2 * capture_main.sample_size, len, capture_main.fp);
+    capture_main.frames += len;
+}
+
+void
+sound_capture_handler(int stream, int idx, const char *name, const int32_t *buf, int len)
+{
+    capture_file_t *file;
+    char            fn[1024 + 64];
+    char            base[1024];
+    char           *ext;
+
+    if ((stream >= SOUND_CAPTURE_STREAMS) || (idx >= CAPTURE_HANDLERS))
+        return;
+
+    file = &capture_handlers[stream][idx];
+    if (file->fp == NULL) {
+        if (file->failed)
+            return;
+
+        /* <base>.<stream><index>-<device>.wav, next to the main file. */
+        snprintf(base, sizeof(base), "%s", sound_capture_path);
+        ext = path_get_extension(base);
+        if (!strcasecmp(ext, "wav") && (ext > base))
+            ext[-1] = '\0';
+        snprintf(fn, sizeof(fn), "%s.%s%i-%s.wav", base, capture_stream_names[stream], idx, name);
+
+        if (!capture_open(file, fn, capture_stream_freqs[stream], 1, 16)) {
+            file->failed = 1;
+            return;
+        }
+    }
+
+    /* The handlers render 16-bit range samples into 32-bit integers, with
+       no clamping until the mix. */
+    for (int i = 0; i < len; i += (CAPTURE_CHUNK >> 1)) {
+        int frames = ((len - i) > (CAPTURE_CHUNK >> 1)) ? (CAPTURE_CHUNK >> 1) : (len - i);
+
+        for (int c = 0; c < (frames << 1); c++) {
+            int32_t val = buf[(i << 1) + c];
+
+            if (val > 32767)
+                val = 32767;
+            if (val < -32768)
+                val = -32768;
+            capture_buf[c] = (int16_t) val;
+        }
+
+        fwrite(capture_buf, 2 * sizeof(int16_t), frames, file->fp);
+    }
+    file->frames += len;
+}
+
+void
+sound_capture_mark(const char *label)
+{
+    if (capture_main.fp != NULL)
+        capture_add_mark(&capture_main, capture_main.frames, label);
+}
+
+void
+sound_capture_close(void)
+{
+    capture_close(&capture_main);
+
+    for (int s = 0; s < SOUND_CAPTURE_STREAMS; s++) {
+        for (int i = 0; i < CAPTURE_HANDLERS; i++)
+            capture_close(&capture_handlers[s][i]);
+    }
+}
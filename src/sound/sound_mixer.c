@@ -0,0 +1,375 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Sound mixer.
+ *
+ *          Every secondary stream is queued in a lock-free FIFO by
+ *          whichever thread renders it, then resampled to SOUND_FREQ by
+ *          a polyphase windowed sinc filter and added to the main stream
+ *          at the end of each of its buffers. The filter and the format
+ *          conversions use SSE2 or NEON where available.
+ */
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined _M_X64 || defined __amd64__ || defined __SSE2__
+#    define MIXER_SSE2
+#    include <emmintrin.h>
+#elif defined _M_ARM64 || defined __ARM_NEON
+#    define MIXER_NEON
+#    include <arm_neon.h>
+#endif
+#include <86box/86box.h>
+#include <86box/sound.h>
+#include <86box/sound_mixer.h>
+
+#define MIXER_TAPS      16  /* Filter length, in input frames. */
+#define MIXER_PHASES    256 /* Filter phases, sub-sample resolution. */
+#define MIXER_FIFO_SIZE 32768
+#define MIXER_FIFO_MASK (MIXER_FIFO_SIZE - 1)
+#define MIXER_IN_SIZE   8192
+
+typedef struct mixer_src_t {
+    float      *fifo;
+    atomic_uint wr;    /* Frames queued so far, producer. */
+    atomic_uint rd;    /* Frames consumed so far, mixer. */
+    atomic_int  chunk; /* Largest number of frames queued at once. */
+
+    /* Only touched by the mixer. */
+    int      freq;
+    int      primed;
+    uint64_t step; /* Input frames per output frame, 32.32 fixed point. */
+    uint64_t pos;  /* Position in in_buf, 32.32 fixed point. */
+    float   *kernel;
+    float   *in_buf;
+    int      in_count;
+} mixer_src_t;
+
+int sound_mixer_enabled = 1;
+
+static mixer_src_t mixer_src[SOUND_MIXER_SOURCES];
+
+/* Filter coefficients for each phase, each one stored twice so a stereo
+   frame can be multiplied by a single vector. */
+static void
+mixer_build_kernel(mixer_src_t *src)
+{
+    double cutoff = 0.46;
+    double c[MIXER_TAPS];
+    double sum;
+    double x;
+    double w;
+
+    /* Keep below the output Nyquist frequency when downsampling. */
+    if (src->freq > SOUND_FREQ)
+        cutoff = (cutoff * SOUND_FREQ) / src->freq;
+
+    for (int p = 0; p < MIXER_PHASES; p++) {
+        sum = 0.0;
+        for (int k = 0; k < MIXER_TAPS; k++) {
+            x = (double) (k - ((MIXER_TAPS / 2) - 1)) - ((double) p / MIXER_PHASES);
+            w = (x + (MIXER_TAPS / 2)) / MIXER_TAPS;
+            w = 0.42 - (0.5 * cos(2.0 * M_PI * w)) + (0.08 * cos(4.0 * M_PI * w));
+
+            if (x == 0.0)
+                c[k] = 2.0 * cutoff;
+            else
+                c[k] = sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+            c[k] *= w;
+            sum += c[k];
+        }
+
+        for (int k = 0; k < MIXER_TAPS; k++) {
+            src->kernel[(((p * MIXER_TAPS) + k) * 2)]     = (float) (c[k] / sum);
+            src->kernel[(((p * MIXER_TAPS) + k) * 2) + 1] = (float) (c[k] / sum);
+        }
+    }
+}
+
+/* One output frame: MIXER_TAPS input frames times one phase of the filter. */
+static inline void
+mixer_dot(const float *in, const float *coef, float *l, float *r)
+{
+#if defined MIXER_SSE2
+    __m128 acc = _mm_setzero_ps();
+
+    for (int k = 0; k < (MIXER_TAPS * 2); k += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&in[k]), _mm_loadu_ps(&coef[k])));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+
+    *l = _mm_cvtss_f32(acc);
+    *r = _mm_cvtss_f32(_mm_shuffle_ps(acc, acc, 0x55));
+#elif defined MIXER_NEON
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    float32x2_t sum;
+
+    for (int k = 0; k < (MIXER_TAPS * 2); k += 4)
+        acc = vmlaq_f32(acc, vld1q_f32(&in[k]), vld1q_f32(&coef[k]));
+    sum = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+
+    *l = vget_lane_f32(sum, 0);
+    *r = vget_lane_f32(sum, 1);
+#else
+    float acc[2] = { 0.0f, 0.0f };
+
+    for (int k = 0; k < (MIXER_TAPS * 2); k += 2) {
+        acc[0] += in[k] * coef[k];
+        acc[1] += in[k + 1] * coef[k + 1];
+    }
+
+    *l = acc[0];
+    *r = acc[1];
+#endif
+}
+
+static void
+mixer_add(float *dest, const float *src, int size)
+{
+    int c = 0;
+
+#if defined MIXER_SSE2
+    for (; c <= (size - 4); c += 4)
+        _mm_storeu_ps(&dest[c], _mm_add_ps(_mm_loadu_ps(&dest[c]), _mm_loadu_ps(&src[c])));
+#elif defined MIXER_NEON
+    for (; c <= (size - 4); c += 4)
+        vst1q_f32(&dest[c], vaddq_f32(vld1q_f32(&dest[c]), vld1q_f32(&src[c])));
+#endif
+
+    for (; c < size; c++)
+        dest[c] += src[c];
+}
+
+void
+sound_mixer_int32_to_float(const int32_t *src, float *dest, int size)
+{
+    int c = 0;
+
+#if defined MIXER_SSE2
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+
+    for (; c <= (size - 4); c += 4)
+        _mm_storeu_ps(&dest[c], _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) &src[c])), scale));
+#elif defined MIXER_NEON
+    for (; c <= (size - 4); c += 4)
+        vst1q_f32(&dest[c], vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(&src[c])), 1.0f / 32768.0f));
+#endif
+
+    for (; c < size; c++)
+        dest[c] = ((float) src[c]) / 32768.0f;
+}
+
+void
+sound_mixer_float_to_int16(const float *src, int16_t *dest, int size)
+{
+    int   c = 0;
+    float s;
+
+#if defined MIXER_SSE2
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const __m128 max   = _mm_set1_ps(32767.0f);
+    const __m128 min   = _mm_set1_ps(-32768.0f);
+    __m128       lo;
+    __m128       hi;
+
+    for (; c <= (size - 8); c += 8) {
+        lo = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(&src[c]), scale), max), min);
+        hi = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(&src[c + 4]), scale), max), min);
+        _mm_storeu_si128((__m128i *) &dest[c], _mm_packs_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi)));
+    }
+#elif defined MIXER_NEON
+    for (; c <= (size - 8); c += 8) {
+        int32x4_t lo = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(&src[c]), 32768.0f));
+        int32x4_t hi = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(&src[c + 4]), 32768.0f));
+
+        vst1q_s16(&dest[c], vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+#endif
+
+    for (; c < size; c++) {
+        s = src[c] * 32768.0f;
+        if (s > 32767.0f)
+            s = 32767.0f;
+        if (s < -32768.0f)
+            s = -32768.0f;
+
+        dest[c] = (int16_t) s;
+    }
+}
+
+void
+sound_mixer_set_rate(int src_id, int freq)
+{
+    mixer_src_t *src = &mixer_src[src_id];
+
+    src->freq     = freq;
+    src->step     = (((uint64_t) freq) << 32) / SOUND_FREQ;
+    src->pos      = 0;
+    src->primed   = 0;
+    src->in_count = 0;
+
+    if (freq == SOUND_FREQ) {
+        free(src->kernel);
+        src->kernel = NULL;
+    } else {
+        if (src->kernel == NULL)
+            src->kernel = calloc(MIXER_PHASES * MIXER_TAPS * 2, sizeof(float));
+        mixer_build_kernel(src);
+    }
+
+    atomic_store(&src->chunk, 0);
+    atomic_store(&src->rd, atomic_load(&src->wr));
+}
+
+void
+sound_mixer_init(void)
+{
+    static const int freqs[SOUND_MIXER_SOURCES] = {
+        [SOUND_MIXER_MUSIC] = MUSIC_FREQ,
+        [SOUND_MIXER_WT]    = WT_FREQ,
+        [SOUND_MIXER_CD]    = CD_FREQ,
+        [SOUND_MIXER_FDD]   = SOUND_FREQ,
+        [SOUND_MIXER_HDD]   = SOUND_FREQ,
+        [SOUND_MIXER_MIDI]  = FREQ_44100
+    };
+
+    for (int i = 0; i < SOUND_MIXER_SOURCES; i++) {
+        mixer_src_t *src = &mixer_src[i];
+
+        if (src->fifo == NULL) {
+            src->fifo   = calloc(MIXER_FIFO_SIZE * 2, sizeof(float));
+            src->in_buf = calloc(MIXER_IN_SIZE * 2, sizeof(float));
+        }
+
+        sound_mixer_set_rate(i, freqs[i]);
+    }
+}
+
+void
+sound_mixer_push(int src_id, const void *buf, int size)
+{
+    mixer_src_t *src    = &mixer_src[src_id];
+    uint32_t     wr     = atomic_load_explicit(&src->wr, memory_order_relaxed);
+    uint32_t     rd     = atomic_load_explicit(&src->rd, memory_order_acquire);
+    int          frames = size >> 1;
+    int          space  = MIXER_FIFO_SIZE - (int) (wr - rd);
+    uint32_t     idx;
+
+    if (src->fifo == NULL)
+        return;
+
+    if (frames > atomic_load_explicit(&src->chunk, memory_order_relaxed))
+        atomic_store_explicit(&src->chunk, frames, memory_order_relaxed);
+
+    /* Nobody is listening, drop what does not fit. */
+    if (frames > space)
+        frames = space;
+
+    for (int c = 0; c < frames; c++) {
+        idx = ((wr + c) & MIXER_FIFO_MASK) << 1;
+        if (sound_is_float) {
+            src->fifo[idx]     = ((const float *) buf)[c << 1];
+            src->fifo[idx + 1] = ((const float *) buf)[(c << 1) + 1];
+        } else {
+            src->fifo[idx]     = ((float) ((const int16_t *) buf)[c << 1]) / 32768.0f;
+            src->fifo[idx + 1] = ((float) ((const int16_t *) buf)[(c << 1) + 1]) / 32768.0f;
+        }
+    }
+
+    atomic_store_explicit(&src->wr, wr + frames, memory_order_release);
+}
+
+static void
+mixer_src_mix(mixer_src_t *src, float *buffer, int len)
+{
+    uint32_t rd    = atomic_load_explicit(&src->rd, memory_order_relaxed);
+    uint32_t wr    = atomic_load_explicit(&src->wr, memory_order_acquire);
+    int      avail = (int) (wr - rd);
+    int      need  = (int) ((src->pos + ((uint64_t) (len - 1) * src->step)) >> 32) + MIXER_TAPS;
+    int      prime = atomic_load_explicit(&src->chunk, memory_order_relaxed) + need;
+    int      n;
+    int      i = 0;
+    int      ip;
+    float    l;
+    float    r;
+
+    /* Sources are queued in chunks that may well be larger than a buffer of
+       the main stream, wait for enough of them to play through without a
+       gap. */
+    if (!src->primed) {
+        if (avail < prime)
+            return;
+        src->primed = 1;
+    }
+
+    /* Too far behind, e.g. after the emulation has been paused. */
+    if (avail > (prime * 2)) {
+        rd += avail - prime;
+        avail = prime;
+    }
+
+    n = need - src->in_count;
+    if (n > avail)
+        n = avail;
+    if (n > (MIXER_IN_SIZE - src->in_count))
+        n = MIXER_IN_SIZE - src->in_count;
+    for (int c = 0; c < n; c++) {
+        src->in_buf[(src->in_count + c) << 1]       = src->fifo[((rd + c) & MIXER_FIFO_MASK) << 1];
+        src->in_buf[((src->in_count + c) << 1) + 1] = src->fifo[(((rd + c) & MIXER_FIFO_MASK) << 1) + 1];
+    }
+    src->in_count += n;
+    atomic_store_explicit(&src->rd, rd + n, memory_order_release);
+
+    if (src->kernel == NULL) {
+        /* Same rate, delayed by the same amount as the filter would. */
+        ip = (int) (src->pos >> 32);
+        n  = src->in_count - ip - MIXER_TAPS + 1;
+        if (n > len)
+            n = len;
+        if (n > 0) {
+            mixer_add(buffer, &src->in_buf[(ip + (MIXER_TAPS / 2) - 1) << 1], n << 1);
+            src->pos += ((uint64_t) n) << 32;
+            i = n;
+        }
+    } else {
+        for (; i < len; i++) {
+            ip = (int) (src->pos >> 32);
+            if ((ip + MIXER_TAPS) > src->in_count)
+                break;
+
+            mixer_dot(&src->in_buf[ip << 1], &src->kernel[((src->pos >> 24) & (MIXER_PHASES - 1)) * MIXER_TAPS * 2], &l, &r);
+            buffer[i << 1] += l;
+            buffer[(i << 1) + 1] += r;
+
+            src->pos += src->step;
+        }
+    }
+
+    /* Ran dry, start over once enough has been queued again. */
+    if (i < len)
+        src->primed = 0;
+
+    /* Keep what the filter still needs for the next buffer. */
+    ip = (int) (src->pos >> 32);
+    if (ip > src->in_count)
+        ip = src->in_count;
+    memmove(src->in_buf, &src->in_buf[ip << 1], (src->in_count - ip) * 2 * sizeof(float));
+    src->in_count -= ip;
+    src->pos -= ((uint64_t) ip) << 32;
+}
+
+void
+sound_mixer_mix(float *buffer, int len)
+{
+    for (int i = 0; i < SOUND_MIXER_SOURCES; i++) {
+        if (mixer_src[i].fifo != NULL)
+            mixer_src_mix(&mixer_src[i], buffer, len);
+    }
+}
@@ -1,26 +1,185 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/nv/vid_nv_rivatimer.h>
 
 uint64_t TIMER_USEC;
 uint64_t timer_target;
 
+#ifdef USE_TIMER_HEAP
+/*Enabled timers are stored in a 4-ary min-heap, with the first timer to expire
+  at the root. Timers with the same timestamp are ordered newest first, exactly
+  like the linked list below, so both backends run callbacks in the same order.*/
+static pc_timer_t **timer_heap     = NULL;
+static uint32_t     timer_heap_num = 0;
+static uint32_t     timer_heap_max = 0;
+static uint64_t     timer_heap_seq = 0;
+#else
 /*Enabled timers are stored in a linked list, with the first timer to expire at
   the head.*/
 pc_timer_t *timer_head = NULL;
+#endif
 
 /* Are we initialized? */
 int timer_inited = 0;
 
 static void timer_advance_ex(pc_timer_t *timer, int start);
 
+#ifdef USE_TIMER_HEAP
+/*True if timer a has to be run before timer b*/
+static __inline int
+timer_heap_less(pc_timer_t *a, pc_timer_t *b)
+{
+    int64_t diff = (int64_t) (a->ts_integer - b->ts_integer);
+
+    if (diff)
+        return diff < 0;
+
+    return (int64_t) (a->heap_seq - b->heap_seq) > 0;
+}
+
+static void
+timer_heap_sift_up(pc_timer_t *timer, uint32_t pos)
+{
+    while (pos > 0) {
+        uint32_t parent = (pos - 1) >> 2;
+
+        if (!timer_heap_less(timer, timer_heap[parent]))
+            break;
+
+        timer_heap[pos]           = timer_heap[parent];
+        timer_heap[pos]->heap_pos = pos + 1;
+        pos                       = parent;
+    }
+
+    timer_heap[pos] = timer;
+    timer->heap_pos = pos + 1;
+}
+
+static void
+timer_heap_sift_down(pc_timer_t *timer, uint32_t pos)
+{
+    while (1) {
+        uint32_t first = (pos << 2) + 1;
+        uint32_t last  = first + 4;
+        uint32_t best  = first;
+
+        if (first >= timer_heap_num)
+            break;
+
+        if (last > timer_heap_num)
+            last = timer_heap_num;
+
+        for (uint32_t c = first + 1; c < last; c++) {
+            if (timer_heap_less(timer_heap[c], timer_heap[best]))
+                best = c;
+        }
+
+        if (!timer_heap_less(timer_heap[best], timer))
+            break;
+
+        timer_heap[pos]           = timer_heap[best];
+        timer_heap[pos]->heap_pos = pos + 1;
+        pos                       = best;
+    }
+
+    timer_heap[pos] = timer;
+    timer->heap_pos = pos + 1;
+}
+
+static void
+timer_heap_remove(pc_timer_t *timer)
+{
+    uint32_t    pos  = timer->heap_pos - 1;
+    pc_timer_t *last = timer_heap[--timer_heap_num];
+
+    timer->heap_pos = 0;
+
+    if (last == timer)
+        return;
+
+    if ((pos > 0) && timer_heap_less(last, timer_heap[(pos - 1) >> 2]))
+        timer_heap_sift_up(last, pos);
+    else
+        timer_heap_sift_down(last, pos);
+}
+
+static __inline pc_timer_t *
+timer_first(void)
+{
+    return timer_heap_num ? timer_heap[0] : NULL;
+}
+
+static void
+timer_queue(pc_timer_t *timer)
+{
+    if (timer->flags & TIMER_ENABLED)
+        timer_disable(timer);
+
+    if (timer->heap_pos)
+        fatal("timer_enable - timer->heap_pos\n");
+
+    timer->flags |= TIMER_ENABLED;
+
+    if (timer_heap_num == timer_heap_max) {
+        timer_heap_max = timer_heap_max ? (timer_heap_max << 1) : 256;
+        timer_heap     = (pc_timer_t **) realloc(timer_heap, timer_heap_max * sizeof(pc_timer_t *));
+        if (timer_heap == NULL)
+            fatal("timer_enable - out of memory\n");
+    }
+
+    timer->heap_seq = timer_heap_seq++;
+    timer_heap_sift_up(timer, timer_heap_num++);
+
+    timer_target = timer_heap[0]->ts_integer;
+}
+
 void
-timer_enable(pc_timer_t *timer)
+timer_disable(pc_timer_t *timer)
+{
+    if (!timer_inited || (timer == NULL) || !(timer->flags & TIMER_ENABLED))
+        return;
+
+    if (!timer->heap_pos) {
+        uint32_t *p = NULL;
+        *p = 5;    /* Crash deliberately. */
+        fatal("timer_disable(): Attempting to disable a non-queued timer "
+              "incorrectly marked as enabled\n");
+    }
+
+    timer->flags &= ~TIMER_ENABLED;
+    timer->in_callback = 0;
+
+    timer_heap_remove(timer);
+
+    if (timer_trace_on)
+        timer_trace_event(TIMER_TRACE_DISABLE, timer, 0);
+}
+
+static void
+timer_remove_head(void)
+{
+    if (timer_heap_num) {
+        pc_timer_t *timer = timer_heap[0];
+        timer_heap_remove(timer);
+        timer->flags &= ~TIMER_ENABLED;
+    }
+}
+#else
+static __inline pc_timer_t *
+timer_first(void)
+{
+    return timer_head;
+}
+
+static void
+timer_queue(pc_timer_t *timer)
 {
     pc_timer_t *timer_node = timer_head;
 
@@ -97,6 +256,9 @@ timer_disable(pc_timer_t *timer)
     if (timer->next)
         timer->next->prev = timer->prev;
     timer->prev = timer->next = NULL;
+
+    if (timer_trace_on)
+        timer_trace_event(TIMER_TRACE_DISABLE, timer, 0);
 }
 
 static void
@@ -110,17 +272,30 @@ timer_remove_head(void)
         timer->flags &= ~TIMER_ENABLED;
     }
 }
+#endif
+
+void
+timer_enable(pc_timer_t *timer)
+{
+    timer_queue(timer);
+
+    if (timer_trace_on)
+        timer_trace_event(TIMER_TRACE_ENABLE, timer, timer->ts_integer);
+}
 
 void
 timer_process(void)
 {
-    if (!timer_head)
+    if (!timer_first())
         return;
 
+    if (timer_trace_on)
+        timer_trace_event(TIMER_TRACE_PROCESS, NULL, 0);
+
     while (1) {
-        pc_timer_t *timer = timer_head;
+        pc_timer_t *timer = timer_first();
 
-        if (!TIMER_LESS_THAN_VAL(timer, (uint64_t) tsc))
+        if ((timer == NULL) || !TIMER_LESS_THAN_VAL(timer, (uint64_t) tsc))
             break;
 
         timer_remove_head();
@@ -140,12 +315,26 @@ timer_process(void)
         }
     }
 
-    timer_target = timer_head->ts_integer;
+    if (timer_first())
+        timer_target = timer_first()->ts_integer;
 }
 
 void
 timer_close(void)
 {
+#ifdef USE_TIMER_HEAP
+    /* Unlink all timers so that timers that are not in calloc'd structs don't
+       appear queued after the heap is gone. */
+    for (uint32_t i = 0; i < timer_heap_num; i++) {
+        timer_heap[i]->heap_pos = 0;
+        timer_heap[i]->flags &= ~TIMER_ENABLED;
+    }
+
+    free(timer_heap);
+    timer_heap     = NULL;
+    timer_heap_num = 0;
+    timer_heap_max = 0;
+#else
     pc_timer_t *t = timer_head;
     pc_timer_t *r;
 
@@ -159,6 +348,7 @@ timer_close(void)
     }
 
     timer_head = NULL;
+#endif
 
     timer_inited = 0;
 }
@@ -185,6 +375,7 @@ timer_add(pc_timer_t *timer, void (*callback)(void *priv), void *priv, int start
     timer->priv        = priv;
     timer->flags       = 0;
     timer->prev        = timer->next = NULL;
+    timer->heap_pos    = 0;
     if (start_timer)
         timer_set_delay_u64(timer, 0);
 }
@@ -269,13 +460,27 @@ timer_set_new_tsc(uint64_t new_tsc)
         update_tsc();
 #endif
 
-    if (!timer_head) {
+    if (timer_trace_on)
+        timer_trace_event(TIMER_TRACE_SET_TSC, NULL, new_tsc);
+
+    if (!timer_first()) {
         tsc = new_tsc;
         return;
     }
 
+    timer_target = new_tsc + (int64_t)(timer_get_ts_int(timer_first()) - (uint64_t)tsc);
+
+#ifdef USE_TIMER_HEAP
+    /* All timers are shifted by the same amount, so the heap order holds. */
+    for (uint32_t i = 0; i < timer_heap_num; i++) {
+        int64_t offset_from_current_tsc;
+
+        timer                   = timer_heap[i];
+        offset_from_current_tsc = (int64_t)(timer_get_ts_int(timer) - (uint64_t)tsc);
+        timer->ts_integer       = new_tsc + offset_from_current_tsc;
+    }
+#else
     timer = timer_head;
-    timer_target = new_tsc + (int64_t)(timer_get_ts_int(timer_head) - (uint64_t)tsc);
 
     while (timer) {
         int64_t offset_from_current_tsc = (int64_t)(timer_get_ts_int(timer) - (uint64_t)tsc);
@@ -283,6 +488,47 @@ timer_set_new_tsc(uint64_t new_tsc)
 
         timer = timer->next;
     }
+#endif
 
     tsc = new_tsc;
 }
+
+/* Save a timer to a snapshot. The expiry time is stored relative to the TSC,
+   so the CPU state (and thus the TSC) must be restored before the timers. */
+void
+timer_save_state(snapshot_t *snap, pc_timer_t *timer)
+{
+    int64_t remaining = (int64_t) (timer->ts_integer - (uint64_t) tsc);
+
+    snapshot_write_var(snap, timer->flags);
+    snapshot_write_var(snap, remaining);
+    snapshot_write_var(snap, timer->ts_frac);
+    snapshot_write_var(snap, timer->period);
+}
+
+void
+timer_load_state(snapshot_t *snap, pc_timer_t *timer)
+{
+    int      flags     = 0;
+    int64_t  remaining = 0;
+    uint32_t frac      = 0;
+    double   period    = 0.0;
+
+    snapshot_read_var(snap, flags);
+    snapshot_read_var(snap, remaining);
+    snapshot_read_var(snap, frac);
+    if (snapshot_read_var(snap, period))
+        return;
+
+    if (timer->flags & TIMER_ENABLED)
+        timer_disable(timer);
+
+    timer->ts_integer  = (uint64_t) tsc + remaining;
+    timer->ts_frac     = frac;
+    timer->period      = period;
+    timer->flags       = flags & ~TIMER_ENABLED;
+    timer->in_callback = 0;
+
+    if ((flags & TIMER_ENABLED) && (timer->callback != NULL))
+        timer_enable(timer);
+}
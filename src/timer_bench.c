@@ -0,0 +1,264 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Timer queue trace and benchmark.
+ *
+ *          --timertrace records every timer arm, disable and dispatch of
+ *          a run, --timerbench replays such a trace on the timer queue
+ *          the emulator was built with (the sorted list, or the 4-ary
+ *          heap with TIMER_HEAP) and reports how fast it went, along
+ *          with a checksum of the order the timers fired in, which must
+ *          be the same on both.
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include <86box/plat.h>
+#include <86box/timer.h>
+
+#define TRACE_MAGIC   "86BTIMR1"
+#define TRACE_MAX_IDS 65536
+
+/* One event, in host byte order. For TIMER_TRACE_ENABLE, val is the new
+   timestamp of the timer, for TIMER_TRACE_SET_TSC the new TSC. */
+typedef struct trace_rec_t {
+    uint64_t tsc;
+    uint64_t val;
+    uint32_t type;
+    uint32_t id;
+} trace_rec_t;
+
+int timer_trace_on = 0;
+
+static FILE        *trace_fp;
+static pc_timer_t **trace_ids;
+static uint32_t     trace_num_ids;
+static uint32_t     trace_last_id;
+
+static uint32_t bench_sum;
+static uint64_t bench_fired;
+
+static uint32_t
+trace_get_id(pc_timer_t *timer)
+{
+    /* Machines have a few dozen timers, and mostly the same ones fire in a
+       row. */
+    if ((trace_last_id < trace_num_ids) && (trace_ids[trace_last_id] == timer))
+        return trace_last_id;
+
+    for (uint32_t i = 0; i < trace_num_ids; i++) {
+        if (trace_ids[i] == timer) {
+            trace_last_id = i;
+            return i;
+        }
+    }
+
+    if (trace_num_ids == TRACE_MAX_IDS)
+        fatal("Timer trace: too many timers\n");
+
+    trace_ids[trace_num_ids] = timer;
+    trace_last_id            = trace_num_ids;
+
+    return trace_num_ids++;
+}
+
+/* Record an event, called by the timer code when timer_trace_on is set. */
+void
+timer_trace_event(int type, pc_timer_t *timer, uint64_t val)
+{
+    trace_rec_t rec;
+
+    rec.tsc  = tsc;
+    rec.val  = val;
+    rec.type = type;
+    rec.id   = (timer != NULL) ? trace_get_id(timer) : 0;
+
+    if (fwrite(&rec, sizeof(rec), 1, trace_fp) != 1) {
+        always_log("Timer trace: write error, stopping the trace\n");
+        timer_trace_close();
+    }
+}
+
+void
+timer_trace_open(const char *fn)
+{
+    timer_trace_close();
+
+    trace_fp = plat_fopen(fn, "wb");
+    if (trace_fp == NULL) {
+        always_log("Timer trace: unable to create '%s'\n", fn);
+        return;
+    }
+
+    trace_ids = calloc(TRACE_MAX_IDS, sizeof(pc_timer_t *));
+    if (trace_ids == NULL)
+        fatal("Timer trace: out of memory\n");
+    trace_num_ids = 0;
+    trace_last_id = 0;
+
+    fwrite(TRACE_MAGIC, 1, 8, trace_fp);
+    timer_trace_on = 1;
+}
+
+void
+timer_trace_close(void)
+{
+    timer_trace_on = 0;
+
+    if (trace_fp != NULL) {
+        fclose(trace_fp);
+        trace_fp = NULL;
+    }
+
+    free(trace_ids);
+    trace_ids = NULL;
+}
+
+static void
+bench_callback(void *priv)
+{
+    /* FNV-1a over the IDs of the timers, in the order they fire. */
+    bench_sum = (bench_sum ^ (uint32_t) (uintptr_t) priv) * 16777619u;
+    bench_fired++;
+}
+
+static trace_rec_t *
+bench_load(const char *fn, uint32_t *num)
+{
+    trace_rec_t *recs = NULL;
+    FILE        *fp;
+    char         magic[8];
+    long         size;
+
+    fp = plat_fopen(fn, "rb");
+    if (fp == NULL) {
+        always_log("Timer benchmark: unable to open '%s'\n", fn);
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp) - 8;
+    fseek(fp, 0, SEEK_SET);
+
+    if ((size < 0) || (fread(magic, 1, 8, fp) != 8) || memcmp(magic, TRACE_MAGIC, 8)) {
+        always_log("Timer benchmark: '%s' is not a timer trace\n", fn);
+        fclose(fp);
+        return NULL;
+    }
+
+    *num = (uint32_t) (size / sizeof(trace_rec_t));
+    recs = malloc((*num ? *num : 1) * sizeof(trace_rec_t));
+    if (recs == NULL)
+        fatal("Timer benchmark: out of memory\n");
+
+    if (fread(recs, sizeof(trace_rec_t), *num, fp) != *num) {
+        always_log("Timer benchmark: read error on '%s'\n", fn);
+        free(recs);
+        recs = NULL;
+    }
+
+    fclose(fp);
+
+    return recs;
+}
+
+/* Replay a trace recorded with --timertrace. Returns 0, so that the emulator
+   exits. */
+int
+timer_bench(const char *fn)
+{
+    pc_timer_t  *timers;
+    trace_rec_t *recs;
+    uint32_t     num     = 0;
+    uint32_t     num_ids = 0;
+    uint32_t     counts[TIMER_TRACE_SET_TSC + 1] = { 0 };
+    uint64_t     start;
+    double       secs;
+
+    recs = bench_load(fn, &num);
+    if (recs == NULL)
+        return 0;
+
+    for (uint32_t i = 0; i < num; i++) {
+        if ((recs[i].type > TIMER_TRACE_SET_TSC) || (recs[i].id >= TRACE_MAX_IDS)) {
+            always_log("Timer benchmark: '%s' is corrupt at event %u\n", fn, i);
+            free(recs);
+            return 0;
+        }
+        if (recs[i].id >= num_ids)
+            num_ids = recs[i].id + 1;
+        counts[recs[i].type]++;
+    }
+
+    timers = calloc(num_ids ? num_ids : 1, sizeof(pc_timer_t));
+    if (timers == NULL)
+        fatal("Timer benchmark: out of memory\n");
+
+    timer_init();
+    for (uint32_t i = 0; i < num_ids; i++)
+        timer_add(&timers[i], bench_callback, (void *) (uintptr_t) i, 0);
+
+    bench_sum   = 2166136261u;
+    bench_fired = 0;
+
+    start = plat_timer_read();
+    for (uint32_t i = 0; i < num; i++) {
+        pc_timer_t *timer = &timers[recs[i].id];
+
+        tsc = recs[i].tsc;
+
+        switch (recs[i].type) {
+            case TIMER_TRACE_ENABLE:
+                timer->ts_integer = recs[i].val;
+                timer->ts_frac    = 0;
+                timer_enable(timer);
+                break;
+
+            case TIMER_TRACE_DISABLE:
+                timer_disable(timer);
+                break;
+
+            case TIMER_TRACE_PROCESS:
+                if (TIMER_VAL_LESS_THAN_VAL(timer_target, (uint64_t) tsc))
+                    timer_process();
+                break;
+
+            case TIMER_TRACE_SET_TSC:
+                timer_set_new_tsc(recs[i].val);
+                break;
+
+            default:
+                break;
+        }
+    }
+    secs = (double) (plat_timer_read() - start) / (double) plat_timer_freq();
+
+    timer_close();
+
+    always_log("Timer benchmark: %s, %u timers, %u events "
+               "(%u arms, %u disables, %u dispatches)\n",
+               fn, num_ids, num, counts[TIMER_TRACE_ENABLE], counts[TIMER_TRACE_DISABLE],
+               counts[TIMER_TRACE_PROCESS]);
+#ifdef USE_TIMER_HEAP
+    always_log("4-ary heap:  ");
+#else
+    always_log("sorted list: ");
+#endif
+    always_log("%8.3f s, %6.1f ns per event, %llu callbacks, checksum %08X\n",
+               secs, num ? ((secs * 1000000000.0) / num) : 0.0,
+               (unsigned long long) bench_fired, bench_sum);
+
+    free(timers);
+    free(recs);
+
+    return 0;
+}
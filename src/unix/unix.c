@@ -62,6 +62,7 @@
 #include <86box/timer.h>
 #include <86box/nvr.h>
 #include <86box/version.h>
+#include <86box/sound.h>
 #include <86box/video.h>
 #include <86box/ui.h>
 #include <86box/gdbstub.h>
@@ -206,9 +207,11 @@ typedef struct sdl_blit_params {
     int y;
     int w;
     int h;
+    int dirty_y1;
+    int dirty_y2;
 } sdl_blit_params;
 
-sdl_blit_params params  = { 0, 0, 0, 0 };
+sdl_blit_params params  = { 0, 0, 0, 0, 0, 0 };
 int             blitreq = 0;
 
 void *
@@ -542,6 +545,13 @@ plat_timer_read(void)
     return SDL_GetPerformanceCounter();
 }
 
+/* Ticks of plat_timer_read() per second, usable before do_start(). */
+uint64_t
+plat_timer_freq(void)
+{
+    return SDL_GetPerformanceFrequency();
+}
+
 static uint64_t
 plat_get_ticks_common(void)
 {
@@ -655,6 +665,36 @@ strnicmp(const char *s1, const char *s2, size_t n)
 
 volatile int cpu_thread_run = 1;
 
+/* Batch run statistics, reported on exit. */
+static uint64_t batch_guest_ms   = 0;
+static uint64_t batch_host_ticks = 0;
+
+/* Run the machine back to back with no pacing at all, until the guest time
+   budget is used up or the guest ends the run. */
+static void
+main_thread_batch(void)
+{
+    uint64_t start  = SDL_GetPerformanceCounter();
+    int      frames = 0;
+
+    while (!is_quit && cpu_thread_run && !batch_stop) {
+        pc_run();
+        batch_guest_ms += force_10ms ? 10 : 1;
+
+        /* Every 2 s of guest time we save the machine status. */
+        if (++frames >= (force_10ms ? 200 : 2000) && nvr_dosave) {
+            nvr_save();
+            nvr_dosave = 0;
+            frames     = 0;
+        }
+
+        if (batch_time && (batch_guest_ms >= ((uint64_t) batch_time * 1000)))
+            break;
+    }
+
+    batch_host_ticks = SDL_GetPerformanceCounter() - start;
+}
+
 void
 main_thread(UNUSED(void *param))
 {
@@ -664,6 +704,12 @@ main_thread(UNUSED(void *param))
     int      frames;
 
     SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+    if (batch_mode) {
+        main_thread_batch();
+        is_quit = 1;
+        return;
+    }
+
     framecountx = 0;
     // title_update = 1;
     old_time = SDL_GetTicks();
@@ -1193,6 +1239,8 @@ unix_executeLine(char *line)
                 "moeject <id> - eject image from MO drive <id>.\n\n"
                 "tapeeject <id> - eject image from tape drive <id>.\n\n"
                 "hardreset - hard reset the emulated system.\n"
+                "savestate - save a snapshot of the emulated system.\n"
+                "loadstate - restore the last snapshot of the emulated system.\n"
                 "pause - pause the the emulated system.\n"
                 "fastfwd - toggle fast forward.\n"
                 "screenshot - save a screenshot.\n"
@@ -1249,6 +1297,10 @@ unix_executeLine(char *line)
             printf("%s", fast_forward ? "Fast forward on.\n" : "Fast forward off.\n");
         } else if (strncasecmp(xargv[0], "hardreset", 9) == 0) {
             pc_reset_hard();
+        } else if (strncasecmp(xargv[0], "savestate", 9) == 0) {
+            pc_snapshot_save();
+        } else if (strncasecmp(xargv[0], "loadstate", 9) == 0) {
+            pc_snapshot_load();
         } else if (strncasecmp(xargv[0], "cdload", 6) == 0 && cmdargc >= 3) {
             uint8_t id;
             bool    err = false;
@@ -1444,6 +1496,34 @@ monitor_thread(UNUSED(void *param))
 #endif
 }
 
+/* The headless side of a batch run: there is no window, no monitor and
+   no event loop, just wait for the emulation thread to finish. */
+static int
+main_batch(void)
+{
+    double guest_secs;
+    double host_secs;
+
+    while (!is_quit)
+        SDL_Delay(10);
+
+    do_stop();
+
+    guest_secs = (double) batch_guest_ms / 1000.0;
+    host_secs  = (double) batch_host_ticks / (double) timer_freq;
+    printf("Batch run: %.3f s emulated in %.3f s, speed ratio %.2fx, exit code %i\n",
+           guest_secs, host_secs, (host_secs > 0.0) ? (guest_secs / host_secs) : 0.0,
+           batch_exit_code);
+    sound_print_handler_times();
+    mmu_tlb_print_stats();
+
+    SDL_DestroyMutex(blitmtx);
+    SDL_DestroyMutex(mousemutex);
+    SDL_Quit();
+
+    return batch_exit_code;
+}
+
 extern int gfxcard[GFXCARD_MAX];
 int
 main(int argc, char **argv)
@@ -1482,9 +1562,12 @@ main(int argc, char **argv)
     } else
         fprintf(stderr, "libedit not found, line editing will be limited.\n");
     mousemutex = SDL_CreateMutex();
-    sdl_initho();
 
-    if (start_in_fullscreen) {
+    /* Batch runs have no window, and thus no blitter either. */
+    if (!batch_mode)
+        sdl_initho();
+
+    if (start_in_fullscreen && !batch_mode) {
         video_fullscreen = 1;
         sdl_set_fs(1);
     }
@@ -1497,6 +1580,9 @@ main(int argc, char **argv)
     /* Initialize the rendering window, or fullscreen. */
     do_start();
 
+    if (batch_mode)
+        return main_batch();
+
 #ifndef USE_CLI
     thread_create(monitor_thread, NULL);
 #endif
@@ -28,6 +28,8 @@ typedef struct sdl_blit_params {
     int y;
     int w;
     int h;
+    int dirty_y1;
+    int dirty_y2;
 } sdl_blit_params;
 extern sdl_blit_params params;
 extern int             blitreq;
@@ -53,6 +55,7 @@ int                 resize_pending    = 0;
 int                 resize_w          = 0;
 int                 resize_h          = 0;
 static void        *pixeldata;
+static int          sdl_tex_full      = 1;
 
 extern void RenderImGui(void);
 static void
@@ -147,19 +150,48 @@ sdl_stretch(int *w, int *h, int *x, int *y)
 void
 sdl_blit_shim(int x, int y, int w, int h, int monitor_index)
 {
-    params.x = x;
-    params.y = y;
-    params.w = w;
-    params.h = h;
+    int y1;
+    int y2;
 
-    if (!(!sdl_enabled || (x < 0) || (y < 0) || (w <= 0) || (h <= 0) || (w > 2048) || (h > 2048) || (buffer32 == NULL) || (sdl_render == NULL) || (sdl_tex == NULL)) || (monitor_index >= 1))
-        for (int row = 0; row < h; ++row)
-            video_copy(&(((uint8_t *) pixeldata)[row * 2048 * sizeof(uint32_t)]), &(buffer32->line[y + row][x]), w * sizeof(uint32_t));
+    video_blit_get_dirty_monitor(monitor_index, &y1, &y2);
+
+    SDL_LockMutex(sdl_mutex);
+
+    /* Lines of a frame that was never uploaded are still owed to the
+       texture, so carry them over. */
+    if (blitreq && (params.dirty_y1 < params.dirty_y2)) {
+        if (y1 >= y2) {
+            y1 = params.dirty_y1;
+            y2 = params.dirty_y2;
+        } else {
+            y1 = MIN(y1, params.dirty_y1);
+            y2 = MAX(y2, params.dirty_y2);
+        }
+    }
+
+    params.x        = x;
+    params.y        = y;
+    params.w        = w;
+    params.h        = h;
+    params.dirty_y1 = y1;
+    params.dirty_y2 = y2;
+
+    /* pixeldata keeps the previous frame, only the lines that changed are
+       copied in. */
+    if (!(!sdl_enabled || (x < 0) || (y < 0) || (w <= 0) || (h <= 0) || (w > 2048) || (h > 2048) || (buffer32 == NULL) || (sdl_render == NULL) || (sdl_tex == NULL)) || (monitor_index >= 1)) {
+        for (int row = y1; row < y2; ++row)
+            video_copy(&(((uint8_t *) pixeldata)[(row - y) * 2048 * sizeof(uint32_t)]), &(buffer32->line[row][x]), w * sizeof(uint32_t));
+    } else
+        video_blit_invalidate_monitor(monitor_index);
 
     if (monitors[monitor_index].mon_screenshots_raw)
         video_screenshot((uint32_t *) pixeldata, 0, 0, 2048);
+
+    /* The frame is still presented when nothing changed, for the OSD. */
     blitreq = 1;
 
+    SDL_UnlockMutex(sdl_mutex);
+
     video_blit_complete_monitor(monitor_index);
 }
 
@@ -207,7 +239,8 @@ sdl_blit(int x, int y, int w, int h)
         r_src.w = w;
         r_src.h = h;
         sdl_real_blit(&r_src);
-        blitreq = 0;
+        blitreq      = 0;
+        sdl_tex_full = 1;
         return;
     }
 
@@ -219,12 +252,26 @@ sdl_blit(int x, int y, int w, int h)
         resize_pending = 0;
     }
 
+    /* Only upload the lines that changed, unless the texture was just
+       recreated. */
+    if (sdl_tex_full) {
+        params.dirty_y1 = y;
+        params.dirty_y2 = y + h;
+        sdl_tex_full    = 0;
+    }
+    if (params.dirty_y1 < params.dirty_y2) {
+        r_src.x = x;
+        r_src.y = params.dirty_y1;
+        r_src.w = w;
+        r_src.h = params.dirty_y2 - params.dirty_y1;
+        SDL_UpdateTexture(sdl_tex, &r_src, &(((uint8_t *) pixeldata)[(params.dirty_y1 - y) * 2048 * sizeof(uint32_t)]), 2048 * 4);
+    }
+    blitreq = 0;
+
     r_src.x = x;
     r_src.y = y;
     r_src.w = w;
     r_src.h = h;
-    SDL_UpdateTexture(sdl_tex, &r_src, pixeldata, 2048 * 4);
-    blitreq = 0;
 
     sdl_real_blit(&r_src);
     SDL_UnlockMutex(sdl_mutex);
@@ -328,8 +375,9 @@ sdl_reinit_texture(void)
     } else
         sdl_render = SDL_CreateRenderer(sdl_win, -1, SDL_RENDERER_SOFTWARE);
 
-    sdl_tex = SDL_CreateTexture(sdl_render, SDL_PIXELFORMAT_ARGB8888,
-                                SDL_TEXTUREACCESS_STREAMING, 2048, 2048);
+    sdl_tex      = SDL_CreateTexture(sdl_render, SDL_PIXELFORMAT_ARGB8888,
+                                     SDL_TEXTUREACCESS_STREAMING, 2048, 2048);
+    sdl_tex_full = 1;
     osd_init();
 }
 
@@ -20,6 +20,8 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -36,6 +38,8 @@
 #include <86box/mem.h>
 #include <86box/rom.h>
 #include <86box/plat.h>
+#include <86box/snapshot.h>
+#include <86box/thread.h>
 #include <86box/ui.h>
 #include <86box/video.h>
 #include <86box/vid_8514a.h>
@@ -44,8 +48,9 @@
 #include <86box/vid_svga_render.h>
 #include <86box/vid_xga_device.h>
 
-void svga_doblit(int wx, int wy, svga_t *svga);
-void svga_poll(void *priv);
+void        svga_doblit(int wx, int wy, svga_t *svga);
+static void svga_doblit_lines(int wx, int wy, svga_t *svga, int lines);
+void        svga_poll(void *priv);
 
 svga_t *svga_8514;
 
@@ -1288,9 +1293,293 @@ svga_recalctimings(svga_t *svga)
     }
 }
 
+/* Scanline render thread.
+
+   The packed pixel modes can have their scanlines rendered on a thread of
+   their own. svga_poll() then only records what the line needs, the start
+   address, position, palette and so on, and the thread renders it, along
+   with its overscan, from a copy of the svga_t taken at the start of the
+   frame with the recorded state applied on top, so that changes made in
+   the middle of the frame still show up on the right lines. The emulation
+   thread only waits for it at the end of the active display, and before
+   rendering any line itself, such as lines with a hardware cursor or an
+   overlay, which stay on the emulation thread. */
+#define SVGA_RENDER_LINES 4096 /* Must be a power of 2. */
+#define SVGA_RENDER_PALS  8
+#define SVGA_RENDER_KICK  16   /* Lines queued between wakeups. */
+
+typedef struct svga_render_line_t {
+    void (*render)(struct svga_t *svga);
+    uint32_t (*remap_func)(struct svga_t *svga, uint32_t in_addr);
+    uint32_t (*conv_16to32)(struct svga_t *svga, uint16_t color, uint8_t bpp);
+    uint32_t *map8;
+    uint32_t  memaddr;
+    uint32_t  vram_display_mask;
+    uint32_t  overscan_color;
+    int       displine;
+    int       y_add;
+    int       x_add;
+    int       left_overscan;
+    int       scrollcache;
+    int       hdisp;
+    int       fullchange;
+    int       render_line_offset;
+    int       remap_required;
+    int       force_old_addr;
+    int       lut_map;
+    int       pal;
+    uint8_t   dac_mask;
+    uint8_t   scrblank;
+} svga_render_line_t;
+
+typedef struct svga_render_thread_t {
+    svga_t shadow;
+
+    svga_render_line_t lines[SVGA_RENDER_LINES];
+    uint32_t           pals[SVGA_RENDER_PALS][512];
+
+    atomic_uint head; /* Next line to be queued, emulation thread. */
+    atomic_uint tail; /* Next line to be rendered, render thread. */
+
+    /* Only touched by the emulation thread. */
+    int pal;
+    int pals_used;
+
+    /* Only touched by the render thread. */
+    int shadow_pal;
+
+    thread_t    *thread;
+    event_t     *wake_event;
+    event_t     *done_event;
+    volatile int on;
+} svga_render_thread_t;
+
+static void
+svga_render_thread(void *priv)
+{
+    svga_render_thread_t *rt     = (svga_render_thread_t *) priv;
+    svga_t               *shadow = &rt->shadow;
+    svga_render_line_t   *line;
+    uint32_t              tail;
+
+    while (rt->on) {
+        thread_wait_event(rt->wake_event, -1);
+        thread_reset_event(rt->wake_event);
+
+        tail = atomic_load_explicit(&rt->tail, memory_order_relaxed);
+        while (tail != atomic_load_explicit(&rt->head, memory_order_acquire)) {
+            line = &rt->lines[tail & (SVGA_RENDER_LINES - 1)];
+
+            if (line->pal != rt->shadow_pal) {
+                memcpy(shadow->pallook, rt->pals[line->pal], sizeof(shadow->pallook));
+                rt->shadow_pal = line->pal;
+            }
+
+            shadow->map8               = line->map8;
+            shadow->remap_func         = line->remap_func;
+            shadow->conv_16to32        = line->conv_16to32;
+            shadow->memaddr            = line->memaddr;
+            shadow->vram_display_mask  = line->vram_display_mask;
+            shadow->overscan_color     = line->overscan_color;
+            shadow->displine           = line->displine;
+            shadow->y_add              = line->y_add;
+            shadow->left_overscan      = line->left_overscan;
+            shadow->scrollcache        = line->scrollcache;
+            shadow->hdisp              = line->hdisp;
+            shadow->fullchange         = line->fullchange;
+            shadow->render_line_offset = line->render_line_offset;
+            shadow->remap_required     = line->remap_required;
+            shadow->force_old_addr     = line->force_old_addr;
+            shadow->lut_map            = line->lut_map;
+            shadow->dac_mask           = line->dac_mask;
+            shadow->scrblank           = line->scrblank;
+
+            shadow->x_add = line->x_add;
+            line->render(shadow);
+
+            shadow->x_add = line->left_overscan;
+            svga_render_overscan_left(shadow);
+            svga_render_overscan_right(shadow);
+
+            tail++;
+            atomic_store_explicit(&rt->tail, tail, memory_order_release);
+        }
+
+        thread_set_event(rt->done_event);
+    }
+}
+
+/* Wait for every queued line to be rendered, then pass the range of lines
+   drawn on to the live svga_t. */
+static void
+svga_render_thread_sync(svga_t *svga)
+{
+    svga_render_thread_t *rt = svga->render_thread;
+
+    if (rt == NULL)
+        return;
+
+    while (1) {
+        thread_reset_event(rt->done_event);
+        if (atomic_load_explicit(&rt->tail, memory_order_acquire) == atomic_load_explicit(&rt->head, memory_order_relaxed))
+            break;
+        thread_set_event(rt->wake_event);
+        thread_wait_event(rt->done_event, -1);
+    }
+
+    if (rt->shadow.firstline_draw < svga->firstline_draw)
+        svga->firstline_draw = rt->shadow.firstline_draw;
+    if (rt->shadow.lastline_draw > svga->lastline_draw)
+        svga->lastline_draw = rt->shadow.lastline_draw;
+
+    /* Merged, so a sync later in the frame does not bring back a range
+       that svga_poll() has since reset. */
+    rt->shadow.firstline_draw = 2000;
+    rt->shadow.lastline_draw  = 0;
+
+    /* Only the current palette is still in use. */
+    rt->pals_used = 1;
+}
+
+/* Take a new copy of the svga_t, at the start of every frame. */
+static void
+svga_render_thread_frame(svga_t *svga)
+{
+    svga_render_thread_t *rt = svga->render_thread;
+
+    if (rt == NULL)
+        return;
+
+    svga_render_thread_sync(svga);
+
+    memcpy(&rt->shadow, svga, sizeof(svga_t));
+    rt->shadow.render_thread = NULL;
+
+    rt->pal = rt->shadow_pal = 0;
+    memcpy(rt->pals[0], svga->pallook, sizeof(svga->pallook));
+    rt->pals_used = 1;
+}
+
+static int
+svga_render_thread_can_queue(svga_t *svga)
+{
+    void (*render)(struct svga_t *svga) = svga->render;
+
+    if ((svga->render_thread == NULL) || svga->dpms || svga->override ||
+        svga->overlay_on || svga->dac_hwcursor_on || svga->hwcursor_on)
+        return 0;
+
+    return (render == svga_render_8bpp_lowres) || (render == svga_render_8bpp_highres) ||
+           (render == svga_render_15bpp_lowres) || (render == svga_render_15bpp_highres) ||
+           (render == svga_render_15bpp_mix_lowres) || (render == svga_render_15bpp_mix_highres) ||
+           (render == svga_render_16bpp_lowres) || (render == svga_render_16bpp_highres) ||
+           (render == svga_render_24bpp_lowres) || (render == svga_render_24bpp_highres) ||
+           (render == svga_render_32bpp_lowres) || (render == svga_render_32bpp_highres);
+}
+
+static void
+svga_render_thread_queue(svga_t *svga)
+{
+    svga_render_thread_t *rt   = svga->render_thread;
+    uint32_t              head = atomic_load_explicit(&rt->head, memory_order_relaxed);
+    svga_render_line_t   *line;
+
+    if ((head - atomic_load_explicit(&rt->tail, memory_order_acquire)) >= SVGA_RENDER_LINES)
+        svga_render_thread_sync(svga);
+
+    /* A palette change takes a new slot, so that queued lines keep theirs. */
+    if (memcmp(rt->pals[rt->pal], svga->pallook, sizeof(svga->pallook))) {
+        if (rt->pals_used == SVGA_RENDER_PALS)
+            svga_render_thread_sync(svga);
+        rt->pal = (rt->pal + 1) & (SVGA_RENDER_PALS - 1);
+        memcpy(rt->pals[rt->pal], svga->pallook, sizeof(svga->pallook));
+        rt->pals_used++;
+    }
+
+    line = &rt->lines[head & (SVGA_RENDER_LINES - 1)];
+
+    line->render             = svga->render;
+    line->remap_func         = svga->remap_func;
+    line->conv_16to32        = svga->conv_16to32;
+    line->map8               = (svga->map8 == svga->pallook) ? rt->shadow.pallook : svga->map8;
+    line->memaddr            = svga->memaddr;
+    line->vram_display_mask  = svga->vram_display_mask;
+    line->overscan_color     = svga->overscan_color;
+    line->displine           = svga->displine;
+    line->y_add              = svga->y_add;
+    line->x_add              = svga->x_add;
+    line->left_overscan      = svga->left_overscan;
+    line->scrollcache        = svga->scrollcache;
+    line->hdisp              = svga->hdisp;
+    line->fullchange         = svga->fullchange;
+    line->render_line_offset = svga->render_line_offset;
+    line->remap_required     = svga->remap_required;
+    line->force_old_addr     = svga->force_old_addr;
+    line->lut_map            = svga->lut_map;
+    line->pal                = rt->pal;
+    line->dac_mask           = svga->dac_mask;
+    line->scrblank           = svga->scrblank;
+
+    head++;
+    atomic_store_explicit(&rt->head, head, memory_order_release);
+
+    if (!(head & (SVGA_RENDER_KICK - 1)))
+        thread_set_event(rt->wake_event);
+}
+
+static void
+svga_render_thread_init(svga_t *svga)
+{
+    svga_render_thread_t *rt = calloc(1, sizeof(svga_render_thread_t));
+
+    atomic_init(&rt->head, 0);
+    atomic_init(&rt->tail, 0);
+    rt->on         = 1;
+    rt->wake_event = thread_create_event();
+    rt->done_event = thread_create_event();
+    rt->thread     = thread_create(svga_render_thread, rt);
+
+    svga->render_thread = rt;
+
+    memcpy(&rt->shadow, svga, sizeof(svga_t));
+    rt->shadow.render_thread = NULL;
+}
+
+static void
+svga_render_thread_close(svga_t *svga)
+{
+    svga_render_thread_t *rt = svga->render_thread;
+
+    if (rt == NULL)
+        return;
+
+    svga_render_thread_sync(svga);
+
+    rt->on = 0;
+    thread_set_event(rt->wake_event);
+    thread_wait(rt->thread);
+
+    thread_destroy_event(rt->wake_event);
+    thread_destroy_event(rt->done_event);
+    free(rt);
+
+    svga->render_thread = NULL;
+}
+
 static void
 svga_do_render(svga_t *svga)
 {
+    if (svga_render_thread_can_queue(svga)) {
+        svga->render_line_offset = svga->start_retrace_latch - svga->crtc[0x4];
+        svga_render_thread_queue(svga);
+        svga->x_add = svga->left_overscan - svga->scrollcache;
+        return;
+    }
+
+    /* Lines are drawn in order. */
+    if (svga->render_thread != NULL)
+        svga_render_thread_sync(svga);
+
     /* Always render a blank screen and nothing else while in DPMS mode. */
     if (svga->dpms) {
         svga_render_blank(svga);
@@ -1300,6 +1589,14 @@ svga_do_render(svga_t *svga)
     if (!svga->override) {
         svga->render_line_offset = svga->start_retrace_latch - svga->crtc[0x4];
         svga->render(svga);
+
+        /* The cursors and the overlay are drawn over the line whether or
+           not the renderer redrew it. */
+        if (svga->overlay_on || svga->dac_hwcursor_on || svga->hwcursor_on) {
+            if (svga->firstline_draw == 2000)
+                svga->firstline_draw = svga->displine;
+            svga->lastline_draw = svga->displine;
+        }
     }
 
     if (svga->overlay_on) {
@@ -1389,6 +1686,7 @@ svga_poll(void *priv)
             if (svga->firstline == 2000) {
                 svga->firstline = svga->displine;
                 video_wait_for_buffer_monitor(svga->monitor_index);
+                svga_render_thread_frame(svga);
             }
 
             if (svga->hwcursor_on || svga->dac_hwcursor_on || svga->overlay_on)
@@ -1530,6 +1828,9 @@ svga_poll(void *priv)
             }
         }
         if (svga->vc == svga->dispend) {
+            /* Before changedvram is aged, the render thread reads it. */
+            svga_render_thread_sync(svga);
+
             if (svga->vblank_start)
                 svga->vblank_start(svga);
 
@@ -1571,11 +1872,11 @@ svga_poll(void *priv)
                 if (svga->vertical_linedbl) {
                     wy = (svga->lastline - svga->firstline) << 1;
                     svga->vdisp = wy + 1;
-                    svga_doblit(wx, wy, svga);
+                    svga_doblit_lines(wx, wy, svga, 1);
                 } else {
                     wy = svga->lastline - svga->firstline;
                     svga->vdisp = wy + 1;
-                    svga_doblit(wx, wy, svga);
+                    svga_doblit_lines(wx, wy, svga, 1);
                 }
             }
 
@@ -1713,6 +2014,8 @@ svga_init(const device_t *info, svga_t *svga, void *priv, int memsize,
     svga->conv_16to32                         = svga_conv_16to32;
     svga->render                              = svga_render_blank;
 
+    svga_render_conv_init();
+
     svga->hwcursor.cur_xsize = svga->hwcursor.cur_ysize = 32;
 
     svga->dac_hwcursor.cur_xsize = svga->dac_hwcursor.cur_ysize = 32;
@@ -1770,12 +2073,17 @@ svga_init(const device_t *info, svga_t *svga, void *priv, int memsize,
 
     svga->map8            = svga->pallook;
 
+    if (vid_render_thread)
+        svga_render_thread_init(svga);
+
     return 0;
 }
 
 void
 svga_close(svga_t *svga)
 {
+    svga_render_thread_close(svga);
+
     free(svga->changedvram);
     free(svga->vram);
 
@@ -1785,6 +2093,85 @@ svga_close(svga_t *svga)
     svga_pri = NULL;
 }
 
+/* Save the state of the VGA core and its video memory. Cards save their
+   extended registers, RAMDAC and clock generator themselves. */
+void
+svga_save_state(svga_t *svga, snapshot_t *snap)
+{
+    svga_render_thread_sync(svga);
+
+    snapshot_write_var(snap, svga->vram_max);
+    snapshot_write(snap, &svga->fast, offsetof(svga_t, map8) - offsetof(svga_t, fast));
+    snapshot_write(snap, svga->pallook, offsetof(svga_t, timer) - offsetof(svga_t, pallook));
+    timer_save_state(snap, &svga->timer);
+    snapshot_write(snap, &svga->clock, offsetof(svga_t, render) - offsetof(svga_t, clock));
+    snapshot_write_var(snap, svga->override);
+    snapshot_write(snap, &svga->vga_enabled, offsetof(svga_t, vram) - offsetof(svga_t, vga_enabled));
+    snapshot_write(snap, &svga->crtcreg, offsetof(svga_t, remap_func) - offsetof(svga_t, crtcreg));
+    snapshot_write_var(snap, svga->lut_map);
+    snapshot_write_var(snap, svga->hoverride);
+    snapshot_write_var(snap, svga->mapping.enable);
+    snapshot_write(snap, svga->vram, svga->vram_max);
+}
+
+void
+svga_load_state(svga_t *svga, snapshot_t *snap)
+{
+    uint32_t vram_max;
+    int      enable;
+
+    if (!snapshot_read_var(snap, vram_max))
+        return;
+    if (vram_max != svga->vram_max) {
+        snapshot_fail(snap, "video memory size mismatch");
+        return;
+    }
+
+    svga_render_thread_sync(svga);
+
+    snapshot_read(snap, &svga->fast, offsetof(svga_t, map8) - offsetof(svga_t, fast));
+    snapshot_read(snap, svga->pallook, offsetof(svga_t, timer) - offsetof(svga_t, pallook));
+    timer_load_state(snap, &svga->timer);
+    snapshot_read(snap, &svga->clock, offsetof(svga_t, render) - offsetof(svga_t, clock));
+    snapshot_read_var(snap, svga->override);
+    snapshot_read(snap, &svga->vga_enabled, offsetof(svga_t, vram) - offsetof(svga_t, vga_enabled));
+    snapshot_read(snap, &svga->crtcreg, offsetof(svga_t, remap_func) - offsetof(svga_t, crtcreg));
+    snapshot_read_var(snap, svga->lut_map);
+    snapshot_read_var(snap, svga->hoverride);
+    snapshot_read_var(snap, svga->mapping.enable);
+    snapshot_read(snap, svga->vram, svga->vram_max);
+    enable = svga->mapping.enable;
+
+    /* Map the memory window and the mono/colour port range the way the
+       restored GDC 6 and misc output registers select them. */
+    switch (svga->gdcreg[6] & 0xc) {
+        case 0x0:
+            mem_mapping_set_addr(&svga->mapping, 0xa0000, 0x20000);
+            break;
+        case 0x4:
+            mem_mapping_set_addr(&svga->mapping, 0xa0000, 0x10000);
+            break;
+        case 0x8:
+            mem_mapping_set_addr(&svga->mapping, 0xb0000, 0x08000);
+            break;
+        default:
+            mem_mapping_set_addr(&svga->mapping, 0xb8000, 0x08000);
+            break;
+    }
+    if (!enable)
+        mem_mapping_disable(&svga->mapping);
+
+    if (svga->priv_parent == NULL) {
+        io_removehandler(0x03a0, 0x0020, svga->video_in, NULL, NULL, svga->video_out, NULL, NULL, svga->priv);
+        if (!(svga->miscout & 1))
+            io_sethandler(0x03a0, 0x0020, svga->video_in, NULL, NULL, svga->video_out, NULL, NULL, svga->priv);
+    }
+
+    memset(svga->changedvram, 0xff, (svga->vram_max >> 12) + 1);
+    svga_recalctimings(svga);
+    svga->fullchange = svga->monitor->mon_changeframecount;
+}
+
 uint32_t
 svga_decode_addr(svga_t *svga, uint32_t addr, int write)
 {
@@ -2131,8 +2518,11 @@ svga_read_linear(uint32_t addr, void *priv)
     return svga_read_common(addr, 1, priv);
 }
 
-void
-svga_doblit(int wx, int wy, svga_t *svga)
+/* Blit the frame, with only the lines drawn since the previous one marked as
+   changed when lines is set. Everything else that draws to the target
+   buffer (the 8514/A, XGA and Voodoo) does not keep track of that. */
+static void
+svga_doblit_lines(int wx, int wy, svga_t *svga, int lines)
 {
     int       y_add;
     int       x_add;
@@ -2144,6 +2534,11 @@ svga_doblit(int wx, int wy, svga_t *svga)
     int       j;
     int       xs_temp;
     int       ys_temp;
+    int       dirty_y1;
+    int       dirty_y2;
+    uint32_t  overscan_color;
+
+    svga_render_thread_sync(svga);
 
     y_add   = enable_overscan ? svga->monitor->mon_overscan_y : 0;
     x_add   = enable_overscan ? svga->monitor->mon_overscan_x : 0;
@@ -2218,12 +2613,31 @@ svga_doblit(int wx, int wy, svga_t *svga)
         }
     }
 
-    video_blit_memtoscreen_monitor(x_start, y_start, svga->monitor->mon_xsize + x_add, svga->monitor->mon_ysize + y_add, svga->monitor_index);
+    overscan_color = svga->dpms ? 0 : svga->overscan_color;
+    if (!lines || svga->override || (overscan_color != svga->blit_overscan_color)) {
+        dirty_y1 = 0;
+        dirty_y2 = 2048;
+    } else if (svga->firstline_draw == 2000)
+        dirty_y1 = dirty_y2 = 0;
+    else {
+        dirty_y1 = svga->firstline_draw + svga->y_add;
+        dirty_y2 = svga->lastline_draw + svga->y_add + 1;
+    }
+    svga->blit_overscan_color = overscan_color;
+
+    video_blit_memtoscreen_dirty_monitor(x_start, y_start, svga->monitor->mon_xsize + x_add, svga->monitor->mon_ysize + y_add,
+                                         dirty_y1, dirty_y2, svga->monitor_index);
 
     if (svga->vertical_linedbl)
         svga->vertical_linedbl >>= 1;
 }
 
+void
+svga_doblit(int wx, int wy, svga_t *svga)
+{
+    svga_doblit_lines(wx, wy, svga, 0);
+}
+
 void
 svga_writeb_linear(uint32_t addr, uint8_t val, void *priv)
 {
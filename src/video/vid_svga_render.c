@@ -42,6 +42,25 @@ svga_lookup_lut_ram(svga_t* svga, uint32_t val)
 
 #define lookup_lut(val) svga_lookup_lut_ram(svga, val)
 
+/* Number of pixels drawn by the loops below, which go through
+   hdisp + scrollcache inclusive, step pixels at a time. */
+static inline int
+svga_render_count(int last, int step)
+{
+    return (last < 0) ? 0 : (((last / step) + 1) * step);
+}
+
+/* Whether the bytes of a line starting at memaddr are in one piece in VRAM,
+   so that they can go through the line converters rather than a dword at a
+   time through the display mask. */
+static inline bool
+svga_render_linear(svga_t *svga, uint32_t bytes)
+{
+    const uint32_t mask = svga->vram_display_mask;
+
+    return !(mask & (mask + 1)) && (((svga->memaddr & mask) + bytes) <= (mask + 1));
+}
+
 void
 svga_render_null(svga_t *svga)
 {
@@ -812,7 +831,27 @@ svga_render_indexed_gfx(svga_t *svga, bool highres, bool combine8bits)
     uint32_t edat         = 0;
     static uint32_t col          = 0;
     static uint32_t col2         = 0;
-    for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += charwidth) {
+
+    /* Packed 8bpp, one byte per pixel straight out of VRAM, the loop below
+       then has nothing left to draw. */
+    x = 0;
+    if (highres && combine8bits && !svga->force_old_addr && !svga->remap_required &&
+        !svga->ati_4color && !svga->packed_4bpp && !svga->half_pixel && !attrblink &&
+        (incevery == 1) && (loadevery == 1)) {
+        const int count = svga_render_count(svga->hdisp + svga->scrollcache, charwidth);
+
+        if ((count > 0) && svga_render_linear(svga, count)) {
+            svga_render_conv->line_8bpp(p, &svga->vram[svga->memaddr & svga->vram_display_mask], svga->map8,
+                                        (0x11 * svga->plane_mask) & svga->dac_mask, count);
+            col = p[count - 1];
+            x   = count;
+
+            svga->memaddr += count;
+            svga->memaddr &= svga->vram_display_mask;
+        }
+    }
+
+    for (; x <= (svga->hdisp + svga->scrollcache); x += charwidth) {
         if (load_counter == 0) {
             /* Find our address */
             if (svga->force_old_addr) {
@@ -1615,7 +1654,11 @@ svga_render_15bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            x = svga_render_count(svga->hdisp + svga->scrollcache, 8);
+            if (!svga->remap_required && (svga->conv_16to32 == svga_conv_16to32) && svga_render_linear(svga, x << 1)) {
+                svga_render_conv->line_15bpp(p, &svga->vram[svga->memaddr & svga->vram_display_mask], x);
+                svga->memaddr += x << 1;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 8) {
                     dat  = *(uint32_t *) (&svga->vram[(svga->memaddr + (x << 1)) & svga->vram_display_mask]);
                     *p++ = svga->conv_16to32(svga, dat & 0xffff, 15);
@@ -1847,7 +1890,11 @@ svga_render_16bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            x = svga_render_count(svga->hdisp + svga->scrollcache, 8);
+            if (!svga->remap_required && (svga->conv_16to32 == svga_conv_16to32) && svga_render_linear(svga, x << 1)) {
+                svga_render_conv->line_16bpp(p, &svga->vram[svga->memaddr & svga->vram_display_mask], x);
+                svga->memaddr += x << 1;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 8) {
                     dat  = *(uint32_t *) (&svga->vram[(svga->memaddr + (x << 1)) & svga->vram_display_mask]);
                     *p++ = svga->conv_16to32(svga, dat & 0xffff, 16);
@@ -2008,7 +2055,11 @@ svga_render_24bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            x = svga_render_count(svga->hdisp + svga->scrollcache, 4);
+            if (!svga->remap_required && !svga->lut_map && svga_render_linear(svga, x * 3)) {
+                svga_render_conv->line_24bpp(p, &svga->vram[svga->memaddr & svga->vram_display_mask], x);
+                svga->memaddr += x * 3;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 4) {
                     dat0 = *(uint32_t *) (&svga->vram[svga->memaddr & svga->vram_display_mask]);
                     dat1 = *(uint32_t *) (&svga->vram[(svga->memaddr + 4) & svga->vram_display_mask]);
@@ -2136,7 +2187,11 @@ svga_render_32bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            x = svga_render_count(svga->hdisp + svga->scrollcache, 1);
+            if (!svga->remap_required && !svga->lut_map && svga_render_linear(svga, x * 4)) {
+                svga_render_conv->line_32bpp(p, &svga->vram[svga->memaddr & svga->vram_display_mask], x);
+                svga->memaddr += x * 4;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x++) {
                     dat  = *(uint32_t *) (&svga->vram[(svga->memaddr + (x << 2)) & svga->vram_display_mask]);
                     *p++ = lookup_lut(dat & 0xffffff);
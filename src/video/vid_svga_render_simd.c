@@ -0,0 +1,574 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          SVGA line converters.
+ *
+ *          The packed pixel renderers hand whole lines of VRAM to one of
+ *          these once they know the line is contiguous, the set is picked
+ *          at startup from what the host CPU supports: SSE2 (always there
+ *          on x86-64), AVX2 or NEON, with plain C as the fallback. Every
+ *          variant produces exactly the same pixels as the tables in
+ *          video.c, including their rounding of the 15/16bpp channels.
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#if defined _M_X64 || defined __amd64__ || defined __SSE2__
+#    define CONV_SSE2
+#    include <immintrin.h>
+#    ifdef _MSC_VER
+#        include <intrin.h>
+#        define CONV_AVX2_TARGET
+#    else
+#        define CONV_AVX2_TARGET __attribute__((target("avx2")))
+#    endif
+#elif defined _M_ARM64 || defined __ARM_NEON
+#    define CONV_NEON
+#    include <arm_neon.h>
+#endif
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/mem.h>
+#include <86box/timer.h>
+#include <86box/plat.h>
+#include <86box/video.h>
+#include <86box/vid_svga.h>
+#include <86box/vid_svga_render.h>
+
+/* The 15/16bpp tables scale each channel as (int) (v / 31.0 * 255.0), that
+   is (v * 255) / 31 rounded down. In 16-bit lanes the division becomes a
+   multiply high and a shift, exact for every v * 255 in range. */
+#define CONV_MUL5   8457 /* ((v * 255) * CONV_MUL5) >> 18 == (v * 255) / 31 */
+#define CONV_SHIFT5 2
+#define CONV_MUL6   8323 /* ((v * 255) * CONV_MUL6) >> 19 == (v * 255) / 63 */
+#define CONV_SHIFT6 3
+
+#define BENCH_WIDTH  1024
+#define BENCH_HEIGHT 768
+#define BENCH_FRAMES 100
+
+#ifdef ENABLE_SVGA_RENDER_SIMD_LOG
+int svga_render_simd_do_log = ENABLE_SVGA_RENDER_SIMD_LOG;
+
+static void
+svga_render_simd_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (svga_render_simd_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define svga_render_simd_log(fmt, ...)
+#endif
+
+static void
+conv_8bpp_c(uint32_t *p, const uint8_t *src, const uint32_t *pal, uint32_t mask, int count)
+{
+    for (int i = 0; i < count; i++)
+        p[i] = pal[src[i] & mask];
+}
+
+static void
+conv_15bpp_c(uint32_t *p, const uint8_t *src, int count)
+{
+    for (int i = 0; i < count; i++)
+        p[i] = video_15to32[*(const uint16_t *) &src[i << 1]];
+}
+
+static void
+conv_16bpp_c(uint32_t *p, const uint8_t *src, int count)
+{
+    for (int i = 0; i < count; i++)
+        p[i] = video_16to32[*(const uint16_t *) &src[i << 1]];
+}
+
+static void
+conv_24bpp_c(uint32_t *p, const uint8_t *src, int count)
+{
+    for (int i = 0; i < count; i++, src += 3)
+        p[i] = src[0] | (src[1] << 8) | (src[2] << 16);
+}
+
+static void
+conv_32bpp_c(uint32_t *p, const uint8_t *src, int count)
+{
+    for (int i = 0; i < count; i++)
+        p[i] = *(const uint32_t *) &src[i << 2] & 0xffffff;
+}
+
+static const svga_render_conv_t conv_c = {
+    .name       = "C",
+    .line_8bpp  = conv_8bpp_c,
+    .line_15bpp = conv_15bpp_c,
+    .line_16bpp = conv_16bpp_c,
+    .line_24bpp = conv_24bpp_c,
+    .line_32bpp = conv_32bpp_c
+};
+
+#if defined CONV_SSE2
+static inline __m128i
+conv_expand_sse2(__m128i v, int mul, int shift)
+{
+    v = _mm_mulhi_epu16(_mm_mullo_epi16(v, _mm_set1_epi16(255)), _mm_set1_epi16(mul));
+    return _mm_srl_epi16(v, _mm_cvtsi32_si128(shift));
+}
+
+/* Interleaves 16-bit b | (g << 8) and r | 0xff00 into two sets of four
+   pixels. */
+static inline void
+conv_store_sse2(uint32_t *p, __m128i b, __m128i g, __m128i r)
+{
+    const __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+    const __m128i ra = _mm_or_si128(r, _mm_set1_epi16((short) 0xff00));
+
+    _mm_storeu_si128((__m128i *) p, _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128((__m128i *) &p[4], _mm_unpackhi_epi16(bg, ra));
+}
+
+static void
+conv_15bpp_sse2(uint32_t *p, const uint8_t *src, int count)
+{
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    int           i     = 0;
+
+    for (; (i + 8) <= count; i += 8) {
+        const __m128i c = _mm_loadu_si128((const __m128i *) &src[i << 1]);
+        const __m128i b = conv_expand_sse2(_mm_and_si128(c, mask5), CONV_MUL5, CONV_SHIFT5);
+        const __m128i g = conv_expand_sse2(_mm_and_si128(_mm_srli_epi16(c, 5), mask5), CONV_MUL5, CONV_SHIFT5);
+        const __m128i r = conv_expand_sse2(_mm_and_si128(_mm_srli_epi16(c, 10), mask5), CONV_MUL5, CONV_SHIFT5);
+
+        conv_store_sse2(&p[i], b, g, r);
+    }
+
+    conv_15bpp_c(&p[i], &src[i << 1], count - i);
+}
+
+static void
+conv_16bpp_sse2(uint32_t *p, const uint8_t *src, int count)
+{
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    const __m128i mask6 = _mm_set1_epi16(0x3f);
+    int           i     = 0;
+
+    for (; (i + 8) <= count; i += 8) {
+        const __m128i c = _mm_loadu_si128((const __m128i *) &src[i << 1]);
+        const __m128i b = conv_expand_sse2(_mm_and_si128(c, mask5), CONV_MUL5, CONV_SHIFT5);
+        const __m128i g = conv_expand_sse2(_mm_and_si128(_mm_srli_epi16(c, 5), mask6), CONV_MUL6, CONV_SHIFT6);
+        const __m128i r = conv_expand_sse2(_mm_srli_epi16(c, 11), CONV_MUL5, CONV_SHIFT5);
+
+        conv_store_sse2(&p[i], b, g, r);
+    }
+
+    conv_16bpp_c(&p[i], &src[i << 1], count - i);
+}
+
+static void
+conv_32bpp_sse2(uint32_t *p, const uint8_t *src, int count)
+{
+    const __m128i mask = _mm_set1_epi32(0x00ffffff);
+    int           i    = 0;
+
+    for (; (i + 4) <= count; i += 4)
+        _mm_storeu_si128((__m128i *) &p[i], _mm_and_si128(_mm_loadu_si128((const __m128i *) &src[i << 2]), mask));
+
+    conv_32bpp_c(&p[i], &src[i << 2], count - i);
+}
+
+/* SSE2 has neither byte shuffles nor gathers, 8bpp and 24bpp stay in C. */
+static const svga_render_conv_t conv_sse2 = {
+    .name       = "SSE2",
+    .line_8bpp  = conv_8bpp_c,
+    .line_15bpp = conv_15bpp_sse2,
+    .line_16bpp = conv_16bpp_sse2,
+    .line_24bpp = conv_24bpp_c,
+    .line_32bpp = conv_32bpp_sse2
+};
+
+static inline CONV_AVX2_TARGET __m256i
+conv_expand_avx2(__m256i v, int mul, int shift)
+{
+    v = _mm256_mulhi_epu16(_mm256_mullo_epi16(v, _mm256_set1_epi16(255)), _mm256_set1_epi16(mul));
+    return _mm256_srl_epi16(v, _mm_cvtsi32_si128(shift));
+}
+
+/* The unpacks work within each 128-bit lane, so put the halves back in
+   pixel order before storing. */
+static inline CONV_AVX2_TARGET void
+conv_store_avx2(uint32_t *p, __m256i b, __m256i g, __m256i r)
+{
+    const __m256i bg = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+    const __m256i ra = _mm256_or_si256(r, _mm256_set1_epi16((short) 0xff00));
+    const __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+    const __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+
+    _mm256_storeu_si256((__m256i *) p, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i *) &p[8], _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+static CONV_AVX2_TARGET void
+conv_8bpp_avx2(uint32_t *p, const uint8_t *src, const uint32_t *pal, uint32_t mask, int count)
+{
+    const __m256i vmask = _mm256_set1_epi32((int) mask);
+    int           i     = 0;
+
+    for (; (i + 8) <= count; i += 8) {
+        const __m256i idx = _mm256_and_si256(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) &src[i])), vmask);
+
+        _mm256_storeu_si256((__m256i *) &p[i], _mm256_i32gather_epi32((const int *) pal, idx, 4));
+    }
+
+    conv_8bpp_c(&p[i], &src[i], pal, mask, count - i);
+}
+
+static CONV_AVX2_TARGET void
+conv_15bpp_avx2(uint32_t *p, const uint8_t *src, int count)
+{
+    const __m256i mask5 = _mm256_set1_epi16(0x1f);
+    int           i     = 0;
+
+    for (; (i + 16) <= count; i += 16) {
+        const __m256i c = _mm256_loadu_si256((const __m256i *) &src[i << 1]);
+        const __m256i b = conv_expand_avx2(_mm256_and_si256(c, mask5), CONV_MUL5, CONV_SHIFT5);
+        const __m256i g = conv_expand_avx2(_mm256_and_si256(_mm256_srli_epi16(c, 5), mask5), CONV_MUL5, CONV_SHIFT5);
+        const __m256i r = conv_expand_avx2(_mm256_and_si256(_mm256_srli_epi16(c, 10), mask5), CONV_MUL5, CONV_SHIFT5);
+
+        conv_store_avx2(&p[i], b, g, r);
+    }
+
+    conv_15bpp_sse2(&p[i], &src[i << 1], count - i);
+}
+
+static CONV_AVX2_TARGET void
+conv_16bpp_avx2(uint32_t *p, const uint8_t *src, int count)
+{
+    const __m256i mask5 = _mm256_set1_epi16(0x1f);
+    const __m256i mask6 = _mm256_set1_epi16(0x3f);
+    int           i     = 0;
+
+    for (; (i + 16) <= count; i += 16) {
+        const __m256i c = _mm256_loadu_si256((const __m256i *) &src[i << 1]);
+        const __m256i b = conv_expand_avx2(_mm256_and_si256(c, mask5), CONV_MUL5, CONV_SHIFT5);
+        const __m256i g = conv_expand_avx2(_mm256_and_si256(_mm256_srli_epi16(c, 5), mask6), CONV_MUL6, CONV_SHIFT6);
+        const __m256i r = conv_expand_avx2(_mm256_srli_epi16(c, 11), CONV_MUL5, CONV_SHIFT5);
+
+        conv_store_avx2(&p[i], b, g, r);
+    }
+
+    conv_16bpp_sse2(&p[i], &src[i << 1], count - i);
+}
+
+static CONV_AVX2_TARGET void
+conv_24bpp_avx2(uint32_t *p, const uint8_t *src, int count)
+{
+    const __m256i shuf = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                          0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    int           i    = 0;
+
+    /* Each half reads 16 bytes for 12 used, stop while the last read is
+       still within the line. */
+    for (; (i + 10) <= count; i += 8) {
+        const __m256i c = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) &src[i * 3])),
+                                                  _mm_loadu_si128((const __m128i *) &src[(i * 3) + 12]), 1);
+
+        _mm256_storeu_si256((__m256i *) &p[i], _mm256_shuffle_epi8(c, shuf));
+    }
+
+    conv_24bpp_c(&p[i], &src[i * 3], count - i);
+}
+
+static CONV_AVX2_TARGET void
+conv_32bpp_avx2(uint32_t *p, const uint8_t *src, int count)
+{
+    const __m256i mask = _mm256_set1_epi32(0x00ffffff);
+    int           i    = 0;
+
+    for (; (i + 8) <= count; i += 8)
+        _mm256_storeu_si256((__m256i *) &p[i], _mm256_and_si256(_mm256_loadu_si256((const __m256i *) &src[i << 2]), mask));
+
+    conv_32bpp_sse2(&p[i], &src[i << 2], count - i);
+}
+
+static const svga_render_conv_t conv_avx2 = {
+    .name       = "AVX2",
+    .line_8bpp  = conv_8bpp_avx2,
+    .line_15bpp = conv_15bpp_avx2,
+    .line_16bpp = conv_16bpp_avx2,
+    .line_24bpp = conv_24bpp_avx2,
+    .line_32bpp = conv_32bpp_avx2
+};
+
+static int
+conv_has_avx2(void)
+{
+#    ifdef _MSC_VER
+    int regs[4];
+
+    __cpuid(regs, 0);
+    if (regs[0] < 7)
+        return 0;
+
+    /* The OS has to save the YMM registers as well. */
+    __cpuid(regs, 1);
+    if (!(regs[2] & (1 << 27)) || !(regs[2] & (1 << 28)) || ((_xgetbv(0) & 6) != 6))
+        return 0;
+
+    __cpuidex(regs, 7, 0);
+    return !!(regs[1] & (1 << 5));
+#    else
+    __builtin_cpu_init();
+    return !!__builtin_cpu_supports("avx2");
+#    endif
+}
+#elif defined CONV_NEON
+static inline uint8x8_t
+conv_expand_neon(uint16x8_t v, uint16_t mul, int shift)
+{
+    v = vmulq_n_u16(v, 255);
+    v = vcombine_u16(vshrn_n_u32(vmull_n_u16(vget_low_u16(v), mul), 16),
+                     vshrn_n_u32(vmull_n_u16(vget_high_u16(v), mul), 16));
+    return vmovn_u16(vshlq_u16(v, vdupq_n_s16(-shift)));
+}
+
+static void
+conv_15bpp_neon(uint32_t *p, const uint8_t *src, int count)
+{
+    const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+    uint8x8x4_t      out;
+    int              i = 0;
+
+    out.val[3] = vdup_n_u8(0xff);
+    for (; (i + 8) <= count; i += 8) {
+        const uint16x8_t c = vld1q_u16((const uint16_t *) &src[i << 1]);
+
+        out.val[0] = conv_expand_neon(vandq_u16(c, mask5), CONV_MUL5, CONV_SHIFT5);
+        out.val[1] = conv_expand_neon(vandq_u16(vshrq_n_u16(c, 5), mask5), CONV_MUL5, CONV_SHIFT5);
+        out.val[2] = conv_expand_neon(vandq_u16(vshrq_n_u16(c, 10), mask5), CONV_MUL5, CONV_SHIFT5);
+        vst4_u8((uint8_t *) &p[i], out);
+    }
+
+    conv_15bpp_c(&p[i], &src[i << 1], count - i);
+}
+
+static void
+conv_16bpp_neon(uint32_t *p, const uint8_t *src, int count)
+{
+    const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+    const uint16x8_t mask6 = vdupq_n_u16(0x3f);
+    uint8x8x4_t      out;
+    int              i = 0;
+
+    out.val[3] = vdup_n_u8(0xff);
+    for (; (i + 8) <= count; i += 8) {
+        const uint16x8_t c = vld1q_u16((const uint16_t *) &src[i << 1]);
+
+        out.val[0] = conv_expand_neon(vandq_u16(c, mask5), CONV_MUL5, CONV_SHIFT5);
+        out.val[1] = conv_expand_neon(vandq_u16(vshrq_n_u16(c, 5), mask6), CONV_MUL6, CONV_SHIFT6);
+        out.val[2] = conv_expand_neon(vshrq_n_u16(c, 11), CONV_MUL5, CONV_SHIFT5);
+        vst4_u8((uint8_t *) &p[i], out);
+    }
+
+    conv_16bpp_c(&p[i], &src[i << 1], count - i);
+}
+
+static void
+conv_24bpp_neon(uint32_t *p, const uint8_t *src, int count)
+{
+    uint8x8x4_t out;
+    uint8x8x3_t in;
+    int         i = 0;
+
+    out.val[3] = vdup_n_u8(0x00);
+    for (; (i + 8) <= count; i += 8) {
+        in         = vld3_u8(&src[i * 3]);
+        out.val[0] = in.val[0];
+        out.val[1] = in.val[1];
+        out.val[2] = in.val[2];
+        vst4_u8((uint8_t *) &p[i], out);
+    }
+
+    conv_24bpp_c(&p[i], &src[i * 3], count - i);
+}
+
+static void
+conv_32bpp_neon(uint32_t *p, const uint8_t *src, int count)
+{
+    const uint32x4_t mask = vdupq_n_u32(0x00ffffff);
+    int              i    = 0;
+
+    for (; (i + 4) <= count; i += 4)
+        vst1q_u32(&p[i], vandq_u32(vld1q_u32((const uint32_t *) &src[i << 2]), mask));
+
+    conv_32bpp_c(&p[i], &src[i << 2], count - i);
+}
+
+/* NEON has no gathers, 8bpp stays in C. */
+static const svga_render_conv_t conv_neon = {
+    .name       = "NEON",
+    .line_8bpp  = conv_8bpp_c,
+    .line_15bpp = conv_15bpp_neon,
+    .line_16bpp = conv_16bpp_neon,
+    .line_24bpp = conv_24bpp_neon,
+    .line_32bpp = conv_32bpp_neon
+};
+#endif
+
+const svga_render_conv_t *svga_render_conv = &conv_c;
+
+/* Fills list with every converter set the host can run, the plain C one
+   first and the preferred one last. */
+static int
+svga_render_conv_list(const svga_render_conv_t **list)
+{
+    int num = 0;
+
+    list[num++] = &conv_c;
+#if defined CONV_SSE2
+    list[num++] = &conv_sse2;
+    if (conv_has_avx2())
+        list[num++] = &conv_avx2;
+#elif defined CONV_NEON
+    list[num++] = &conv_neon;
+#endif
+
+    return num;
+}
+
+void
+svga_render_conv_init(void)
+{
+    const svga_render_conv_t *list[4];
+    int                       num = svga_render_conv_list(list);
+
+    svga_render_conv = list[num - 1];
+    svga_render_simd_log("SVGA: using the %s line converters\n", svga_render_conv->name);
+}
+
+static void
+bench_line(const svga_render_conv_t *conv, int bpp, uint32_t *p, const uint8_t *src, const uint32_t *pal, int count)
+{
+    switch (bpp) {
+        case 8:
+            conv->line_8bpp(p, src, pal, 0xff, count);
+            break;
+        case 15:
+            conv->line_15bpp(p, src, count);
+            break;
+        case 16:
+            conv->line_16bpp(p, src, count);
+            break;
+        case 24:
+            conv->line_24bpp(p, src, count);
+            break;
+        default:
+            conv->line_32bpp(p, src, count);
+            break;
+    }
+}
+
+/* Converts a frame of random VRAM in every mode with every converter set the
+   host can run, and reports how many pixels each one converts per second of
+   host time, and whether its output matches the plain C one. Returns 0, so
+   that the emulator exits. */
+int
+svga_render_bench(void)
+{
+    static const int          bpps[5] = { 8, 15, 16, 24, 32 };
+    const svga_render_conv_t *list[4];
+    uint32_t                 *own_tables = NULL;
+    uint32_t                 *ref;
+    uint32_t                 *out;
+    uint32_t                  pal[256];
+    uint8_t                  *vram;
+    uint32_t                  seed = 0x86b0c5e5;
+    uint64_t                  start;
+    uint64_t                  ticks;
+    uint32_t                  sum;
+    double                    secs;
+    double                    base;
+    int                       num = svga_render_conv_list(list);
+    int                       pitch;
+
+    /* The benchmark runs before video_init(), so make our own tables. */
+    if (video_15to32 == NULL) {
+        own_tables   = malloc(2 * 65536 * sizeof(uint32_t));
+        video_15to32 = own_tables;
+        video_16to32 = &own_tables[65536];
+        for (uint32_t c = 0; c < 65536; c++) {
+            video_15to32[c] = calc_15to32(c & 0x7fff);
+            video_16to32[c] = calc_16to32(c);
+        }
+    }
+
+    vram = malloc(BENCH_WIDTH * BENCH_HEIGHT * 4);
+    ref  = malloc(BENCH_WIDTH * BENCH_HEIGHT * sizeof(uint32_t));
+    out  = malloc(BENCH_WIDTH * BENCH_HEIGHT * sizeof(uint32_t));
+    if ((vram == NULL) || (ref == NULL) || (out == NULL))
+        fatal("SVGA benchmark: out of memory\n");
+
+    for (int i = 0; i < (BENCH_WIDTH * BENCH_HEIGHT * 4); i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        vram[i] = seed >> 24;
+    }
+    for (int i = 0; i < 256; i++)
+        pal[i] = *(uint32_t *) &vram[i << 2];
+
+    always_log("SVGA benchmark: %ix%i, %i frames per mode\n", BENCH_WIDTH, BENCH_HEIGHT, BENCH_FRAMES);
+
+    for (int m = 0; m < 5; m++) {
+        pitch = BENCH_WIDTH * ((bpps[m] + 7) >> 3);
+        base  = 0.0;
+
+        for (int c = 0; c < num; c++) {
+            ticks = 0;
+            for (int f = 0; f < BENCH_FRAMES; f++) {
+                start = plat_timer_read();
+                for (int y = 0; y < BENCH_HEIGHT; y++)
+                    bench_line(list[c], bpps[m], &out[y * BENCH_WIDTH], &vram[y * pitch], pal, BENCH_WIDTH);
+                ticks += plat_timer_read() - start;
+            }
+
+            if (c == 0)
+                memcpy(ref, out, BENCH_WIDTH * BENCH_HEIGHT * sizeof(uint32_t));
+
+            /* FNV-1a over the frame, outside of the timed section. */
+            sum = 2166136261u;
+            for (int i = 0; i < (BENCH_WIDTH * BENCH_HEIGHT); i++)
+                sum = (sum ^ out[i]) * 16777619u;
+
+            secs = (double) ticks / (double) plat_timer_freq();
+            secs = (secs > 0.0) ? (((double) BENCH_WIDTH * BENCH_HEIGHT * BENCH_FRAMES) / secs) : 0.0;
+            if (c == 0)
+                base = secs;
+            always_log("%2i bpp  %-5s %14.0f pixels/s, %5.2fx, checksum %08X%s\n",
+                       bpps[m], list[c]->name, secs, (base > 0.0) ? (secs / base) : 0.0, sum,
+                       memcmp(ref, out, BENCH_WIDTH * BENCH_HEIGHT * sizeof(uint32_t)) ? ", MISMATCH" : "");
+        }
+    }
+
+    free(out);
+    free(ref);
+    free(vram);
+
+    if (own_tables != NULL) {
+        free(own_tables);
+        video_15to32 = NULL;
+        video_16to32 = NULL;
+    }
+
+    return 0;
+}
@@ -25,6 +25,7 @@
 #include <86box/rom.h>
 #include <86box/device.h>
 #include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/video.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_vga.h>
@@ -215,6 +216,22 @@ vga_force_redraw(void *priv)
     vga->svga.fullchange = changeframecount;
 }
 
+static void
+vga_save(void *priv, snapshot_t *snap)
+{
+    vga_t *vga = (vga_t *) priv;
+
+    svga_save_state(&vga->svga, snap);
+}
+
+static void
+vga_load(void *priv, snapshot_t *snap)
+{
+    vga_t *vga = (vga_t *) priv;
+
+    svga_load_state(&vga->svga, snap);
+}
+
 const device_t vga_device = {
     .name          = "IBM VGA",
     .internal_name = "vga",
@@ -226,7 +243,9 @@ const device_t vga_device = {
     .available     = vga_available,
     .speed_changed = vga_speed_changed,
     .force_redraw  = vga_force_redraw,
-    .config        = NULL
+    .config        = NULL,
+    .save          = vga_save,
+    .load          = vga_load
 };
 
 const device_t ps1vga_device = {
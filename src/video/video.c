@@ -203,6 +203,9 @@ const uint32_t shade[5][256] = {
 
 typedef struct blit_data_struct {
     int x, y, w, h;
+    int dirty_y1, dirty_y2; /* Lines changed since the previous frame, y2 excluded. */
+    int last_x, last_y, last_w, last_h;
+    atomic_int invalid;     /* The renderer lost a frame, send all of the next one. */
     int busy;
     int buffer_in_use;
     int thread_run;
@@ -427,9 +430,14 @@ blit_thread(void *param)
     }
 }
 
+/* Blit a frame of which only lines dirty_y1 to dirty_y2 - 1 changed since the
+   previous one, renderers that keep the previous frame around only need to
+   update those. */
 void
-video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index)
+video_blit_memtoscreen_dirty_monitor(int x, int y, int w, int h, int dirty_y1, int dirty_y2, int monitor_index)
 {
+    blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+
     MTR_BEGIN("video", "video_blit_memtoscreen");
 
     if ((w <= 0) || (h <= 0))
@@ -437,18 +445,70 @@ video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index)
 
     video_wait_for_blit_monitor(monitor_index);
 
-    monitors[monitor_index].mon_blit_data_ptr->busy          = 1;
-    monitors[monitor_index].mon_blit_data_ptr->buffer_in_use = 1;
-    monitors[monitor_index].mon_blit_data_ptr->x             = x;
-    monitors[monitor_index].mon_blit_data_ptr->y             = y;
-    monitors[monitor_index].mon_blit_data_ptr->w             = w;
-    monitors[monitor_index].mon_blit_data_ptr->h             = h;
+    /* Anything the renderer may not have, send whole. */
+    if ((x != blit_data_ptr->last_x) || (y != blit_data_ptr->last_y) || (w != blit_data_ptr->last_w) ||
+        (h != blit_data_ptr->last_h) || atomic_exchange(&blit_data_ptr->invalid, 0) ||
+        monitors[monitor_index].mon_screenshots || monitors[monitor_index].mon_screenshots_clipboard ||
+        monitors[monitor_index].mon_screenshots_raw || monitors[monitor_index].mon_screenshots_raw_clipboard) {
+        dirty_y1 = y;
+        dirty_y2 = y + h;
+    } else {
+        if (dirty_y1 < y)
+            dirty_y1 = y;
+        if (dirty_y2 > (y + h))
+            dirty_y2 = y + h;
+        if (dirty_y1 >= dirty_y2)
+            dirty_y1 = dirty_y2 = y;
+    }
+
+    blit_data_ptr->last_x = x;
+    blit_data_ptr->last_y = y;
+    blit_data_ptr->last_w = w;
+    blit_data_ptr->last_h = h;
+
+    blit_data_ptr->busy          = 1;
+    blit_data_ptr->buffer_in_use = 1;
+    blit_data_ptr->x             = x;
+    blit_data_ptr->y             = y;
+    blit_data_ptr->w             = w;
+    blit_data_ptr->h             = h;
+    blit_data_ptr->dirty_y1      = dirty_y1;
+    blit_data_ptr->dirty_y2      = dirty_y2;
     monitors[monitor_index].mon_renderedframes++;
 
-    thread_set_event(monitors[monitor_index].mon_blit_data_ptr->wake_blit_thread);
+    thread_set_event(blit_data_ptr->wake_blit_thread);
     MTR_END("video", "video_blit_memtoscreen");
 }
 
+void
+video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index)
+{
+    video_blit_memtoscreen_dirty_monitor(x, y, w, h, y, y + h, monitor_index);
+}
+
+/* Called by the renderer from its blit function: the lines of the frame it is
+   given that changed since the previous one. The range is empty when the
+   frame is the same as the previous one. */
+void
+video_blit_get_dirty_monitor(int monitor_index, int *y1, int *y2)
+{
+    const blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+
+    *y1 = blit_data_ptr->dirty_y1;
+    *y2 = blit_data_ptr->dirty_y2;
+}
+
+/* Called by the renderer when it dropped a frame, or lost its copy of the
+   previous one, so that the next frame is sent whole. */
+void
+video_blit_invalidate_monitor(int monitor_index)
+{
+    blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+
+    if (blit_data_ptr != NULL)
+        atomic_store(&blit_data_ptr->invalid, 1);
+}
+
 uint8_t
 pixels8(uint32_t *pixels)
 {